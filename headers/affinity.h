@@ -0,0 +1,31 @@
+/*
+ * affinity.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "universe.h"
+
+/* On machines with several NUMA nodes, a page lives on the node of the thread
+ * that first wrote to it. Arrays walked by the atom loops are first written
+ * by the threads that will later walk them, with the same static split, for
+ * each thread to find its share of the atoms in local memory.
+ *
+ * Threads may also be pinned to the CPUs this process may run on, either
+ * packed onto the first node before moving on to the next (compact), or
+ * dealt to the nodes in turn (scatter). Pinned threads don't wander away from
+ * the memory they touched first.
+ */
+
+int   affinity_init(const uint64_t thread_nb, const uint8_t mode);
+void *affinity_alloc(const uint64_t nb, const size_t size);
+void  affinity_report(const universe_t *universe);
+
+#endif
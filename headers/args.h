@@ -10,6 +10,8 @@
 
 #include <stdint.h>
 
+#include "config.h"
+
 #define FLAG_NUMERICAL  "--numerical"
 #define FLAG_NUMERICAL_TETRA  "--numerical-tetra"
 #define FLAG_SUBSTRATE  "--substrate"
@@ -25,12 +27,64 @@
 #define FLAG_SOLVENT    "--solvent"
 #define FLAG_MODEL      "--model"
 #define FLAG_SRAND_SEED "--srand"
+#define FLAG_LATTICE    "--lattice"
+#define FLAG_SIZE       "--size"
+#define FLAG_REDUCEPOT_BATCH "--reduce_potential_batch"
+#define FLAG_FORMAT     "--format"
+#define FLAG_PRECISION  "--precision"
+#define FLAG_OUT_BUFFERS "--out_buffers"
+#define FLAG_SAVE_PREPARED "--save-prepared"
+#define FLAG_LOAD_PREPARED "--load-prepared"
+#define FLAG_CHECKPOINT  "--checkpoint"
+#define FLAG_CHECKPOINT_INTERVAL "--checkpoint_interval"
+#define FLAG_RESTART     "--restart"
+#define FLAG_GROUP       "--group"
+#define FLAG_SHM         "--shm"
+#define FLAG_THERMO      "--thermo"
+#define FLAG_CUTOFF      "--cutoff"
+#define FLAG_THREADS     "--threads"
+#define FLAG_PIN         "--pin"
+#define FLAG_ENSEMBLE    "--ensemble"
+#define FLAG_EXCHANGE    "--exchange"
+#define FLAG_TEMP_MAX    "--temp_max"
+#define FLAG_THERMOSTAT  "--thermostat"
+#define FLAG_REORDER     "--reorder"
+
+/* Values accepted by FLAG_LATTICE */
+#define LATTICE_RANDOM  "random"
+#define LATTICE_SC      "sc"
+#define LATTICE_FCC     "fcc"
+#define LATTICE_JITTER  "jitter"
+
+/* Values accepted by FLAG_PIN */
+#define PIN_COMPACT     "compact"
+#define PIN_SCATTER     "scatter"
+
+/* Values accepted by FLAG_FORMAT, and matching output file extensions */
+#define FORMAT_XYZ      "xyz"
+#define FORMAT_DCD      "dcd"
+#define FORMAT_STC      "stc"
+
+/* Selections accepted by FLAG_GROUP, followed by their argument */
+#define GROUP_MOLECULES "molecules:" /* Molecule range, as in 0-15 */
+#define GROUP_ELEMENT   "element:"   /* Element symbols, as in O,H */
+#define GROUP_INDEX     "index:"     /* File listing atom indices */
 
 /* t_args */
 #define ARGS_PATH_SUBSTRATE_DEFAULT    ((char*)NULL)      /* Path to the MDS substrate file */
 #define ARGS_PATH_OUT_DEFAULT          ((char*)NULL)      /* Path to the XYZ output file */
 #define ARGS_PATH_SOLVENT_DEFAULT      ((char*)NULL)      /* Path to the MDS solvent file */
 #define ARGS_PATH_MODEL_DEFAULT        ((char*)NULL)      /* Path to the MDM model file */
+#define ARGS_PATH_SAVE_PREPARED_DEFAULT ((char*)NULL)     /* Where to save the system once prepared */
+#define ARGS_PATH_LOAD_PREPARED_DEFAULT ((char*)NULL)     /* Prepared system to simulate right away */
+#define ARGS_PATH_CHECKPOINT_DEFAULT   ((char*)NULL)      /* Where to checkpoint the simulation, if anywhere */
+#define ARGS_CHECKPOINT_INTERVAL_DEFAULT ((uint64_t)1000) /* Iterations between two checkpoints */
+#define ARGS_RESTART_DEFAULT           ((uint8_t)0)       /* Resume from the checkpoint */
+#define ARGS_GROUP_NB_DEFAULT          ((uint64_t)0)      /* Output groups, on top of the main trajectory */
+#define ARGS_PATH_SHM_DEFAULT          ((char*)NULL)      /* Shared memory segment to publish the frames to, if any */
+#define ARGS_SHM_EVERY_DEFAULT         ((uint64_t)1)      /* Iterations between two published frames */
+#define ARGS_PATH_THERMO_DEFAULT       ((char*)NULL)      /* Where to log the thermodynamics, if anywhere */
+#define ARGS_THERMO_EVERY_DEFAULT      ((uint64_t)100)    /* Iterations between two lines of the log */
 #define ARGS_NUMERICAL_DEFAULT         MODE_ANALYTICAL    /* MODE_ANALYTICAL | MODE_NUMERICAL */
 #define ARGS_TIMESTEP_DEFAULT          ((double)1E0)      /* Timestep for the numerical integration (fs) */
 #define ARGS_MAX_TIME_DEFAULT          ((double)1E0)      /* Time until the simulation ends (ns) */
@@ -40,7 +94,22 @@
 #define ARGS_DENSITY_DEFAULT           ((double)1E0)      /* Density (g.cm-3) */
 #define ARGS_FRAMESKIP_DEFAULT         ((uint64_t)0)      /* Frames to skip (= render but not save) */
 #define ARGS_REDUCE_POTENTIAL_DEFAULT  ((double)1E1)      /* Pre-simulation target potential energy */
-#define ARGS_SRAND_SEED_DEFAULT        ((unsigned int)time(NULL))  /* Seed for SRAND */
+#define ARGS_SRAND_SEED_DEFAULT        ((unsigned int)time(NULL))  /* Key of the random number streams */
+#define ARGS_SRAND_GIVEN_DEFAULT       ((uint8_t)0)       /* The key was chosen on the command line */
+#define ARGS_LATTICE_DEFAULT           POPULATE_MODE_RANDOM  /* How substrate copies are placed */
+#define ARGS_FORMAT_DEFAULT            OUTPUT_FORMAT_AUTO /* Trajectory format, guessed from the extension */
+#define ARGS_PRECISION_DEFAULT         ((double)1E-2)     /* Precision of the compressed trajectory (Å) */
+#define ARGS_OUT_BUFFERS_DEFAULT       ((uint64_t)2)      /* Snapshots handed to the output thread, 0 for synchronous output */
+#define ARGS_REDUCEPOT_BATCH_DEFAULT   ((uint8_t)0)       /* Move every atom at once during gradient descent */
+#define ARGS_SIZE_DEFAULT              ((double)0.0)      /* Universe size (Å), 0 to derive it from the density */
+#define ARGS_CUTOFF_DEFAULT            ((double)0.0)      /* Non-bonded interaction cutoff (Å), 0 for none */
+#define ARGS_THREADS_DEFAULT           ((uint64_t)0)      /* Threads running the loops, 0 for the OpenMP default */
+#define ARGS_PIN_DEFAULT               PIN_MODE_NONE      /* How the threads are pinned to the CPUs */
+#define ARGS_ENSEMBLE_DEFAULT          ((uint64_t)1)      /* Independent replicas simulated side by side */
+#define ARGS_EXCHANGE_DEFAULT          ((uint64_t)0)      /* Iterations between two replica swaps, 0 for none */
+#define ARGS_TEMP_MAX_DEFAULT          ((double)0.0)      /* Temperature of the hottest replica (K) */
+#define ARGS_THERMOSTAT_DEFAULT        ((double)0.0)      /* Coupling time of the thermostat (fs), 0 for none */
+#define ARGS_REORDER_DEFAULT           ((uint64_t)0)      /* Iterations between two sorts of the atoms, 0 for none */
 
 typedef struct args_s args_t;
 struct args_s
@@ -50,22 +119,51 @@ struct args_s
   char *path_out;            /* Path to output file */
   char *path_solvent;        /* Path to solvent file */
   char *path_model;          /* Path to the model file */
+  char *path_save_prepared;  /* Path to the prepared system to write */
+  char *path_load_prepared;  /* Path to the prepared system to read */
+  char *path_checkpoint;     /* Path to the checkpoint file */
+  uint64_t checkpoint_interval; /* (unitless) Iterations between two checkpoints */
+  uint8_t restart;           /* (unitless) Resume from the checkpoint */
+  uint64_t group_nb;         /* (unitless) Output groups */
+  char *group_selection[GROUP_MAX]; /* Atoms written by each group */
+  uint64_t group_every[GROUP_MAX];  /* (unitless) Iterations between two frames of each group */
+  char *group_path[GROUP_MAX];      /* Trajectory of each group */
+  char *path_shm;            /* Name of the shared memory segment */
+  uint64_t shm_every;        /* (unitless) Iterations between two published frames */
+  char *path_thermo;         /* Path to the thermodynamics log */
+  uint64_t thermo_every;     /* (unitless) Iterations between two lines of the log */
   double timestep;           /* (s)        Simulation timestep */
   double max_time;           /* (s)        Simulation duration */
   double reduce_potential;   /* (pJ)       Maximum potential energy before simulating */
   uint64_t frameskip;        /* (unitless) Frameskip */
   uint8_t numerical;         /* (unitless) Force computation mode */
-  uint64_t srand_seed;        /* (unitless) Seed to give to srand for setting RNG seed */
+  uint64_t srand_seed;        /* (unitless) Key of the random number streams */
+  uint8_t srand_given;       /* (unitless) The key was chosen on the command line */
+  uint8_t lattice;           /* (unitless) Placement mode of the substrate copies */
+  uint8_t reducepot_batch;   /* (unitless) Batched gradient descent */
+  uint8_t format;            /* (unitless) Trajectory format (OUTPUT_FORMAT_*) */
+  double precision;          /* (Å)        Precision of the compressed trajectory */
+  uint64_t out_buffers;      /* (unitless) Snapshot buffers of the output thread */
+  double cutoff;             /* (m)        Non-bonded pairs further apart are ignored, 0 for none */
+  uint64_t threads;          /* (unitless) Threads running the loops, 0 for the OpenMP default */
+  uint8_t pin;               /* (unitless) Thread pinning (PIN_MODE_*) */
+  uint64_t ensemble;         /* (unitless) Replicas, each with its own seed and trajectory */
+  uint64_t exchange;         /* (unitless) Iterations between two replica swaps, 0 for none */
+  double temp_max;           /* (K)        Temperature of the hottest replica */
+  double thermostat;         /* (s)        Coupling time of the thermostat, 0 for none */
+  uint64_t reorder;          /* (unitless) Iterations between two sorts of the atoms, 0 for none */
 
   /* Chemical properties, thermodynamics */
   uint64_t copies;           /* (unitless) Substrate copies to be simulated */
   double temperature;        /* (K)        Universe thermodynamic temperature */
   double pressure;           /* (hPa)      Universe pressure */
   double density;            /* (g.cm-3)   Universe density */
+  double size;               /* (m)        Universe size, 0 to derive it from the substrate and density */
 };
 
 args_t *args_init(args_t *args);
 args_t *args_check(args_t *args);
 args_t *args_parse(args_t *args, int argc, char **argv);
+uint8_t args_format(const char *path);
 
 #endif
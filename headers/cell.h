@@ -0,0 +1,56 @@
+/*
+ * cell.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef CELL_H
+#define CELL_H
+
+#include <stdint.h>
+
+#include "universe.h"
+
+/* With a cutoff, the box is cut into cubic cells at least as wide as the
+ * cutoff. An atom then only interacts with the atoms of its own cell and of
+ * the 26 cells around it, instead of the whole universe.
+ *
+ * The atoms are binned again before every force pass, cell after cell and in
+ * index order within a cell. Each cell's atoms are updated by a single task,
+ * which only writes to them: the forces don't depend on how the tasks are
+ * spread over the threads.
+ */
+
+#define CELL_NEIGHBOUR_NB 27 /* A cell and the ones around it */
+
+/* cell_t */
+#define CELL_SIDE_NB_DEFAULT    ((uint64_t)  0)
+#define CELL_CELL_NB_DEFAULT    ((uint64_t)  0)
+#define CELL_SIDE_DEFAULT       ((double)    0.0)
+#define CELL_FIRST_DEFAULT      ((uint64_t*) NULL)
+#define CELL_ATOM_DEFAULT       ((uint64_t*) NULL)
+#define CELL_OF_DEFAULT         ((uint64_t*) NULL)
+#define CELL_NEIGHBOUR_DEFAULT  ((uint64_t*) NULL)
+#define CELL_PAIR_NB_DEFAULT    ((uint64_t*) NULL)
+#define CELL_PASS_NB_DEFAULT    ((uint64_t)  0)
+
+struct cell_s
+{
+  uint64_t side_nb;    /* Cells along each axis */
+  uint64_t cell_nb;    /* Cells in the box */
+  double side;         /* (m) Width of a cell */
+  uint64_t *first;     /* Where each cell starts in atom, cell_nb+1 entries */
+  uint64_t *atom;      /* Binned atoms, cell after cell */
+  uint64_t *of;        /* Cell of each atom */
+  uint64_t *neighbour; /* The CELL_NEIGHBOUR_NB cells around each cell */
+  uint64_t *pair_nb;   /* Pairs computed for each cell's atoms during the last pass */
+  uint64_t pass_nb;    /* Force passes so far */
+};
+
+universe_t *cell_init(universe_t *universe);
+universe_t *cell_bin(universe_t *universe);
+universe_t *cell_update_frc(universe_t *universe, const uint64_t cell_id);
+void        cell_clean(universe_t *universe);
+
+#endif
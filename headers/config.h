@@ -54,8 +54,122 @@
  * through the universe. This generation mechanism can be tuned here.
  *  UNIVERSE_POPULATE_MIN_DIST: Fraction of the universe size. Particles cannot
  *                              be inserted this close or closer from the origin
+ *  UNIVERSE_POPULATE_JITTER: Fraction of the lattice spacing. In jittered mode,
+ *                            copies are moved at most this far from their site
+ *  UNIVERSE_VELOCITY_BLOCK_NB: Atoms whose initial directions are drawn in
+ *                              one gaussian batch
  */
 #define UNIVERSE_POPULATE_MIN_DIST ((double)4E-1)
+#define UNIVERSE_POPULATE_JITTER   ((double)2E-1)
+#define UNIVERSE_VELOCITY_BLOCK_NB ((size_t)256)
+
+/* PLACEMENT MODE
+ *
+ * Copies of the substrate can either be inserted at random locations, or on
+ * the sites of a lattice sized to the universe. Lattice starts are much closer
+ * to equilibrium at liquid densities, and get randomly oriented copies.
+ */
+#define POPULATE_MODE_RANDOM     0
+#define POPULATE_MODE_SC         1
+#define POPULATE_MODE_FCC        2
+#define POPULATE_MODE_JITTER     3
+#define POPULATE_MODE_INVALID    0xFF
+
+/* THREAD PINNING
+ *
+ * Threads can be left where the system puts them, packed onto the CPUs of
+ * one NUMA node before moving on to the next, or dealt to the nodes in turn.
+ */
+#define PIN_MODE_NONE            0
+#define PIN_MODE_COMPACT         1
+#define PIN_MODE_SCATTER         2
+#define PIN_MODE_INVALID         0xFF
+
+/* SOLVATION
+ *
+ * When a non-empty solvent is given, the space left by the substrate copies
+ * is filled with solvent molecules until the universe reaches its density.
+ *  UNIVERSE_SOLVATE_CLASH_DIST: Solvent molecules with an atom closer than
+ *                               this to another atom are not inserted
+ */
+#define UNIVERSE_SOLVATE_CLASH_DIST ((double)1.5E-10)
+
+/* OUTPUT FORMAT
+ *
+ * The trajectory is either written as text (XYZ), as binary single
+ * precision coordinates (DCD) which are much cheaper to produce and smaller,
+ * or as quantized and bit-packed coordinates (STC) which are smaller still.
+ * Unless a format is forced, it is picked from the output file extension.
+ */
+#define OUTPUT_FORMAT_AUTO       0
+#define OUTPUT_FORMAT_XYZ        1
+#define OUTPUT_FORMAT_DCD        2
+#define OUTPUT_FORMAT_STC        3
+#define OUTPUT_FORMAT_INVALID    0xFF
+
+/* OUTPUT GROUPS
+ *
+ * Subsets of the atoms can be written to trajectories of their own, each at
+ * its own pace, alongside the main trajectory.
+ *  GROUP_MAX: How many groups can be written at once
+ */
+#define GROUP_MAX 16
+
+/* LIVE STREAM
+ *
+ * Frames published to shared memory are kept in a ring, a consumer falling
+ * further behind than this loses the older frames.
+ *  STREAM_SLOT_NB: Frames held by the shared memory segment
+ */
+#define STREAM_SLOT_NB 16
+
+/* DOMAIN DECOMPOSITION
+ *
+ * Built with MPI, the box is cut into slabs along x, one per process. Each
+ * process integrates the atoms in its slab and receives copies of the atoms
+ * lying within the cutoff of it (the halo). Bonded interactions reach past the
+ * cutoff, the halo is widened to still hold every atom two bonds away.
+ *  DOMAIN_HALO_MARGIN: Width of the halo past the cutoff (m)
+ */
+#define DOMAIN_HALO_MARGIN ((double)5E-10)
+
+/* CELL GRID
+ *
+ * With a cutoff, the box is cut into cells at least as wide as it, and the
+ * forces of each cell's atoms are a task for the work-stealing scheduler.
+ * A box too small for this many cells along an axis keeps the all-pairs loop.
+ *  CELL_SIDE_MIN: Fewest cells along an axis for the grid to be used
+ */
+#define CELL_SIDE_MIN 3
+
+/* ATOM REORDERING
+ *
+ * With --reorder, the atoms are sorted along a Morton curve through the cells
+ * of the grid. Without a grid, the box is cut into finer cells for the sort.
+ *  REORDER_SIDE_NB: Cells along an axis of the box, without a grid
+ *  REORDER_AXIS_BITS: Bits of each axis in a key, three of them fit 64 bits
+ */
+#define REORDER_SIDE_NB ((uint64_t)1024)
+#define REORDER_AXIS_BITS 21
+
+/* TILED ALL-PAIRS
+ *
+ * Without a cell grid, systems of up to TILE_ATOM_MAX atoms have their
+ * non-bonded forces computed tile against tile, each pair of atoms once.
+ * A tile of TILE_ATOM_NB atoms takes 10 doubles per atom, 20 kB, for the
+ * second tile of a pair to stay in a 32 kB L1 cache.
+ *  TILE_ATOM_NB: Atoms in a tile
+ *  TILE_ATOM_MAX: Most atoms for the tiles to be used
+ */
+#define TILE_ATOM_NB ((uint64_t)256)
+#define TILE_ATOM_MAX ((uint64_t)4096)
+
+/* XYZ OUTPUT
+ *
+ * XYZ frames are formatted in parallel, each thread taking whole chunks.
+ *  XYZ_CHUNK_ATOMS: Atoms formatted by a thread in one go
+ */
+#define XYZ_CHUNK_ATOMS ((size_t)1024)
 
 /* SIMULATION MODE
  *
@@ -94,17 +208,37 @@
  * Before starting a simulation, SENPAI will use a two-stage algorithm to reduce
  * the potential energy of the system.
  *
+ * STAGE 0: RIGID (molecule translation/rotation)
+ * Molecules are loaded with a sane geometry, so clashes between molecules are
+ * first resolved by moving each molecule as a whole: a random translation and
+ * a random rotation about its centroid, discarded should the intermolecular
+ * potential of the molecule increase. The stage ends when a cycle doesn't
+ * yield significant results anymore.
+ *   UNIVERSE_REDUCEPOT_RIGID_STEP: max translation of a molecule
+ *   UNIVERSE_REDUCEPOT_RIGID_ANGLE: max rotation of a molecule (rad)
+ *   UNIVERSE_REDUCEPOT_RIGID_ATTEMPTS: moves tried per molecule per cycle
+ *   UNIVERSE_REDUCEPOT_RIGID_MAX_CYCLES: max number of cycles
+ *
  * STAGE 1: COARSE (brute force, wiggling)
  * The first stage consists of iterating through the particles and relocating
  * them to random offsets, discarding the relocation should the total potential
- * increase. The magnitude of the relocation offset gets lowered after a set
- * number of attempts. The first stage ends when the potential energy has been
- * halved.
+ * increase. Each atom has its own relocation magnitude, which is adapted after
+ * every cycle so that about UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE of its
+ * moves get accepted. Atoms that keep failing to lower the potential are
+ * frozen and left alone for the rest of the stage. The first stage ends when
+ * the potential energy has been halved, or when every atom is frozen.
  *   UNIVERSE_REDUCEPOT_COARSE_STEP_MAGNITUDE: start magnitude of the relocation
- *   UNIVERSE_REDUCEPOT_COARSE_MAX_ATTEMPTS: Max attempts before lowering the
- *                                           magnitude.
- *   UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER: Reduce the magnitude by
- *                                                   multiplying it.
+ *   UNIVERSE_REDUCEPOT_COARSE_MAX_ATTEMPTS: Max attempts per atom and per cycle
+ *   UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER: Smallest factor the
+ *                                                   magnitude is multiplied by
+ *                                                   between two cycles.
+ *   UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_GROWTH: Largest factor the magnitude is
+ *                                               multiplied by between two cycles
+ *   UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE: Acceptance ratio to aim for
+ *   UNIVERSE_REDUCEPOT_COARSE_FREEZE_CYCLES: Atoms are frozen after that many
+ *                                            cycles without an accepted move
+ *   UNIVERSE_REDUCEPOT_COARSE_MIN_MAGNITUDE: Atoms are frozen if their
+ *                                            magnitude gets smaller than this
  *
  * STAGE 2: FINE (fine)
  * The second stage consists of tuning the coordinates of each atom so as to
@@ -112,17 +246,35 @@
  * analytical gradient is easily computable from the force (F = -nabla*U).
  *   UNIVERSE_REDUCEPOT_FINE_MAX_STEP: Maximum step an atom can take
  *   UNIVERSE_REDUCEPOT_FINE_TIMESTEP: Used to compute the step (dx=(dt^2)/2)
+ * In batched mode, every atom takes its step at once from a single force
+ * pass, and the whole sweep is undone if the potential rose.
+ *   UNIVERSE_REDUCEPOT_FINE_BACKOFF: Factor the global step scale is
+ *                                    multiplied by after a rejected sweep
+ *   UNIVERSE_REDUCEPOT_FINE_GROWTH: Factor the global step scale is multiplied
+ *                                   by after an accepted sweep (capped at 1)
+ *   UNIVERSE_REDUCEPOT_FINE_MIN_SCALE: Sweeps are given up below this scale
  *   UNIVERSE_REDUCEPOT_END_WIGGLING: Percentage progress after which we
  *                                    stop wiggling and use grad descent
  *   UNIVERSE_REDUCEPOT_CUTOFF: If a step decreases the potential energy
  *                              by less than this value, potential reduction
  *                              stops and the simulation starts. (J)
  */
+#define UNIVERSE_REDUCEPOT_RIGID_STEP                  ((double)1E-10)
+#define UNIVERSE_REDUCEPOT_RIGID_ANGLE                 ((double)5E-1)
+#define UNIVERSE_REDUCEPOT_RIGID_ATTEMPTS              ((size_t)4)
+#define UNIVERSE_REDUCEPOT_RIGID_MAX_CYCLES            ((size_t)1E2)
 #define UNIVERSE_REDUCEPOT_COARSE_STEP_MAGNITUDE       ((double)1E-9)
-#define UNIVERSE_REDUCEPOT_COARSE_MAX_ATTEMPTS         ((size_t)1E2)
+#define UNIVERSE_REDUCEPOT_COARSE_MAX_ATTEMPTS         ((size_t)4)
 #define UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER ((double)1E-1)
+#define UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_GROWTH     ((double)2E0)
+#define UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE    ((double)3E-1)
+#define UNIVERSE_REDUCEPOT_COARSE_FREEZE_CYCLES        ((uint64_t)3)
+#define UNIVERSE_REDUCEPOT_COARSE_MIN_MAGNITUDE        ((double)1E-14)
 #define UNIVERSE_REDUCEPOT_FINE_MAX_STEP               ((double)1E-10)
 #define UNIVERSE_REDUCEPOT_FINE_TIMESTEP               ((double)1E-15)
+#define UNIVERSE_REDUCEPOT_FINE_BACKOFF                ((double)5E-1)
+#define UNIVERSE_REDUCEPOT_FINE_GROWTH                 ((double)1.2E0)
+#define UNIVERSE_REDUCEPOT_FINE_MIN_SCALE              ((double)1E-6)
 #define UNIVERSE_REDUCEPOT_END_WIGGLING                ((double)0.5)
 #define UNIVERSE_REDUCEPOT_CUTOFF                      ((double)1E-6 * 1E-12)
 
@@ -0,0 +1,35 @@
+/*
+ * dcd.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef DCD_H
+#define DCD_H
+
+#include "universe.h"
+#include "args.h"
+
+/* DCD is the binary trajectory format of CHARMM, also written by NAMD and read
+ * directly by VMD. Every record is framed by its length in bytes, coordinates
+ * are stored as single precision Ångströms, one axis after the other, and
+ * each frame is preceded by the unit cell.
+ *
+ * The header is written once the universe is populated, the number of frames
+ * it announces is patched in when the output is closed.
+ */
+
+#define DCD_MAGIC           "CORD"
+#define DCD_CHARMM_VERSION  ((int32_t)24)
+#define DCD_TITLE_LEN       80
+#define DCD_TITLE           "SENPAI trajectory"
+#define DCD_AKMA            ((double)4.888821E-14) /* (s) CHARMM time unit */
+#define DCD_OFFSET_NSET     ((long)8)              /* Where the frame count lives */
+#define DCD_OFFSET_NSTEP    ((long)20)             /* Where the step count lives */
+
+universe_t *dcd_header(universe_t *universe, const args_t *args);
+universe_t *dcd_frame(universe_t *universe);
+universe_t *dcd_close(universe_t *universe);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * domain.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef DOMAIN_H
+#define DOMAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "universe.h"
+
+/* Built with MPI (make MPI=1) and run on several processes, the box is cut
+ * into as many slabs along x. Every process keeps the whole atom array, but
+ * only integrates the atoms in its slab, which it owns. After the positions
+ * are updated, atoms that left a slab are handed over to their new owner with
+ * their whole state, then every process sends the positions of its atoms
+ * lying within the halo width of another slab to that slab's owner. The other
+ * atoms are out of reach and left alone: their entries are stale.
+ *
+ * The first process writes the trajectory, the owned positions are gathered
+ * to it whenever a frame is due.
+ */
+
+/* State of an atom, as seen by a process */
+#define DOMAIN_ABSENT  ((uint8_t)0) /* Out of reach */
+#define DOMAIN_HALO    ((uint8_t)1) /* Copy of an atom owned by another process */
+#define DOMAIN_OWNED   ((uint8_t)2) /* Integrated by this process */
+
+/* Whether the process can't see an atom, or has to integrate it */
+#define DOMAIN_IS_ABSENT(universe, atom_id) ((universe)->domain != NULL && (universe)->domain->state[(atom_id)] == DOMAIN_ABSENT)
+#define DOMAIN_IS_OWNED(universe, atom_id)  ((universe)->domain == NULL || (universe)->domain->state[(atom_id)] == DOMAIN_OWNED)
+
+/* domain_t */
+#define DOMAIN_RANK_DEFAULT         ((int)      0)
+#define DOMAIN_RANK_NB_DEFAULT      ((int)      1)
+#define DOMAIN_STATE_DEFAULT        ((uint8_t*) NULL)
+#define DOMAIN_WIDTH_DEFAULT        ((double)   0.0)
+#define DOMAIN_HALO_DEFAULT         ((double)   0.0)
+#define DOMAIN_SEND_NB_DEFAULT      ((int*)     NULL)
+#define DOMAIN_SEND_OFFSET_DEFAULT  ((int*)     NULL)
+#define DOMAIN_RECV_NB_DEFAULT      ((int*)     NULL)
+#define DOMAIN_RECV_OFFSET_DEFAULT  ((int*)     NULL)
+#define DOMAIN_SEND_DEFAULT         ((uint8_t*) NULL)
+#define DOMAIN_SEND_LEN_DEFAULT     ((size_t)   0)
+#define DOMAIN_RECV_DEFAULT         ((uint8_t*) NULL)
+#define DOMAIN_RECV_LEN_DEFAULT     ((size_t)   0)
+
+struct domain_s
+{
+  int rank;            /* This process */
+  int rank_nb;         /* How many there are, and slabs */
+  uint8_t *state;      /* DOMAIN_* of each atom */
+  double width;        /* (m) Width of a slab */
+  double halo;         /* (m) Reach of a slab into its neighbours */
+  int *send_nb;        /* Bytes sent to each process */
+  int *send_offset;    /* Where they start in the send buffer */
+  int *recv_nb;        /* Bytes received from each process */
+  int *recv_offset;    /* Where they start in the receive buffer */
+  uint8_t *send;       /* Send buffer */
+  size_t send_len;     /* Its length */
+  uint8_t *recv;       /* Receive buffer */
+  size_t recv_len;     /* Its length */
+};
+
+/* The MPI runtime, around the whole program */
+int  domain_start(int *argc, char ***argv);
+int  domain_stop(const int status);
+int  domain_rank(void);
+int  domain_rank_nb(void);
+
+/* The decomposition, during the simulation */
+universe_t *domain_init(universe_t *universe);
+universe_t *domain_exchange(universe_t *universe);
+universe_t *domain_gather(universe_t *universe);
+double      domain_sum(const universe_t *universe, const double value);
+void        domain_clean(universe_t *universe);
+
+#endif
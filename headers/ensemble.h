@@ -0,0 +1,37 @@
+/*
+ * ensemble.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <stdint.h>
+
+#include "args.h"
+
+/* Runs independent replicas of the same system side by side. The input files
+ * are parsed once, the replicas borrowing the model and the templates, then
+ * each populates, solvates, reduces and simulates a universe of its own.
+ * Replica r draws its random numbers from seed + r, and writes its trajectory
+ * next to the output path, as traj.<r>.xyz for traj.xyz.
+ *
+ * With --exchange, the replicas are rather spread over a temperature ladder,
+ * from --temp to --temp_max geometrically, and all start from the same
+ * system. Every so many iterations, neighbouring replicas try to swap their
+ * systems (Metropolis, on the potential energies), the even pairs then the
+ * odd pairs in turn, for the cold ones to borrow the hot ones' escapes from
+ * local minima. Each replica holds its temperature with its own stochastic
+ * thermostat (Bussi et al., 2007), drawing from its own seed: the swaps are
+ * only fair between canonical ensembles, which Berendsen's rescaling is not.
+ * A replica's trajectory stays at its temperature.
+ *
+ * As many replicas run at once as there are threads, the threads left being
+ * shared between them for their own loops.
+ */
+
+int ensemble_run(const args_t *args);
+
+#endif
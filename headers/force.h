@@ -11,10 +11,15 @@
 #include "universe.h"
 #include "vec3.h"
 
-universe_t *force_bond(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2);
-universe_t *force_electrostatic(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2);
-universe_t *force_lennardjones(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2);
-universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2);
+/* The pair forces take a1 and a2 to be at pos_1 and pos_2, a2's position
+ * being its periodic image closest to a1. The universe's atoms aren't moved.
+ */
+universe_t *force_bond(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
+universe_t *force_electrostatic(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
+universe_t *force_lennardjones(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
+universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
 universe_t *force_total(vec3_t *frc, universe_t *universe, const uint64_t atom_id);
+universe_t *force_bonded(vec3_t *frc, universe_t *universe, const uint64_t atom_id);
+universe_t *force_total_cell(vec3_t *frc, universe_t *universe, const uint64_t atom_id, uint64_t *pair_nb);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+ * frames.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "universe.h"
+#include "args.h"
+
+/* Every trajectory comes with a frame index, written next to it with an extra
+ * .idx extension. It starts with a 16 bytes header:
+ *
+ *   "SIDX" | uint32 version | uint32 OUTPUT_FORMAT_* | uint32 zero
+ *
+ * followed by one fixed size entry per frame, giving the offset of the frame
+ * in the trajectory and the iteration it was taken at. Finding frame k is a
+ * matter of reading entry k, and a frame ends where the next one starts (or
+ * at the end of the trajectory, for the last one). Whatever precedes the
+ * first frame is the trajectory's header.
+ */
+
+#define FRAMES_MAGIC       "SIDX"
+#define FRAMES_VERSION     ((uint32_t)1)
+#define FRAMES_SUFFIX      ".idx"
+#define FRAMES_HEADER_LEN  ((size_t)16)
+#define FRAMES_COPY_LEN    ((size_t)65536) /* Bytes copied at once when extracting frames */
+
+typedef struct frames_entry_s frames_entry_t;
+struct frames_entry_s
+{
+  uint64_t offset;     /* Where the frame starts in the trajectory */
+  uint64_t iteration;  /* When it was taken */
+};
+
+/* frames_t */
+#define FRAMES_FILE_DEFAULT       ((FILE*)                 NULL)
+#define FRAMES_ENTRY_DEFAULT      ((const frames_entry_t*) NULL)
+#define FRAMES_MAP_DEFAULT        ((const char*)           NULL)
+#define FRAMES_MAP_LEN_DEFAULT    ((size_t)                0)
+#define FRAMES_FRAME_NB_DEFAULT   ((uint64_t)              0)
+#define FRAMES_FORMAT_DEFAULT     ((uint8_t)               0)
+#define FRAMES_FILE_LEN_DEFAULT   ((uint64_t)              0)
+
+/* An indexed trajectory, opened for reading */
+typedef struct frames_s frames_t;
+struct frames_s
+{
+  FILE *file;                   /* The trajectory */
+  const frames_entry_t *entry;  /* The frame entries, in the mapped index */
+  const char *map;              /* The mapped index */
+  size_t map_len;               /* Its length */
+  uint64_t frame_nb;            /* Complete frames in the trajectory */
+  uint8_t format;               /* OUTPUT_FORMAT_* */
+  uint64_t file_len;            /* Length of the trajectory */
+};
+
+/* Writing, alongside the trajectory */
+universe_t *frames_open(universe_t *universe, const args_t *args);
+universe_t *frames_append(universe_t *universe);
+
+/* Reading */
+frames_t   *frames_init(frames_t *frames, const char *path);
+void        frames_clean(frames_t *frames);
+frames_t   *frames_span(frames_t *frames, const uint64_t frame, uint64_t *offset, uint64_t *len);
+frames_t   *frames_copy(frames_t *frames, FILE *out, const uint64_t offset, const uint64_t len);
+
+#endif
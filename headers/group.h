@@ -0,0 +1,46 @@
+/*
+ * group.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <stdint.h>
+
+#include "universe.h"
+#include "args.h"
+
+/* An output group is a subset of the atoms written to a trajectory of its own,
+ * every so many iterations. Atoms are selected by molecule range (substrate
+ * copies first, then the solvent molecules), by element symbol, or listed by
+ * index in a file (0 based, separated by blanks or newlines).
+ *
+ * Each group writes through its own view of the universe, whose atoms are the
+ * selected ones, gathered before every frame. The existing output formats and
+ * the frame index are thus used as they are, the format following the
+ * group's file extension.
+ */
+
+/* group_t */
+#define GROUP_ATOM_DEFAULT     ((uint64_t*) NULL)
+#define GROUP_ATOM_NB_DEFAULT  ((uint64_t)  0)
+#define GROUP_EVERY_DEFAULT    ((uint64_t)  1)
+
+struct group_s
+{
+  uint64_t *atom;      /* Indices of the selected atoms */
+  uint64_t atom_nb;    /* How many were selected */
+  uint64_t every;      /* Iterations between two frames */
+  universe_t view;     /* Output state of the group */
+};
+
+universe_t *group_init(universe_t *universe, const args_t *args, const uint64_t group_id);
+universe_t *group_printstate(universe_t *universe);
+universe_t *group_flush(universe_t *universe);
+int         group_due(const universe_t *universe);
+void        group_clean(group_t *group);
+
+#endif
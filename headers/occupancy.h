@@ -0,0 +1,57 @@
+/*
+ * occupancy.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "vec3.h"
+
+/* An occupancy grid records where atoms were placed in the periodic universe,
+ * so that "is there anything within d of this point?" is answered by looking
+ * at the 27 cells around the point instead of at every atom.
+ *
+ * Cells are hashed into a fixed number of buckets: the memory footprint
+ * follows the number of atoms rather than the volume of the universe.
+ */
+
+/* occupancy_t */
+#define OCCUPANCY_SIZE_DEFAULT       ((double)    0.0)
+#define OCCUPANCY_CELL_SIZE_DEFAULT  ((double)    0.0)
+#define OCCUPANCY_CELL_NB_DEFAULT    ((uint64_t)  0)
+#define OCCUPANCY_BUCKET_NB_DEFAULT  ((uint64_t)  0)
+#define OCCUPANCY_ENTRY_NB_DEFAULT   ((uint64_t)  0)
+#define OCCUPANCY_ENTRY_MAX_DEFAULT  ((uint64_t)  0)
+#define OCCUPANCY_HEAD_DEFAULT       ((int64_t*)  NULL)
+#define OCCUPANCY_NEXT_DEFAULT       ((int64_t*)  NULL)
+#define OCCUPANCY_CELL_DEFAULT       ((uint64_t*) NULL)
+#define OCCUPANCY_POS_DEFAULT        ((vec3_t*)   NULL)
+
+typedef struct occupancy_s occupancy_t;
+struct occupancy_s
+{
+  double size;         /* (m) Side of the periodic universe */
+  double cell_size;    /* (m) Side of a cell */
+  uint64_t cell_nb;    /* Cells per side */
+  uint64_t bucket_nb;  /* Number of hash buckets (power of two) */
+  uint64_t entry_nb;   /* Number of recorded points */
+  uint64_t entry_max;  /* Number of points the grid can hold */
+  int64_t *head;       /* First entry of each bucket (-1 if empty) */
+  int64_t *next;       /* Next entry in the same bucket (-1 if last) */
+  uint64_t *cell;      /* Linear cell index of each entry */
+  vec3_t *pos;         /* Position of each entry */
+};
+
+occupancy_t *occupancy_init(occupancy_t *occupancy, const double size, const double cell_size, const uint64_t entry_max);
+void         occupancy_clean(occupancy_t *occupancy);
+void         occupancy_reset(occupancy_t *occupancy);
+occupancy_t *occupancy_insert(occupancy_t *occupancy, const vec3_t *pos);
+int          occupancy_clash(const occupancy_t *occupancy, const vec3_t *pos, const double dist);
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * parse.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* MDM and MDS files are memory-mapped and parsed in place, in a single pass.
+ * The parser keeps track of the current line and column, so that malformed
+ * input can be reported precisely. The buffer is never modified and doesn't
+ * need to be NUL terminated.
+ *
+ * Numbers are read by a hand-rolled strtod: the mantissa and exponent are
+ * accumulated as integers, and converted exactly when both are small enough
+ * (which covers every value found in our files), strtod is used otherwise.
+ */
+
+#define PARSER_DIGITS_MAX   19  /* Mantissa digits that fit in a uint64_t */
+#define PARSER_EXACT_POW10  22  /* Largest power of ten that is an exact double */
+#define PARSER_TOKEN_MAX    64  /* Longest number handed over to strtod */
+
+/* parser_t */
+#define PARSER_BUF_DEFAULT        ((const char*) NULL)
+#define PARSER_LEN_DEFAULT        ((size_t)      0)
+#define PARSER_POS_DEFAULT        ((size_t)      0)
+#define PARSER_LINE_DEFAULT       ((uint64_t)    1)
+#define PARSER_LINE_START_DEFAULT ((size_t)      0)
+#define PARSER_TOKEN_DEFAULT      ((size_t)      0)
+#define PARSER_PATH_DEFAULT       ((const char*) NULL)
+
+typedef struct parser_s parser_t;
+struct parser_s
+{
+  const char *buf;    /* The mapped file */
+  size_t len;         /* Its length */
+  size_t pos;         /* Where we're at */
+  uint64_t line;      /* Current line, starting at 1 */
+  size_t line_start;  /* Offset of the current line */
+  size_t token;       /* Offset of the token being read, for error messages */
+  const char *path;   /* File name, for error messages */
+};
+
+const char *parser_map(FILE *file, size_t *len);
+void        parser_unmap(const char *buf, const size_t len);
+size_t      parser_strtod(const char *str, const size_t len, double *x);
+
+parser_t   *parser_init(parser_t *parser, const char *buf, const size_t len, const char *path);
+parser_t   *parser_text(parser_t *parser, char **str);
+parser_t   *parser_word(parser_t *parser, char **str);
+parser_t   *parser_double(parser_t *parser, double *x);
+parser_t   *parser_uint(parser_t *parser, uint64_t *x);
+parser_t   *parser_next_line(parser_t *parser);
+int         parser_eof(parser_t *parser);
+parser_t   *parser_error(parser_t *parser, const char *what);
+
+#endif
@@ -11,11 +11,24 @@
 #include <stdint.h>
 
 #include "universe.h"
+#include "vec3.h"
 
-universe_t *potential_bond(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2);
-universe_t *potential_electrostatic(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2);
-universe_t *potential_lennardjones(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2);
-universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2);
+/* The terms of an atom's potential energy, as split by potential_terms */
+#define POTENTIAL_TERM_BOND          0
+#define POTENTIAL_TERM_ANGLE         1
+#define POTENTIAL_TERM_ELECTROSTATIC 2
+#define POTENTIAL_TERM_LENNARDJONES  3
+#define POTENTIAL_TERM_NB            4
+
+/* Same convention as the pair forces, see force.h */
+universe_t *potential_bond(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
+universe_t *potential_electrostatic(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
+universe_t *potential_lennardjones(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
+universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2);
 universe_t *potential_total(double *pot, universe_t *universe, const uint64_t atom_id);
+universe_t *potential_total_at(double *pot, universe_t *universe, const uint64_t atom_id, const vec3_t *pos);
+universe_t *potential_terms(double term[POTENTIAL_TERM_NB], universe_t *universe, const uint64_t atom_id);
+universe_t *potential_terms_cell(double term[POTENTIAL_TERM_NB], universe_t *universe, const uint64_t atom_id);
+universe_t *potential_intermolecular(double *pot, universe_t *universe, const uint64_t first, const uint64_t nb);
 
 #endif
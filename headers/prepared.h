@@ -0,0 +1,107 @@
+/*
+ * prepared.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef PREPARED_H
+#define PREPARED_H
+
+#include <stdint.h>
+
+#include "universe.h"
+#include "args.h"
+#include "vec3.h"
+
+/* A prepared system is the universe as it stands once populated, solvated and
+ * minimized, so that production runs can start simulating right away.
+ *
+ * The file is made of 8 bytes aligned blocks, in the host's byte order:
+ *
+ *   prepared_header_t
+ *   9 strings (model, substrate and solvent metadata)
+ *   The model entries, each followed by its name and symbol
+ *   The substrate, solvent and universe atoms, each as
+ *     atom_nb prepared_atom_t, then the bonded atom IDs, then the strengths
+ *
+ * Strings are stored as their uint64_t length followed by the characters.
+ * Every block being aligned, the file can be used in place once mapped.
+ * A file written on a machine of the other endianness fails the version check.
+ *
+ * Checkpoints are prepared systems taken during the simulation. They also
+ * record where the trajectory and the thermodynamics log stood, so that a
+ * restart can cut them back to the last checkpointed frame and line and
+ * append to them. They're written next to their
+ * final path first, and renamed over it once complete, so a job killed while
+ * checkpointing still leaves the previous checkpoint intact.
+ */
+
+#define PREPARED_TMP_SUFFIX ".tmp"
+
+#define PREPARED_MAGIC    "SNPR"
+#define PREPARED_VERSION  ((uint32_t)3)
+#define PREPARED_ALIGN    ((size_t)8)
+
+typedef struct prepared_header_s prepared_header_t;
+struct prepared_header_s
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t srand_seed;
+  uint64_t entry_nb;
+  uint64_t substrate_atom_nb;
+  uint64_t substrate_bond_nb;
+  uint64_t solvent_atom_nb;
+  uint64_t solvent_bond_nb;
+  uint64_t copy_nb;
+  uint64_t solvent_copy_nb;
+  uint64_t atom_nb;
+  uint64_t iterations;
+  uint64_t populate_mode;
+  uint64_t output_format;
+  uint64_t frame_nb;
+  uint64_t frameskip_left;
+  uint64_t output_offset;
+  uint64_t thermo_offset;
+  uint64_t thermo_line_nb;
+  double output_precision;
+  double thermo_energy_0;
+  double size;
+  double time;
+  double temperature;
+  double pressure;
+};
+
+typedef struct prepared_entry_s prepared_entry_t;
+struct prepared_entry_s
+{
+  uint64_t id;
+  double mass;
+  double radius_covalent;
+  double radius_vdw;
+  double bond_angle;
+  double lj_epsilon;
+  double lj_sigma;
+};
+
+typedef struct prepared_atom_s prepared_atom_t;
+struct prepared_atom_s
+{
+  uint64_t element;
+  uint64_t bond_nb;
+  double charge;
+  double epsilon;
+  double sigma;
+  vec3_t pos;
+  vec3_t vel;
+  vec3_t acc;
+  vec3_t frc;
+};
+
+universe_t *prepared_save(universe_t *universe, const char *path);
+universe_t *prepared_load(universe_t *universe, const char *path);
+universe_t *prepared_checkpoint(universe_t *universe, const args_t *args);
+universe_t *prepared_restart(universe_t *universe, const args_t *args);
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * reorder.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <stdint.h>
+
+#include "universe.h"
+#include "args.h"
+
+/* Atoms built molecule after molecule drift apart, and the force loops end up
+ * walking atoms scattered all over memory. Every so many iterations, the
+ * atoms are sorted along a Morton (Z-order) curve through the box, for atoms
+ * close in space to be close in memory. The key of an atom interleaves the
+ * bits of its cell along each axis, the cell grid's when there is one.
+ *
+ * Sorting moves the atoms, so the bonds are renumbered, and the original id
+ * of each atom is kept for the frames to still be written in the input order.
+ */
+
+/* reorder_t */
+#define REORDER_EVERY_DEFAULT         ((uint64_t)   0)
+#define REORDER_ORDER_DEFAULT         ((uint64_t*)  NULL)
+#define REORDER_WHERE_DEFAULT         ((uint64_t*)  NULL)
+#define REORDER_FROM_DEFAULT          ((uint64_t*)  NULL)
+#define REORDER_ENTRY_DEFAULT         ((reorder_entry_t*) NULL)
+#define REORDER_ATOM_DEFAULT          ((atom_t*)    NULL)
+#define REORDER_PASS_NB_DEFAULT       ((uint64_t)   0)
+#define REORDER_PASS_TIME_DEFAULT     ((double)     0.0)
+#define REORDER_STEP_NB_DEFAULT       ((uint64_t)   0)
+#define REORDER_STEP_TIME_DEFAULT     ((double)     0.0)
+
+/* An atom and its key, while sorting */
+typedef struct reorder_entry_s reorder_entry_t;
+struct reorder_entry_s
+{
+  uint64_t key;
+  uint64_t id;
+};
+
+struct reorder_s
+{
+  uint64_t every;            /* Iterations between two sorts */
+  uint64_t *order;           /* Original id of the atom at each index */
+  uint64_t *where;           /* Index of each original atom */
+  uint64_t *from;            /* Index each atom comes from, while moving them */
+  reorder_entry_t *entry;    /* Atoms sorted by key */
+  atom_t *atom;              /* The atoms once moved, swapped with the universe's */
+  uint64_t pass_nb;          /* Sorts so far */
+  double pass_time;          /* (s) Time spent sorting and moving the atoms */
+  uint64_t step_nb[2];       /* Iterations before the first sort, and since */
+  double step_time[2];       /* (s) Time they took */
+};
+
+universe_t *reorder_open(universe_t *universe, const args_t *args);
+int         reorder_due(const universe_t *universe);
+universe_t *reorder_apply(universe_t *universe);
+universe_t *reorder_restore(universe_t *universe);
+void        reorder_account(universe_t *universe, const double step_time);
+void        reorder_report(const universe_t *universe);
+void        reorder_close(universe_t *universe);
+
+#endif
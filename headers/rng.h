@@ -0,0 +1,64 @@
+/*
+ * rng.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Counter-based random numbers (Philox4x32-10, Salmon et al., 2011)
+ *
+ * A block of four 32 bits words is a pure function of a 128 bits counter and
+ * a 64 bits key, there is no state to share. The key is the seed given with
+ * --srand, the counter names what the numbers are drawn for: the atom or
+ * molecule id, the step (iteration, cycle, attempt...), the purpose, and
+ * which block of that stream it is. Whichever thread draws a number, and in
+ * whatever order, it is always the same one.
+ *
+ * Ids and steps are taken modulo 2^32.
+ */
+
+/* What the numbers are drawn for, for the streams not to overlap */
+#define RNG_PURPOSE_POPULATE  ((uint32_t)0) /* Random placement of the substrate copies */
+#define RNG_PURPOSE_ORIENT    ((uint32_t)1) /* Orientation of the substrate copies on a lattice */
+#define RNG_PURPOSE_JITTER    ((uint32_t)2) /* Offset of the copies from their lattice site */
+#define RNG_PURPOSE_SHUFFLE   ((uint32_t)3) /* Order the solvent lattice sites are visited in */
+#define RNG_PURPOSE_SOLVATE   ((uint32_t)4) /* Orientation of the solvent molecules */
+#define RNG_PURPOSE_VELOCITY  ((uint32_t)5) /* Initial velocities */
+#define RNG_PURPOSE_RIGID     ((uint32_t)6) /* Rigid molecule moves of the potential reduction */
+#define RNG_PURPOSE_COARSE    ((uint32_t)7) /* Atom wiggling of the potential reduction */
+#define RNG_PURPOSE_EXCHANGE  ((uint32_t)8) /* Swaps between replicas at neighbouring temperatures */
+#define RNG_PURPOSE_THERMOSTAT ((uint32_t)9) /* Noise of the stochastic thermostat */
+
+#define RNG_WORD_NB 4 /* Words in a block */
+
+/* rng_t */
+#define RNG_LEFT_DEFAULT ((uint8_t)0)
+
+/* A stream of numbers, drawn block after block */
+typedef struct rng_s rng_t;
+struct rng_s
+{
+  uint32_t key[2];             /* The seed */
+  uint32_t ctr[RNG_WORD_NB];   /* Block, purpose, id and step */
+  uint32_t word[RNG_WORD_NB];  /* Current block */
+  uint8_t left;                /* Words of the current block not drawn yet */
+};
+
+void      rng_philox(uint32_t word[RNG_WORD_NB], const uint32_t ctr[RNG_WORD_NB], const uint32_t key[2]);
+rng_t    *rng_init(rng_t *rng, const uint64_t seed, const uint64_t id, const uint64_t step, const uint32_t purpose);
+uint32_t  rng_u32(rng_t *rng);
+double    rng_uniform(rng_t *rng);  /* [0;1[ */
+
+/* Fill dest with nb gaussian variates, dest[i] being the (first+i)-th of the
+ * (seed, id, step, purpose) stream. The variates don't depend on each other,
+ * a batch can be split between threads and still hold the same numbers.
+ */
+double   *rng_gaussian_batch(double *dest, const size_t nb, const uint64_t first, const uint64_t seed, const uint64_t id, const uint64_t step, const uint32_t purpose);
+
+#endif
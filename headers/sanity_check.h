@@ -58,3 +58,55 @@
 #if UNIVERSE_POPULATE_MIN_DIST < 0
   #error "UNIVERSE_POPULATE_MIN_DIST lesser than 0.0"
 #endif
+
+#if UNIVERSE_POPULATE_JITTER > 5E-1
+  #error "UNIVERSE_POPULATE_JITTER greater than 0.5, lattice copies could swap sites"
+#endif
+
+#if UNIVERSE_POPULATE_JITTER < 0
+  #error "UNIVERSE_POPULATE_JITTER lesser than 0.0"
+#endif
+
+#if GROUP_MAX < 1
+  #error "GROUP_MAX lesser than 1"
+#endif
+
+#if STREAM_SLOT_NB < 2
+  #error "STREAM_SLOT_NB lesser than 2"
+#endif
+
+#if DOMAIN_HALO_MARGIN <= 0
+  #error "Negative or null DOMAIN_HALO_MARGIN"
+#endif
+
+#if CELL_SIDE_MIN < 3
+  #error "CELL_SIDE_MIN lesser than 3"
+#endif
+
+#if UNIVERSE_SOLVATE_CLASH_DIST <= 0
+  #error "Negative or null UNIVERSE_SOLVATE_CLASH_DIST"
+#endif
+
+#if UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE <= 0 || UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE >= 1
+  #error "UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE must lie within ]0;1["
+#endif
+
+#if UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER <= 0 || UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER >= 1
+  #error "UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER must lie within ]0;1["
+#endif
+
+#if UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_GROWTH < 1
+  #error "UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_GROWTH lesser than 1.0"
+#endif
+
+#if UNIVERSE_REDUCEPOT_FINE_BACKOFF <= 0 || UNIVERSE_REDUCEPOT_FINE_BACKOFF >= 1
+  #error "UNIVERSE_REDUCEPOT_FINE_BACKOFF must lie within ]0;1["
+#endif
+
+#if UNIVERSE_REDUCEPOT_FINE_GROWTH < 1
+  #error "UNIVERSE_REDUCEPOT_FINE_GROWTH lesser than 1.0"
+#endif
+
+#if UNIVERSE_REDUCEPOT_FINE_MIN_SCALE <= 0 || UNIVERSE_REDUCEPOT_FINE_MIN_SCALE >= 1
+  #error "UNIVERSE_REDUCEPOT_FINE_MIN_SCALE must lie within ]0;1["
+#endif
@@ -0,0 +1,86 @@
+/*
+ * scheduler.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <omp.h>
+
+#include "universe.h"
+
+/* Spreads tasks of uneven cost over the threads. Before each run, the tasks
+ * are sorted by estimated cost and dealt to the least loaded thread, each
+ * thread getting a deque of its own, most expensive first. A thread works
+ * from the front of its deque, and once it's empty steals from the back of
+ * the others', where the cheapest tasks are.
+ *
+ * The team is as large as omp_get_max_threads() when a run starts, for a
+ * replica of an ensemble to keep to its share of the threads.
+ *
+ * The time each thread spends running tasks (busy) and waiting for the
+ * others to finish (idle) is summed over the runs, for the imbalance to be
+ * reported.
+ */
+
+/* A task, given its id */
+typedef universe_t *(*sched_task_t)(universe_t *universe, const uint64_t task_id);
+
+/* A thread's share of the tasks, order[head] to order[tail-1] */
+typedef struct sched_deque_s sched_deque_t;
+struct sched_deque_s
+{
+  omp_lock_t lock;  /* Taken by the owner and thieves alike */
+  uint64_t head;    /* Next task for the owner */
+  uint64_t tail;    /* One past the next task for a thief */
+};
+
+/* A task and its estimated cost, while dealing */
+typedef struct sched_entry_s sched_entry_t;
+struct sched_entry_s
+{
+  uint64_t cost;
+  uint64_t id;
+  int thread;      /* Thread it was dealt to */
+};
+
+/* sched_t */
+#define SCHED_THREAD_NB_DEFAULT  ((int)            0)
+#define SCHED_TEAM_NB_DEFAULT    ((int)            0)
+#define SCHED_TASK_MAX_DEFAULT   ((uint64_t)       0)
+#define SCHED_DEQUE_DEFAULT      ((sched_deque_t*) NULL)
+#define SCHED_ENTRY_DEFAULT      ((sched_entry_t*) NULL)
+#define SCHED_ORDER_DEFAULT      ((uint64_t*)      NULL)
+#define SCHED_LOAD_DEFAULT       ((uint64_t*)      NULL)
+#define SCHED_BUSY_DEFAULT       ((double*)        NULL)
+#define SCHED_IDLE_DEFAULT       ((double*)        NULL)
+#define SCHED_DONE_DEFAULT       ((uint64_t*)      NULL)
+#define SCHED_STOLEN_DEFAULT     ((uint64_t*)      NULL)
+#define SCHED_RUN_NB_DEFAULT     ((uint64_t)       0)
+
+struct sched_s
+{
+  int thread_nb;          /* Threads the arrays below have room for */
+  int team_nb;            /* Threads the tasks are spread over in this run */
+  uint64_t task_max;      /* Most tasks in a run */
+  sched_deque_t *deque;   /* One per thread */
+  sched_entry_t *entry;   /* Tasks sorted by cost */
+  uint64_t *order;        /* Task ids, deque after deque */
+  uint64_t *load;         /* Estimated cost dealt to each thread */
+  double *busy;           /* (s) Time each thread spent running tasks */
+  double *idle;           /* (s) Time each thread spent waiting for the others */
+  uint64_t *done;         /* Tasks each thread ran */
+  uint64_t *stolen;       /* How many of them it stole */
+  uint64_t run_nb;        /* Runs so far */
+};
+
+universe_t *sched_init(universe_t *universe, const uint64_t task_max);
+universe_t *sched_run(universe_t *universe, const uint64_t task_nb, const uint64_t *cost, sched_task_t task);
+void        sched_report(const universe_t *universe);
+void        sched_clean(universe_t *universe);
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * stc.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef STC_H
+#define STC_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "universe.h"
+#include "args.h"
+
+/* STC is SENPAI's compressed trajectory format, in the spirit of XTC.
+ * Coordinates are quantized to a fixed precision, each atom is stored as the
+ * difference to the previous one (bonded atoms are next to each other, so
+ * those are small), and the differences are bit-packed by blocks of atoms
+ * using the smallest width that fits the whole block.
+ *
+ * File:  magic | atom_nb (uint32) | precision (double, Å) | symbols
+ * Frame: iteration (uint64) | box (double, Å) | payload_len (uint32) | payload
+ * Payload: first atom (3*32 bits), then for each block of the other atoms,
+ *          width (STC_WIDTH_BITS) | 3*block zigzagged deltas
+ */
+
+#define STC_MAGIC        "STC1"
+#define STC_SYMBOL_LEN   4                     /* Bytes per atom symbol, NUL padded */
+#define STC_BLOCK        32                    /* Atoms sharing a single bit width */
+#define STC_WIDTH_BITS   6                     /* Bits used to store a width (0-32) */
+#define STC_QUANT_MAX    ((int64_t)INT32_MAX)  /* Largest quantized coordinate */
+
+size_t   stc_frame_bound(const uint64_t atom_nb);
+uint8_t *stc_frame_encode(uint8_t *out, size_t *len, const double *coord, const uint64_t atom_nb, const double precision);
+double  *stc_frame_decode(double *coord, const uint8_t *in, const size_t len, const uint64_t atom_nb, const double precision);
+
+FILE    *stc_read_header(FILE *file, uint64_t *atom_nb, double *precision, char **symbol);
+FILE    *stc_read_frame(FILE *file, uint64_t *iteration, double *box, double *coord, const uint64_t atom_nb, const double precision);
+
+universe_t *stc_header(universe_t *universe, const args_t *args);
+universe_t *stc_frame(universe_t *universe);
+
+#endif
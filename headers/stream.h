@@ -0,0 +1,97 @@
+/*
+ * stream.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "universe.h"
+#include "args.h"
+
+/* Frames can be published live to a POSIX shared memory segment, for local
+ * processes to watch the simulation without going through a trajectory file.
+ * The segment holds a header, the element symbols of the atoms, then a ring
+ * of STREAM_SLOT_NB frame slots:
+ *
+ *   stream_header_t | atom_nb * STREAM_SYMBOL_LEN | slot_nb * slot_len
+ *
+ * Symbols are padded with zeros, but not terminated when they fill their
+ * STREAM_SYMBOL_LEN bytes. A slot is a stream_slot_t followed by the
+ * 3*atom_nb coordinates (Å, xyz per atom), frame k going to slot k % slot_nb.
+ * Each slot is a sequence lock: its seq is odd while the slot is being written
+ * and 2k+2 once frame k is in. The header's frame_nb is raised once the frame
+ * is complete.
+ *
+ * The simulation never waits for the consumers. They read frames in place,
+ * then check the slot's seq hasn't moved, or the frame was overwritten while
+ * they were reading it and must be dropped.
+ */
+
+#define STREAM_MAGIC          "SSHM"
+#define STREAM_VERSION        ((uint32_t)1)
+#define STREAM_SYMBOL_LEN     ((size_t)4)
+#define STREAM_STATE_RUNNING  ((uint32_t)1)
+#define STREAM_STATE_ENDED    ((uint32_t)2)
+
+typedef struct stream_header_s stream_header_t;
+struct stream_header_s
+{
+  char magic[4];          /* STREAM_MAGIC */
+  uint32_t version;       /* STREAM_VERSION */
+  uint32_t state;         /* STREAM_STATE_*, ended once the simulation is over */
+  uint32_t pad;
+  uint64_t atom_nb;       /* Atoms in each frame */
+  uint64_t slot_nb;       /* Frames kept in the ring */
+  uint64_t slot_len;      /* Bytes per slot, coordinates included */
+  uint64_t symbol_offset; /* Where the element symbols start */
+  uint64_t slot_offset;   /* Where the first slot starts */
+  uint64_t frame_nb;      /* Frames published so far */
+};
+
+typedef struct stream_slot_s stream_slot_t;
+struct stream_slot_s
+{
+  uint64_t seq;        /* Sequence lock, 2k+2 once frame k is complete */
+  uint64_t iteration;  /* Iteration the frame was taken at */
+  double box;          /* (Å) Universe size */
+  uint64_t pad;
+};
+
+/* stream_t */
+#define STREAM_NAME_DEFAULT     ((char*)    NULL)
+#define STREAM_MAP_DEFAULT      ((uint8_t*) NULL)
+#define STREAM_MAP_LEN_DEFAULT  ((size_t)   0)
+#define STREAM_EVERY_DEFAULT    ((uint64_t) 1)
+
+/* A mapped segment, on either side */
+struct stream_s
+{
+  char *name;          /* Name of the segment, with its leading slash */
+  uint8_t *map;        /* The mapped segment */
+  size_t map_len;      /* Its length */
+  uint64_t every;      /* Iterations between two published frames */
+};
+
+/* Publishing, from the simulation */
+universe_t *stream_open(universe_t *universe, const args_t *args);
+universe_t *stream_publish(universe_t *universe);
+int         stream_due(const universe_t *universe);
+void        stream_close(universe_t *universe);
+
+/* Consuming, from another process */
+stream_t             *stream_attach(stream_t *stream, const char *name);
+void                  stream_detach(stream_t *stream);
+const stream_header_t *stream_header(const stream_t *stream);
+const char           *stream_symbol(const stream_t *stream, const uint64_t atom_id);
+uint64_t              stream_frame_nb(const stream_t *stream);
+int                   stream_ended(const stream_t *stream);
+const double         *stream_read_begin(const stream_t *stream, const uint64_t frame, uint64_t *iteration, double *box);
+int                   stream_read_end(const stream_t *stream, const uint64_t frame);
+
+#endif
@@ -48,6 +48,155 @@
 #define TEXT_ARGS_PRESSURE_FAILURE             TEXT_FAILURE "args_check: The system pressure must be positive!"
 #define TEXT_ARGS_DENSITY_FAILURE              TEXT_FAILURE "args_check: The system's density must be positive!"
 #define TEXT_ARGS_REDUCEPOT_FAILURE            TEXT_FAILURE "args_check: The target potential must be positive!"
+#define TEXT_ARGS_SIZE_FAILURE                 TEXT_FAILURE "args_check: The universe size cannot be negative!"
+#define TEXT_ARGS_FORMAT_FAILURE               TEXT_FAILURE "args_check: Unknown output format (expected xyz, dcd or stc)"
+#define TEXT_ARGS_PRECISION_FAILURE            TEXT_FAILURE "args_check: The trajectory precision must be positive!"
+#define TEXT_ARGS_RESTART_FAILURE              TEXT_FAILURE "args_check: Restarting needs a checkpoint path"
+#define TEXT_ARGS_CHECKPOINT_INTERVAL_FAILURE  TEXT_FAILURE "args_check: The checkpoint interval must be positive!"
+#define TEXT_ARGS_GROUP_FAILURE                TEXT_FAILURE "args_check: Groups must be written every 1 or more iterations"
+#define TEXT_ARGS_GROUP_NB_FAILURE             TEXT_FAILURE "args_parse: Too many output groups"
+#define TEXT_ARGS_THERMO_FAILURE               TEXT_FAILURE "args_check: The thermodynamics must be logged every 1 or more iterations"
+#define TEXT_ARGS_SHM_FAILURE                  TEXT_FAILURE "args_check: Frames must be published every 1 or more iterations"
+#define TEXT_ARGS_CUTOFF_FAILURE               TEXT_FAILURE "args_check: The cutoff cannot be negative!"
+#define TEXT_ARGS_DOMAIN_CUTOFF_FAILURE        TEXT_FAILURE "args_check: Running on several processes needs a cutoff"
+#define TEXT_ARGS_DOMAIN_FAILURE               TEXT_FAILURE "args_check: Checkpoints, groups and live streams need a single process"
+#define TEXT_ARGS_LATTICE_FAILURE              TEXT_FAILURE "args_check: Unknown lattice (expected random, sc, fcc or jitter)"
+#define TEXT_ARGS_PIN_FAILURE                  TEXT_FAILURE "args_check: Unknown pinning (expected compact or scatter)"
+#define TEXT_ARGS_THREADS_FAILURE              TEXT_FAILURE "args_check: Too many threads"
+#define TEXT_ARGS_ENSEMBLE_NB_FAILURE          TEXT_FAILURE "args_check: An ensemble needs at least one replica"
+#define TEXT_ARGS_THERMOSTAT_FAILURE           TEXT_FAILURE "args_check: The thermostat coupling time cannot be shorter than a timestep"
+#define TEXT_ARGS_EXCHANGE_FAILURE             TEXT_FAILURE "args_check: Replica exchange needs an ensemble, a thermostat and --temp_max above --temp"
+#define TEXT_ARGS_ENSEMBLE_FAILURE             TEXT_FAILURE "args_check: Ensembles need a single process, and no checkpoint, group, live stream or prepared system"
+#define TEXT_ARGS_REORDER_FAILURE              TEXT_FAILURE "args_check: Sorting the atoms needs a single process and the output thread"
+
+/* affinity.c */
+#define TEXT_AFFINITY_INIT_FAILURE             TEXT_FAILURE "affinity_init: Failed to pin the threads"
+#define TEXT_AFFINITY_PIN                      TEXT_INFO    "Thread %d pinned to CPU %d (NUMA node %d)\n"
+#define TEXT_AFFINITY_NODE                     TEXT_INFO    "Atoms %ld to %ld on NUMA node %d\n"
+#define TEXT_AFFINITY_NODE_UNKNOWN             TEXT_INFO    "Atoms %ld to %ld on an unknown NUMA node\n"
+
+/* cell.c */
+#define TEXT_CELL_INIT_FAILURE                 TEXT_FAILURE "cell_init: Failed to cut the box into cells"
+#define TEXT_CELL_UPDATE_FRC_FAILURE           TEXT_FAILURE "cell_update_frc: Failed to update the forces of a cell"
+
+/* dcd.c */
+#define TEXT_DCD_HEADER_FAILURE                TEXT_FAILURE "dcd_header: Failed to write the trajectory header"
+#define TEXT_DCD_FRAME_FAILURE                 TEXT_FAILURE "dcd_frame: Failed to write a trajectory frame"
+#define TEXT_DCD_CLOSE_FAILURE                 TEXT_FAILURE "dcd_close: Failed to finalize the trajectory"
+
+/* domain.c */
+#define TEXT_DOMAIN_START_FAILURE              TEXT_FAILURE "domain_start: Failed to start MPI"
+#define TEXT_DOMAIN_INIT_FAILURE               TEXT_FAILURE "domain_init: Failed to split the universe between the processes"
+#define TEXT_DOMAIN_EXCHANGE_FAILURE           TEXT_FAILURE "domain_exchange: Failed to exchange atoms between the processes"
+#define TEXT_DOMAIN_REACH_FAILURE              TEXT_FAILURE "domain_exchange: A molecule stretches past the halo, DOMAIN_HALO_MARGIN is too small"
+#define TEXT_DOMAIN_GATHER_FAILURE             TEXT_FAILURE "domain_gather: Failed to gather the atoms"
+
+/* ensemble.c */
+#define TEXT_ENSEMBLE_RUN_FAILURE              TEXT_FAILURE "ensemble_run: Failed to run the ensemble"
+#define TEXT_ENSEMBLE_REPLICA_FAILURE          TEXT_FAILURE "ensemble_run: A replica failed"
+#define TEXT_ENSEMBLE_EXCHANGE_FAILURE         TEXT_FAILURE "ensemble_exchange: Failed to run the replica exchange"
+#define TEXT_ENSEMBLE_RUNG                     TEXT_INFO    "Replica %ld at %.2lf K, trajectory in %s\n"
+#define TEXT_ENSEMBLE_EXCHANGE_RATIO           TEXT_INFO    "Replicas %ld (%.2lf K) and %ld (%.2lf K): %ld of %ld swaps accepted (%.1lf%%)\n"
+#define TEXT_ENSEMBLE_START                    TEXT_INFO    "%ld replicas, %d at once with %d threads each\n"
+#define TEXT_ENSEMBLE_REPLICA_DONE             TEXT_INFO    "Replica %ld (seed %ld) done, trajectory in %s\n"
+#define TEXT_ENSEMBLE_REPLICA_SPEED            TEXT_INFO    "Replica %ld: %.3E ns in %.3lf s, %.3lf ns/day\n"
+#define TEXT_ENSEMBLE_SPEED                    TEXT_INFO    "Ensemble: %.3E ns in %.3lf s over %ld replicas, %.3lf ns/day\n"
+
+/* frames.c */
+#define TEXT_FRAMES_OPEN_FAILURE               TEXT_FAILURE "frames_open: Failed to create the frame index"
+#define TEXT_FRAMES_APPEND_FAILURE             TEXT_FAILURE "frames_append: Failed to index a frame"
+#define TEXT_FRAMES_INIT_FAILURE               TEXT_FAILURE "frames_init: Failed to open the indexed trajectory"
+#define TEXT_FRAMES_SPAN_FAILURE               TEXT_FAILURE "frames_span: No such frame"
+#define TEXT_FRAMES_COPY_FAILURE               TEXT_FAILURE "frames_copy: Failed to copy frames"
+
+/* group.c */
+#define TEXT_GROUP_INIT_FAILURE                TEXT_FAILURE "group_init: Failed to open an output group"
+#define TEXT_GROUP_SELECTION_FAILURE           TEXT_FAILURE "group_init: The group's selection is invalid or selects no atom"
+#define TEXT_GROUP_PRINTSTATE_FAILURE          TEXT_FAILURE "group_printstate: Failed to write a group's frame"
+#define TEXT_GROUP_FLUSH_FAILURE               TEXT_FAILURE "group_flush: Failed to flush a group's trajectory"
+
+/* reorder.c */
+#define TEXT_REORDER_OPEN_FAILURE              TEXT_FAILURE "reorder_open: Failed to allocate the atom order"
+#define TEXT_REORDER_APPLY_FAILURE             TEXT_FAILURE "reorder_apply: Too many cells along an axis for the sort keys"
+#define TEXT_REORDER_REPORT                    TEXT_INFO    "Atoms sorted %ld times in %.3lf s, %.3lf ms per iteration before (%ld), %.3lf ms after (%ld)\n"
+
+/* scheduler.c */
+#define TEXT_SCHED_INIT_FAILURE                TEXT_FAILURE "sched_init: Failed to allocate the task deques"
+#define TEXT_SCHED_RUN_FAILURE                 TEXT_FAILURE "sched_run: A task failed"
+#define TEXT_SCHED_REPORT                      TEXT_INFO    "Thread %d: busy %.3lf s, idle %.3lf s (%.1lf%%), %ld tasks, %ld stolen\n"
+
+/* stream.c */
+#define TEXT_STREAM_OPEN_FAILURE               TEXT_FAILURE "stream_open: Failed to create the shared memory segment"
+#define TEXT_STREAM_ATTACH_FAILURE             TEXT_FAILURE "stream_attach: Failed to attach to the shared memory segment"
+
+/* shmdump.c */
+#define TEXT_SHMDUMP_USAGE                     "Usage: shmdump <name> [output.xyz] [frames]\n"
+#define TEXT_SHMDUMP_SUCCESS                   TEXT_SUCCESS "Dumped %ld frames of %ld atoms (%ld missed)\n"
+#define TEXT_SHMDUMP_FAILURE                   TEXT_FAILURE "shmdump: Failed to dump the stream"
+
+/* trajslice.c */
+#define TEXT_TRAJSLICE_USAGE                   "Usage: trajslice <input> <output> <first> [last] [stride]\n"
+#define TEXT_TRAJSLICE_SUCCESS                 TEXT_SUCCESS "Extracted %ld of %ld frames\n"
+#define TEXT_TRAJSLICE_FAILURE                 TEXT_FAILURE "trajslice: Failed to extract the frames"
+
+/* parse.c */
+#define TEXT_PARSER_ERROR                      TEXT_FAILURE "%s:%ld:%ld: %s\n"
+#define TEXT_PARSER_MAP_FAILURE                TEXT_FAILURE "parser_map: Failed to map the input file"
+#define TEXT_PARSER_TEXT_FAILURE               TEXT_FAILURE "parser_text: Failed to copy a line"
+#define TEXT_PARSER_WORD_FAILURE               TEXT_FAILURE "parser_word: Failed to copy a word"
+#define TEXT_PARSER_EXPECTED_LINE              "Unexpected end of file"
+#define TEXT_PARSER_EXPECTED_WORD              "Expected a word"
+#define TEXT_PARSER_EXPECTED_NUMBER            "Expected a number"
+#define TEXT_PARSER_EXPECTED_INTEGER           "Expected a positive integer"
+#define TEXT_PARSER_MALFORMED_NUMBER           "Malformed number"
+#define TEXT_PARSER_MALFORMED_INTEGER          "Malformed integer"
+#define TEXT_PARSER_UNKNOWN_ELEMENT            "Element not defined by the model"
+#define TEXT_PARSER_UNKNOWN_ATOM               "Bond to an atom that doesn't exist"
+#define TEXT_PARSER_ATOM_RANGE                 "Atom index out of range"
+
+/* prepared.c */
+#define TEXT_PREPARED_SAVE_FAILURE             TEXT_FAILURE "prepared_save: Failed to save the prepared system"
+#define TEXT_PREPARED_LOAD_FAILURE             TEXT_FAILURE "prepared_load: Not a valid prepared system"
+#define TEXT_PREPARED_CHECKPOINT_FAILURE       TEXT_FAILURE "prepared_checkpoint: Failed to checkpoint the simulation"
+#define TEXT_PREPARED_RESTART_FAILURE          TEXT_FAILURE "prepared_restart: The trajectory doesn't match the checkpoint"
+#define TEXT_PREPARED_SAVED                    TEXT_SUCCESS "Saved the prepared system to %s\n"
+
+/* stc.c */
+#define TEXT_STC_HEADER_FAILURE                TEXT_FAILURE "stc_header: Failed to write the trajectory header"
+#define TEXT_STC_FRAME_FAILURE                 TEXT_FAILURE "stc_frame: Failed to write a trajectory frame"
+#define TEXT_STC_FRAME_ENCODE_FAILURE          TEXT_FAILURE "stc_frame_encode: Coordinates out of range for this precision"
+#define TEXT_STC_FRAME_DECODE_FAILURE          TEXT_FAILURE "stc_frame_decode: Truncated or corrupted frame"
+#define TEXT_STC_READ_HEADER_FAILURE           TEXT_FAILURE "stc_read_header: Not a valid STC trajectory"
+#define TEXT_STC_READ_FRAME_FAILURE            TEXT_FAILURE "stc_read_frame: Failed to read a trajectory frame"
+
+/* stc2xyz.c */
+#define TEXT_STC2XYZ_USAGE                     "Usage: stc2xyz <input.stc> [output.xyz]\n"
+#define TEXT_STC2XYZ_SUCCESS                   TEXT_SUCCESS "Converted %ld frames of %ld atoms (precision %.2E Å)\n"
+#define TEXT_STC2XYZ_FAILURE                   TEXT_FAILURE "stc2xyz: Failed to convert the trajectory"
+
+/* tile.c */
+#define TEXT_TILE_INIT_FAILURE                 TEXT_FAILURE "tile_init: Failed to allocate the tiles"
+#define TEXT_TILE_UPDATE_FRC_FAILURE           TEXT_FAILURE "tile_update_frc: Failed to update the forces"
+
+/* thermo.c */
+#define TEXT_THERMO_OPEN_FAILURE               TEXT_FAILURE "thermo_open: Failed to open the thermodynamics log"
+#define TEXT_THERMO_WRITE_FAILURE              TEXT_FAILURE "thermo_write: Failed to write the thermodynamics log"
+#define TEXT_THERMO_SYNC_FAILURE               TEXT_FAILURE "thermo_sync: Failed to flush the thermodynamics log"
+#define TEXT_THERMO_EXCHANGE_FAILURE           TEXT_FAILURE "thermo_exchange: Failed to log the replica swaps"
+#define TEXT_THERMO_HEADER                     "# time(ns) iteration kinetic(pJ) bond(pJ) angle(pJ) electrostatic(pJ) lennardjones(pJ) potential(pJ) total(pJ) temperature(K) drift(pJ)\n"
+#define TEXT_THERMO_LINE                       "%.9lf %ld %.9e %.9e %.9e %.9e %.9e %.9e %.9e %.3lf %.9e\n"
+#define TEXT_THERMO_EXCHANGE                   "# exchange %.9lf %ld with %.2lf K: %ld of %ld swaps accepted\n"
+
+/* writer.c */
+#define TEXT_WRITER_INIT_FAILURE               TEXT_FAILURE "writer_init: Failed to start the output thread"
+#define TEXT_WRITER_PUSH_FAILURE               TEXT_FAILURE "writer_push: Failed to write the current state"
+#define TEXT_WRITER_SYNC_FAILURE               TEXT_FAILURE "writer_sync: Failed to flush the trajectory"
+#define TEXT_WRITER_CLEAN_FAILURE              TEXT_FAILURE "writer_clean: Failed to write the trajectory"
+#define TEXT_WRITER_WAIT                       TEXT_INFO    "Waited %.3lf s for the output thread (%ld times)\n"
+
+/* xyz.c */
+#define TEXT_XYZ_INIT_FAILURE                  TEXT_FAILURE "xyz_init: Failed to allocate the frame buffer"
+#define TEXT_XYZ_FRAME_FAILURE                 TEXT_FAILURE "xyz_frame: Failed to write a trajectory frame"
 
 /* force.c */
 #define TEXT_FORCE_BOND_FAILURE                TEXT_FAILURE "force_bond: Failed to compute the bond force"
@@ -55,6 +204,8 @@
 #define TEXT_FORCE_LENNARDJONES_FAILURE        TEXT_FAILURE "force_lennardjones: Failed to compute the Lennard-Jones force"
 #define TEXT_FORCE_ANGLE_FAILURE               TEXT_FAILURE "force_angle: Failed to compute bond angle force"
 #define TEXT_FORCE_TOTAL_FAILURE               TEXT_FAILURE "force_total: Failed to compute the force vector"
+#define TEXT_FORCE_BONDED_FAILURE              TEXT_FAILURE "force_bonded: Failed to compute the bonded forces"
+#define TEXT_FORCE_TOTAL_CELL_FAILURE          TEXT_FAILURE "force_total_cell: Failed to compute the force vector"
 
 /* main.c */
 #define TEXT_MAIN_FAILURE                      TEXT_FAILURE "SENPAI failed to execute properly"
@@ -73,7 +224,10 @@
 #define TEXT_POTENTIAL_ELECTROSTATIC_FAILURE   TEXT_FAILURE "potential_electrostatic: Failed to compute electrostatic potential"
 #define TEXT_POTENTIAL_LENNARDJONES_FAILURE    TEXT_FAILURE "potential_lennardjones: Failed to compute Lennard-Jones potential"
 #define TEXT_POTENTIAL_ANGLE_FAILURE           TEXT_FAILURE "potential_angle: Failed to compute bond angle potential"
+#define TEXT_POTENTIAL_INTERMOLECULAR_FAILURE  TEXT_FAILURE "potential_intermolecular: Failed to compute intermolecular potential energy"
 #define TEXT_POTENTIAL_TOTAL_FAILURE           TEXT_FAILURE "potential_total: Failed to compute total potential energy"
+#define TEXT_POTENTIAL_TERMS_FAILURE           TEXT_FAILURE "potential_terms: Failed to compute the potential energy terms"
+#define TEXT_POTENTIAL_TERMS_CELL_FAILURE      TEXT_FAILURE "potential_terms_cell: Failed to compute the potential energy terms"
 
 /* universe.c */
 #define TEXT_INFO_BORDER                                      "+---------------------+"
@@ -89,6 +243,10 @@
 #define TEXT_INFO_SUBSTRATE_ATOM_NB                         "Atoms..................%ld\n"
 #define TEXT_INFO_SUBSTRATE_BOND_NB                         "Bonds..................%ld\n"
 #define TEXT_INFO_SUBSTRATE_COPIES                          "Duplicates to simulate.%ld\n"
+#define TEXT_INFO_LATTICE                                   "Placement..............%s\n"
+#define TEXT_INFO_FORMAT                                    "Output format..........%s\n"
+#define TEXT_INFO_OUT_BUFFERS                               "Output buffers.........%ld\n"
+#define TEXT_INFO_SOLVENT_COPIES                            "Solvent molecules......%ld\n"
 #define TEXT_INFO_ATOM_NB                                   "Atoms..................%ld\n"
 #define TEXT_INFO_TEMPERATURE                               "Temperature............%lf K\n"
 #define TEXT_INFO_PRESSURE                                  "Pressure...............%.2E hPa\n"
@@ -97,35 +255,65 @@
 #define TEXT_INFO_SIMULATION_TIME                           "Simulation time........%.2E s\n"
 #define TEXT_INFO_TIMESTEP                                  "Timestep...............%.2E s\n"
 #define TEXT_INFO_FRAMESKIP                                 "Frameskip..............%ld\n"
+#define TEXT_INFO_THERMO                                    "Thermodynamics.........%s (every %ld iterations)\n"
+#define TEXT_INFO_REORDER                                   "Atom sorting...........every %ld iterations\n"
+#define TEXT_INFO_SHM                                       "Live stream............%s (every %ld iterations)\n"
+#define TEXT_INFO_GROUP                                     "Output group...........%s (%ld atoms, every %ld iterations) to %s\n"
+#define TEXT_INFO_CUTOFF                                    "Cutoff.................%.2E m\n"
+#define TEXT_INFO_PROCESSES                                 "Processes..............%d (slabs along x)\n"
+#define TEXT_INFO_THREADS                                   "Threads................%d\n"
+#define TEXT_INFO_THREADS_PINNED                            "Threads................%d (pinned %s)\n"
 #define TEXT_INFO_ITERATIONS                                "Iterations.............%ld\n\n"
 
 #define TEXT_UNIVERSE_SIMULATE_SUCCESS         LINE_RESET TEXT_SUCCESS "Rendered frame %ld/%ld (%.2lf%%)"
 
 #define TEXT_UNIVERSE_REDUCEPOT_CURRENT_POT               TEXT_INFO    "Current potential is %.2E pJ (Target: %.2E pJ)\n"
 #define TEXT_UNIVERSE_REDUCEPOT_START                     TEXT_INFO    "Starting potential reduction\n"
+#define TEXT_UNIVERSE_REDUCEPOT_RIGID_START               TEXT_INFO    "Starting stage 0 algorithm (rigid molecules)\n"
+#define TEXT_UNIVERSE_REDUCEPOT_RIGID_SUCCESS  LINE_RESET TEXT_SUCCESS "Reduced potential by %.2E pJ to %.2E pJ (%ld cycles, %.2lf%% complete)"
 #define TEXT_UNIVERSE_REDUCEPOT_COARSE_START              TEXT_INFO    "Starting stage 1 algorithm (wiggling)\n"
-#define TEXT_UNIVERSE_REDUCEPOT_COARSE_SUCCESS LINE_RESET TEXT_SUCCESS "Reduced potential by %.2E pJ to %.2E pJ (%ld cycles, %.2lf%% complete)"
+#define TEXT_UNIVERSE_REDUCEPOT_COARSE_SUCCESS LINE_RESET TEXT_SUCCESS "Reduced potential by %.2E pJ to %.2E pJ (%ld cycles, %.2lf%% complete, %ld atoms frozen)"
 #define TEXT_UNIVERSE_REDUCEPOT_FINE_START                TEXT_INFO    "Starting stage 2 algorithm (Gradient descent)\n"
+#define TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_START          TEXT_INFO    "Starting stage 2 algorithm (Batched gradient descent)\n"
 #define TEXT_UNIVERSE_REDUCEPOT_FINE_SUCCESS   LINE_RESET TEXT_SUCCESS "Reduced potential by %.2E pJ to %.2E pJ (%ld cycles, %.2lf%% complete)"
+#define TEXT_UNIVERSE_REDUCEPOT_FROZEN                    TEXT_INFO    "Every atom is frozen, wiggling can't do any better.\n"
 #define TEXT_UNIVERSE_REDUCEPOT_CUTOFF                    TEXT_INFO    "Potental reduction isn't yielding significant results anymore. Proceeding with the simulation.\n"
 #define TEXT_UNIVERSE_REDUCEPOT_SUCCESS                   TEXT_SUCCESS "Potential reduction completed\n"
+#define TEXT_REDUCEPOT_INIT_FAILURE                       TEXT_FAILURE "reducepot_init: Failed to initialize the potential reduction state"
 #define TEXT_UNIVERSE_REDUCEPOT_FAILURE                   TEXT_FAILURE "universe_reducepot: Failed to lower the system's potential"
+#define TEXT_UNIVERSE_REDUCEPOT_RIGID_FAILURE             TEXT_FAILURE "universe_reducepot_rigid: Failed to lower the system's potential"
 #define TEXT_UNIVERSE_REDUCEPOT_COARSE_FAILURE            TEXT_FAILURE "universe_reducepot_coarse: Failed to lower the system's potential"
 #define TEXT_UNIVERSE_REDUCEPOT_FINE_FAILURE              TEXT_FAILURE "universe_reducepot_fine: Failed to lower the system's potential"
+#define TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE        TEXT_FAILURE "universe_reducepot_fine_batch: Failed to lower the system's potential"
 
 #define TEXT_UNIVERSE_INIT_FAILURE             TEXT_FAILURE "universe_init: Failed to initialize the universe"
+#define TEXT_UNIVERSE_INIT_OUTPUT_FAILURE      TEXT_FAILURE "universe_init_output: Failed to open the outputs"
+#define TEXT_UNIVERSE_INIT_REPLICA_FAILURE     TEXT_FAILURE "universe_init_replica: Failed to build a replica"
+#define TEXT_UNIVERSE_PREPARE_FAILURE          TEXT_FAILURE "universe_prepare: Failed to build the universe from the input files"
+#define TEXT_UNIVERSE_LOAD_FAILURE             TEXT_FAILURE "universe_load: Failed to load the input files"
+#define TEXT_UNIVERSE_BUILD_FAILURE            TEXT_FAILURE "universe_build: Failed to populate the universe"
 #define TEXT_UNIVERSE_LOAD_MODEL_FAILURE       TEXT_FAILURE "universe_load_model: Failed to load initial state"
 #define TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE   TEXT_FAILURE "universe_load_substrate: Failed to load initial state"
 #define TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE     TEXT_FAILURE "universe_load_solvent: Failed to load initial state"
 #define TEXT_UNIVERSE_POPULATE_FAILURE         TEXT_FAILURE "universe_populate: Failed to populate universe"
+#define TEXT_UNIVERSE_POPULATE_SITE_FAILURE    TEXT_FAILURE "universe_populate_site: Unknown lattice"
+#define TEXT_UNIVERSE_SOLVATE_FAILURE          TEXT_FAILURE "universe_solvate: Failed to solvate the universe"
+#define TEXT_UNIVERSE_SOLVATE_SHORT                         TEXT_INFO "Could only fit %ld solvent molecules out of %ld\n"
+#define TEXT_UNIVERSE_MOLECULE_FAILURE         TEXT_FAILURE "universe_molecule: No such molecule"
 #define TEXT_UNIVERSE_SETVELOCITY_FAILURE      TEXT_FAILURE "universe_setvelocity: Failed to set initial velocities"
 #define TEXT_UNIVERSE_SIMULATE_FAILURE         TEXT_FAILURE "universe_simulate: Simulation failed"
 #define TEXT_UNIVERSE_ITERATE_FAILURE          TEXT_FAILURE "universe_iterate: Iteration failed"
+#define TEXT_UNIVERSE_PRINTSTATE_FAILURE       TEXT_FAILURE "universe_printstate: Failed to write the current state"
+#define TEXT_UNIVERSE_ENERGY_ALLOC_FAILURE     TEXT_FAILURE "universe_energy_alloc: Failed to allocate the per-atom energies"
 #define TEXT_UNIVERSE_ENERGY_KINETIC_FAILURE   TEXT_FAILURE "universe_energy_kinetic: Failed to compute kinetic system energy"
 #define TEXT_UNIVERSE_ENERGY_POTENTIAL_FAILURE TEXT_FAILURE "universe_energy_potential: Failed to compute potential system energy"
 #define TEXT_UNIVERSE_ENERGY_TOTAL_FAILURE     TEXT_FAILURE "universe_energy_total: Failed to compute total system energy"
 #define TEXT_UNIVERSE_PARAMETERS_PRINT_FAILURE TEXT_FAILURE "universe_parameters_print: Failed to print the simulation parameters"
 
+/* occupancy.c */
+#define TEXT_OCCUPANCY_INIT_FAILURE           TEXT_FAILURE "occupancy_init: Failed to initialize the occupancy grid"
+#define TEXT_OCCUPANCY_INSERT_FAILURE         TEXT_FAILURE "occupancy_insert: The occupancy grid is full"
+
 /* vec3.c */
 #define TEXT_VEC3_ADD_FAILURE                 TEXT_FAILURE "vec3_add: Failed to perform vector addition"
 #define TEXT_VEC3_SUB_FAILURE                 TEXT_FAILURE "vec3_sub: Failed to perform vector substraction"
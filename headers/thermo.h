@@ -0,0 +1,64 @@
+/*
+ * thermo.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef THERMO_H
+#define THERMO_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "universe.h"
+#include "args.h"
+#include "potential.h"
+
+/* The thermodynamics of the system can be logged every so many iterations,
+ * one line each, in columns:
+ *
+ *   time (ns), iteration, kinetic energy, bond, angle, electrostatic and
+ *   Lennard-Jones potential energy, total potential energy, total energy
+ *   (all in pJ), temperature (K), drift of the total energy since the first
+ *   line (pJ)
+ *
+ * The kinetic energy and the temperature come from the velocity update, only
+ * the potential energy terms are computed for the log.
+ *
+ * With --exchange, the log of each replica but the hottest also gets a
+ * comment line after every round of swaps with the next replica up:
+ *
+ *   # exchange time (ns) iteration with T (K): accepted of tried swaps accepted
+ *
+ * the counts being totals since the start, for them to survive a run cut short.
+ *
+ * A checkpoint records the length of the log, the lines in it and the first
+ * total energy. A restart cuts the log back to that length, and the drift
+ * goes on from the same first line.
+ */
+
+/* thermo_t */
+#define THERMO_FILE_DEFAULT      ((FILE*)   NULL)
+#define THERMO_TERM_DEFAULT      ((double*) NULL)
+#define THERMO_EVERY_DEFAULT     ((uint64_t) 1)
+#define THERMO_ENERGY_0_DEFAULT  ((double)  0.0)
+#define THERMO_LINE_NB_DEFAULT   ((uint64_t) 0)
+
+struct thermo_s
+{
+  FILE *file;          /* The log, only the first process writes it */
+  double *term;        /* (J) Potential energy terms of each atom */
+  uint64_t every;      /* Iterations between two lines */
+  double energy_0;     /* (J) Total energy on the first line */
+  uint64_t line_nb;    /* Lines written so far */
+};
+
+universe_t *thermo_open(universe_t *universe, const args_t *args);
+int         thermo_due(const universe_t *universe);
+universe_t *thermo_write(universe_t *universe);
+universe_t *thermo_sync(universe_t *universe);
+universe_t *thermo_exchange(universe_t *universe, const double temperature_next, const uint64_t accepted, const uint64_t tried);
+void        thermo_close(universe_t *universe);
+
+#endif
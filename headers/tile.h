@@ -0,0 +1,58 @@
+/*
+ * tile.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef TILE_H
+#define TILE_H
+
+#include <stdint.h>
+
+#include "universe.h"
+#include "args.h"
+
+/* Small systems have no use for a cell grid, every pair is looked at. The
+ * atoms are cut into tiles of TILE_ATOM_NB, whose positions and parameters
+ * are copied to flat arrays small enough to stay in the L1 cache. Each pair
+ * of tiles is a task, which computes the non-bonded force of each pair of
+ * atoms once, vectorized over the second atom, and gives it to both atoms.
+ *
+ * A task writes what it adds to each atom's force to slots of its own, and
+ * the slots of an atom are added in tile order: the forces don't depend on
+ * how the tasks are spread over the threads. Bonded atoms are left to
+ * force_bonded, as with the cell grid.
+ */
+
+/* tile_t */
+#define TILE_TILE_NB_DEFAULT    ((uint64_t) 0)
+#define TILE_THREAD_NB_DEFAULT  ((int)     0)
+#define TILE_X_DEFAULT          ((double*) NULL)
+#define TILE_Y_DEFAULT          ((double*) NULL)
+#define TILE_Z_DEFAULT          ((double*) NULL)
+#define TILE_CHARGE_DEFAULT     ((double*) NULL)
+#define TILE_EPSILON_DEFAULT    ((double*) NULL)
+#define TILE_SIGMA_DEFAULT      ((double*) NULL)
+#define TILE_KEEP_DEFAULT       ((double*) NULL)
+#define TILE_PARTIAL_DEFAULT    ((double*) NULL)
+
+struct tile_s
+{
+  uint64_t tile_nb;    /* Tiles the atoms are cut into */
+  int thread_nb;       /* Threads keep has room for */
+  double *x;           /* (m) Positions of the atoms, padded to whole tiles */
+  double *y;
+  double *z;
+  double *charge;      /* (C) Charge of each atom */
+  double *epsilon;     /* Square root of each atom's Lennard-Jones well depth */
+  double *sigma;       /* Square root of each atom's Lennard-Jones distance */
+  double *keep;        /* 0 for the atoms of a tile bonded to the current one, 1 otherwise, per thread */
+  double *partial;     /* (N) Forces given by each pair of tiles, x, y and z slot after slot */
+};
+
+universe_t *tile_init(universe_t *universe, const args_t *args);
+universe_t *tile_update_frc(universe_t *universe);
+void        tile_clean(universe_t *universe);
+
+#endif
@@ -15,6 +15,7 @@
 #include "vec3.h"
 #include "text.h"
 #include "args.h"
+#include "parse.h"
 
 /* t_atom */
 #define ATOM_ELEMENT_DEFAULT       ((uint64_t)   0)
@@ -40,6 +41,7 @@
 /* t_universe */
 #define UNIVERSE_FILE_MODEL_DEFAULT             ((FILE*)    NULL)
 #define UNIVERSE_FILE_OUTPUT_DEFAULT            ((FILE*)    NULL)
+#define UNIVERSE_FILE_INDEX_DEFAULT             ((FILE*)    NULL)
 #define UNIVERSE_FILE_SUBSTRATE_DEFAULT         ((FILE*)    NULL)
 #define UNIVERSE_FILE_SOLVENT_DEFAULT           ((FILE*)    NULL)
 #define UNIVERSE_META_MODEL_NAME_DEFAULT        ((char*)    NULL)
@@ -60,14 +62,53 @@
 #define UNIVERSE_SOLVENT_ATOM_DEFAULT           ((atom_t*)  NULL)
 #define UNIVERSE_ATOM_DEFAULT                   ((atom_t*)  NULL)
 #define UNIVERSE_COPY_NB_DEFAULT                ((uint64_t) 0   )
+#define UNIVERSE_SOLVENT_COPY_NB_DEFAULT        ((uint64_t) 0   )
 #define UNIVERSE_ATOM_NB_DEFAULT                ((uint64_t) 0   )
 #define UNIVERSE_ITERATIONS_DEFAULT             ((uint64_t) 0   )
 #define UNIVERSE_SIZE_DEFAULT                   ((double)   0.0 )
 #define UNIVERSE_TIME_DEFAULT                   ((double)   0.0 )
 #define UNIVERSE_TEMPERATURE_DEFAULT            ((double)   0.0 )
 #define UNIVERSE_PRESSURE_DEFAULT               ((double)   0.0 )
+#define UNIVERSE_POPULATE_MODE_DEFAULT          ((uint8_t)  0   )
+#define UNIVERSE_SEED_DEFAULT                   ((uint64_t) 0   )
+#define UNIVERSE_SHARED_DEFAULT                 ((uint8_t)  0   )
+#define UNIVERSE_QUIET_DEFAULT                  ((uint8_t)  0   )
+#define UNIVERSE_OUTPUT_FORMAT_DEFAULT          ((uint8_t)  0   )
+#define UNIVERSE_FRAME_NB_DEFAULT               ((uint64_t) 0   )
+#define UNIVERSE_OUTPUT_PRECISION_DEFAULT       ((double)   0.0 )
+#define UNIVERSE_OUTPUT_BUFFER_DEFAULT          ((char*)    NULL)
+#define UNIVERSE_OUTPUT_CHUNK_LEN_DEFAULT       ((size_t*)  NULL)
+#define UNIVERSE_OUTPUT_CHUNK_NB_DEFAULT        ((size_t)   0   )
+#define UNIVERSE_OUTPUT_LINE_MAX_DEFAULT        ((size_t)   0   )
+#define UNIVERSE_OUTPUT_OFFSET_DEFAULT          ((uint64_t) 0   )
+#define UNIVERSE_FRAMESKIP_LEFT_DEFAULT         ((uint64_t) 0   )
+#define UNIVERSE_GROUP_DEFAULT                  ((group_t*) NULL)
+#define UNIVERSE_GROUP_NB_DEFAULT               ((uint64_t) 0   )
+#define UNIVERSE_STREAM_DEFAULT                 ((stream_t*)NULL)
+#define UNIVERSE_THERMO_DEFAULT                 ((thermo_t*)NULL)
+#define UNIVERSE_THERMO_OFFSET_DEFAULT          ((uint64_t) 0   )
+#define UNIVERSE_THERMO_LINE_NB_DEFAULT         ((uint64_t) 0   )
+#define UNIVERSE_THERMO_ENERGY_0_DEFAULT        ((double)   0.0 )
+#define UNIVERSE_ENERGY_DEFAULT                 ((double*)  NULL)
+#define UNIVERSE_DOMAIN_DEFAULT                 ((domain_t*)NULL)
+#define UNIVERSE_CELL_DEFAULT                   ((cell_t*)  NULL)
+#define UNIVERSE_SCHED_DEFAULT                  ((sched_t*) NULL)
+#define UNIVERSE_REORDER_DEFAULT                ((reorder_t*)NULL)
+#define UNIVERSE_TILE_DEFAULT                   ((tile_t*)  NULL)
+#define UNIVERSE_CUTOFF_DEFAULT                 ((double)   0.0 )
+#define UNIVERSE_THERMOSTAT_DEFAULT             ((double)   0.0 )
+#define UNIVERSE_KINETIC_DEFAULT                ((double)   0.0 )
 
 typedef struct atom_s atom_t;
+typedef struct group_s group_t;
+typedef struct stream_s stream_t;
+typedef struct domain_s domain_t;
+typedef struct cell_s cell_t;
+typedef struct sched_s sched_t;
+typedef struct writer_s writer_t;
+typedef struct thermo_s thermo_t;
+typedef struct reorder_s reorder_t;
+typedef struct tile_s tile_t;
 struct atom_s
 {
   /* MISC. INFORMATION */
@@ -90,12 +131,57 @@ struct atom_s
   vec3_t frc;            /* Force */
 };
 
+/* t_reducepot */
+#define REDUCEPOT_STEP_DEFAULT       ((double*)   NULL)
+#define REDUCEPOT_ATTEMPTS_DEFAULT   ((uint64_t*) NULL)
+#define REDUCEPOT_ACCEPTED_DEFAULT   ((uint64_t*) NULL)
+#define REDUCEPOT_IDLE_DEFAULT       ((uint64_t*) NULL)
+#define REDUCEPOT_FROZEN_DEFAULT     ((uint8_t*)  NULL)
+#define REDUCEPOT_ATOM_NB_DEFAULT    ((uint64_t)  0)
+#define REDUCEPOT_FROZEN_NB_DEFAULT  ((uint64_t)  0)
+
+/* Per-atom state of the coarse potential reduction, kept across cycles */
+typedef struct reducepot_s reducepot_t;
+struct reducepot_s
+{
+  double *step;        /* (m) Relocation magnitude of each atom */
+  uint64_t *attempts;  /* Moves tried during the last cycle */
+  uint64_t *accepted;  /* Moves accepted during the last cycle */
+  uint64_t *idle;      /* Consecutive cycles without an accepted move */
+  uint8_t *frozen;     /* 1 if the atom is left alone */
+  uint64_t atom_nb;    /* Number of atoms tracked */
+  uint64_t frozen_nb;  /* Number of frozen atoms */
+};
+
 typedef struct universe_s universe_t;
 struct universe_s
 {
   /* MISC. INFORMATION */
   FILE *file_model;             /* The model file (.mdm) */
-  FILE *file_output;            /* The output file (.xyz) */
+  FILE *file_output;            /* The output file (.xyz or .dcd) */
+  FILE *file_index;             /* Offsets of the frames in the output file (.idx) */
+  uint8_t output_format;        /* Format of the output file (OUTPUT_FORMAT_*) */
+  uint64_t frame_nb;            /* How many frames were written to the output file */
+  double output_precision;      /* (Å) Quantization step of compressed trajectories */
+  char *output_buffer;          /* XYZ frame buffer */
+  size_t *output_chunk_len;     /* Bytes formatted by each chunk of the XYZ frame */
+  size_t output_chunk_nb;       /* Number of chunks in an XYZ frame */
+  size_t output_line_max;       /* Longest line of an XYZ frame */
+  uint64_t output_offset;       /* Length of the output file as of the last checkpoint */
+  uint64_t frameskip_left;      /* Iterations to render before the next frame is saved */
+  group_t *group;               /* Output groups, written on top of the main trajectory */
+  uint64_t group_nb;            /* How many there are */
+  stream_t *stream;             /* Shared memory the frames are published to, if any */
+  thermo_t *thermo;             /* Thermodynamics log, if any */
+  uint64_t thermo_offset;       /* Length of the log as of the last checkpoint */
+  uint64_t thermo_line_nb;      /* Lines in it by then */
+  double thermo_energy_0;       /* (J) Total energy on its first line */
+  double *energy;               /* (J) Energy of each atom, summed in index order for totals not to depend on the thread count */
+  domain_t *domain;             /* Atoms this process integrates, when spread over several */
+  cell_t *cell;                 /* Cells the atoms are binned in, with a cutoff */
+  sched_t *sched;               /* Spreads the cells' force updates over the threads */
+  reorder_t *reorder;           /* Order the atoms were sorted in, if they are */
+  tile_t *tile;                 /* Tiles the pairs are computed in, for small systems without cells */
   FILE *file_substrate;         /* The substrate file (.mds) */
   FILE *file_solvent;           /* The solvent file (.mds) */
 
@@ -131,14 +217,22 @@ struct universe_s
   /* UNIVERSE */
   atom_t *atom;                 /* The universe (set of all atoms) to simulate */
   uint64_t copy_nb;             /* Number of copies of the substrate to simulate */
+  uint64_t solvent_copy_nb;     /* Number of solvent molecules, stored after the substrate copies */
   uint64_t atom_nb;             /* Total number of atoms in the universe */
   uint64_t iterations;          /* How many iterations have been rendered so far */
+  uint8_t populate_mode;        /* How the substrate copies are placed (POPULATE_MODE_*) */
+  uint64_t seed;                /* Key of the random number streams */
+  uint8_t shared;               /* The model and the templates belong to another universe */
+  uint8_t quiet;                /* Progress isn't reported, other universes run alongside */
 
   /* PARAMETERS & THERMODYNAMICS */
   double size;                  /* (m) The universe is a cube, that's how long a side is */
   double time;                  /* (s) Current time */
-  double temperature;           /* (K) Initial thermodynamic temperature */
+  double temperature;           /* (K) Initial thermodynamic temperature, and the thermostat's target */
   double pressure;              /* (Pa) Initial pressure */
+  double cutoff;                /* (m) Non-bonded pairs further apart are ignored, 0 for none */
+  double thermostat;            /* (s) Coupling time of the thermostat, 0 for none */
+  double kinetic;               /* (J) Kinetic energy of the atoms this process owns, as of the last velocity update */
 };
 
 /* ################## */
@@ -148,6 +242,7 @@ struct universe_s
 void        atom_init(atom_t *atom);
 void        atom_clean(atom_t *atom);
 int         atom_is_bonded(universe_t *universe, const uint64_t a1, const uint64_t a2);
+int         atom_is_near(const universe_t *universe, const vec3_t *pos_1, const vec3_t *pos_2);
 universe_t *atom_update_frc_numerical(universe_t *universe, const uint64_t atom_id);
 universe_t *atom_update_frc_numerical_tetrahedron(universe_t *universe, const uint64_t atom_id);
 universe_t *atom_update_frc_analytical(universe_t *universe, const uint64_t atom_id);
@@ -155,27 +250,57 @@ universe_t *atom_update_acc(universe_t *universe, const uint64_t atom_id);
 universe_t *atom_update_vel(universe_t *universe, const args_t *args, const uint64_t atom_id);
 universe_t *atom_update_pos(universe_t *universe, const args_t *args, uint64_t atom_id);
 universe_t *atom_enforce_pbc(universe_t *universe, const uint64_t atom_id);
+universe_t *atom_image(vec3_t *image, universe_t *universe, const uint64_t atom_id, const vec3_t *from);
+
+/* ####################### */
+/* # REDUCEPOT FUNCTIONS # */
+/* ####################### */
+/* The following functions operate on the reducepot_s structure */
+reducepot_t *reducepot_init(reducepot_t *reducepot, const uint64_t atom_nb);
+void         reducepot_clean(reducepot_t *reducepot);
+reducepot_t *reducepot_adapt(reducepot_t *reducepot);
 
 /* ###################### */
 /* # UNIVERSE FUNCTIONS # */
 /* ###################### */
 /* The following functions operate on the universe_s structure */
+universe_t *universe_reset(universe_t *universe, const args_t *args);
 universe_t *universe_init(universe_t *universe, const args_t *args);
+universe_t *universe_init_replica(universe_t *universe, const universe_t *reference, const args_t *args);
+universe_t *universe_prepare(universe_t *universe, const args_t *args);
+universe_t *universe_load(universe_t *universe, const args_t *args);
+universe_t *universe_build(universe_t *universe, const args_t *args);
+void        universe_say(const universe_t *universe, const char *format, ...);
 void        universe_clean(universe_t *universe);
 universe_t *universe_populate(universe_t *universe);
+universe_t *universe_populate_site(universe_t *universe, vec3_t *site, const uint64_t id, const uint64_t nb, const uint8_t mode);
+universe_t *universe_populate_copy(universe_t *universe, const atom_t *reference, const uint64_t reference_nb, const uint64_t first, const vec3_t *site, mat3_t *rot);
+universe_t *universe_solvate(universe_t *universe, const args_t *args);
+universe_t *universe_molecule(universe_t *universe, const uint64_t molecule_id, uint64_t *first, uint64_t *nb);
 universe_t *universe_setvelocity(universe_t *universe);
-universe_t *universe_load_model(universe_t *universe, char *model_file_buffer);
-universe_t *universe_load_substrate(universe_t *universe, char *substrate_file_buffer);
-universe_t *universe_load_solvent(universe_t *universe, char *solvent_file_buffer);
+universe_t *universe_load_model(universe_t *universe, parser_t *parser);
+universe_t *universe_load_substrate(universe_t *universe, parser_t *parser);
+universe_t *universe_load_solvent(universe_t *universe, parser_t *parser);
 universe_t *universe_printstate(universe_t *universe);
 int         universe_simulate(universe_t *universe, const args_t *args);
+universe_t *universe_simulate_start(universe_t *universe, const args_t *args, writer_t *writer);
+universe_t *universe_simulate_step(universe_t *universe, const args_t *args, writer_t *writer);
+int         universe_simulate_end(universe_t *universe, writer_t *writer);
 universe_t *universe_iterate(universe_t *universe, const args_t *args);
+universe_t *universe_thermostat(universe_t *universe, const args_t *args);
+universe_t *universe_thermostat_bussi(universe_t *universe, const args_t *args);
+universe_t *universe_energy_alloc(universe_t *universe);
+double      universe_energy_sum(const universe_t *universe);
 universe_t *universe_energy_kinetic(universe_t *universe, double *energy);
 universe_t *universe_energy_potential(universe_t *universe, double *energy);
+universe_t *universe_energy_potential_cell(universe_t *universe, double *energy);
 universe_t *universe_energy_total(universe_t *universe, double *energy);
+double      universe_temperature(const universe_t *universe);
 universe_t *universe_reducepot(universe_t *universe, args_t *args);
-universe_t *universe_reducepot_coarse(universe_t *universe);
+universe_t *universe_reducepot_rigid(universe_t *universe, const uint64_t cycle);
+universe_t *universe_reducepot_coarse(universe_t *universe, reducepot_t *reducepot);
 universe_t *universe_reducepot_fine(universe_t *universe);
+universe_t *universe_reducepot_fine_batch(universe_t *universe, double *potential, double *scale);
 universe_t *universe_parameters_print(universe_t *universe, const args_t *args);
 
 #endif
@@ -8,6 +8,8 @@
 #ifndef VEC3_H
 #define VEC3_H
 
+#include "rng.h"
+
 /* Represents a 3D vector
  *
  * +- -+
@@ -56,7 +58,7 @@ vec3_t *vec3_mul(vec3_t *dest, const vec3_t *v, const double lambda); /* dest =
 vec3_t *vec3_div(vec3_t *dest, const vec3_t *v, const double lambda); /* dest = v / lambda */
 vec3_t *vec3_cross(vec3_t *dest, const vec3_t *v1, const vec3_t *v2); /* dest = v1 ^ v2 */
 vec3_t *vec3_unit(vec3_t *dest, const vec3_t *v);                     /* dest = v / |v| */
-vec3_t *vec3_marsaglia(vec3_t *v); /* Generates a random vector as per the 1972 Marsaglia method */
+vec3_t *vec3_marsaglia(vec3_t *v, rng_t *rng); /* Generates a random vector as per the 1972 Marsaglia method */
 
 double vec3_dot(const vec3_t *v1, const vec3_t *v2); /* Returns the dot product of v1 by v2 */
 double vec3_ang(const vec3_t *v1, const vec3_t *v2); /* Returns the angle between v1 and v2 */
@@ -64,5 +66,6 @@ double vec3_mag(const vec3_t *v);                    /* Returns the vector's mag
 
 mat3_t *mat3_transform_apply(mat3_t *m, vec3_t *v); /* Apply a transform matrix to a vector */
 mat3_t *mat3_transform_gen_rot(mat3_t *m, vec3_t *axis, const double angle); /* Generates a random rotation transform matrix */
+mat3_t *mat3_transform_gen_rand_rot(mat3_t *m, const double max_angle, rng_t *rng); /* Random axis, random angle in [0;max_angle[ */
 
 #endif
@@ -0,0 +1,74 @@
+/*
+ * writer.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "universe.h"
+
+/* The asynchronous writer moves trajectory output off the simulation thread.
+ * The step loop copies the atoms into a free snapshot slot and goes on, while
+ * a dedicated thread formats and writes the slots in order. The step loop
+ * only blocks when every slot is still waiting to be written.
+ *
+ * The writer thread works on its own view of the universe, pointing at the
+ * snapshot instead of the live atoms, so the existing output formats are used
+ * as they are.
+ */
+
+/* writer_slot_t */
+#define WRITER_SLOT_ATOM_DEFAULT        ((atom_t*)       NULL)
+#define WRITER_SLOT_ITERATIONS_DEFAULT  ((uint64_t)      0)
+#define WRITER_SLOT_SIZE_DEFAULT        ((double)        0.0)
+#define WRITER_SLOT_MAIN_DEFAULT        ((int)           0)
+
+/* writer_t */
+#define WRITER_SLOT_DEFAULT             ((writer_slot_t*) NULL)
+#define WRITER_SLOT_NB_DEFAULT          ((uint64_t)      0)
+#define WRITER_HEAD_DEFAULT             ((uint64_t)      0)
+#define WRITER_TAIL_DEFAULT             ((uint64_t)      0)
+#define WRITER_PENDING_DEFAULT          ((uint64_t)      0)
+#define WRITER_STOP_DEFAULT             ((int)           0)
+#define WRITER_ERR_DEFAULT              ((int)           0)
+#define WRITER_WAIT_TIME_DEFAULT        ((double)        0.0)
+#define WRITER_WAIT_NB_DEFAULT          ((uint64_t)      0)
+
+typedef struct writer_slot_s writer_slot_t;
+struct writer_slot_s
+{
+  atom_t *atom;         /* Snapshot of the atoms */
+  uint64_t iterations;  /* Iteration the snapshot was taken at */
+  double size;          /* (m) Universe size at that time */
+  int main;             /* Set if the main trajectory takes this frame, not only groups */
+};
+
+struct writer_s
+{
+  pthread_t thread;      /* The I/O thread */
+  pthread_mutex_t lock;  /* Protects everything below */
+  pthread_cond_t cond;   /* Signaled when a slot is filled or written */
+  universe_t view;       /* The I/O thread's own view of the universe */
+  writer_slot_t *slot;   /* Snapshot slots, used as a ring */
+  uint64_t slot_nb;      /* Number of slots, 0 to write synchronously */
+  uint64_t head;         /* Next slot to fill */
+  uint64_t tail;         /* Next slot to write */
+  uint64_t pending;      /* Slots filled but not written yet */
+  int stop;              /* Set when no more snapshots will come */
+  int err;               /* Set if the I/O thread failed to write */
+  double wait_time;      /* (s) Time the simulation spent waiting for a slot */
+  uint64_t wait_nb;      /* How many times it had to wait */
+};
+
+writer_t *writer_init(writer_t *writer, universe_t *universe, const uint64_t slot_nb);
+writer_t *writer_push(writer_t *writer, universe_t *universe, const int main);
+writer_t *writer_sync(writer_t *writer, universe_t *universe);
+writer_t *writer_clean(writer_t *writer, universe_t *universe);
+
+#endif
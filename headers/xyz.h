@@ -0,0 +1,29 @@
+/*
+ * xyz.h
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#ifndef XYZ_H
+#define XYZ_H
+
+#include <stddef.h>
+
+#include "universe.h"
+
+/* XYZ frames are formatted by chunks of atoms in parallel, into a buffer
+ * allocated once, and written with a single write() per frame. Coordinates
+ * go through a fixed-precision encoder that prints exactly what "%lf" would,
+ * and falls back to snprintf whenever the rounding is too close to call.
+ */
+
+#define XYZ_HEADER_MAX   ((size_t)48)   /* Room for the atom count and iteration */
+#define XYZ_FIELD_MAX    ((size_t)32)   /* Longest coordinate written, enough below 1E22 Å */
+#define XYZ_FAST_MAX     ((double)1E15) /* Larger scaled values use snprintf */
+
+size_t      xyz_format_double(char *out, const double x);
+universe_t *xyz_init(universe_t *universe);
+universe_t *xyz_frame(universe_t *universe);
+
+#endif
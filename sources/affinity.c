@@ -0,0 +1,307 @@
+/*
+ * affinity.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#define _GNU_SOURCE /* CPU sets and sched_setaffinity */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+
+#include "config.h"
+#include "affinity.h"
+#include "text.h"
+#include "util.h"
+
+#define AFFINITY_LINE_MAX 4096 /* Longest CPU or node list read from sysfs */
+#define AFFINITY_NODE_ONLINE "/sys/devices/system/node/online"
+#define AFFINITY_NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+
+/* Read a sysfs list, as in 0-3,8-11, returning how many ids it held or -1 */
+static int affinity_list(const char *path, int *list, const int max)
+{
+  FILE *file;
+  char buf[AFFINITY_LINE_MAX];
+  char *cur;
+  long first;
+  long last;
+  int nb;
+
+  if ((file = fopen(path, "r")) == NULL)
+  {
+    return (-1);
+  }
+  if (fgets(buf, sizeof(buf), file) == NULL)
+  {
+    fclose(file);
+    return (-1);
+  }
+  fclose(file);
+
+  nb = 0;
+  cur = buf;
+  while (*cur >= '0' && *cur <= '9')
+  {
+    first = strtol(cur, &cur, 10);
+    last = first;
+    if (*cur == '-')
+    {
+      last = strtol(cur + 1, &cur, 10);
+    }
+    for (; first<=last && nb<max; ++first)
+    {
+      list[nb++] = (int) first;
+    }
+    if (*cur == ',')
+    {
+      ++cur;
+    }
+  }
+
+  return (nb);
+}
+
+/* Order the CPUs this process may run on, for thread i to take the i-th one
+ * cpu_node tells the node of each. Returns how many there are, 0 on failure.
+ */
+static int affinity_order(const uint8_t mode, int *cpu, int *cpu_node)
+{
+  cpu_set_t allowed;
+  cpu_set_t taken;
+  char path[AFFINITY_LINE_MAX];
+  int node[CPU_SETSIZE];
+  int *node_cpu;
+  int *node_cpu_nb;
+  int list[CPU_SETSIZE];
+  int list_nb;
+  int node_nb;
+  int cpu_nb;
+  int i;
+  int j;
+  int k;
+
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+  {
+    return (0);
+  }
+
+  /* Without sysfs, every CPU is taken to be on a single node */
+  if ((node_nb = affinity_list(AFFINITY_NODE_ONLINE, node, CPU_SETSIZE)) <= 0)
+  {
+    node_nb = 1;
+    node[0] = 0;
+  }
+  if ((node_cpu = malloc(sizeof(int) * node_nb * CPU_SETSIZE)) == NULL ||
+      (node_cpu_nb = calloc(node_nb, sizeof(int))) == NULL)
+  {
+    free(node_cpu);
+    return (0);
+  }
+
+  /* The allowed CPUs of each node */
+  CPU_ZERO(&taken);
+  for (i=0; i<node_nb; ++i)
+  {
+    snprintf(path, sizeof(path), AFFINITY_NODE_CPULIST, node[i]);
+    if ((list_nb = affinity_list(path, list, CPU_SETSIZE)) < 0)
+    {
+      for (list_nb=0; list_nb<CPU_SETSIZE; ++list_nb)
+      {
+        list[list_nb] = list_nb;
+      }
+    }
+    for (j=0; j<list_nb; ++j)
+    {
+      if (CPU_ISSET(list[j], &allowed) && !CPU_ISSET(list[j], &taken))
+      {
+        CPU_SET(list[j], &taken);
+        node_cpu[i*CPU_SETSIZE + (node_cpu_nb[i]++)] = list[j];
+      }
+    }
+  }
+
+  /* Node after node, or one CPU of each node in turn */
+  cpu_nb = 0;
+  if (mode == PIN_MODE_COMPACT)
+  {
+    for (i=0; i<node_nb; ++i)
+    {
+      for (j=0; j<node_cpu_nb[i]; ++j)
+      {
+        cpu_node[cpu_nb] = node[i];
+        cpu[cpu_nb++] = node_cpu[i*CPU_SETSIZE + j];
+      }
+    }
+  }
+  else
+  {
+    for (k=0; k<CPU_SETSIZE; ++k)
+    {
+      for (i=0; i<node_nb; ++i)
+      {
+        if (k < node_cpu_nb[i])
+        {
+          cpu_node[cpu_nb] = node[i];
+          cpu[cpu_nb++] = node_cpu[i*CPU_SETSIZE + k];
+        }
+      }
+    }
+  }
+
+  free(node_cpu);
+  free(node_cpu_nb);
+
+  return (cpu_nb);
+}
+
+/* Set how many threads run the loops, 0 leaving the OpenMP default, and pin them */
+int affinity_init(const uint64_t thread_nb, const uint8_t mode)
+{
+  int cpu[CPU_SETSIZE];
+  int cpu_node[CPU_SETSIZE];
+  int *pinned;
+  int cpu_nb;
+  int err;
+  int i;
+
+  if (thread_nb > 0)
+  {
+    omp_set_num_threads((int) thread_nb);
+  }
+
+  if (mode == PIN_MODE_NONE)
+  {
+    return (1);
+  }
+
+  if ((cpu_nb = affinity_order(mode, cpu, cpu_node)) == 0 ||
+      (pinned = malloc(sizeof(int) * omp_get_max_threads())) == NULL)
+  {
+    return (retstri(0, TEXT_AFFINITY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The team is kept between parallel regions, its threads stay pinned */
+  err = 0;
+#pragma omp parallel
+  {
+    cpu_set_t set;
+    int thread;
+
+    thread = omp_get_thread_num();
+    pinned[thread] = thread % cpu_nb;
+    CPU_ZERO(&set);
+    CPU_SET(cpu[pinned[thread]], &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+#pragma omp atomic write
+      err = 1;
+    }
+  }
+
+  if (err)
+  {
+    free(pinned);
+    return (retstri(0, TEXT_AFFINITY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<omp_get_max_threads(); ++i)
+  {
+    printf(TEXT_AFFINITY_PIN, i, cpu[pinned[i]], cpu_node[pinned[i]]);
+  }
+  free(pinned);
+
+  return (1);
+}
+
+/* Allocate nb elements, each written to first by the thread the atom loops give it to */
+void *affinity_alloc(const uint64_t nb, const size_t size)
+{
+  char *ptr;
+  uint64_t i;
+
+  if ((ptr = malloc(nb * size)) == NULL)
+  {
+    return (NULL);
+  }
+
+#pragma omp parallel for schedule(static)
+  for (i=0; i<nb; ++i)
+  {
+    memset(ptr + i*size, 0, size);
+  }
+
+  return (ptr);
+}
+
+/* Tell which NUMA node holds which range of atoms */
+void affinity_report(const universe_t *universe)
+{
+  uintptr_t start;
+  uintptr_t end;
+  uint64_t page_nb;
+  uint64_t first;
+  uint64_t i;
+  void **page;
+  int *status;
+  int node_first;
+  int node;
+  long page_len;
+
+  if (universe->atom_nb == 0)
+  {
+    return;
+  }
+
+  page_len = sysconf(_SC_PAGESIZE);
+  start = ((uintptr_t) universe->atom) & ~((uintptr_t) page_len - 1);
+  end = (uintptr_t) (universe->atom + universe->atom_nb);
+  page_nb = (end - start + page_len - 1) / page_len;
+
+  if ((page = malloc(sizeof(void*) * page_nb)) == NULL ||
+      (status = malloc(sizeof(int) * page_nb)) == NULL)
+  {
+    free(page);
+    return;
+  }
+  for (i=0; i<page_nb; ++i)
+  {
+    page[i] = (void*) (start + i*page_len);
+  }
+
+  /* Without nodes to move the pages to, move_pages tells where they are */
+  if (syscall(SYS_move_pages, 0, (unsigned long) page_nb, page, NULL, status, 0) != 0)
+  {
+    for (i=0; i<page_nb; ++i)
+    {
+      status[i] = -1;
+    }
+  }
+
+  first = 0;
+  node_first = status[0];
+  for (i=1; i<=(universe->atom_nb); ++i)
+  {
+    node = (i < universe->atom_nb) ? status[((uintptr_t) &(universe->atom[i]) - start) / page_len] : -1;
+    if (i == universe->atom_nb || node != node_first)
+    {
+      if (node_first >= 0)
+        printf(TEXT_AFFINITY_NODE, first, i - 1, node_first);
+      else
+        printf(TEXT_AFFINITY_NODE_UNKNOWN, first, i - 1);
+      first = i;
+      node_first = node;
+    }
+  }
+
+  free(page);
+  free(status);
+}
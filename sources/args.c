@@ -10,11 +10,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <limits.h>
 
 #include "config.h"
 #include "args.h"
 #include "util.h"
 #include "text.h"
+#include "domain.h"
 
 args_t *args_init(args_t *args)
 {
@@ -27,6 +29,16 @@ args_t *args_init(args_t *args)
   args->path_out = ARGS_PATH_OUT_DEFAULT;
   args->path_solvent = ARGS_PATH_SOLVENT_DEFAULT;
   args->path_model = ARGS_PATH_MODEL_DEFAULT;
+  args->path_save_prepared = ARGS_PATH_SAVE_PREPARED_DEFAULT;
+  args->path_load_prepared = ARGS_PATH_LOAD_PREPARED_DEFAULT;
+  args->path_checkpoint = ARGS_PATH_CHECKPOINT_DEFAULT;
+  args->checkpoint_interval = ARGS_CHECKPOINT_INTERVAL_DEFAULT;
+  args->restart = ARGS_RESTART_DEFAULT;
+  args->group_nb = ARGS_GROUP_NB_DEFAULT;
+  args->path_shm = ARGS_PATH_SHM_DEFAULT;
+  args->shm_every = ARGS_SHM_EVERY_DEFAULT;
+  args->path_thermo = ARGS_PATH_THERMO_DEFAULT;
+  args->thermo_every = ARGS_THERMO_EVERY_DEFAULT;
   args->numerical = ARGS_NUMERICAL_DEFAULT;
   args->timestep = ARGS_TIMESTEP_DEFAULT;
   args->max_time = ARGS_MAX_TIME_DEFAULT;
@@ -37,29 +49,72 @@ args_t *args_init(args_t *args)
   args->frameskip = ARGS_FRAMESKIP_DEFAULT;
   args->reduce_potential = ARGS_REDUCE_POTENTIAL_DEFAULT;
   args->srand_seed = time(NULL);
+  args->srand_given = ARGS_SRAND_GIVEN_DEFAULT;
+  args->lattice = ARGS_LATTICE_DEFAULT;
+  args->reducepot_batch = ARGS_REDUCEPOT_BATCH_DEFAULT;
+  args->format = ARGS_FORMAT_DEFAULT;
+  args->precision = ARGS_PRECISION_DEFAULT;
+  args->out_buffers = ARGS_OUT_BUFFERS_DEFAULT;
+  args->size = ARGS_SIZE_DEFAULT;
+  args->cutoff = ARGS_CUTOFF_DEFAULT;
+  args->threads = ARGS_THREADS_DEFAULT;
+  args->pin = ARGS_PIN_DEFAULT;
+  args->ensemble = ARGS_ENSEMBLE_DEFAULT;
+  args->exchange = ARGS_EXCHANGE_DEFAULT;
+  args->temp_max = ARGS_TEMP_MAX_DEFAULT;
+  args->thermostat = ARGS_THERMOSTAT_DEFAULT;
+  args->reorder = ARGS_REORDER_DEFAULT;
   return (args);
 }
 
+/* Guess a trajectory format from its file extension */
+uint8_t args_format(const char *path)
+{
+  const char *extension;
+
+  extension = strrchr(path, '.');
+  if (extension != NULL && (!strcmp(extension + 1, FORMAT_DCD) || !strcmp(extension + 1, "DCD")))
+    return (OUTPUT_FORMAT_DCD);
+  if (extension != NULL && (!strcmp(extension + 1, FORMAT_STC) || !strcmp(extension + 1, "STC")))
+    return (OUTPUT_FORMAT_STC);
+
+  return (OUTPUT_FORMAT_XYZ);
+}
+
 args_t *args_check(args_t *args)
 {
-  /* A model MUST be specified */
-  if (args->path_model == ARGS_PATH_MODEL_DEFAULT)
+  size_t i;
+
+  /* Resuming needs something to resume from */
+  if (args->restart && args->path_checkpoint == ARGS_PATH_CHECKPOINT_DEFAULT)
+  {
+    return (retstr(NULL, TEXT_ARGS_RESTART_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* A model MUST be specified, unless the system comes prepared */
+  if (args->path_model == ARGS_PATH_MODEL_DEFAULT && args->path_load_prepared == ARGS_PATH_LOAD_PREPARED_DEFAULT && !args->restart)
   {
     return (retstr(NULL, TEXT_ARGS_MODEL_FAILURE, __FILE__, __LINE__));
   }
 
-  /* A substrate path MUST be specified */
-  if (args->path_substrate == ARGS_PATH_SUBSTRATE_DEFAULT)
+  /* A substrate path MUST be specified, same */
+  if (args->path_substrate == ARGS_PATH_SUBSTRATE_DEFAULT && args->path_load_prepared == ARGS_PATH_LOAD_PREPARED_DEFAULT && !args->restart)
   {
     return (retstr(NULL, TEXT_ARGS_SUBSTRATE_FAILURE, __FILE__, __LINE__));
   }
   
-  /* A solvent path MUST be specified */
-  if (args->path_solvent == ARGS_PATH_SOLVENT_DEFAULT)
+  /* A solvent path MUST be specified, same */
+  if (args->path_solvent == ARGS_PATH_SOLVENT_DEFAULT && args->path_load_prepared == ARGS_PATH_LOAD_PREPARED_DEFAULT && !args->restart)
   {
     return (retstr(NULL, TEXT_ARGS_SOLVENT_FAILURE, __FILE__, __LINE__));
   }
 
+  /* Checkpoints can't be taken more often than every iteration */
+  if (args->checkpoint_interval == 0)
+  {
+    return (retstr(NULL, TEXT_ARGS_CHECKPOINT_INTERVAL_FAILURE, __FILE__, __LINE__));
+  }
+
   /* And so must an output path */
   if (args->path_out == ARGS_PATH_OUT_DEFAULT)
   {
@@ -103,12 +158,137 @@ args_t *args_check(args_t *args)
     return (retstr(NULL, TEXT_ARGS_DENSITY_FAILURE, __FILE__, __LINE__));
   }
 
+  /* A universe can't be smaller than nothing */
+  if (args->size < 0.0)
+  {
+    return (retstr(NULL, TEXT_ARGS_SIZE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The placement mode must be one we know of */
+  if (args->lattice == POPULATE_MODE_INVALID)
+  {
+    return (retstr(NULL, TEXT_ARGS_LATTICE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The pinning mode too */
+  if (args->pin == PIN_MODE_INVALID)
+  {
+    return (retstr(NULL, TEXT_ARGS_PIN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* OpenMP counts its threads with an int */
+  if (args->threads > INT_MAX)
+  {
+    return (retstr(NULL, TEXT_ARGS_THREADS_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The trajectory format must be one we know of */
+  if (args->format == OUTPUT_FORMAT_INVALID)
+  {
+    return (retstr(NULL, TEXT_ARGS_FORMAT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Compressed trajectories can't be infinitely precise */
+  if (args->precision <= 0.0)
+  {
+    return (retstr(NULL, TEXT_ARGS_PRECISION_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Unless forced, it follows the output file extension */
+  if (args->format == OUTPUT_FORMAT_AUTO)
+  {
+    args->format = args_format(args->path_out);
+  }
+
+  /* Groups are written every so many iterations, not never */
+  for (i=0; i<(args->group_nb); ++i)
+  {
+    if (args->group_every[i] == 0)
+    {
+      return (retstr(NULL, TEXT_ARGS_GROUP_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  /* Same for the live stream */
+  if (args->path_shm != ARGS_PATH_SHM_DEFAULT && args->shm_every == 0)
+  {
+    return (retstr(NULL, TEXT_ARGS_SHM_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* And for the thermodynamics log */
+  if (args->path_thermo != ARGS_PATH_THERMO_DEFAULT && args->thermo_every == 0)
+  {
+    return (retstr(NULL, TEXT_ARGS_THERMO_FAILURE, __FILE__, __LINE__));
+  }
+
   /* A negative potential has no meaning here */
   if (args->reduce_potential <= 0.0)
   {
     return (retstr(NULL, TEXT_ARGS_REDUCEPOT_FAILURE, __FILE__, __LINE__));
   }
 
+  /* Nor does a negative distance */
+  if (args->cutoff < 0.0)
+  {
+    return (retstr(NULL, TEXT_ARGS_CUTOFF_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Processes only see the atoms around their slab, so a cutoff is needed.
+   * What needs the whole system in one place isn't spread over them yet.
+   */
+  if (domain_rank_nb() > 1)
+  {
+    if (args->cutoff == 0.0)
+    {
+      return (retstr(NULL, TEXT_ARGS_DOMAIN_CUTOFF_FAILURE, __FILE__, __LINE__));
+    }
+
+    if (args->restart || args->path_checkpoint != ARGS_PATH_CHECKPOINT_DEFAULT ||
+        args->group_nb || args->path_shm != ARGS_PATH_SHM_DEFAULT)
+    {
+      return (retstr(NULL, TEXT_ARGS_DOMAIN_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  /* An ensemble holds at least one replica */
+  if (args->ensemble == 0)
+  {
+    return (retstr(NULL, TEXT_ARGS_ENSEMBLE_NB_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Replicas are built from the input files, and only write their trajectory */
+  if (args->ensemble > 1 &&
+      (args->restart || args->path_checkpoint != ARGS_PATH_CHECKPOINT_DEFAULT ||
+       args->group_nb || args->path_shm != ARGS_PATH_SHM_DEFAULT ||
+       args->path_save_prepared != ARGS_PATH_SAVE_PREPARED_DEFAULT ||
+       args->path_load_prepared != ARGS_PATH_LOAD_PREPARED_DEFAULT ||
+       domain_rank_nb() > 1))
+  {
+    return (retstr(NULL, TEXT_ARGS_ENSEMBLE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* A thermostat can't react faster than the integration, nor in negative time */
+  if (args->thermostat < 0.0 || (args->thermostat > 0.0 && args->thermostat < args->timestep))
+  {
+    return (retstr(NULL, TEXT_ARGS_THERMOSTAT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Swapped replicas need a ladder to climb, and a thermostat to hold each rung */
+  if (args->exchange &&
+      (args->ensemble < 2 || args->thermostat == 0.0 ||
+       args->temperature <= 0.0 || args->temp_max <= args->temperature))
+  {
+    return (retstr(NULL, TEXT_ARGS_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Sorted atoms are put back in order in the snapshots of the output thread,
+   * which a single process writing synchronously doesn't take
+   */
+  if (args->reorder && (domain_rank_nb() > 1 || args->out_buffers == 0))
+  {
+    return (retstr(NULL, TEXT_ARGS_REORDER_FAILURE, __FILE__, __LINE__));
+  }
+
   return (args);
 }
 
@@ -141,6 +321,11 @@ args_t *args_parse(args_t *args, int argc, char **argv)
     else if (!strcmp(argv[i], FLAG_NUMERICAL_TETRA))
       args->numerical = MODE_NUMERICAL_TETRA;
 
+    else if (!strcmp(argv[i], FLAG_REDUCEPOT_BATCH))
+    {
+      args->reducepot_batch = 1;
+    }
+
     else if (!strcmp(argv[i], FLAG_TIME) && (i+1)<argc)
     {
       args->max_time = atof(argv[++i]);
@@ -189,6 +374,145 @@ args_t *args_parse(args_t *args, int argc, char **argv)
     else if (!strcmp(argv[i], FLAG_SRAND_SEED) && (i+1)<argc)
     {
       args->srand_seed = strtoul(argv[++i], NULL, 10);
+      args->srand_given = 1;
+    }
+
+    else if (!strcmp(argv[i], FLAG_SIZE) && (i+1)<argc)
+    {
+      args->size = atof(argv[++i]);
+    }
+
+    else if (!strcmp(argv[i], FLAG_LATTICE) && (i+1)<argc)
+    {
+      ++i;
+      if (!strcmp(argv[i], LATTICE_RANDOM))
+        args->lattice = POPULATE_MODE_RANDOM;
+      else if (!strcmp(argv[i], LATTICE_SC))
+        args->lattice = POPULATE_MODE_SC;
+      else if (!strcmp(argv[i], LATTICE_FCC))
+        args->lattice = POPULATE_MODE_FCC;
+      else if (!strcmp(argv[i], LATTICE_JITTER))
+        args->lattice = POPULATE_MODE_JITTER;
+      else
+        args->lattice = POPULATE_MODE_INVALID;
+    }
+
+    else if (!strcmp(argv[i], FLAG_FORMAT) && (i+1)<argc)
+    {
+      ++i;
+      if (!strcmp(argv[i], FORMAT_XYZ))
+        args->format = OUTPUT_FORMAT_XYZ;
+      else if (!strcmp(argv[i], FORMAT_DCD))
+        args->format = OUTPUT_FORMAT_DCD;
+      else if (!strcmp(argv[i], FORMAT_STC))
+        args->format = OUTPUT_FORMAT_STC;
+      else
+        args->format = OUTPUT_FORMAT_INVALID;
+    }
+
+    else if (!strcmp(argv[i], FLAG_OUT_BUFFERS) && (i+1)<argc)
+    {
+      args->out_buffers = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_CUTOFF) && (i+1)<argc)
+    {
+      args->cutoff = atof(argv[++i]);
+    }
+
+    else if (!strcmp(argv[i], FLAG_THREADS) && (i+1)<argc)
+    {
+      args->threads = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_PIN) && (i+1)<argc)
+    {
+      ++i;
+      if (!strcmp(argv[i], PIN_COMPACT))
+        args->pin = PIN_MODE_COMPACT;
+      else if (!strcmp(argv[i], PIN_SCATTER))
+        args->pin = PIN_MODE_SCATTER;
+      else
+        args->pin = PIN_MODE_INVALID;
+    }
+
+    else if (!strcmp(argv[i], FLAG_ENSEMBLE) && (i+1)<argc)
+    {
+      args->ensemble = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_EXCHANGE) && (i+1)<argc)
+    {
+      args->exchange = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_TEMP_MAX) && (i+1)<argc)
+    {
+      args->temp_max = atof(argv[++i]);
+    }
+
+    else if (!strcmp(argv[i], FLAG_THERMOSTAT) && (i+1)<argc)
+    {
+      args->thermostat = atof(argv[++i]);
+    }
+
+    else if (!strcmp(argv[i], FLAG_REORDER) && (i+1)<argc)
+    {
+      args->reorder = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_PRECISION) && (i+1)<argc)
+    {
+      args->precision = atof(argv[++i]);
+    }
+
+    else if (!strcmp(argv[i], FLAG_SAVE_PREPARED) && (i+1)<argc)
+    {
+      args->path_save_prepared = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], FLAG_LOAD_PREPARED) && (i+1)<argc)
+    {
+      args->path_load_prepared = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], FLAG_CHECKPOINT) && (i+1)<argc)
+    {
+      args->path_checkpoint = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], FLAG_CHECKPOINT_INTERVAL) && (i+1)<argc)
+    {
+      args->checkpoint_interval = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_RESTART))
+    {
+      args->restart = 1;
+    }
+
+    else if (!strcmp(argv[i], FLAG_GROUP) && (i+3)<argc)
+    {
+      if (args->group_nb == GROUP_MAX)
+      {
+        return (retstr(NULL, TEXT_ARGS_GROUP_NB_FAILURE, __FILE__, __LINE__));
+      }
+      args->group_selection[args->group_nb] = argv[++i];
+      args->group_every[args->group_nb] = strtoul(argv[++i], NULL, 10);
+      args->group_path[args->group_nb] = argv[++i];
+      ++(args->group_nb);
+    }
+
+    else if (!strcmp(argv[i], FLAG_SHM) && (i+2)<argc)
+    {
+      args->path_shm = argv[++i];
+      args->shm_every = strtoul(argv[++i], NULL, 10);
+    }
+
+    else if (!strcmp(argv[i], FLAG_THERMO) && (i+2)<argc)
+    {
+      args->path_thermo = argv[++i];
+      args->thermo_every = strtoul(argv[++i], NULL, 10);
     }
 
     else if (i == (argc-1))
@@ -201,9 +525,12 @@ args_t *args_parse(args_t *args, int argc, char **argv)
   /* Convert units */
   args->max_time *= 1E-9;          /* Scale from ns to s */
   args->timestep *= 1E-15;         /* Scale from fs to s */
+  args->thermostat *= 1E-15;       /* Scale from fs to s */
   args->pressure *= 1E2;           /* Scale from mbar to Pa */
   args->density  *= 1E3;           /* Scale from g.cm-1 to kg.m-1 */
   args->reduce_potential *= 1E-12; /* Scale from pJ to J */
+  args->size     *= 1E-10;         /* Scale from Å to m */
+  args->cutoff   *= 1E-10;         /* Scale from Å to m */
 
   if (args_check(args) == NULL)
   {
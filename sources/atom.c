@@ -53,12 +53,16 @@ void atom_clean(atom_t *atom)
   free(atom->bond_strength);
 }
 
-/* Get the force through numerical differentiation */
+/* Get the force through numerical differentiation
+ * The atom is moved on a copy of its position, the one in the universe is
+ * read by the other threads.
+ */
 universe_t *atom_update_frc_numerical(universe_t *universe, const uint64_t atom_id)
 {
   double potential;
   double potential_new;
   double h;
+  vec3_t pos;
 
   /* Reset the force vector */
   universe->atom[atom_id].frc.x = ATOM_FRC_X_DEFAULT;
@@ -66,65 +70,65 @@ universe_t *atom_update_frc_numerical(universe_t *universe, const uint64_t atom_
   universe->atom[atom_id].frc.z = ATOM_FRC_Z_DEFAULT;
 
   /* Differentiate potential over x axis */
-  h = ROOT_MACHINE_EPSILON * (universe->atom[atom_id].pos.x);
-  universe->atom[atom_id].pos.x -= h;
+  pos = universe->atom[atom_id].pos;
+  h = ROOT_MACHINE_EPSILON * (pos.x);
+  pos.x -= h;
   
-  if (potential_total(&potential, universe, atom_id) == NULL)
+  if (potential_total_at(&potential, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
   
-  universe->atom[atom_id].pos.x += 2*h;
+  pos.x += 2*h;
   
-  if (potential_total(&potential_new, universe, atom_id) == NULL)
+  if (potential_total_at(&potential_new, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
   
   universe->atom[atom_id].frc.x = -(potential_new - potential)/(2*h);
-  universe->atom[atom_id].pos.x -= h;
 
 
 
   /* Differentiate potential over y axis */
-  h = ROOT_MACHINE_EPSILON * (universe->atom[atom_id].pos.y);
-  universe->atom[atom_id].pos.y -= h;
+  pos = universe->atom[atom_id].pos;
+  h = ROOT_MACHINE_EPSILON * (pos.y);
+  pos.y -= h;
   
-  if (potential_total(&potential, universe, atom_id) == NULL)
+  if (potential_total_at(&potential, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
   
-  universe->atom[atom_id].pos.y += 2*h;
+  pos.y += 2*h;
   
-  if (potential_total(&potential_new, universe, atom_id) == NULL)
+  if (potential_total_at(&potential_new, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
   
   universe->atom[atom_id].frc.y = -(potential_new - potential)/(2*h);
-  universe->atom[atom_id].pos.y -= h;
 
 
 
   /* Differentiate potential over z axis */
-  h = ROOT_MACHINE_EPSILON * (universe->atom[atom_id].pos.z);
-  universe->atom[atom_id].pos.z -= h;
+  pos = universe->atom[atom_id].pos;
+  h = ROOT_MACHINE_EPSILON * (pos.z);
+  pos.z -= h;
   
-  if (potential_total(&potential, universe, atom_id) == NULL)
+  if (potential_total_at(&potential, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
   
-  universe->atom[atom_id].pos.z += 2*h;
+  pos.z += 2*h;
   
-  if (potential_total(&potential_new, universe, atom_id) == NULL)
+  if (potential_total_at(&potential_new, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
   
   universe->atom[atom_id].frc.z = -(potential_new - potential)/(2*h);
-  universe->atom[atom_id].pos.z -= h;
 
   return (universe);
 }
@@ -139,6 +143,7 @@ universe_t *atom_update_frc_numerical_tetrahedron(universe_t *universe, const ui
   double hx;
   double hy;
   double hz;
+  vec3_t pos;
 
   /* Reset the force vector */
   universe->atom[atom_id].frc.x = 0.0;
@@ -146,36 +151,37 @@ universe_t *atom_update_frc_numerical_tetrahedron(universe_t *universe, const ui
   universe->atom[atom_id].frc.z = 0.0;
 
   /* I'm not entirely sure why these are multiplied by the position, but this is how the other numerical differentiation does h */
-  hx = ROOT_MACHINE_EPSILON * (universe->atom[atom_id].pos.x);
-  hy = ROOT_MACHINE_EPSILON * (universe->atom[atom_id].pos.y);
-  hz = ROOT_MACHINE_EPSILON * (universe->atom[atom_id].pos.z);
+  pos = universe->atom[atom_id].pos;
+  hx = ROOT_MACHINE_EPSILON * (pos.x);
+  hy = ROOT_MACHINE_EPSILON * (pos.y);
+  hz = ROOT_MACHINE_EPSILON * (pos.z);
 
   /* Calculate potentials for each of the corners of the tetrahedron */
-  universe->atom[atom_id].pos.x -= hx;
-  universe->atom[atom_id].pos.y -= hy;
-  universe->atom[atom_id].pos.z -= hz;
-  if (potential_total(&potential_000, universe, atom_id) == NULL)
+  pos.x -= hx;
+  pos.y -= hy;
+  pos.z -= hz;
+  if (potential_total_at(&potential_000, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
 
-  universe->atom[atom_id].pos.x += 2*hx;
-  universe->atom[atom_id].pos.y += 2*hy;
-  if (potential_total(&potential_110, universe, atom_id) == NULL)
+  pos.x += 2*hx;
+  pos.y += 2*hy;
+  if (potential_total_at(&potential_110, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
 
-  universe->atom[atom_id].pos.x -= 2*hx;
-  universe->atom[atom_id].pos.z += 2*hz;
-  if (potential_total(&potential_011, universe, atom_id) == NULL)
+  pos.x -= 2*hx;
+  pos.z += 2*hz;
+  if (potential_total_at(&potential_011, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
 
-  universe->atom[atom_id].pos.x += 2*hx;
-  universe->atom[atom_id].pos.y -= 2*hy;
-  if (potential_total(&potential_101, universe, atom_id) == NULL)
+  pos.x += 2*hx;
+  pos.y -= 2*hy;
+  if (potential_total_at(&potential_101, universe, atom_id, &pos) == NULL)
   {
     return (retstr(NULL, TEXT_ATOM_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
   }
@@ -183,9 +189,6 @@ universe_t *atom_update_frc_numerical_tetrahedron(universe_t *universe, const ui
   universe->atom[atom_id].frc.x = -(potential_110 + potential_101 - potential_000 - potential_011)/(4*hx);
   universe->atom[atom_id].frc.y = -(potential_110 + potential_011 - potential_000 - potential_101)/(4*hy);
   universe->atom[atom_id].frc.z = -(potential_101 + potential_011 - potential_000 - potential_110)/(4*hz);
-  universe->atom[atom_id].pos.x -= hx;
-  universe->atom[atom_id].pos.y += hy;
-  universe->atom[atom_id].pos.z -= hz;
 
   return (universe);
 }
@@ -289,6 +292,66 @@ universe_t *atom_enforce_pbc(universe_t *universe, const uint64_t atom_id)
   return (universe);
 }
 
+/* Get the periodic image of an atom that's closest to a point
+ * The atom itself isn't moved, other threads may be reading it.
+ */
+universe_t *atom_image(vec3_t *image, universe_t *universe, const uint64_t atom_id, const vec3_t *from)
+{
+  vec3_t to_target;
+
+  *image = universe->atom[atom_id].pos;
+
+  /* Get the vector going to the target atom */
+  vec3_sub(&to_target, image, from);
+
+  if (to_target.x > 0.5*(universe->size))
+  {
+    image->x -= universe->size;
+  }
+
+  else if (to_target.x <= -0.5*(universe->size))
+  {
+    image->x += universe->size;
+  }
+
+  if (to_target.y > 0.5*(universe->size))
+  {
+    image->y -= universe->size;
+  }
+
+  else if (to_target.y <= -0.5*(universe->size))
+  {
+    image->y += universe->size;
+  }
+
+  if (to_target.z > 0.5*(universe->size))
+  {
+    image->z -= universe->size;
+  }
+
+  else if (to_target.z <= -0.5*(universe->size))
+  {
+    image->z += universe->size;
+  }
+
+  return (universe);
+}
+
+/* Returns 1 if two positions are within the cutoff of each other, or if there's none */
+int atom_is_near(const universe_t *universe, const vec3_t *pos_1, const vec3_t *pos_2)
+{
+  vec3_t vec;
+
+  if (universe->cutoff == 0.0)
+  {
+    return (1);
+  }
+
+  vec3_sub(&vec, pos_2, pos_1);
+
+  return (vec3_dot(&vec, &vec) <= POW2(universe->cutoff));
+}
+
 /* Returns 0 if a1 is not bonded to a2, returns 1 if it is bonded to a2 */
 int atom_is_bonded(universe_t *universe, const uint64_t a1, const uint64_t a2)
 {
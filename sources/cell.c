@@ -0,0 +1,231 @@
+/*
+ * cell.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "config.h"
+#include "cell.h"
+#include "domain.h"
+#include "force.h"
+#include "text.h"
+#include "util.h"
+
+/* Cell along an axis of a coordinate, through the periodic boundaries */
+static uint64_t cell_axis(const cell_t *cell, const universe_t *universe, const double x)
+{
+  double wrapped;
+  int64_t slot;
+
+  wrapped = x - (universe->size)*floor((x + 0.5*(universe->size))/(universe->size));
+  slot = (int64_t) floor((wrapped + 0.5*(universe->size))/(cell->side));
+  if (slot < 0)
+    return (0);
+  if (slot >= (int64_t) cell->side_nb)
+    return (cell->side_nb - 1);
+
+  return ((uint64_t) slot);
+}
+
+/* Cut the box into cells, if the cutoff leaves room for three along an axis
+ * With fewer, the cells around one would overlap and the universe is left
+ * without a grid, every pair being looked at.
+ */
+universe_t *cell_init(universe_t *universe)
+{
+  cell_t *cell;
+  uint64_t side_nb;
+  uint64_t x;
+  uint64_t y;
+  uint64_t z;
+  uint64_t n;
+  int64_t dx;
+  int64_t dy;
+  int64_t dz;
+
+  if (universe->cutoff == 0.0)
+  {
+    return (universe);
+  }
+  side_nb = (uint64_t) floor(universe->size/universe->cutoff);
+  if (side_nb < CELL_SIDE_MIN)
+  {
+    return (universe);
+  }
+
+  if ((cell = malloc(sizeof(cell_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_CELL_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  cell->side_nb = CELL_SIDE_NB_DEFAULT;
+  cell->cell_nb = CELL_CELL_NB_DEFAULT;
+  cell->side = CELL_SIDE_DEFAULT;
+  cell->first = CELL_FIRST_DEFAULT;
+  cell->atom = CELL_ATOM_DEFAULT;
+  cell->of = CELL_OF_DEFAULT;
+  cell->neighbour = CELL_NEIGHBOUR_DEFAULT;
+  cell->pair_nb = CELL_PAIR_NB_DEFAULT;
+  cell->pass_nb = CELL_PASS_NB_DEFAULT;
+  universe->cell = cell;
+
+  cell->side_nb = side_nb;
+  cell->cell_nb = side_nb*side_nb*side_nb;
+  cell->side = (universe->size)/side_nb;
+
+  if ((cell->first = malloc(sizeof(uint64_t) * (cell->cell_nb + 1))) == NULL ||
+      (cell->atom = malloc(sizeof(uint64_t) * (universe->atom_nb))) == NULL ||
+      (cell->of = malloc(sizeof(uint64_t) * (universe->atom_nb))) == NULL ||
+      (cell->neighbour = malloc(sizeof(uint64_t) * CELL_NEIGHBOUR_NB * (cell->cell_nb))) == NULL ||
+      (cell->pair_nb = malloc(sizeof(uint64_t) * (cell->cell_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_CELL_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The cells around each one, always in the same order */
+  for (z=0; z<side_nb; ++z)
+  {
+    for (y=0; y<side_nb; ++y)
+    {
+      for (x=0; x<side_nb; ++x)
+      {
+        n = 0;
+        for (dz=-1; dz<=1; ++dz)
+        {
+          for (dy=-1; dy<=1; ++dy)
+          {
+            for (dx=-1; dx<=1; ++dx)
+            {
+              cell->neighbour[CELL_NEIGHBOUR_NB*((z*side_nb + y)*side_nb + x) + (n++)] =
+                ((((z + side_nb + dz) % side_nb)*side_nb + ((y + side_nb + dy) % side_nb))*side_nb + ((x + side_nb + dx) % side_nb));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return (universe);
+}
+
+/* Sort the atoms into their cells, keeping them in index order within a cell
+ * Atoms out of this process' reach are left out.
+ */
+universe_t *cell_bin(universe_t *universe)
+{
+  cell_t *cell;
+  uint64_t i;
+  uint64_t j;
+  uint64_t c;
+  uint64_t around;
+
+  cell = universe->cell;
+
+  /* Count */
+  for (c=0; c<=(cell->cell_nb); ++c)
+  {
+    cell->first[c] = 0;
+  }
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (DOMAIN_IS_ABSENT(universe, i))
+    {
+      continue;
+    }
+    cell->of[i] = (cell_axis(cell, universe, universe->atom[i].pos.z)*(cell->side_nb) +
+                   cell_axis(cell, universe, universe->atom[i].pos.y))*(cell->side_nb) +
+                   cell_axis(cell, universe, universe->atom[i].pos.x);
+    ++(cell->first[cell->of[i] + 1]);
+  }
+
+  /* Before the first pass, estimate a cell's cost from the pairs it could form */
+  if (cell->pass_nb == 0)
+  {
+    for (c=0; c<(cell->cell_nb); ++c)
+    {
+      around = 0;
+      for (j=0; j<CELL_NEIGHBOUR_NB; ++j)
+      {
+        around += cell->first[cell->neighbour[CELL_NEIGHBOUR_NB*c + j] + 1];
+      }
+      cell->pair_nb[c] = cell->first[c + 1] * around;
+    }
+  }
+
+  /* Turn the counts into offsets, then place the atoms */
+  for (c=0; c<(cell->cell_nb); ++c)
+  {
+    cell->first[c + 1] += cell->first[c];
+  }
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (!DOMAIN_IS_ABSENT(universe, i))
+    {
+      cell->atom[(cell->first[cell->of[i]])++] = i;
+    }
+  }
+
+  /* Placing moved each offset to the next cell's, move them back */
+  for (c=cell->cell_nb; c>0; --c)
+  {
+    cell->first[c] = cell->first[c - 1];
+  }
+  cell->first[0] = 0;
+  ++(cell->pass_nb);
+
+  return (universe);
+}
+
+/* Update the forces of a cell's atoms, counting the pairs it took */
+universe_t *cell_update_frc(universe_t *universe, const uint64_t cell_id)
+{
+  cell_t *cell;
+  uint64_t pair_nb;
+  uint64_t i;
+  uint64_t atom_id;
+
+  cell = universe->cell;
+  pair_nb = 0;
+  for (i=cell->first[cell_id]; i<(cell->first[cell_id + 1]); ++i)
+  {
+    atom_id = cell->atom[i];
+    if (!DOMAIN_IS_OWNED(universe, atom_id))
+    {
+      continue;
+    }
+
+    universe->atom[atom_id].frc.x = ATOM_FRC_X_DEFAULT;
+    universe->atom[atom_id].frc.y = ATOM_FRC_Y_DEFAULT;
+    universe->atom[atom_id].frc.z = ATOM_FRC_Z_DEFAULT;
+
+    if (force_total_cell(&(universe->atom[atom_id].frc), universe, atom_id, &pair_nb) == NULL)
+    {
+      return (retstr(NULL, TEXT_CELL_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  /* The cost of the cell for the next pass */
+  cell->pair_nb[cell_id] = pair_nb;
+
+  return (universe);
+}
+
+void cell_clean(universe_t *universe)
+{
+  if (universe->cell == NULL)
+  {
+    return;
+  }
+
+  free(universe->cell->first);
+  free(universe->cell->atom);
+  free(universe->cell->of);
+  free(universe->cell->neighbour);
+  free(universe->cell->pair_nb);
+  free(universe->cell);
+  universe->cell = UNIVERSE_CELL_DEFAULT;
+}
@@ -0,0 +1,154 @@
+/*
+ * dcd.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dcd.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+
+/* Write a single 32 bits integer */
+static int dcd_write_int(FILE *file, const int32_t value)
+{
+  return (fwrite(&value, sizeof(int32_t), 1, file) == 1);
+}
+
+/* Write a record framed by its length, as the format wants it */
+static int dcd_write_record(FILE *file, const void *data, const size_t len)
+{
+  return (dcd_write_int(file, (int32_t) len) &&
+          fwrite(data, 1, len, file) == len &&
+          dcd_write_int(file, (int32_t) len));
+}
+
+/* Write the header of the trajectory, announcing no frame yet */
+universe_t *dcd_header(universe_t *universe, const args_t *args)
+{
+  int32_t icntrl[20];
+  float delta;
+  char title[2*DCD_TITLE_LEN + sizeof(int32_t)];
+  int32_t title_nb;
+  size_t len;
+  int32_t atom_nb;
+
+  /* The control record, starting with the magic number */
+  memset(icntrl, 0, sizeof(icntrl));
+  icntrl[0] = 0;                                  /* NSET: Frames in the file */
+  icntrl[1] = 0;                                  /* ISTART: First step saved */
+  icntrl[2] = (int32_t) (args->frameskip + 1);    /* NSAVC: Steps between frames */
+  icntrl[3] = 0;                                  /* NSTEP: Steps simulated */
+  delta = (float) (args->timestep / DCD_AKMA);
+  memcpy(&(icntrl[9]), &delta, sizeof(float));    /* DELTA: Timestep (AKMA) */
+  icntrl[10] = 1;                                 /* Frames carry a unit cell */
+  icntrl[19] = DCD_CHARMM_VERSION;
+
+  if (!dcd_write_int(universe->file_output, (int32_t) (sizeof(DCD_MAGIC)-1 + sizeof(icntrl))) ||
+      fwrite(DCD_MAGIC, 1, sizeof(DCD_MAGIC)-1, universe->file_output) != sizeof(DCD_MAGIC)-1 ||
+      fwrite(icntrl, sizeof(icntrl), 1, universe->file_output) != 1 ||
+      !dcd_write_int(universe->file_output, (int32_t) (sizeof(DCD_MAGIC)-1 + sizeof(icntrl))))
+  {
+    return (retstr(NULL, TEXT_DCD_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The title record, space padded lines */
+  title_nb = 2;
+  memcpy(title, &title_nb, sizeof(int32_t));
+  memset(title + sizeof(int32_t), ' ', 2*DCD_TITLE_LEN);
+  memcpy(title + sizeof(int32_t), DCD_TITLE, sizeof(DCD_TITLE)-1);
+  if (universe->meta_substrate_name != NULL)
+  {
+    len = strlen(universe->meta_substrate_name);
+    memcpy(title + sizeof(int32_t) + DCD_TITLE_LEN, universe->meta_substrate_name, (len < DCD_TITLE_LEN) ? len : DCD_TITLE_LEN);
+  }
+  if (!dcd_write_record(universe->file_output, title, sizeof(title)))
+  {
+    return (retstr(NULL, TEXT_DCD_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The atom count record */
+  atom_nb = (int32_t) universe->atom_nb;
+  if (!dcd_write_record(universe->file_output, &atom_nb, sizeof(int32_t)))
+  {
+    return (retstr(NULL, TEXT_DCD_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Append the current state to the trajectory */
+universe_t *dcd_frame(universe_t *universe)
+{
+  size_t i;
+  double cell[6];
+  float *coord;
+
+  /* The unit cell, in CHARMM order: A, gamma, B, beta, alpha, C */
+  cell[0] = universe->size*1E10;
+  cell[1] = 90.0;
+  cell[2] = universe->size*1E10;
+  cell[3] = 90.0;
+  cell[4] = 90.0;
+  cell[5] = universe->size*1E10;
+  if (!dcd_write_record(universe->file_output, cell, sizeof(cell)))
+  {
+    return (retstr(NULL, TEXT_DCD_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  if ((coord = malloc(sizeof(float) * 3 * (universe->atom_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_DCD_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* One record per axis */
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    coord[i] = (float) (universe->atom[i].pos.x*1E10);
+    coord[(universe->atom_nb) + i] = (float) (universe->atom[i].pos.y*1E10);
+    coord[2*(universe->atom_nb) + i] = (float) (universe->atom[i].pos.z*1E10);
+  }
+  for (i=0; i<3; ++i)
+  {
+    if (!dcd_write_record(universe->file_output, coord + i*(universe->atom_nb), sizeof(float) * (universe->atom_nb)))
+    {
+      free(coord);
+      return (retstr(NULL, TEXT_DCD_FRAME_FAILURE, __FILE__, __LINE__));
+    }
+  }
+  free(coord);
+
+  ++(universe->frame_nb);
+
+  return (universe);
+}
+
+/* Patch the header with how many frames were actually written */
+universe_t *dcd_close(universe_t *universe)
+{
+  long end;
+
+  end = ftell(universe->file_output);
+
+  if (fseek(universe->file_output, DCD_OFFSET_NSET, SEEK_SET) ||
+      !dcd_write_int(universe->file_output, (int32_t) universe->frame_nb))
+  {
+    return (retstr(NULL, TEXT_DCD_CLOSE_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (fseek(universe->file_output, DCD_OFFSET_NSTEP, SEEK_SET) ||
+      !dcd_write_int(universe->file_output, (int32_t) universe->iterations))
+  {
+    return (retstr(NULL, TEXT_DCD_CLOSE_FAILURE, __FILE__, __LINE__));
+  }
+
+  fseek(universe->file_output, end, SEEK_SET);
+
+  return (universe);
+}
@@ -0,0 +1,573 @@
+/*
+ * domain.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#ifdef SENPAI_MPI
+#include <mpi.h>
+#endif
+
+#include "config.h"
+#include "domain.h"
+#include "text.h"
+#include "util.h"
+#include "vec3.h"
+
+#ifdef SENPAI_MPI
+
+/* An atom handed over to its new owner */
+typedef struct domain_migrant_s domain_migrant_t;
+struct domain_migrant_s
+{
+  uint64_t id;
+  vec3_t pos;
+  vec3_t vel;
+  vec3_t acc;
+  vec3_t frc;
+};
+
+/* An atom shown to another process */
+typedef struct domain_ghost_s domain_ghost_t;
+struct domain_ghost_s
+{
+  uint64_t id;
+  vec3_t pos;
+};
+
+/* Make room in a buffer, keeping what's in it */
+static uint8_t *domain_reserve(uint8_t **buffer, size_t *buffer_len, const size_t len)
+{
+  uint8_t *grown;
+  size_t grown_len;
+
+  if (len <= *buffer_len)
+  {
+    return (*buffer);
+  }
+
+  grown_len = (*buffer_len) ? (*buffer_len) : len;
+  while (grown_len < len)
+  {
+    grown_len *= 2;
+  }
+  if ((grown = realloc(*buffer, grown_len)) == NULL)
+  {
+    return (NULL);
+  }
+  *buffer = grown;
+  *buffer_len = grown_len;
+
+  return (*buffer);
+}
+
+/* Bring a coordinate back into the box */
+static double domain_wrap(const universe_t *universe, const double x)
+{
+  return (x - (universe->size)*floor((x + 0.5*(universe->size))/(universe->size)));
+}
+
+/* Slab a coordinate falls in */
+static int domain_slab(const domain_t *domain, const universe_t *universe, const double x)
+{
+  int slab;
+
+  slab = (int) floor((domain_wrap(universe, x) + 0.5*(universe->size))/(domain->width));
+  if (slab < 0)
+    return (0);
+  if (slab >= domain->rank_nb)
+    return (domain->rank_nb - 1);
+
+  return (slab);
+}
+
+/* How far a coordinate is from a slab, through the periodic boundaries */
+static double domain_distance(const domain_t *domain, const universe_t *universe, const double x, const int slab)
+{
+  double low;
+  double high;
+  double shifted;
+  double dst;
+  double closest;
+  int k;
+
+  low = -0.5*(universe->size) + slab*(domain->width);
+  high = low + domain->width;
+
+  closest = universe->size;
+  for (k=-1; k<=1; ++k)
+  {
+    shifted = domain_wrap(universe, x) + k*(universe->size);
+    dst = (shifted < low) ? (low - shifted) : (shifted > high) ? (shifted - high) : 0.0;
+    if (dst < closest)
+    {
+      closest = dst;
+    }
+  }
+
+  return (closest);
+}
+
+/* Hand each process the bytes laid out for it in the send buffer
+ * Returns the number of bytes received.
+ */
+static domain_t *domain_alltoall(domain_t *domain, size_t *len)
+{
+  int i;
+
+  if (MPI_Alltoall(domain->send_nb, 1, MPI_INT, domain->recv_nb, 1, MPI_INT, MPI_COMM_WORLD) != MPI_SUCCESS)
+  {
+    return (NULL);
+  }
+
+  *len = 0;
+  for (i=0; i<(domain->rank_nb); ++i)
+  {
+    domain->recv_offset[i] = (int) *len;
+    *len += domain->recv_nb[i];
+  }
+  if (domain_reserve(&(domain->recv), &(domain->recv_len), *len) == NULL)
+  {
+    return (NULL);
+  }
+
+  if (MPI_Alltoallv(domain->send, domain->send_nb, domain->send_offset, MPI_BYTE,
+                    domain->recv, domain->recv_nb, domain->recv_offset, MPI_BYTE, MPI_COMM_WORLD) != MPI_SUCCESS)
+  {
+    return (NULL);
+  }
+
+  return (domain);
+}
+
+/* Hand the atoms that left the slab over to their new owner */
+static universe_t *domain_migrate(universe_t *universe)
+{
+  domain_t *domain;
+  domain_migrant_t migrant;
+  atom_t *atom;
+  size_t len;
+  size_t i;
+  int rank;
+
+  domain = universe->domain;
+
+  /* Lay the atoms out by destination */
+  len = 0;
+  for (rank=0; rank<(domain->rank_nb); ++rank)
+  {
+    domain->send_offset[rank] = (int) len;
+    for (i=0; i<(universe->atom_nb) && rank != domain->rank; ++i)
+    {
+      atom = &(universe->atom[i]);
+      if (domain->state[i] != DOMAIN_OWNED || domain_slab(domain, universe, atom->pos.x) != rank)
+      {
+        continue;
+      }
+
+      if (domain_reserve(&(domain->send), &(domain->send_len), len + sizeof(domain_migrant_t)) == NULL)
+      {
+        return (retstr(NULL, TEXT_DOMAIN_EXCHANGE_FAILURE, __FILE__, __LINE__));
+      }
+      migrant.id = i;
+      migrant.pos = atom->pos;
+      migrant.vel = atom->vel;
+      migrant.acc = atom->acc;
+      migrant.frc = atom->frc;
+      memcpy(domain->send + len, &migrant, sizeof(domain_migrant_t));
+      len += sizeof(domain_migrant_t);
+
+      domain->state[i] = DOMAIN_ABSENT;
+    }
+    domain->send_nb[rank] = (int) len - domain->send_offset[rank];
+  }
+
+  if (domain_alltoall(domain, &len) == NULL)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Take the newcomers in, as they were */
+  for (i=0; i<len; i+=sizeof(domain_migrant_t))
+  {
+    memcpy(&migrant, domain->recv + i, sizeof(domain_migrant_t));
+    atom = &(universe->atom[migrant.id]);
+    atom->pos = migrant.pos;
+    atom->vel = migrant.vel;
+    atom->acc = migrant.acc;
+    atom->frc = migrant.frc;
+    domain->state[migrant.id] = DOMAIN_OWNED;
+  }
+
+  return (universe);
+}
+
+/* Show the atoms near other slabs to their owners */
+static universe_t *domain_halo(universe_t *universe)
+{
+  domain_t *domain;
+  domain_ghost_t ghost;
+  size_t len;
+  size_t i;
+  int rank;
+
+  domain = universe->domain;
+
+  /* What was seen last time has moved since */
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (domain->state[i] == DOMAIN_HALO)
+    {
+      domain->state[i] = DOMAIN_ABSENT;
+    }
+  }
+
+  /* An atom goes to every slab it's close enough to */
+  len = 0;
+  for (rank=0; rank<(domain->rank_nb); ++rank)
+  {
+    domain->send_offset[rank] = (int) len;
+    for (i=0; i<(universe->atom_nb) && rank != domain->rank; ++i)
+    {
+      if (domain->state[i] != DOMAIN_OWNED || domain_distance(domain, universe, universe->atom[i].pos.x, rank) >= domain->halo)
+      {
+        continue;
+      }
+
+      if (domain_reserve(&(domain->send), &(domain->send_len), len + sizeof(domain_ghost_t)) == NULL)
+      {
+        return (retstr(NULL, TEXT_DOMAIN_EXCHANGE_FAILURE, __FILE__, __LINE__));
+      }
+      ghost.id = i;
+      ghost.pos = universe->atom[i].pos;
+      memcpy(domain->send + len, &ghost, sizeof(domain_ghost_t));
+      len += sizeof(domain_ghost_t);
+    }
+    domain->send_nb[rank] = (int) len - domain->send_offset[rank];
+  }
+
+  if (domain_alltoall(domain, &len) == NULL)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<len; i+=sizeof(domain_ghost_t))
+  {
+    memcpy(&ghost, domain->recv + i, sizeof(domain_ghost_t));
+    universe->atom[ghost.id].pos = ghost.pos;
+    domain->state[ghost.id] = DOMAIN_HALO;
+  }
+
+  return (universe);
+}
+
+/* Make sure every atom two bonds away from an owned one is in sight
+ * Bonds and angles don't care about the cutoff.
+ */
+static universe_t *domain_reach(universe_t *universe)
+{
+  domain_t *domain;
+  atom_t *atom;
+  atom_t *node;
+  size_t i;
+  size_t j;
+  size_t k;
+
+  domain = universe->domain;
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (domain->state[i] != DOMAIN_OWNED)
+    {
+      continue;
+    }
+
+    atom = &(universe->atom[i]);
+    for (j=0; j<(atom->bond_nb); ++j)
+    {
+      if (domain->state[atom->bond[j]] == DOMAIN_ABSENT)
+      {
+        return (retstr(NULL, TEXT_DOMAIN_REACH_FAILURE, __FILE__, __LINE__));
+      }
+
+      node = &(universe->atom[atom->bond[j]]);
+      for (k=0; k<(node->bond_nb); ++k)
+      {
+        if (domain->state[node->bond[k]] == DOMAIN_ABSENT)
+        {
+          return (retstr(NULL, TEXT_DOMAIN_REACH_FAILURE, __FILE__, __LINE__));
+        }
+      }
+    }
+  }
+
+  return (universe);
+}
+
+#endif
+
+/* Start the MPI runtime, only the first process talks */
+int domain_start(int *argc, char ***argv)
+{
+#ifdef SENPAI_MPI
+  if (MPI_Init(argc, argv) != MPI_SUCCESS)
+  {
+    return (retstri(0, TEXT_DOMAIN_START_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (domain_rank() != 0 && freopen("/dev/null", "w", stdout) == NULL)
+  {
+    return (retstri(0, TEXT_DOMAIN_START_FAILURE, __FILE__, __LINE__));
+  }
+#else
+  (void) argc;
+  (void) argv;
+#endif
+
+  return (1);
+}
+
+/* Stop the MPI runtime, passing the exit status through
+ * A process failing alone would leave the others waiting on it forever, the
+ * whole run is brought down instead.
+ */
+int domain_stop(const int status)
+{
+#ifdef SENPAI_MPI
+  int initialized;
+  int finalized;
+
+  MPI_Initialized(&initialized);
+  MPI_Finalized(&finalized);
+  if (initialized && !finalized)
+  {
+    if (status != EXIT_SUCCESS && domain_rank_nb() > 1)
+    {
+      MPI_Abort(MPI_COMM_WORLD, status);
+    }
+    MPI_Finalize();
+  }
+#endif
+
+  return (status);
+}
+
+/* Which process this is, the first one unless MPI was started */
+int domain_rank(void)
+{
+#ifdef SENPAI_MPI
+  int initialized;
+  int rank;
+
+  MPI_Initialized(&initialized);
+  if (initialized && MPI_Comm_rank(MPI_COMM_WORLD, &rank) == MPI_SUCCESS)
+  {
+    return (rank);
+  }
+#endif
+
+  return (DOMAIN_RANK_DEFAULT);
+}
+
+/* How many processes share the simulation */
+int domain_rank_nb(void)
+{
+#ifdef SENPAI_MPI
+  int initialized;
+  int rank_nb;
+
+  MPI_Initialized(&initialized);
+  if (initialized && MPI_Comm_size(MPI_COMM_WORLD, &rank_nb) == MPI_SUCCESS)
+  {
+    return (rank_nb);
+  }
+#endif
+
+  return (DOMAIN_RANK_NB_DEFAULT);
+}
+
+/* Split the universe between the processes
+ * Every process holds the same system at this point, each one takes its slab.
+ * Alone, there's nothing to split and the universe is left as it is.
+ */
+universe_t *domain_init(universe_t *universe)
+{
+#ifdef SENPAI_MPI
+  domain_t *domain;
+  size_t i;
+
+  if (domain_rank_nb() == 1)
+  {
+    return (universe);
+  }
+
+  if ((domain = malloc(sizeof(domain_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  domain->rank = domain_rank();
+  domain->rank_nb = domain_rank_nb();
+  domain->state = DOMAIN_STATE_DEFAULT;
+  domain->width = DOMAIN_WIDTH_DEFAULT;
+  domain->halo = DOMAIN_HALO_DEFAULT;
+  domain->send_nb = DOMAIN_SEND_NB_DEFAULT;
+  domain->send_offset = DOMAIN_SEND_OFFSET_DEFAULT;
+  domain->recv_nb = DOMAIN_RECV_NB_DEFAULT;
+  domain->recv_offset = DOMAIN_RECV_OFFSET_DEFAULT;
+  domain->send = DOMAIN_SEND_DEFAULT;
+  domain->send_len = DOMAIN_SEND_LEN_DEFAULT;
+  domain->recv = DOMAIN_RECV_DEFAULT;
+  domain->recv_len = DOMAIN_RECV_LEN_DEFAULT;
+  universe->domain = domain;
+
+  if ((domain->state = malloc(sizeof(uint8_t) * (universe->atom_nb))) == NULL ||
+      (domain->send_nb = malloc(sizeof(int) * (domain->rank_nb))) == NULL ||
+      (domain->send_offset = malloc(sizeof(int) * (domain->rank_nb))) == NULL ||
+      (domain->recv_nb = malloc(sizeof(int) * (domain->rank_nb))) == NULL ||
+      (domain->recv_offset = malloc(sizeof(int) * (domain->rank_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  domain->width = (universe->size)/(domain->rank_nb);
+  domain->halo = universe->cutoff + DOMAIN_HALO_MARGIN;
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    domain->state[i] = (domain_slab(domain, universe, universe->atom[i].pos.x) == domain->rank) ? DOMAIN_OWNED : DOMAIN_ABSENT;
+  }
+
+  if (domain_halo(universe) == NULL || domain_reach(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_INIT_FAILURE, __FILE__, __LINE__));
+  }
+#endif
+
+  return (universe);
+}
+
+/* Once the positions are updated, move the atoms between processes
+ * Those that left the slab go to their new owner, then every process gets
+ * the atoms within reach of its slab.
+ */
+universe_t *domain_exchange(universe_t *universe)
+{
+#ifdef SENPAI_MPI
+  if (domain_migrate(universe) == NULL ||
+      domain_halo(universe) == NULL ||
+      domain_reach(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+#endif
+
+  return (universe);
+}
+
+/* Bring the positions of every atom to the first process, for it to write them */
+universe_t *domain_gather(universe_t *universe)
+{
+#ifdef SENPAI_MPI
+  domain_t *domain;
+  domain_ghost_t ghost;
+  size_t len;
+  size_t i;
+  int rank;
+  int count;
+
+  domain = universe->domain;
+
+  /* The first process already has its own */
+  len = 0;
+  for (i=0; i<(universe->atom_nb) && domain->rank != 0; ++i)
+  {
+    if (domain->state[i] != DOMAIN_OWNED)
+    {
+      continue;
+    }
+
+    if (domain_reserve(&(domain->send), &(domain->send_len), len + sizeof(domain_ghost_t)) == NULL)
+    {
+      return (retstr(NULL, TEXT_DOMAIN_GATHER_FAILURE, __FILE__, __LINE__));
+    }
+    ghost.id = i;
+    ghost.pos = universe->atom[i].pos;
+    memcpy(domain->send + len, &ghost, sizeof(domain_ghost_t));
+    len += sizeof(domain_ghost_t);
+  }
+  count = (int) len;
+
+  if (MPI_Gather(&count, 1, MPI_INT, domain->recv_nb, 1, MPI_INT, 0, MPI_COMM_WORLD) != MPI_SUCCESS)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_GATHER_FAILURE, __FILE__, __LINE__));
+  }
+
+  len = 0;
+  if (domain->rank == 0)
+  {
+    for (rank=0; rank<(domain->rank_nb); ++rank)
+    {
+      domain->recv_offset[rank] = (int) len;
+      len += domain->recv_nb[rank];
+    }
+    if (domain_reserve(&(domain->recv), &(domain->recv_len), len) == NULL)
+    {
+      return (retstr(NULL, TEXT_DOMAIN_GATHER_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  if (MPI_Gatherv(domain->send, count, MPI_BYTE, domain->recv, domain->recv_nb, domain->recv_offset, MPI_BYTE, 0, MPI_COMM_WORLD) != MPI_SUCCESS)
+  {
+    return (retstr(NULL, TEXT_DOMAIN_GATHER_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<len; i+=sizeof(domain_ghost_t))
+  {
+    memcpy(&ghost, domain->recv + i, sizeof(domain_ghost_t));
+    universe->atom[ghost.id].pos = ghost.pos;
+  }
+#endif
+
+  return (universe);
+}
+
+/* Sum a value over the processes, every one of them getting the total */
+double domain_sum(const universe_t *universe, const double value)
+{
+#ifdef SENPAI_MPI
+  double sum;
+
+  if (universe->domain != NULL && MPI_Allreduce(&value, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD) == MPI_SUCCESS)
+  {
+    return (sum);
+  }
+#else
+  (void) universe;
+#endif
+
+  return (value);
+}
+
+void domain_clean(universe_t *universe)
+{
+  if (universe->domain == NULL)
+  {
+    return;
+  }
+
+  free(universe->domain->state);
+  free(universe->domain->send_nb);
+  free(universe->domain->send_offset);
+  free(universe->domain->recv_nb);
+  free(universe->domain->recv_offset);
+  free(universe->domain->send);
+  free(universe->domain->recv);
+  free(universe->domain);
+  universe->domain = UNIVERSE_DOMAIN_DEFAULT;
+}
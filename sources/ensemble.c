@@ -0,0 +1,447 @@
+/*
+ * ensemble.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "config.h"
+#include "ensemble.h"
+#include "universe.h"
+#include "writer.h"
+#include "rng.h"
+#include "reorder.h"
+#include "thermo.h"
+#include "text.h"
+#include "util.h"
+
+/* The output path of a replica, its number going before the extension */
+static char *ensemble_path(const char *path_out, const uint64_t replica_id)
+{
+  const char *slash;
+  const char *dot;
+  char *path;
+  size_t stem_len;
+  size_t path_len;
+
+  /* Room for the dot, the 20 digits of the number, and the terminator */
+  path_len = strlen(path_out) + 22;
+  if ((path = malloc(path_len)) == NULL)
+  {
+    return (retstr(NULL, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* A dot in a directory name isn't an extension */
+  slash = strrchr(path_out, '/');
+  dot = strrchr(path_out, '.');
+  if (dot == NULL || (slash != NULL && dot < slash))
+  {
+    dot = path_out + strlen(path_out);
+  }
+  stem_len = (size_t) (dot - path_out);
+
+  memcpy(path, path_out, stem_len);
+  snprintf(path + stem_len, path_len - stem_len, ".%" PRIu64 "%s", replica_id, dot);
+
+  return (path);
+}
+
+/* Simulated time per day of wall time (ns/day), given both in seconds */
+static double ensemble_ns_day(const double simulated, const double wall)
+{
+  return ((wall > 0.0) ? simulated*1E9*86400.0/wall : 0.0);
+}
+
+/* Tell how fast the replicas went, on their own and all together */
+static void ensemble_speed(const universe_t *replica, const uint64_t replica_nb, const double *busy, const double wall)
+{
+  double simulated;
+  uint64_t i;
+
+  simulated = 0.0;
+  for (i=0; i<replica_nb; ++i)
+  {
+    printf(TEXT_ENSEMBLE_REPLICA_SPEED, i, replica[i].time*1E9, busy[i], ensemble_ns_day(replica[i].time, busy[i]));
+    simulated += replica[i].time;
+  }
+  printf(TEXT_ENSEMBLE_SPEED, simulated*1E9, wall, replica_nb, ensemble_ns_day(simulated, wall));
+}
+
+/* Reduce and simulate each replica on its own */
+static int ensemble_independent(universe_t *replica, args_t *replica_args, const uint64_t replica_nb, const int concurrent, const int per)
+{
+  double *busy;  /* (s) Time each replica spent simulating */
+  double start;
+  uint64_t i;
+  int failed;
+
+  if ((busy = calloc(replica_nb, sizeof(double))) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  failed = 0;
+  start = omp_get_wtime();
+#pragma omp parallel for num_threads(concurrent) schedule(dynamic, 1) reduction(|:failed)
+  for (i=0; i<replica_nb; ++i)
+  {
+    double replica_start;
+
+    omp_set_num_threads(per);
+    if (universe_reducepot(&(replica[i]), &(replica_args[i])) == NULL)
+    {
+      failed |= retstri(1, TEXT_ENSEMBLE_REPLICA_FAILURE, __FILE__, __LINE__);
+      continue;
+    }
+    replica_start = omp_get_wtime();
+    if (universe_simulate(&(replica[i]), &(replica_args[i])) != EXIT_SUCCESS)
+    {
+      failed |= retstri(1, TEXT_ENSEMBLE_REPLICA_FAILURE, __FILE__, __LINE__);
+      continue;
+    }
+    busy[i] = omp_get_wtime() - replica_start;
+    printf(TEXT_ENSEMBLE_REPLICA_DONE, i, replica_args[i].srand_seed, replica_args[i].path_out);
+    fflush(stdout);
+  }
+
+  /* The wall time takes in the potential reductions, the replicas' own don't */
+  if (!failed)
+  {
+    ensemble_speed(replica, replica_nb, busy, omp_get_wtime() - start);
+  }
+  free(busy);
+
+  return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* Swap the systems of two replicas, if Metropolis agrees
+ * The velocities are rescaled to the temperature they arrive at.
+ */
+static int ensemble_swap(universe_t *cold, universe_t *hot, const double potential_cold, const double potential_hot, rng_t *rng)
+{
+  atom_t *atom;
+  uint64_t *order;
+  double delta;
+  double scale;
+  uint64_t i;
+
+  delta = (1.0/(C_BOLTZMANN*(cold->temperature)) - 1.0/(C_BOLTZMANN*(hot->temperature))) * (potential_cold - potential_hot);
+  if (delta < 0.0 && rng_uniform(rng) >= exp(delta))
+  {
+    return (0);
+  }
+
+  atom = cold->atom;
+  cold->atom = hot->atom;
+  hot->atom = atom;
+
+  /* Sorted atoms take the order they were sorted in along */
+  if (cold->reorder != NULL)
+  {
+    order = cold->reorder->order;
+    cold->reorder->order = hot->reorder->order;
+    hot->reorder->order = order;
+    order = cold->reorder->where;
+    cold->reorder->where = hot->reorder->where;
+    hot->reorder->where = order;
+  }
+
+  scale = sqrt((cold->temperature)/(hot->temperature));
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(cold->atom_nb); ++i)
+  {
+    vec3_mul(&(cold->atom[i].vel), &(cold->atom[i].vel), scale);
+    vec3_mul(&(hot->atom[i].vel), &(hot->atom[i].vel), 1.0/scale);
+  }
+
+  return (1);
+}
+
+/* Start the replicas from the first one's reduced system, for every replica
+ * to hold the same atoms and be able to swap them
+ */
+static int ensemble_share(universe_t *replica, args_t *replica_args, const uint64_t replica_nb)
+{
+  uint64_t i;
+  uint64_t j;
+
+  if (universe_reducepot(&(replica[0]), &(replica_args[0])) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+  for (i=1; i<replica_nb; ++i)
+  {
+    if (replica[i].atom_nb != replica[0].atom_nb)
+    {
+      return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__));
+    }
+    for (j=0; j<(replica[i].atom_nb); ++j)
+    {
+      replica[i].atom[j].pos = replica[0].atom[j].pos;
+    }
+  }
+
+  return (EXIT_SUCCESS);
+}
+
+/* Step the started replicas side by side, every args->exchange iterations
+ * trying to swap neighbouring ones, the even pairs then the odd pairs in turn
+ */
+static int ensemble_rounds(universe_t *replica, args_t *replica_args, const uint64_t replica_nb, const int concurrent, const int per,
+                           writer_t *writer, double *potential, double *busy, uint64_t *tried, uint64_t *accepted)
+{
+  uint64_t round;
+  uint64_t i;
+  uint64_t k;
+  rng_t rng;
+  int failed;
+
+  round = 0;
+  while (replica[0].time < replica_args[0].max_time)
+  {
+    failed = 0;
+#pragma omp parallel for num_threads(concurrent) schedule(dynamic, 1) private(k) reduction(|:failed)
+    for (i=0; i<replica_nb; ++i)
+    {
+      double replica_start;
+
+      omp_set_num_threads(per);
+      replica_start = omp_get_wtime();
+      for (k=0; k<(replica_args[i].exchange) && replica[i].time < replica_args[i].max_time; ++k)
+      {
+        if (universe_simulate_step(&(replica[i]), &(replica_args[i]), &(writer[i])) == NULL)
+        {
+          failed |= retstri(1, TEXT_ENSEMBLE_REPLICA_FAILURE, __FILE__, __LINE__);
+          break;
+        }
+      }
+      busy[i] += omp_get_wtime() - replica_start;
+    }
+    if (failed)
+    {
+      return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__));
+    }
+    if (replica[0].time >= replica_args[0].max_time)
+    {
+      break;
+    }
+
+    /* Within the cutoff if there's one, each pair counted from both of its atoms */
+#pragma omp parallel for num_threads(concurrent) schedule(dynamic, 1) reduction(|:failed)
+    for (i=0; i<replica_nb; ++i)
+    {
+      omp_set_num_threads(per);
+      if (((replica[i].cell != NULL) ? universe_energy_potential_cell(&(replica[i]), &(potential[i])) :
+                                       universe_energy_potential(&(replica[i]), &(potential[i]))) == NULL)
+      {
+        failed |= retstri(1, TEXT_ENSEMBLE_REPLICA_FAILURE, __FILE__, __LINE__);
+      }
+      potential[i] *= 0.5;
+    }
+    if (failed)
+    {
+      return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__));
+    }
+
+    for (i=(round % 2); i+1<replica_nb; i+=2)
+    {
+      rng_init(&rng, replica[0].seed, i, round, RNG_PURPOSE_EXCHANGE);
+      ++(tried[i]);
+      accepted[i] += ensemble_swap(&(replica[i]), &(replica[i+1]), potential[i], potential[i+1], &rng);
+      if (thermo_exchange(&(replica[i]), replica[i+1].temperature, accepted[i], tried[i]) == NULL)
+      {
+        return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__));
+      }
+    }
+    ++round;
+  }
+
+  return (EXIT_SUCCESS);
+}
+
+/* Run the exchange, then stop the writers and clean the replicas however it went */
+static int ensemble_exchange(universe_t *replica, args_t *replica_args, const uint64_t replica_nb, const int concurrent, const int per)
+{
+  writer_t *writer;
+  double *potential;   /* (J) Potential energy of each replica */
+  double *busy;        /* (s) Time each replica spent stepping */
+  uint64_t *tried;     /* Swaps tried between each replica and the next one */
+  uint64_t *accepted;  /* And how many went through */
+  uint64_t started;    /* Replicas whose writer is running */
+  uint64_t i;
+  double start;
+  int status;
+
+  status = EXIT_SUCCESS;
+  started = 0;
+  writer = malloc(sizeof(writer_t) * replica_nb);
+  potential = malloc(sizeof(double) * replica_nb);
+  busy = calloc(replica_nb, sizeof(double));
+  tried = calloc(replica_nb, sizeof(uint64_t));
+  accepted = calloc(replica_nb, sizeof(uint64_t));
+  if (writer == NULL || potential == NULL || busy == NULL || tried == NULL || accepted == NULL)
+  {
+    status = retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__);
+  }
+
+  if (status == EXIT_SUCCESS)
+  {
+    status = ensemble_share(replica, replica_args, replica_nb);
+  }
+  for (i=0; i<replica_nb && status == EXIT_SUCCESS; ++i)
+  {
+    if (universe_simulate_start(&(replica[i]), &(replica_args[i]), &(writer[i])) == NULL)
+    {
+      status = retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__);
+      break;
+    }
+    ++started;
+  }
+  if (status == EXIT_SUCCESS)
+  {
+    start = omp_get_wtime();
+    status = ensemble_rounds(replica, replica_args, replica_nb, concurrent, per, writer, potential, busy, tried, accepted);
+
+    /* The wall time takes in the swaps and the energies they need, the replicas' own don't */
+    if (status == EXIT_SUCCESS)
+    {
+      ensemble_speed(replica, replica_nb, busy, omp_get_wtime() - start);
+    }
+  }
+
+  /* The started replicas wait for their writers, the others are only freed */
+  for (i=0; i<replica_nb; ++i)
+  {
+    if (i >= started)
+    {
+      universe_clean(&(replica[i]));
+    }
+    else if (universe_simulate_end(&(replica[i]), &(writer[i])) != EXIT_SUCCESS)
+    {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  /* How often each rung of the ladder swapped with the next one */
+  for (i=0; i+1<replica_nb && status == EXIT_SUCCESS; ++i)
+  {
+    printf(TEXT_ENSEMBLE_EXCHANGE_RATIO, i, replica_args[i].temperature, i+1, replica_args[i+1].temperature,
+           accepted[i], tried[i], (tried[i]) ? 1E2*accepted[i]/tried[i] : 0.0);
+  }
+
+  free(writer);
+  free(potential);
+  free(busy);
+  free(tried);
+  free(accepted);
+
+  if (status != EXIT_SUCCESS)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (EXIT_SUCCESS);
+}
+
+int ensemble_run(const args_t *args)
+{
+  universe_t reference;  /* Holds the model and the templates */
+  universe_t *replica;   /* The replicas' universes */
+  args_t *replica_args;  /* And their arguments */
+  uint64_t replica_nb;
+  uint64_t i;
+  int concurrent;        /* Replicas running at once */
+  int per;               /* Threads of each */
+  int status;
+
+  replica_nb = args->ensemble;
+  if ((replica = malloc(sizeof(universe_t) * replica_nb)) == NULL ||
+      (replica_args = malloc(sizeof(args_t) * replica_nb)) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Parse the input files once */
+  universe_reset(&reference, args);
+  if (universe_load(&reference, args) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Each replica gets a trajectory and a seed of its own, and with exchanges a
+   * rung of the temperature ladder, spaced geometrically from --temp to --temp_max
+   */
+  for (i=0; i<replica_nb; ++i)
+  {
+    replica_args[i] = *args;
+    replica_args[i].srand_seed = args->srand_seed + i;
+    if (args->exchange)
+      replica_args[i].temperature = args->temperature * pow(args->temp_max/args->temperature, (double) i/(replica_nb - 1));
+    if (args->path_thermo != ARGS_PATH_THERMO_DEFAULT &&
+        (replica_args[i].path_thermo = ensemble_path(args->path_thermo, i)) == NULL)
+    {
+      return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+    }
+    if ((replica_args[i].path_out = ensemble_path(args->path_out, i)) == NULL ||
+        universe_init_replica(&(replica[i]), &reference, &(replica_args[i])) == NULL)
+    {
+      return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  /* They're alike but for the seed and temperature, the first one stands for all */
+  if (universe_parameters_print(&(replica[0]), &(replica_args[0])) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* One thread per replica, the rest shared out for their own loops */
+  concurrent = (replica_nb < (uint64_t) omp_get_max_threads()) ? (int) replica_nb : omp_get_max_threads();
+  per = omp_get_max_threads() / concurrent;
+  if (per < 1)
+  {
+    per = 1;
+  }
+  printf(TEXT_ENSEMBLE_START, replica_nb, concurrent, per);
+  omp_set_max_active_levels(2);
+
+  if (args->exchange)
+  {
+    for (i=0; i<replica_nb; ++i)
+    {
+      printf(TEXT_ENSEMBLE_RUNG, i, replica_args[i].temperature, replica_args[i].path_out);
+    }
+    status = ensemble_exchange(replica, replica_args, replica_nb, concurrent, per);
+  }
+  else
+  {
+    status = ensemble_independent(replica, replica_args, replica_nb, concurrent, per);
+  }
+
+  /* The replicas cleaned up after themselves, only the templates are left */
+  for (i=0; i<replica_nb; ++i)
+  {
+    free(replica_args[i].path_out);
+    if (args->path_thermo != ARGS_PATH_THERMO_DEFAULT)
+      free(replica_args[i].path_thermo);
+  }
+  free(replica_args);
+  free(replica);
+  universe_clean(&reference);
+
+  if (status != EXIT_SUCCESS)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_ENSEMBLE_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  puts(TEXT_SIMEND);
+
+  return (EXIT_SUCCESS);
+}
@@ -12,9 +12,11 @@
 #include "force.h"
 #include "model.h"
 #include "universe.h"
+#include "domain.h"
+#include "cell.h"
 #include "util.h"
 
-universe_t *force_bond(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *force_bond(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
   atom_t *atom_1;
   atom_t *atom_2;
@@ -32,7 +34,7 @@ universe_t *force_bond(vec3_t *frc, universe_t *universe, const uint64_t a1, con
   atom_2 = &(universe->atom[a2]);
 
   /* Get the distance between the atoms */
-  vec3_sub(&vec, &(atom_2->pos), &(atom_1->pos));
+  vec3_sub(&vec, pos_2, pos_1);
   dst = vec3_mag(&vec);
 
   /* Turn it into its unit vector */
@@ -63,7 +65,7 @@ universe_t *force_bond(vec3_t *frc, universe_t *universe, const uint64_t a1, con
   return (universe);
 }
 
-universe_t *force_electrostatic(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *force_electrostatic(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
   atom_t *atom_1;
   atom_t *atom_2;
@@ -76,7 +78,7 @@ universe_t *force_electrostatic(vec3_t *frc, universe_t *universe, const uint64_
   atom_2 = &(universe->atom[a2]);
 
   /* Get the distance between the atoms */
-  vec3_sub(&vec, &(atom_2->pos), &(atom_1->pos));
+  vec3_sub(&vec, pos_2, pos_1);
   dst = vec3_mag(&vec);
 
   /* Turn it into its unit vector */
@@ -92,10 +94,8 @@ universe_t *force_electrostatic(vec3_t *frc, universe_t *universe, const uint64_
   return (universe);
 }
 
-universe_t *force_lennardjones(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *force_lennardjones(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
-  atom_t *atom_1;
-  atom_t *atom_2;
   double sigma;
   double epsilon;
   double force;
@@ -107,13 +107,9 @@ universe_t *force_lennardjones(vec3_t *frc, universe_t *universe, const uint64_t
   frc->y = 0.0;
   frc->z = 0.0;
 
-  /* Makes the code easier to read */
-  atom_1 = &(universe->atom[a1]);
-  atom_2 = &(universe->atom[a2]);
-
   /* Get the distance between the atoms */
   /* Scale it to Angstroms */
-  vec3_sub(&vec, &(atom_2->pos), &(atom_1->pos));
+  vec3_sub(&vec, pos_2, pos_1);
   dst = vec3_mag(&vec);
   dst *= 1E10;
 
@@ -136,7 +132,7 @@ universe_t *force_lennardjones(vec3_t *frc, universe_t *universe, const uint64_t
   return (universe);
 }
 
-universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
   /* This function is a bit complex so here is a rundown:
    * a1 is bonded to a2, but a2 can be bonded to more atoms.
@@ -166,7 +162,6 @@ universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, co
   vec3_t to_ligand;
   vec3_t e_phi;
   vec3_t temp;
-  vec3_t pos_backup;
   atom_t *current;
   atom_t *ligand;
   atom_t *node;
@@ -188,7 +183,7 @@ universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, co
   }
 
   /* Get the vector going from the node to the current atom and its magnitude */
-  vec3_sub(&to_current, &(current->pos), &(node->pos));
+  vec3_sub(&to_current, pos_1, pos_2);
   to_current_mag = vec3_mag(&to_current);
 
   /* For all ligands */
@@ -200,41 +195,7 @@ universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, co
     if (ligand != NULL && ligand != current)
     {
       /* Get the vector going from the node to the ligand */
-      vec3_sub(&to_ligand, &(ligand->pos), &(node->pos));
-
-      /* PERIODIC BOUNDARY CONDITIONS */
-      pos_backup = ligand->pos;
-
-      if (to_ligand.x > 0.5*(universe->size))
-      {
-        ligand->pos.x -= universe->size;
-      }
-      
-      else if (to_ligand.x <= -0.5*(universe->size))
-      {
-        ligand->pos.x += universe->size;
-      }
-
-      if (to_ligand.y > 0.5*(universe->size))
-      {
-        ligand->pos.y -= universe->size;
-      }
-      
-      else if (to_ligand.y <= -0.5*(universe->size))
-      {
-        ligand->pos.y += universe->size;
-      }
-
-      if (to_ligand.z > 0.5*(universe->size))
-      {
-        ligand->pos.z -= universe->size;
-      }
-      
-      else if (to_ligand.z <= -0.5*(universe->size))
-      {
-        ligand->pos.z += universe->size;
-      }
-      /* PERIODIC BOUNDARY CONDITIONS */
+      vec3_sub(&to_ligand, &(ligand->pos), pos_2);
 
       /* Get its magnitude */
       to_ligand_mag = vec3_mag(&to_ligand);
@@ -277,9 +238,6 @@ universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, co
 
       /* Sum it */
       vec3_add(frc, frc, &temp);
-
-      /* Restore the backup coordinates */
-      ligand->pos = pos_backup;
     }
   }
 
@@ -289,8 +247,7 @@ universe_t *force_angle(vec3_t *frc, universe_t *universe, const uint64_t a1, co
 universe_t *force_total(vec3_t *frc, universe_t *universe, const uint64_t atom_id)
 {
   uint64_t i;
-  vec3_t to_target;
-  vec3_t pos_backup;
+  vec3_t pos;
   vec3_t vec_bond;
   vec3_t vec_electrostatic;
   vec3_t vec_lennardjones;
@@ -299,58 +256,23 @@ universe_t *force_total(vec3_t *frc, universe_t *universe, const uint64_t atom_i
   /* For each atom */
   for (i=0; i<(universe->atom_nb); ++i)
   {
-    /* That isn't the same as the current one */
-    if (i != atom_id)
+    /* That isn't the same as the current one, nor out of this process' reach */
+    if (i != atom_id && !DOMAIN_IS_ABSENT(universe, i))
     {
       /* PERIODIC BOUNDARY CONDITIONS */
-      /* Backup the atom's coordinates */
-      pos_backup = universe->atom[i].pos;
-
-      /* Get the vector going to the target atom */
-      vec3_sub(&to_target, &(universe->atom[i].pos), &(universe->atom[atom_id].pos));
-
-      /* Temporarily undo the PBC enforcement, if needed */
-      if (to_target.x > 0.5*(universe->size))
-      {
-        universe->atom[i].pos.x -= universe->size;
-      }
-
-      else if (to_target.x <= -0.5*(universe->size))
-      {
-        universe->atom[i].pos.x += universe->size;
-      }
-
-      if (to_target.y > 0.5*(universe->size))
-      {
-        universe->atom[i].pos.y -= universe->size;
-      }
-      
-      else if (to_target.y <= -0.5*(universe->size))
-      {
-        universe->atom[i].pos.y += universe->size;
-      }
-
-      if (to_target.z > 0.5*(universe->size))
-      {
-        universe->atom[i].pos.z -= universe->size;
-      }
-      
-      else if (to_target.z <= -0.5*(universe->size))
-      {
-        universe->atom[i].pos.z += universe->size;
-      }
-      /* PERIODIC BOUNDARY CONDITIONS */
+      /* Work with the atom's closest image, every thread sees the same positions */
+      atom_image(&pos, universe, i, &(universe->atom[atom_id].pos));
 
       /* Bonded interractions */
       if (atom_is_bonded(universe, atom_id, i))
       {
         /* Compute the forces */
-        if (force_bond(&vec_bond, universe, atom_id, i) == NULL)
+        if (force_bond(&vec_bond, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
         {
           return (retstr(NULL, TEXT_FORCE_TOTAL_FAILURE, __FILE__, __LINE__));
         }
         
-        if (force_angle(&vec_angle, universe, atom_id, i) == NULL)
+        if (force_angle(&vec_angle, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
         {
           return (retstr(NULL, TEXT_FORCE_TOTAL_FAILURE, __FILE__, __LINE__));
         }
@@ -360,16 +282,16 @@ universe_t *force_total(vec3_t *frc, universe_t *universe, const uint64_t atom_i
         vec3_add(frc, frc, &vec_angle);
       }
 
-      /* Non-bonded interractions */
-      else
+      /* Non-bonded interractions, up to the cutoff */
+      else if (atom_is_near(universe, &(universe->atom[atom_id].pos), &pos))
       {
         /* Compute the forces */
-        if (force_electrostatic(&vec_electrostatic, universe, atom_id, i) == NULL)
+        if (force_electrostatic(&vec_electrostatic, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
         {
           return (retstr(NULL, TEXT_FORCE_TOTAL_FAILURE, __FILE__, __LINE__));
         }
         
-        if (force_lennardjones(&vec_lennardjones, universe, atom_id, i) == NULL)
+        if (force_lennardjones(&vec_lennardjones, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
         {
           return (retstr(NULL, TEXT_FORCE_TOTAL_FAILURE, __FILE__, __LINE__));
         }
@@ -378,8 +300,96 @@ universe_t *force_total(vec3_t *frc, universe_t *universe, const uint64_t atom_i
         vec3_add(frc, frc, &vec_electrostatic);
         vec3_add(frc, frc, &vec_lennardjones);
       }
-      /* Restore the backup coordinates */
-      universe->atom[i].pos = pos_backup;
+    }
+  }
+
+  return (universe);
+}
+
+/* The bonded terms of force_total, bonded atom after bonded atom, in bond order */
+universe_t *force_bonded(vec3_t *frc, universe_t *universe, const uint64_t atom_id)
+{
+  uint64_t i;
+  uint64_t j;
+  vec3_t pos;
+  vec3_t vec_bond;
+  vec3_t vec_angle;
+
+  for (j=0; j<(universe->atom[atom_id].bond_nb); ++j)
+  {
+    i = universe->atom[atom_id].bond[j];
+    atom_image(&pos, universe, i, &(universe->atom[atom_id].pos));
+
+    if (force_bond(&vec_bond, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
+    {
+      return (retstr(NULL, TEXT_FORCE_BONDED_FAILURE, __FILE__, __LINE__));
+    }
+
+    if (force_angle(&vec_angle, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
+    {
+      return (retstr(NULL, TEXT_FORCE_BONDED_FAILURE, __FILE__, __LINE__));
+    }
+
+    vec3_add(frc, frc, &vec_bond);
+    vec3_add(frc, frc, &vec_angle);
+  }
+
+  return (universe);
+}
+
+/* Same as force_total, with the cells around the atom instead of the whole
+ * universe. The bonded atoms come first, in bond order, then the non-bonded
+ * ones cell after cell. The pairs looked at are added to pair_nb.
+ */
+universe_t *force_total_cell(vec3_t *frc, universe_t *universe, const uint64_t atom_id, uint64_t *pair_nb)
+{
+  const cell_t *cell;
+  const uint64_t *around;
+  uint64_t i;
+  uint64_t j;
+  uint64_t k;
+  vec3_t pos;
+  vec3_t vec_electrostatic;
+  vec3_t vec_lennardjones;
+
+  /* Bonded interractions */
+  if (force_bonded(frc, universe, atom_id) == NULL)
+  {
+    return (retstr(NULL, TEXT_FORCE_TOTAL_CELL_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Non-bonded interractions, with the atoms of the cells around */
+  cell = universe->cell;
+  around = &(cell->neighbour[CELL_NEIGHBOUR_NB*(cell->of[atom_id])]);
+  for (k=0; k<CELL_NEIGHBOUR_NB; ++k)
+  {
+    for (j=cell->first[around[k]]; j<(cell->first[around[k] + 1]); ++j)
+    {
+      i = cell->atom[j];
+      if (i == atom_id || atom_is_bonded(universe, atom_id, i))
+      {
+        continue;
+      }
+
+      atom_image(&pos, universe, i, &(universe->atom[atom_id].pos));
+      ++(*pair_nb);
+      if (!atom_is_near(universe, &(universe->atom[atom_id].pos), &pos))
+      {
+        continue;
+      }
+
+      if (force_electrostatic(&vec_electrostatic, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
+      {
+        return (retstr(NULL, TEXT_FORCE_TOTAL_CELL_FAILURE, __FILE__, __LINE__));
+      }
+
+      if (force_lennardjones(&vec_lennardjones, universe, atom_id, i, &(universe->atom[atom_id].pos), &pos) == NULL)
+      {
+        return (retstr(NULL, TEXT_FORCE_TOTAL_CELL_FAILURE, __FILE__, __LINE__));
+      }
+
+      vec3_add(frc, frc, &vec_electrostatic);
+      vec3_add(frc, frc, &vec_lennardjones);
     }
   }
 
@@ -0,0 +1,213 @@
+/*
+ * frames.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "frames.h"
+#include "parse.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+
+/* Get the index path from the trajectory path */
+static char *frames_path(const char *path)
+{
+  char *path_index;
+
+  if ((path_index = malloc(strlen(path) + sizeof(FRAMES_SUFFIX))) == NULL)
+  {
+    return (NULL);
+  }
+  strcpy(path_index, path);
+  strcat(path_index, FRAMES_SUFFIX);
+
+  return (path_index);
+}
+
+/* Create the index, or cut it back to the frames kept by a restart */
+universe_t *frames_open(universe_t *universe, const args_t *args)
+{
+  char *path_index;
+  uint32_t header[4];
+
+  if ((path_index = frames_path(args->path_out)) == NULL)
+  {
+    return (retstr(NULL, TEXT_FRAMES_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+  universe->file_index = fopen(path_index, (args->restart) ? "r+b" : "wb");
+  free(path_index);
+  if (universe->file_index == NULL)
+  {
+    return (retstr(NULL, TEXT_FRAMES_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (args->restart)
+  {
+    if (ftruncate(fileno(universe->file_index), (off_t) (FRAMES_HEADER_LEN + sizeof(frames_entry_t) * universe->frame_nb)) ||
+        fseek(universe->file_index, 0, SEEK_END))
+    {
+      return (retstr(NULL, TEXT_FRAMES_OPEN_FAILURE, __FILE__, __LINE__));
+    }
+    return (universe);
+  }
+
+  memcpy(&(header[0]), FRAMES_MAGIC, sizeof(uint32_t));
+  header[1] = FRAMES_VERSION;
+  header[2] = universe->output_format;
+  header[3] = 0;
+  if (fwrite(header, sizeof(header), 1, universe->file_index) != 1)
+  {
+    return (retstr(NULL, TEXT_FRAMES_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Record where the frame about to be written starts */
+universe_t *frames_append(universe_t *universe)
+{
+  frames_entry_t entry;
+  long offset;
+
+  if ((offset = ftell(universe->file_output)) < 0)
+  {
+    return (retstr(NULL, TEXT_FRAMES_APPEND_FAILURE, __FILE__, __LINE__));
+  }
+  entry.offset = (uint64_t) offset;
+  entry.iteration = universe->iterations;
+
+  if (fwrite(&entry, sizeof(frames_entry_t), 1, universe->file_index) != 1)
+  {
+    return (retstr(NULL, TEXT_FRAMES_APPEND_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Open a trajectory and map its index */
+frames_t *frames_init(frames_t *frames, const char *path)
+{
+  char *path_index;
+  FILE *file_index;
+  uint32_t header[4];
+  long file_len;
+
+  frames->file = FRAMES_FILE_DEFAULT;
+  frames->entry = FRAMES_ENTRY_DEFAULT;
+  frames->map = FRAMES_MAP_DEFAULT;
+  frames->map_len = FRAMES_MAP_LEN_DEFAULT;
+  frames->frame_nb = FRAMES_FRAME_NB_DEFAULT;
+  frames->format = FRAMES_FORMAT_DEFAULT;
+  frames->file_len = FRAMES_FILE_LEN_DEFAULT;
+
+  if ((frames->file = fopen(path, "rb")) == NULL ||
+      fseek(frames->file, 0, SEEK_END) ||
+      (file_len = ftell(frames->file)) < 0)
+  {
+    return (retstr(NULL, TEXT_FRAMES_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  frames->file_len = (uint64_t) file_len;
+
+  if ((path_index = frames_path(path)) == NULL)
+  {
+    return (retstr(NULL, TEXT_FRAMES_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  file_index = fopen(path_index, "rb");
+  free(path_index);
+  if (file_index == NULL)
+  {
+    return (retstr(NULL, TEXT_FRAMES_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The mapping outlives the file pointer */
+  frames->map = parser_map(file_index, &(frames->map_len));
+  fclose(file_index);
+  if (frames->map == NULL || frames->map_len < FRAMES_HEADER_LEN)
+  {
+    return (retstr(NULL, TEXT_FRAMES_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  memcpy(header, frames->map, sizeof(header));
+  if (memcmp(&(header[0]), FRAMES_MAGIC, sizeof(uint32_t)) || header[1] != FRAMES_VERSION)
+  {
+    return (retstr(NULL, TEXT_FRAMES_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  frames->format = (uint8_t) header[2];
+
+  /* A frame whose entry was written but not its data is left out */
+  frames->entry = (const frames_entry_t*) (frames->map + FRAMES_HEADER_LEN);
+  frames->frame_nb = (frames->map_len - FRAMES_HEADER_LEN) / sizeof(frames_entry_t);
+  while (frames->frame_nb && frames->entry[frames->frame_nb - 1].offset >= frames->file_len)
+  {
+    --(frames->frame_nb);
+  }
+
+  return (frames);
+}
+
+void frames_clean(frames_t *frames)
+{
+  if (frames->map != NULL)
+  {
+    parser_unmap(frames->map, frames->map_len);
+  }
+  if (frames->file != NULL)
+  {
+    fclose(frames->file);
+  }
+}
+
+/* Where a frame starts, and how long it is */
+frames_t *frames_span(frames_t *frames, const uint64_t frame, uint64_t *offset, uint64_t *len)
+{
+  uint64_t end;
+
+  if (frame >= frames->frame_nb)
+  {
+    return (retstr(NULL, TEXT_FRAMES_SPAN_FAILURE, __FILE__, __LINE__));
+  }
+
+  *offset = frames->entry[frame].offset;
+  end = (frame + 1 < frames->frame_nb) ? frames->entry[frame + 1].offset : frames->file_len;
+  if (end < *offset)
+  {
+    return (retstr(NULL, TEXT_FRAMES_SPAN_FAILURE, __FILE__, __LINE__));
+  }
+  *len = end - *offset;
+
+  return (frames);
+}
+
+/* Copy part of the trajectory as it is, without reading anything before it */
+frames_t *frames_copy(frames_t *frames, FILE *out, const uint64_t offset, const uint64_t len)
+{
+  char buf[FRAMES_COPY_LEN];
+  uint64_t left;
+  size_t chunk;
+
+  if (fseek(frames->file, (long) offset, SEEK_SET))
+  {
+    return (retstr(NULL, TEXT_FRAMES_COPY_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (left=len; left; left-=chunk)
+  {
+    chunk = (left < FRAMES_COPY_LEN) ? (size_t) left : FRAMES_COPY_LEN;
+    if (fread(buf, 1, chunk, frames->file) != chunk ||
+        fwrite(buf, 1, chunk, out) != chunk)
+    {
+      return (retstr(NULL, TEXT_FRAMES_COPY_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  return (frames);
+}
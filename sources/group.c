@@ -0,0 +1,365 @@
+/*
+ * group.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "dcd.h"
+#include "frames.h"
+#include "group.h"
+#include "parse.h"
+#include "stc.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+#include "xyz.h"
+
+/* Add an atom to the selection */
+static group_t *group_select(group_t *group, const uint64_t atom_id)
+{
+  uint64_t *atom;
+
+  /* Grow by powers of two, the count is only known at the end */
+  if (!(group->atom_nb & (group->atom_nb - 1)))
+  {
+    if ((atom = realloc(group->atom, sizeof(uint64_t) * (group->atom_nb ? 2*group->atom_nb : 1))) == NULL)
+    {
+      return (NULL);
+    }
+    group->atom = atom;
+  }
+  group->atom[group->atom_nb] = atom_id;
+  ++(group->atom_nb);
+
+  return (group);
+}
+
+/* Select molecules first to last, as in "0-15" or "3" */
+static group_t *group_select_molecules(group_t *group, universe_t *universe, const char *range)
+{
+  uint64_t molecule;
+  uint64_t first_molecule;
+  uint64_t last_molecule;
+  uint64_t first;
+  uint64_t nb;
+  uint64_t i;
+  char *end;
+
+  first_molecule = strtoul(range, &end, 10);
+  last_molecule = (*end == '-') ? strtoul(end + 1, &end, 10) : first_molecule;
+  if (end == range || *end != '\0' || first_molecule > last_molecule)
+  {
+    return (NULL);
+  }
+
+  for (molecule=first_molecule; molecule<=last_molecule; ++molecule)
+  {
+    if (universe_molecule(universe, molecule, &first, &nb) == NULL)
+    {
+      return (NULL);
+    }
+    for (i=0; i<nb; ++i)
+    {
+      if (group_select(group, first + i) == NULL)
+      {
+        return (NULL);
+      }
+    }
+  }
+
+  return (group);
+}
+
+/* Select every atom of the listed elements, as in "O,H" */
+static group_t *group_select_element(group_t *group, universe_t *universe, const char *symbols)
+{
+  const char *symbol;
+  size_t len;
+  uint64_t i;
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    for (symbol=symbols; *symbol != '\0'; symbol+=len + (symbol[len] == ','))
+    {
+      len = strcspn(symbol, ",");
+      if (len == strlen(universe->model.entry[universe->atom[i].element].symbol) &&
+          !strncmp(symbol, universe->model.entry[universe->atom[i].element].symbol, len))
+      {
+        if (group_select(group, i) == NULL)
+        {
+          return (NULL);
+        }
+        break;
+      }
+    }
+  }
+
+  return (group);
+}
+
+/* Select the atoms listed in a file */
+static group_t *group_select_index(group_t *group, universe_t *universe, const char *path)
+{
+  parser_t parser;
+  const char *buf;
+  size_t len;
+  uint64_t atom_id;
+  FILE *file;
+
+  if ((file = fopen(path, "r")) == NULL)
+  {
+    return (NULL);
+  }
+  if ((buf = parser_map(file, &len)) == NULL)
+  {
+    fclose(file);
+    return (NULL);
+  }
+  fclose(file);
+
+  parser_init(&parser, buf, len, path);
+  while (!parser_eof(&parser))
+  {
+    if (parser_uint(&parser, &atom_id) == NULL)
+    {
+      parser_unmap(buf, len);
+      return (NULL);
+    }
+    if (atom_id >= universe->atom_nb)
+    {
+      parser_error(&parser, TEXT_PARSER_ATOM_RANGE);
+      parser_unmap(buf, len);
+      return (NULL);
+    }
+    if (group_select(group, atom_id) == NULL)
+    {
+      parser_unmap(buf, len);
+      return (NULL);
+    }
+  }
+  parser_unmap(buf, len);
+
+  return (group);
+}
+
+/* Copy the selected atoms into the group's view */
+static void group_gather(group_t *group, const atom_t *atom)
+{
+  uint64_t i;
+
+  for (i=0; i<(group->atom_nb); ++i)
+  {
+    group->view.atom[i] = atom[group->atom[i]];
+  }
+}
+
+/* Cut the group's trajectory back to the frames taken before the checkpoint */
+static group_t *group_restart(group_t *group, const char *path, const uint64_t iterations)
+{
+  frames_t frames;
+  uint64_t kept;
+  uint64_t offset;
+
+  if (frames_init(&frames, path) == NULL)
+  {
+    frames_clean(&frames);
+    return (NULL);
+  }
+  for (kept=0; kept<frames.frame_nb && frames.entry[kept].iteration < iterations; ++kept);
+  offset = (kept < frames.frame_nb) ? frames.entry[kept].offset : frames.file_len;
+  frames_clean(&frames);
+
+  group->view.frame_nb = kept;
+  if (ftruncate(fileno(group->view.file_output), (off_t) offset) ||
+      fseek(group->view.file_output, 0, SEEK_END))
+  {
+    return (NULL);
+  }
+
+  return (group);
+}
+
+/* Select the atoms of a group, and open its trajectory */
+universe_t *group_init(universe_t *universe, const args_t *args, const uint64_t group_id)
+{
+  group_t *group;
+  args_t group_args;
+  const char *selection;
+
+  group = &(universe->group[group_id]);
+  group->atom = GROUP_ATOM_DEFAULT;
+  group->atom_nb = GROUP_ATOM_NB_DEFAULT;
+  group->every = GROUP_EVERY_DEFAULT;
+  group->view = *universe;
+  group->view.atom = UNIVERSE_ATOM_DEFAULT;
+  group->view.file_output = UNIVERSE_FILE_OUTPUT_DEFAULT;
+  group->view.file_index = UNIVERSE_FILE_INDEX_DEFAULT;
+  group->view.output_buffer = UNIVERSE_OUTPUT_BUFFER_DEFAULT;
+  group->view.output_chunk_len = UNIVERSE_OUTPUT_CHUNK_LEN_DEFAULT;
+  group->view.frame_nb = UNIVERSE_FRAME_NB_DEFAULT;
+  group->view.group = UNIVERSE_GROUP_DEFAULT;
+  group->view.group_nb = UNIVERSE_GROUP_NB_DEFAULT;
+  group->view.stream = UNIVERSE_STREAM_DEFAULT;
+  ++(universe->group_nb);
+
+  /* The group's trajectory is described by the arguments of its own */
+  group_args = *args;
+  group_args.path_out = args->group_path[group_id];
+  group_args.format = args_format(group_args.path_out);
+  group_args.frameskip = args->group_every[group_id] - 1;
+  group->every = args->group_every[group_id];
+  group->view.output_format = group_args.format;
+
+  selection = args->group_selection[group_id];
+  if (!strncmp(selection, GROUP_MOLECULES, strlen(GROUP_MOLECULES)))
+  {
+    group = group_select_molecules(group, universe, selection + strlen(GROUP_MOLECULES));
+  }
+  else if (!strncmp(selection, GROUP_ELEMENT, strlen(GROUP_ELEMENT)))
+  {
+    group = group_select_element(group, universe, selection + strlen(GROUP_ELEMENT));
+  }
+  else if (!strncmp(selection, GROUP_INDEX, strlen(GROUP_INDEX)))
+  {
+    group = group_select_index(group, universe, selection + strlen(GROUP_INDEX));
+  }
+  else
+  {
+    group = NULL;
+  }
+  if (group == NULL || universe->group[group_id].atom_nb == 0)
+  {
+    return (retstr(NULL, TEXT_GROUP_SELECTION_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The formats size their headers and buffers from the view's atoms */
+  group->view.atom_nb = group->atom_nb;
+  if ((group->view.atom = malloc(sizeof(atom_t) * (group->atom_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  group_gather(group, universe->atom);
+
+  if ((group->view.file_output = fopen(group_args.path_out, (args->restart) ? "r+b" : "wb")) == NULL)
+  {
+    return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if (args->restart && group_restart(group, group_args.path_out, universe->iterations) == NULL)
+  {
+    return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (group->view.output_format == OUTPUT_FORMAT_DCD)
+  {
+    if (!(args->restart) && dcd_header(&(group->view), &group_args) == NULL)
+    {
+      return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+    }
+  }
+  else if (group->view.output_format == OUTPUT_FORMAT_STC)
+  {
+    /* Groups aren't checkpointed, a restart is given the same arguments */
+    group->view.output_precision = args->precision;
+    if (!(args->restart) && stc_header(&(group->view), &group_args) == NULL)
+    {
+      return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+    }
+  }
+  else if (xyz_init(&(group->view)) == NULL)
+  {
+    return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (frames_open(&(group->view), &group_args) == NULL)
+  {
+    return (retstr(NULL, TEXT_GROUP_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Returns 1 if any group takes a frame at the current iteration */
+int group_due(const universe_t *universe)
+{
+  uint64_t i;
+
+  for (i=0; i<(universe->group_nb); ++i)
+  {
+    if (!(universe->iterations % universe->group[i].every))
+    {
+      return (1);
+    }
+  }
+
+  return (0);
+}
+
+/* Write a frame for every group due at the current iteration */
+universe_t *group_printstate(universe_t *universe)
+{
+  group_t *group;
+  uint64_t i;
+
+  for (i=0; i<(universe->group_nb); ++i)
+  {
+    group = &(universe->group[i]);
+    if (universe->iterations % group->every)
+    {
+      continue;
+    }
+
+    group_gather(group, universe->atom);
+    group->view.iterations = universe->iterations;
+    group->view.size = universe->size;
+    if (universe_printstate(&(group->view)) == NULL)
+    {
+      return (retstr(NULL, TEXT_GROUP_PRINTSTATE_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  return (universe);
+}
+
+/* Get every group's trajectory on disk */
+universe_t *group_flush(universe_t *universe)
+{
+  group_t *group;
+  uint64_t i;
+
+  for (i=0; i<(universe->group_nb); ++i)
+  {
+    group = &(universe->group[i]);
+    if (fflush(group->view.file_output) || fsync(fileno(group->view.file_output)) ||
+        fflush(group->view.file_index) || fsync(fileno(group->view.file_index)))
+    {
+      return (retstr(NULL, TEXT_GROUP_FLUSH_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  return (universe);
+}
+
+void group_clean(group_t *group)
+{
+  if (group->view.output_format == OUTPUT_FORMAT_DCD && group->view.file_output != NULL)
+  {
+    dcd_close(&(group->view));
+  }
+  if (group->view.file_output != NULL)
+    fclose(group->view.file_output);
+  if (group->view.file_index != NULL)
+    fclose(group->view.file_index);
+
+  free(group->view.output_buffer);
+  free(group->view.output_chunk_len);
+  free(group->view.atom);
+  free(group->atom);
+}
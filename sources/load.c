@@ -12,97 +12,69 @@
 
 #include "config.h"
 #include "model.h"
+#include "parse.h"
 #include "text.h"
 #include "util.h"
 #include "universe.h"
 
-universe_t *universe_load_model(universe_t *universe, char *file_buffer_model)
+universe_t *universe_load_model(universe_t *universe, parser_t *parser)
 {
-  char *tok;
-  size_t i;
-
-  /* Get the number of entries in the model */
-  /* -3 is there because we're not counting the metadata lines */
-  universe->model.entry_nb = line_nb(file_buffer_model) - 4;
-
-  /* Allocate memory for the entries */
-  if ((universe->model.entry = malloc(sizeof(model_entry_t) * universe->model.entry_nb)) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
-  }
-
-  /* Initialize each entry */
-  for (i=0; i < universe->model.entry_nb; ++i)
-  {
-    if (model_entry_init(&(universe->model.entry[i])) == NULL)
-    {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
-    }
-  }
-
-  /* Get the name line and load the model's name from it */
-  tok = strtok(file_buffer_model, "\n");
-  if ((universe->meta_model_name = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
-  }
-  strcpy(universe->meta_model_name, tok);
-
-  /* Get the author line and load the author's name from it */
-  tok = strtok(NULL, "\n");
-  if ((universe->meta_model_author = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
-  }
-  strcpy(universe->meta_model_author, tok);
+  model_entry_t *entry;
+  size_t entry_max;
 
-  /* Get the comment line and load the author's comment from it */
-  tok = strtok(NULL, "\n");
-  if ((universe->meta_model_comment = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
+  /* Get the metadata lines */
+  if (parser_text(parser, &(universe->meta_model_name)) == NULL ||
+      parser_text(parser, &(universe->meta_model_author)) == NULL ||
+      parser_text(parser, &(universe->meta_model_comment)) == NULL)
   {
     return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
   }
-  strcpy(universe->meta_model_comment, tok);
 
-  /* Load each entry */
-  for (i=0; i < (universe->model.entry_nb); ++i)
+  /* Every other line is an entry, grow the array as we go */
+  entry_max = 0;
+  while (!parser_eof(parser))
   {
-    /* Get the next line */
-    tok = strtok(NULL, "\n");
-
-    /* Initialize memory for each entry name and symbol */
-    if ((universe->model.entry[i].name = malloc(sizeof(char) * strlen(tok))) == NULL)
+    if (universe->model.entry_nb == entry_max)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
+      entry_max = entry_max ? 2*entry_max : 32;
+      if ((entry = realloc(universe->model.entry, sizeof(model_entry_t) * entry_max)) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
+      }
+      universe->model.entry = entry;
     }
 
-    if ((universe->model.entry[i].symbol = malloc(sizeof(char) * strlen(tok))) == NULL)
+    /* Count it right away, so that model_clean frees what was read */
+    entry = &(universe->model.entry[universe->model.entry_nb]);
+    if (model_entry_init(entry) == NULL)
     {
       return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
     }
-
-    /* Get the next entry as a line */
-    if (sscanf(tok, "%s %s %lf %lf %lf %lf %lf %lf",
-           universe->model.entry[i].name,
-           universe->model.entry[i].symbol,
-           &(universe->model.entry[i].mass),
-           &(universe->model.entry[i].radius_covalent),
-           &(universe->model.entry[i].radius_vdw),
-           &(universe->model.entry[i].bond_angle),
-           &(universe->model.entry[i].lj_epsilon),
-           &(universe->model.entry[i].lj_sigma)) != 8)
+    ++(universe->model.entry_nb);
+
+    if (parser_word(parser, &(entry->name)) == NULL ||
+        parser_word(parser, &(entry->symbol)) == NULL ||
+        parser_double(parser, &(entry->mass)) == NULL ||
+        parser_double(parser, &(entry->radius_covalent)) == NULL ||
+        parser_double(parser, &(entry->radius_vdw)) == NULL ||
+        parser_double(parser, &(entry->bond_angle)) == NULL ||
+        parser_double(parser, &(entry->lj_epsilon)) == NULL ||
+        parser_double(parser, &(entry->lj_sigma)) == NULL)
     {
       return (retstr(NULL, TEXT_UNIVERSE_LOAD_MODEL_FAILURE, __FILE__, __LINE__));
     }
+    parser_next_line(parser);
   }
 
   return (universe);
 }
 
-universe_t *universe_load_substrate(universe_t *universe, char *file_buffer_substrate)
+/* Both the substrate and the solvent are MDS files */
+static universe_t *universe_load_mds(universe_t *universe, parser_t *parser,
+                                     char **name, char **author, char **comment,
+                                     uint64_t *atom_nb, uint64_t *bond_nb, atom_t **atom)
 {
   size_t i;
-  char *tok;
   /* Used when reading the bond block */
   uint64_t *a1;
   uint64_t *a2;
@@ -111,124 +83,140 @@ universe_t *universe_load_substrate(universe_t *universe, char *file_buffer_subs
   uint64_t first;
   uint64_t second;
 
-  /* Get the name line and load the system's name from it */
-  tok = strtok(file_buffer_substrate, "\n");
-  if ((universe->meta_substrate_name = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
+  /* Get the metadata lines */
+  if (parser_text(parser, name) == NULL ||
+      parser_text(parser, author) == NULL ||
+      parser_text(parser, comment) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
-  strcpy(universe->meta_substrate_name, tok);
 
-  /* Get the author line and load the author's name from it */
-  tok = strtok(NULL, "\n");
-  if ((universe->meta_substrate_author = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
+  /* Get the count line, and the atom/bond nb from it, ignore the rest */
+  if (parser_uint(parser, atom_nb) == NULL || parser_uint(parser, bond_nb) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
-  strcpy(universe->meta_substrate_author, tok);
-
-  /* Get the comment line and load the author's comment from it */
-  tok = strtok(NULL, "\n");
-  if ((universe->meta_substrate_comment = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
-  }
-  strcpy(universe->meta_substrate_comment, tok);
-
-  /* Get the count line, and the atom/bond nb from it  */
-  tok = strtok(NULL, "\n");
-  sscanf(tok, "%ld %ld", &(universe->substrate_atom_nb), &(universe->substrate_bond_nb));
+  parser_next_line(parser);
 
   /* Allocate memory for the atoms */
-  if ((universe->substrate_atom = malloc (sizeof(atom_t)*(universe->substrate_atom_nb))) == NULL)
+  if ((*atom = malloc(sizeof(atom_t) * (*atom_nb))) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
 
   /* Initialize the atom memory */
-  for (i=0; i<(universe->substrate_atom_nb); ++i)
+  for (i=0; i<(*atom_nb); ++i)
   {
-    atom_init(&(universe->substrate_atom[i]));
+    atom_init(&((*atom)[i]));
   }
 
   /* Read the atom block */
-  for (i=0; i<(universe->substrate_atom_nb); ++i)
+  for (i=0; i<(*atom_nb); ++i)
   {
-    tok = strtok(NULL, "\n");
-    if ((sscanf(tok, "%lf %lf %lf %ld %lf %lf %lf",
-           &(universe->substrate_atom[i].pos.x),
-           &(universe->substrate_atom[i].pos.y),
-           &(universe->substrate_atom[i].pos.z),
-           &(universe->substrate_atom[i].element),
-           &(universe->substrate_atom[i].charge),
-           &(universe->substrate_atom[i].epsilon),
-           &(universe->substrate_atom[i].sigma))) != 7)
+    if (parser_double(parser, &((*atom)[i].pos.x)) == NULL ||
+        parser_double(parser, &((*atom)[i].pos.y)) == NULL ||
+        parser_double(parser, &((*atom)[i].pos.z)) == NULL ||
+        parser_uint(parser, &((*atom)[i].element)) == NULL)
+    {
+      return (NULL);
+    }
+    if ((*atom)[i].element >= universe->model.entry_nb)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+      parser_error(parser, TEXT_PARSER_UNKNOWN_ELEMENT);
+      return (NULL);
     }
+    if (parser_double(parser, &((*atom)[i].charge)) == NULL ||
+        parser_double(parser, &((*atom)[i].epsilon)) == NULL ||
+        parser_double(parser, &((*atom)[i].sigma)) == NULL)
+    {
+      return (NULL);
+    }
+    parser_next_line(parser);
 
     /* Scale the atom's position vector from Å to m */
-    vec3_mul(&(universe->substrate_atom[i].pos), &(universe->substrate_atom[i].pos), 1E-10);
+    vec3_mul(&((*atom)[i].pos), &((*atom)[i].pos), 1E-10);
 
     /* Scale the atom's charge from C.e-1 to C */
-    universe->substrate_atom[i].charge *= C_ELEMCHARGE;
+    (*atom)[i].charge *= C_ELEMCHARGE;
   }
 
   /* Allocate memory for the temporary bond information storage */
-  if ((a1 = malloc(sizeof(uint64_t) * (universe->substrate_bond_nb))) == NULL)
+  if ((a1 = malloc(sizeof(uint64_t) * (*bond_nb))) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
-  if ((a2 = malloc(sizeof(uint64_t) * (universe->substrate_bond_nb))) == NULL)
+  if ((a2 = malloc(sizeof(uint64_t) * (*bond_nb))) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
-  if ((bond_strength = malloc(sizeof(double) * (universe->substrate_bond_nb))) == NULL)
+  if ((bond_strength = malloc(sizeof(double) * (*bond_nb))) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
   /* Zero the allocated memory */
-  if ((bond_index = calloc(universe->substrate_atom_nb, sizeof(uint8_t))) == NULL)
+  if ((bond_index = calloc(*atom_nb, sizeof(uint8_t))) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+    return (NULL);
   }
 
   /* Read the bond block and get the number of bonds for each atom */
-  for (i=0; i<(universe->substrate_bond_nb); ++i)
+  for (i=0; i<(*bond_nb); ++i)
   {
-    tok = strtok(NULL, "\n");
-    sscanf(tok, "%ld %ld %lf", &(a1[i]), &(a2[i]), &(bond_strength[i]));
-    ++(universe->substrate_atom[a1[i] - 1].bond_nb);
-    ++(universe->substrate_atom[a2[i] - 1].bond_nb);
+    if (parser_uint(parser, &(a1[i])) == NULL)
+    {
+      return (NULL);
+    }
+    if (a1[i] == 0 || a1[i] > *atom_nb)
+    {
+      parser_error(parser, TEXT_PARSER_UNKNOWN_ATOM);
+      return (NULL);
+    }
+    if (parser_uint(parser, &(a2[i])) == NULL)
+    {
+      return (NULL);
+    }
+    if (a2[i] == 0 || a2[i] > *atom_nb)
+    {
+      parser_error(parser, TEXT_PARSER_UNKNOWN_ATOM);
+      return (NULL);
+    }
+    if (parser_double(parser, &(bond_strength[i])) == NULL)
+    {
+      return (NULL);
+    }
+    parser_next_line(parser);
+
+    ++((*atom)[a1[i] - 1].bond_nb);
+    ++((*atom)[a2[i] - 1].bond_nb);
   }
 
   /* Allocate memory for the bond information */
-  for (i=0; i<(universe->substrate_atom_nb); ++i)
+  for (i=0; i<(*atom_nb); ++i)
   {
     /* For the bond nodes */
-    if ((universe->substrate_atom[i].bond = malloc(sizeof(uint64_t) * universe->substrate_atom[i].bond_nb)) == NULL)
+    if (((*atom)[i].bond = malloc(sizeof(uint64_t) * (*atom)[i].bond_nb)) == NULL)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+      return (NULL);
     }
 
     /* For the bond strengths */
-    if ((universe->substrate_atom[i].bond_strength = malloc(sizeof(double) * universe->substrate_atom[i].bond_nb)) == NULL)
+    if (((*atom)[i].bond_strength = malloc(sizeof(double) * (*atom)[i].bond_nb)) == NULL)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
+      return (NULL);
     }
   }
 
   /* Load the bond information */
-  for (i=0; i<(universe->substrate_bond_nb); ++i)
+  for (i=0; i<(*bond_nb); ++i)
   {
     first = a1[i] - 1;
     second = a2[i] - 1;
 
-    universe->substrate_atom[first].bond[bond_index[first]] = second;
-    universe->substrate_atom[first].bond_strength[bond_index[first]] = bond_strength[i];
+    (*atom)[first].bond[bond_index[first]] = second;
+    (*atom)[first].bond_strength[bond_index[first]] = bond_strength[i];
 
-    universe->substrate_atom[second].bond[bond_index[second]] = first;
-    universe->substrate_atom[second].bond_strength[bond_index[second]] = bond_strength[i];
+    (*atom)[second].bond[bond_index[second]] = first;
+    (*atom)[second].bond_strength[bond_index[second]] = bond_strength[i];
 
     ++bond_index[first];
     ++bond_index[second];
@@ -240,149 +228,38 @@ universe_t *universe_load_substrate(universe_t *universe, char *file_buffer_subs
   free(bond_strength);
   free(bond_index);
 
+  /* Whatever follows (M  END) is not ours to read */
   return (universe);
 }
 
-universe_t *universe_load_solvent(universe_t *universe, char *file_buffer_solvent)
+universe_t *universe_load_substrate(universe_t *universe, parser_t *parser)
 {
-  size_t i;
-  char *tok;
-  /* Used when reading the bond block */
-  uint64_t *a1;
-  uint64_t *a2;
-  double *bond_strength;
-  uint8_t *bond_index;
-  uint64_t first;
-  uint64_t second;
-
-  /* Get the name line and load the system's name from it */
-  tok = strtok(file_buffer_solvent, "\n");
-  if ((universe->meta_solvent_name = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-  strcpy(universe->meta_solvent_name, tok);
-
-  /* Get the author line and load the author's name from it */
-  tok = strtok(NULL, "\n");
-  if ((universe->meta_solvent_author = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-  strcpy(universe->meta_solvent_author, tok);
-
-  /* Get the comment line and load the author's comment from it */
-  tok = strtok(NULL, "\n");
-  if ((universe->meta_solvent_comment = malloc(sizeof(char)*(strlen(tok)+1))) == NULL)
+  if (universe_load_mds(universe, parser,
+                        &(universe->meta_substrate_name),
+                        &(universe->meta_substrate_author),
+                        &(universe->meta_substrate_comment),
+                        &(universe->substrate_atom_nb),
+                        &(universe->substrate_bond_nb),
+                        &(universe->substrate_atom)) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-  strcpy(universe->meta_solvent_comment, tok);
-
-  /* Get the count line, and the atom/bond nb from it  */
-  tok = strtok(NULL, "\n");
-  sscanf(tok, "%ld %ld", &(universe->solvent_atom_nb), &(universe->solvent_bond_nb));
-
-  /* Allocate memory for the atoms */
-  if ((universe->solvent_atom = malloc (sizeof(atom_t)*(universe->solvent_atom_nb))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-
-  /* Initialize the atom memory */
-  for (i=0; i<(universe->solvent_atom_nb); ++i)
-  {
-    atom_init(&(universe->solvent_atom[i]));
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SUBSTRATE_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Read the atom block */
-  for (i=0; i<(universe->solvent_atom_nb); ++i)
-  {
-    tok = strtok(NULL, "\n");
-    if ((sscanf(tok, "%lf %lf %lf %ld %lf %lf %lf",
-           &(universe->solvent_atom[i].pos.x),
-           &(universe->solvent_atom[i].pos.y),
-           &(universe->solvent_atom[i].pos.z),
-           &(universe->solvent_atom[i].element),
-           &(universe->solvent_atom[i].charge),
-           &(universe->solvent_atom[i].epsilon),
-           &(universe->solvent_atom[i].sigma))) != 7)
-    {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-    }
-
-    /* Scale the atom's position vector from Å to m */
-    vec3_mul(&(universe->solvent_atom[i].pos), &(universe->solvent_atom[i].pos), 1E-10);
-
-    /* Scale the atom's charge from C.e-1 to C */
-    universe->solvent_atom[i].charge *= C_ELEMCHARGE;
-  }
+  return (universe);
+}
 
-  /* Allocate memory for the temporary bond information storage */
-  if ((a1 = malloc(sizeof(uint64_t) * (universe->solvent_bond_nb))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-  if ((a2 = malloc(sizeof(uint64_t) * (universe->solvent_bond_nb))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-  if ((bond_strength = malloc(sizeof(double) * (universe->solvent_bond_nb))) == NULL)
-  {
-    return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-  }
-  /* Zero the allocated memory */
-  if ((bond_index = calloc(universe->solvent_atom_nb, sizeof(uint8_t))) == NULL)
+universe_t *universe_load_solvent(universe_t *universe, parser_t *parser)
+{
+  if (universe_load_mds(universe, parser,
+                        &(universe->meta_solvent_name),
+                        &(universe->meta_solvent_author),
+                        &(universe->meta_solvent_comment),
+                        &(universe->solvent_atom_nb),
+                        &(universe->solvent_bond_nb),
+                        &(universe->solvent_atom)) == NULL)
   {
     return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Read the bond block and get the number of bonds for each atom */
-  for (i=0; i<(universe->solvent_bond_nb); ++i)
-  {
-    tok = strtok(NULL, "\n");
-    sscanf(tok, "%ld %ld %lf", &(a1[i]), &(a2[i]), &(bond_strength[i]));
-    ++(universe->solvent_atom[a1[i] - 1].bond_nb);
-    ++(universe->solvent_atom[a2[i] - 1].bond_nb);
-  }
-
-  /* Allocate memory for the bond information */
-  for (i=0; i<(universe->solvent_atom_nb); ++i)
-  {
-    /* For the bond nodes */
-    if ((universe->solvent_atom[i].bond = malloc(sizeof(uint64_t) * universe->solvent_atom[i].bond_nb)) == NULL)
-    {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-    }
-
-    /* For the bond strengths */
-    if ((universe->solvent_atom[i].bond_strength = malloc(sizeof(double) * universe->solvent_atom[i].bond_nb)) == NULL)
-    {
-      return (retstr(NULL, TEXT_UNIVERSE_LOAD_SOLVENT_FAILURE, __FILE__, __LINE__));
-    }
-  }
-
-  /* Load the bond information */
-  for (i=0; i<(universe->solvent_bond_nb); ++i)
-  {
-    first = a1[i] - 1;
-    second = a2[i] - 1;
-
-    universe->solvent_atom[first].bond[bond_index[first]] = second;
-    universe->solvent_atom[first].bond_strength[bond_index[first]] = bond_strength[i];
-
-    universe->solvent_atom[second].bond[bond_index[second]] = first;
-    universe->solvent_atom[second].bond_strength[bond_index[second]] = bond_strength[i];
-
-    ++bond_index[first];
-    ++bond_index[second];
-  }
-
-  /* Free the temporary bond information storage */
-  free(a1);
-  free(a2);
-  free(bond_strength);
-  free(bond_index);
-
   return (universe);
 }
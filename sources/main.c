@@ -10,6 +10,10 @@
 #include <math.h>
 
 #include "universe.h"
+#include "prepared.h"
+#include "domain.h"
+#include "affinity.h"
+#include "ensemble.h"
 #include "args.h"
 #include "text.h"
 #include "util.h"
@@ -19,6 +23,12 @@ int main(int argc, char **argv)
   args_t args;         /* Program arguments (from argv) */
   universe_t universe; /* The universe itself (wow) */
 
+  /* Several processes may share the simulation */
+  if (!domain_start(&argc, &argv))
+  {
+    return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
+  }
+
   /* That's the welcome message */
   puts(TEXT_START);
 
@@ -26,28 +36,56 @@ int main(int argc, char **argv)
   args_init(&args);
   if (args_parse(&args, argc, argv) == NULL)
   {
-    return (retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__));
+    return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
+  }
+
+  /* Settle the threads before any memory is touched */
+  if (!affinity_init(args.threads, args.pin))
+  {
+    return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
+  }
+
+  /* Replicas of the system run side by side, each on its own */
+  if (args.ensemble > 1)
+  {
+    return (domain_stop(ensemble_run(&args)));
   }
-  srand (args.srand_seed);
 
   /* Initialise the universe with the arguments */
   if (universe_init(&universe, &args) == NULL)
   {
-    return (retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__));
+    return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
   }
 
   /* Print the simulation parameters */
   if (universe_parameters_print(&universe, &args) == NULL)
   {
-    return (retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__));
+    return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
+  }
+
+  /* Tell where the atoms ended up */
+  affinity_report(&universe);
+
+  /* Reduce the potential energy before simulating, prepared and resumed systems already were */
+  if (args.path_load_prepared == ARGS_PATH_LOAD_PREPARED_DEFAULT && !args.restart)
+  {
+    if (universe_reducepot(&universe, &args) == NULL)
+    {
+      return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
+    }
   }
 
-  /* Reduce the potential energy before simulating */
-  if (universe_reducepot(&universe, &args) == NULL)
+  /* Keep the system as it is now, for the next runs to start from */
+  /* Every process holds the same system so far, one copy is enough */
+  if (args.path_save_prepared != ARGS_PATH_SAVE_PREPARED_DEFAULT && domain_rank() == 0)
   {
-    return (retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__));
+    if (prepared_save(&universe, args.path_save_prepared) == NULL)
+    {
+      return (domain_stop(retstri(EXIT_FAILURE, TEXT_MAIN_FAILURE, __FILE__, __LINE__)));
+    }
+    printf(TEXT_PREPARED_SAVED, args.path_save_prepared);
   }
 
   /* Let's roll */
-  return (universe_simulate(&universe, &args));
+  return (domain_stop(universe_simulate(&universe, &args)));
 }
@@ -0,0 +1,195 @@
+/*
+ * occupancy.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "occupancy.h"
+#include "text.h"
+#include "util.h"
+#include "vec3.h"
+
+/* Get the cell coordinate of x along one axis, wrapped into the universe */
+static int64_t occupancy_coord(const occupancy_t *occupancy, const double x)
+{
+  int64_t c;
+
+  c = (int64_t) floor((x + 0.5*(occupancy->size)) / (occupancy->cell_size));
+  c %= (int64_t) occupancy->cell_nb;
+  if (c < 0)
+  {
+    c += occupancy->cell_nb;
+  }
+
+  return (c);
+}
+
+/* Get the bucket a cell is hashed to */
+static uint64_t occupancy_bucket(const occupancy_t *occupancy, const uint64_t cell)
+{
+  /* Fibonacci hashing, the bucket number is a power of two */
+  return ((cell * UINT64_C(11400714819323198485)) >> 32) & (occupancy->bucket_nb - 1);
+}
+
+occupancy_t *occupancy_init(occupancy_t *occupancy, const double size, const double cell_size, const uint64_t entry_max)
+{
+  occupancy->size = OCCUPANCY_SIZE_DEFAULT;
+  occupancy->cell_size = OCCUPANCY_CELL_SIZE_DEFAULT;
+  occupancy->cell_nb = OCCUPANCY_CELL_NB_DEFAULT;
+  occupancy->bucket_nb = OCCUPANCY_BUCKET_NB_DEFAULT;
+  occupancy->entry_nb = OCCUPANCY_ENTRY_NB_DEFAULT;
+  occupancy->entry_max = OCCUPANCY_ENTRY_MAX_DEFAULT;
+  occupancy->head = OCCUPANCY_HEAD_DEFAULT;
+  occupancy->next = OCCUPANCY_NEXT_DEFAULT;
+  occupancy->cell = OCCUPANCY_CELL_DEFAULT;
+  occupancy->pos = OCCUPANCY_POS_DEFAULT;
+
+  if (size <= 0.0 || cell_size <= 0.0)
+  {
+    return (retstr(NULL, TEXT_OCCUPANCY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Cells can't be smaller than the requested size, or the 27 neighbours won't cover it */
+  occupancy->size = size;
+  occupancy->cell_nb = (uint64_t) floor(size / cell_size);
+  if (occupancy->cell_nb == 0)
+  {
+    occupancy->cell_nb = 1;
+  }
+  occupancy->cell_size = size / (occupancy->cell_nb);
+
+  /* Twice as many buckets as entries keeps the chains short */
+  occupancy->bucket_nb = 1;
+  while (occupancy->bucket_nb < 2*entry_max)
+  {
+    occupancy->bucket_nb <<= 1;
+  }
+  occupancy->entry_max = entry_max;
+
+  if ((occupancy->head = malloc(sizeof(int64_t) * (occupancy->bucket_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_OCCUPANCY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((occupancy->next = malloc(sizeof(int64_t) * (entry_max + 1))) == NULL)
+  {
+    return (retstr(NULL, TEXT_OCCUPANCY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((occupancy->cell = malloc(sizeof(uint64_t) * (entry_max + 1))) == NULL)
+  {
+    return (retstr(NULL, TEXT_OCCUPANCY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((occupancy->pos = malloc(sizeof(vec3_t) * (entry_max + 1))) == NULL)
+  {
+    return (retstr(NULL, TEXT_OCCUPANCY_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  occupancy_reset(occupancy);
+
+  return (occupancy);
+}
+
+void occupancy_clean(occupancy_t *occupancy)
+{
+  free(occupancy->head);
+  free(occupancy->next);
+  free(occupancy->cell);
+  free(occupancy->pos);
+}
+
+/* Forget every recorded point */
+void occupancy_reset(occupancy_t *occupancy)
+{
+  uint64_t i;
+
+  for (i=0; i<(occupancy->bucket_nb); ++i)
+  {
+    occupancy->head[i] = -1;
+  }
+  occupancy->entry_nb = 0;
+}
+
+/* Record a point */
+occupancy_t *occupancy_insert(occupancy_t *occupancy, const vec3_t *pos)
+{
+  uint64_t cell;
+  uint64_t bucket;
+  uint64_t id;
+
+  if (occupancy->entry_nb >= occupancy->entry_max)
+  {
+    return (retstr(NULL, TEXT_OCCUPANCY_INSERT_FAILURE, __FILE__, __LINE__));
+  }
+
+  cell = occupancy_coord(occupancy, pos->x)
+       + occupancy->cell_nb * (occupancy_coord(occupancy, pos->y)
+       + occupancy->cell_nb * occupancy_coord(occupancy, pos->z));
+  bucket = occupancy_bucket(occupancy, cell);
+
+  /* Push the entry at the head of its bucket */
+  id = (occupancy->entry_nb)++;
+  occupancy->cell[id] = cell;
+  occupancy->pos[id] = *pos;
+  occupancy->next[id] = occupancy->head[bucket];
+  occupancy->head[bucket] = (int64_t) id;
+
+  return (occupancy);
+}
+
+/* Returns 1 if a recorded point lies closer than dist from pos (PBC included), 0 otherwise */
+int occupancy_clash(const occupancy_t *occupancy, const vec3_t *pos, const double dist)
+{
+  int64_t cx;
+  int64_t cy;
+  int64_t cz;
+  int64_t dx;
+  int64_t dy;
+  int64_t dz;
+  int64_t n;
+  int64_t entry;
+  uint64_t cell;
+  vec3_t vec;
+
+  n = (int64_t) occupancy->cell_nb;
+  cx = occupancy_coord(occupancy, pos->x);
+  cy = occupancy_coord(occupancy, pos->y);
+  cz = occupancy_coord(occupancy, pos->z);
+
+  /* Look at the 27 cells around the point */
+  for (dx=-1; dx<=1; ++dx)
+  {
+    for (dy=-1; dy<=1; ++dy)
+    {
+      for (dz=-1; dz<=1; ++dz)
+      {
+        cell = (uint64_t) (((cx+dx+n)%n) + n*(((cy+dy+n)%n) + n*((cz+dz+n)%n)));
+
+        for (entry = occupancy->head[occupancy_bucket(occupancy, cell)]; entry != -1; entry = occupancy->next[entry])
+        {
+          /* Other cells can share the bucket */
+          if (occupancy->cell[entry] != cell)
+          {
+            continue;
+          }
+
+          /* Minimum image distance */
+          vec3_sub(&vec, &(occupancy->pos[entry]), pos);
+          vec.x -= (occupancy->size) * round(vec.x / (occupancy->size));
+          vec.y -= (occupancy->size) * round(vec.y / (occupancy->size));
+          vec.z -= (occupancy->size) * round(vec.z / (occupancy->size));
+
+          if (vec3_mag(&vec) < dist)
+          {
+            return (1);
+          }
+        }
+      }
+    }
+  }
+
+  return (0);
+}
@@ -0,0 +1,385 @@
+/*
+ * parse.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "parse.h"
+#include "text.h"
+#include "util.h"
+
+/* Powers of ten that are exactly represented as doubles */
+static const double parser_pow10[PARSER_EXACT_POW10 + 1] =
+{
+  1E0,  1E1,  1E2,  1E3,  1E4,  1E5,  1E6,  1E7,  1E8,  1E9,  1E10, 1E11,
+  1E12, 1E13, 1E14, 1E15, 1E16, 1E17, 1E18, 1E19, 1E20, 1E21, 1E22
+};
+
+/* Characters separating tokens on a line */
+static int parser_is_blank(const char c)
+{
+  return (c == ' ' || c == '\t' || c == '\r');
+}
+
+static int parser_is_digit(const char c)
+{
+  return (c >= '0' && c <= '9');
+}
+
+/* Map a whole file, read-only */
+const char *parser_map(FILE *file, size_t *len)
+{
+  struct stat st;
+  void *buf;
+
+  if (fstat(fileno(file), &st))
+  {
+    return (retstr(NULL, TEXT_PARSER_MAP_FAILURE, __FILE__, __LINE__));
+  }
+  *len = (size_t) st.st_size;
+
+  /* Empty files can't be mapped, but they're still empty files */
+  if (*len == 0)
+  {
+    return ("");
+  }
+
+  if ((buf = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fileno(file), 0)) == MAP_FAILED)
+  {
+    return (retstr(NULL, TEXT_PARSER_MAP_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* We read it once, from start to end */
+  madvise(buf, *len, MADV_SEQUENTIAL);
+
+  return ((const char*) buf);
+}
+
+void parser_unmap(const char *buf, const size_t len)
+{
+  if (len)
+  {
+    munmap((void*) buf, len);
+  }
+}
+
+/* Read a decimal number from the len first characters of str
+ * Returns how many characters were used, 0 if there's no number there.
+ */
+size_t parser_strtod(const char *str, const size_t len, double *x)
+{
+  size_t i;
+  uint64_t mantissa;
+  int digits;
+  int any;
+  int negative;
+  int exp_negative;
+  int64_t exp10;
+  int64_t exp_value;
+  size_t j;
+  char token[PARSER_TOKEN_MAX];
+  char *copy;
+
+  i = 0;
+  negative = 0;
+  if (i < len && (str[i] == '+' || str[i] == '-'))
+  {
+    negative = (str[i] == '-');
+    ++i;
+  }
+
+  /* Accumulate the significant digits, count the ones that don't fit */
+  mantissa = 0;
+  digits = 0;
+  any = 0;
+  exp10 = 0;
+  for (; i < len && parser_is_digit(str[i]); ++i)
+  {
+    any = 1;
+    if (digits < PARSER_DIGITS_MAX)
+    {
+      mantissa = mantissa*10 + (uint64_t) (str[i] - '0');
+      if (mantissa)
+        ++digits;
+    }
+    else
+      ++exp10;
+  }
+  if (i < len && str[i] == '.')
+  {
+    for (++i; i < len && parser_is_digit(str[i]); ++i)
+    {
+      any = 1;
+      if (digits < PARSER_DIGITS_MAX)
+      {
+        mantissa = mantissa*10 + (uint64_t) (str[i] - '0');
+        if (mantissa)
+          ++digits;
+        --exp10;
+      }
+    }
+  }
+  if (!any)
+  {
+    return (0);
+  }
+
+  /* The exponent only counts if it has digits */
+  if (i < len && (str[i] == 'e' || str[i] == 'E'))
+  {
+    j = i + 1;
+    exp_negative = 0;
+    if (j < len && (str[j] == '+' || str[j] == '-'))
+    {
+      exp_negative = (str[j] == '-');
+      ++j;
+    }
+    if (j < len && parser_is_digit(str[j]))
+    {
+      exp_value = 0;
+      for (; j < len && parser_is_digit(str[j]); ++j)
+      {
+        if (exp_value < 100000)
+          exp_value = exp_value*10 + (str[j] - '0');
+      }
+      exp10 += exp_negative ? -exp_value : exp_value;
+      i = j;
+    }
+  }
+
+  /* Exact conversion: both operands are exact doubles, and so is the
+   * correctly rounded result of the single operation between them.
+   */
+  if (mantissa == 0)
+  {
+    *x = negative ? -0.0 : 0.0;
+    return (i);
+  }
+  if (mantissa < ((uint64_t) 1 << 53) && exp10 >= -PARSER_EXACT_POW10 && exp10 <= PARSER_EXACT_POW10)
+  {
+    *x = (exp10 < 0) ? (double) mantissa / parser_pow10[-exp10] : (double) mantissa * parser_pow10[exp10];
+    if (negative)
+      *x = -*x;
+    return (i);
+  }
+
+  /* Anything else goes through strtod */
+  if (i < PARSER_TOKEN_MAX)
+  {
+    memcpy(token, str, i);
+    token[i] = '\0';
+    *x = strtod(token, NULL);
+  }
+  else
+  {
+    if ((copy = malloc(i + 1)) == NULL)
+    {
+      return (0);
+    }
+    memcpy(copy, str, i);
+    copy[i] = '\0';
+    *x = strtod(copy, NULL);
+    free(copy);
+  }
+
+  return (i);
+}
+
+parser_t *parser_init(parser_t *parser, const char *buf, const size_t len, const char *path)
+{
+  parser->buf = PARSER_BUF_DEFAULT;
+  parser->len = PARSER_LEN_DEFAULT;
+  parser->pos = PARSER_POS_DEFAULT;
+  parser->line = PARSER_LINE_DEFAULT;
+  parser->line_start = PARSER_LINE_START_DEFAULT;
+  parser->token = PARSER_TOKEN_DEFAULT;
+  parser->path = PARSER_PATH_DEFAULT;
+
+  parser->buf = buf;
+  parser->len = len;
+  parser->path = path;
+
+  return (parser);
+}
+
+/* Report where the input went wrong */
+parser_t *parser_error(parser_t *parser, const char *what)
+{
+  fprintf(stderr, TEXT_PARSER_ERROR, parser->path, parser->line, parser->token - parser->line_start + 1, what);
+
+  return (NULL);
+}
+
+/* Skip the blanks before the next token of the current line */
+static void parser_skip_blanks(parser_t *parser)
+{
+  while (parser->pos < parser->len && parser_is_blank(parser->buf[parser->pos]))
+  {
+    ++(parser->pos);
+  }
+  parser->token = parser->pos;
+}
+
+/* A token must be followed by a blank, the end of the line or of the file */
+static int parser_at_separator(const parser_t *parser)
+{
+  return (parser->pos >= parser->len ||
+          parser_is_blank(parser->buf[parser->pos]) ||
+          parser->buf[parser->pos] == '\n');
+}
+
+/* Skip what's left of the current line, and the newline */
+parser_t *parser_next_line(parser_t *parser)
+{
+  const char *newline;
+
+  newline = memchr(parser->buf + parser->pos, '\n', parser->len - parser->pos);
+  if (newline == NULL)
+  {
+    parser->pos = parser->len;
+    return (parser);
+  }
+
+  parser->pos = (size_t) (newline - parser->buf) + 1;
+  parser->line_start = parser->pos;
+  ++(parser->line);
+
+  return (parser);
+}
+
+/* Returns 1 if only blank lines are left */
+int parser_eof(parser_t *parser)
+{
+  while (1)
+  {
+    parser_skip_blanks(parser);
+    if (parser->pos >= parser->len)
+    {
+      return (1);
+    }
+    if (parser->buf[parser->pos] != '\n')
+    {
+      return (0);
+    }
+    parser_next_line(parser);
+  }
+}
+
+/* Copy the rest of the current line, and move to the next one */
+parser_t *parser_text(parser_t *parser, char **str)
+{
+  size_t end;
+
+  parser->token = parser->pos;
+  if (parser->pos >= parser->len)
+  {
+    return (parser_error(parser, TEXT_PARSER_EXPECTED_LINE));
+  }
+
+  for (end=parser->pos; end < parser->len && parser->buf[end] != '\n'; ++end);
+
+  /* Files written on other systems end their lines with \r\n */
+  while (end > parser->pos && parser->buf[end-1] == '\r')
+  {
+    --end;
+  }
+
+  if ((*str = malloc(end - parser->pos + 1)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PARSER_TEXT_FAILURE, __FILE__, __LINE__));
+  }
+  memcpy(*str, parser->buf + parser->pos, end - parser->pos);
+  (*str)[end - parser->pos] = '\0';
+
+  parser->pos = end;
+  return (parser_next_line(parser));
+}
+
+/* Copy the next token of the current line */
+parser_t *parser_word(parser_t *parser, char **str)
+{
+  size_t start;
+
+  parser_skip_blanks(parser);
+  if (parser_at_separator(parser))
+  {
+    return (parser_error(parser, TEXT_PARSER_EXPECTED_WORD));
+  }
+
+  start = parser->pos;
+  while (!parser_at_separator(parser))
+  {
+    ++(parser->pos);
+  }
+
+  if ((*str = malloc(parser->pos - start + 1)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PARSER_WORD_FAILURE, __FILE__, __LINE__));
+  }
+  memcpy(*str, parser->buf + start, parser->pos - start);
+  (*str)[parser->pos - start] = '\0';
+
+  return (parser);
+}
+
+/* Read the next token of the current line as a real number */
+parser_t *parser_double(parser_t *parser, double *x)
+{
+  size_t used;
+
+  parser_skip_blanks(parser);
+  if (parser_at_separator(parser))
+  {
+    return (parser_error(parser, TEXT_PARSER_EXPECTED_NUMBER));
+  }
+
+  used = parser_strtod(parser->buf + parser->pos, parser->len - parser->pos, x);
+  if (used == 0)
+  {
+    return (parser_error(parser, TEXT_PARSER_EXPECTED_NUMBER));
+  }
+
+  parser->pos += used;
+  if (!parser_at_separator(parser))
+  {
+    return (parser_error(parser, TEXT_PARSER_MALFORMED_NUMBER));
+  }
+
+  return (parser);
+}
+
+/* Read the next token of the current line as a positive integer */
+parser_t *parser_uint(parser_t *parser, uint64_t *x)
+{
+  parser_skip_blanks(parser);
+  if (parser->pos < parser->len && parser->buf[parser->pos] == '+')
+  {
+    ++(parser->pos);
+  }
+  if (parser->pos >= parser->len || !parser_is_digit(parser->buf[parser->pos]))
+  {
+    return (parser_error(parser, TEXT_PARSER_EXPECTED_INTEGER));
+  }
+
+  *x = 0;
+  while (parser->pos < parser->len && parser_is_digit(parser->buf[parser->pos]))
+  {
+    *x = (*x)*10 + (uint64_t) (parser->buf[parser->pos] - '0');
+    ++(parser->pos);
+  }
+
+  if (!parser_at_separator(parser))
+  {
+    return (parser_error(parser, TEXT_PARSER_MALFORMED_INTEGER));
+  }
+
+  return (parser);
+}
@@ -13,10 +13,12 @@
 #include "potential.h"
 #include "text.h"
 #include "universe.h"
+#include "domain.h"
+#include "cell.h"
 #include "util.h"
 #include "vec3.h"
 
-universe_t *potential_bond(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *potential_bond(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
   atom_t *atom_1;
   atom_t *atom_2;
@@ -33,7 +35,7 @@ universe_t *potential_bond(double *pot, universe_t *universe, const uint64_t a1,
   atom_2 = &(universe->atom[a2]);
 
   /* Get the distance between the atoms */
-  vec3_sub(&vec, &(atom_2->pos), &(atom_1->pos));
+  vec3_sub(&vec, pos_2, pos_1);
   dst = vec3_mag(&vec);
 
   /* Turn it into its unit vector */
@@ -63,7 +65,7 @@ universe_t *potential_bond(double *pot, universe_t *universe, const uint64_t a1,
   return (universe);
 }
 
-universe_t *potential_electrostatic(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *potential_electrostatic(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
   atom_t *atom_1;
   atom_t *atom_2;
@@ -77,7 +79,7 @@ universe_t *potential_electrostatic(double *pot, universe_t *universe, const uin
   atom_2 = &(universe->atom[a2]);
 
   /* Get the distance between the atoms */
-  vec3_sub(&vec, &(atom_2->pos), &(atom_1->pos));
+  vec3_sub(&vec, pos_2, pos_1);
   dst = vec3_mag(&vec);
 
   /* Turn it into its unit vector */
@@ -96,22 +98,16 @@ universe_t *potential_electrostatic(double *pot, universe_t *universe, const uin
   return (universe);
 }
 
-universe_t *potential_lennardjones(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *potential_lennardjones(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
-  atom_t *atom_1;
-  atom_t *atom_2;
   double sigma;
   double epsilon;
   double dst;
   vec3_t vec;
 
-  /* Makes the code easier to read */
-  atom_1 = &(universe->atom[a1]);
-  atom_2 = &(universe->atom[a2]);
-
   /* Get the distance between the atoms */
   /* Scale it to Angstroms */
-  vec3_sub(&vec, &(atom_2->pos), &(atom_1->pos));
+  vec3_sub(&vec, pos_2, pos_1);
   dst = vec3_mag(&vec);
   dst *= 1E10;
 
@@ -145,7 +141,7 @@ universe_t *potential_lennardjones(double *pot, universe_t *universe, const uint
   return (universe);
 }
 
-universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2)
+universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1, const uint64_t a2, const vec3_t *pos_1, const vec3_t *pos_2)
 {
   /* This function is a bit complex so here is a rundown:
    * a1 is bonded to a2, but a2 can be bonded to more atoms.
@@ -171,7 +167,6 @@ universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1
   double to_ligand_mag;
   vec3_t to_current;
   vec3_t to_ligand;
-  vec3_t pos_backup;
   atom_t *current;
   atom_t *ligand;
   atom_t *node;
@@ -190,7 +185,7 @@ universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1
   }
 
   /* Get the vector going from the node to the current atom */
-  vec3_sub(&to_current, &(current->pos), &(node->pos));
+  vec3_sub(&to_current, pos_1, pos_2);
 
   /* As well as its magnitude */
   to_current_mag = vec3_mag(&to_current);
@@ -204,41 +199,7 @@ universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1
     if (ligand != NULL && ligand != current)
     {
       /* Get the vector going from the node to the ligand */
-      vec3_sub(&to_ligand, &(ligand->pos), &(node->pos));
-
-      /* PERIODIC BOUNDARY CONDITIONS */
-      pos_backup = ligand->pos;
-
-      if (to_ligand.x > 0.5*(universe->size))
-      {
-        ligand->pos.x -= universe->size;
-      }
-
-      else if (to_ligand.x <= -0.5*(universe->size))
-      {
-        ligand->pos.x += universe->size;
-      }
-
-      if (to_ligand.y > 0.5*(universe->size))
-      {
-        ligand->pos.y -= universe->size;
-      }
-
-      else if (to_ligand.y <= -0.5*(universe->size))
-      {
-        ligand->pos.y += universe->size;
-      }
-
-      if (to_ligand.z > 0.5*(universe->size))
-      {
-        ligand->pos.z -= universe->size;
-      }
-
-      else if (to_ligand.z <= -0.5*(universe->size))
-      {
-        ligand->pos.z += universe->size;
-      }
-      /* PERIODIC BOUNDARY CONDITIONS */
+      vec3_sub(&to_ligand, &(ligand->pos), pos_2);
 
       /* Get its magnitude */
       to_ligand_mag = vec3_mag(&to_ligand);
@@ -253,9 +214,6 @@ universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1
       /* Compute the potential U=(k/2)*(angle^2) */
       angular_displacement = angle - angle_eq;
       *pot += 0.5*C_AHO*POW2(angular_displacement);
-
-      /* Restore the backup coordinates */
-      ligand->pos = pos_backup;
     }
   }
 
@@ -263,10 +221,18 @@ universe_t *potential_angle(double *pot, universe_t *universe, const uint64_t a1
 }
 
 universe_t *potential_total(double *pot, universe_t *universe, const uint64_t atom_id)
+{
+  return (potential_total_at(pot, universe, atom_id, &(universe->atom[atom_id].pos)));
+}
+
+/* Get the potential energy of an atom as if it were at pos
+ * The numerical differentiation moves it around this way, without touching
+ * positions other threads may be reading.
+ */
+universe_t *potential_total_at(double *pot, universe_t *universe, const uint64_t atom_id, const vec3_t *pos)
 {
   size_t i;
-  vec3_t to_target;
-  vec3_t pos_backup;
+  vec3_t image;
   double pot_bond;
   double pot_electrostatic;
   double pot_lennardjones;
@@ -278,58 +244,21 @@ universe_t *potential_total(double *pot, universe_t *universe, const uint64_t at
   /* For each atom */
   for (i=0; i<(universe->atom_nb); ++i)
   {
-    /* That isn't the same as the current one */
-    if (i != atom_id)
+    /* That isn't the same as the current one, nor out of this process' reach */
+    if (i != atom_id && !DOMAIN_IS_ABSENT(universe, i))
     {
       /* PERIODIC BOUNDARY CONDITIONS */
-      /* Backup the atom's coordinates */
-      pos_backup = universe->atom[i].pos;
-
-      /* Get the vector going to the target atom */
-      vec3_sub(&to_target, &(universe->atom[i].pos), &(universe->atom[atom_id].pos));
-
-      /* Temporarily undo the PBC enforcement, if needed */
-      if (to_target.x > 0.5*(universe->size))
-      {
-        universe->atom[i].pos.x -= universe->size;
-      }
-      
-      else if (to_target.x <= -0.5*(universe->size))
-      {
-        universe->atom[i].pos.x += universe->size;
-      }
-
-      if (to_target.y > 0.5*(universe->size))
-      {
-        universe->atom[i].pos.y -= universe->size;
-      }
-        
-      else if (to_target.y <= -0.5*(universe->size))
-      {
-        universe->atom[i].pos.y += universe->size;
-      }
-
-      if (to_target.z > 0.5*(universe->size))
-      {
-        universe->atom[i].pos.z -= universe->size;
-      }
-        
-      else if (to_target.z <= -0.5*(universe->size))
-      {
-        universe->atom[i].pos.z += universe->size;
-      }
-
-      /* PERIODIC BOUNDARY CONDITIONS */
+      atom_image(&image, universe, i, pos);
 
       /* Bonded interractions */
       if (atom_is_bonded(universe, atom_id, i))
       {
-        if (potential_bond(&pot_bond, universe, atom_id, i) == NULL)
+        if (potential_bond(&pot_bond, universe, atom_id, i, pos, &image) == NULL)
         {
           return (retstr(NULL, TEXT_POTENTIAL_TOTAL_FAILURE, __FILE__, __LINE__));
         }
           
-        if (potential_angle(&pot_angle, universe, atom_id, i) == NULL)
+        if (potential_angle(&pot_angle, universe, atom_id, i, pos, &image) == NULL)
         {
           return (retstr(NULL, TEXT_POTENTIAL_TOTAL_FAILURE, __FILE__, __LINE__));
         }
@@ -339,15 +268,15 @@ universe_t *potential_total(double *pot, universe_t *universe, const uint64_t at
         *pot += pot_angle;
       }
 
-      /* Non-bonded interractions */
-      else
+      /* Non-bonded interractions, up to the cutoff */
+      else if (atom_is_near(universe, pos, &image))
       {
-        if (potential_electrostatic(&pot_electrostatic, universe, atom_id, i) == NULL)
+        if (potential_electrostatic(&pot_electrostatic, universe, atom_id, i, pos, &image) == NULL)
         {
           return (retstr(NULL, TEXT_POTENTIAL_TOTAL_FAILURE, __FILE__, __LINE__));
         }
           
-        if (potential_lennardjones(&pot_lennardjones, universe, atom_id, i) == NULL)
+        if (potential_lennardjones(&pot_lennardjones, universe, atom_id, i, pos, &image) == NULL)
         {
           return (retstr(NULL, TEXT_POTENTIAL_TOTAL_FAILURE, __FILE__, __LINE__));
         }
@@ -357,9 +286,190 @@ universe_t *potential_total(double *pot, universe_t *universe, const uint64_t at
         *pot += pot_electrostatic;
         *pot += pot_lennardjones;
       }
+    }
+  }
+
+  return (universe);
+}
+
+/* Same as potential_total, each term on its own */
+universe_t *potential_terms(double term[POTENTIAL_TERM_NB], universe_t *universe, const uint64_t atom_id)
+{
+  size_t i;
+  vec3_t image;
+  const vec3_t *pos;
+  double pot;
+
+  for (i=0; i<POTENTIAL_TERM_NB; ++i)
+  {
+    term[i] = 0.0;
+  }
+
+  pos = &(universe->atom[atom_id].pos);
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (i == atom_id || DOMAIN_IS_ABSENT(universe, i))
+    {
+      continue;
+    }
+    atom_image(&image, universe, i, pos);
+
+    if (atom_is_bonded(universe, atom_id, i))
+    {
+      if (potential_bond(&pot, universe, atom_id, i, pos, &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_TERMS_FAILURE, __FILE__, __LINE__));
+      }
+      term[POTENTIAL_TERM_BOND] += pot;
+
+      if (potential_angle(&pot, universe, atom_id, i, pos, &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_TERMS_FAILURE, __FILE__, __LINE__));
+      }
+      term[POTENTIAL_TERM_ANGLE] += pot;
+    }
+    else if (atom_is_near(universe, pos, &image))
+    {
+      if (potential_electrostatic(&pot, universe, atom_id, i, pos, &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_TERMS_FAILURE, __FILE__, __LINE__));
+      }
+      term[POTENTIAL_TERM_ELECTROSTATIC] += pot;
+
+      if (potential_lennardjones(&pot, universe, atom_id, i, pos, &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_TERMS_FAILURE, __FILE__, __LINE__));
+      }
+      term[POTENTIAL_TERM_LENNARDJONES] += pot;
+    }
+  }
+
+  return (universe);
+}
+
+/* Same as potential_terms, with the atoms bonded to this one and those of the
+ * cells around it, as force_total_cell has them
+ */
+universe_t *potential_terms_cell(double term[POTENTIAL_TERM_NB], universe_t *universe, const uint64_t atom_id)
+{
+  const cell_t *cell;
+  const uint64_t *around;
+  const vec3_t *pos;
+  uint64_t i;
+  uint64_t j;
+  uint64_t k;
+  vec3_t image;
+  double pot;
+
+  for (k=0; k<POTENTIAL_TERM_NB; ++k)
+  {
+    term[k] = 0.0;
+  }
+  pos = &(universe->atom[atom_id].pos);
+
+  /* Bonded interractions */
+  for (j=0; j<(universe->atom[atom_id].bond_nb); ++j)
+  {
+    i = universe->atom[atom_id].bond[j];
+    atom_image(&image, universe, i, pos);
+
+    if (potential_bond(&pot, universe, atom_id, i, pos, &image) == NULL)
+    {
+      return (retstr(NULL, TEXT_POTENTIAL_TERMS_CELL_FAILURE, __FILE__, __LINE__));
+    }
+    term[POTENTIAL_TERM_BOND] += pot;
+
+    if (potential_angle(&pot, universe, atom_id, i, pos, &image) == NULL)
+    {
+      return (retstr(NULL, TEXT_POTENTIAL_TERMS_CELL_FAILURE, __FILE__, __LINE__));
+    }
+    term[POTENTIAL_TERM_ANGLE] += pot;
+  }
+
+  /* Non-bonded interractions, with the atoms of the cells around */
+  cell = universe->cell;
+  around = &(cell->neighbour[CELL_NEIGHBOUR_NB*(cell->of[atom_id])]);
+  for (k=0; k<CELL_NEIGHBOUR_NB; ++k)
+  {
+    for (j=cell->first[around[k]]; j<(cell->first[around[k] + 1]); ++j)
+    {
+      i = cell->atom[j];
+      if (i == atom_id || atom_is_bonded(universe, atom_id, i))
+      {
+        continue;
+      }
+
+      atom_image(&image, universe, i, pos);
+      if (!atom_is_near(universe, pos, &image))
+      {
+        continue;
+      }
+
+      if (potential_electrostatic(&pot, universe, atom_id, i, pos, &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_TERMS_CELL_FAILURE, __FILE__, __LINE__));
+      }
+      term[POTENTIAL_TERM_ELECTROSTATIC] += pot;
+
+      if (potential_lennardjones(&pot, universe, atom_id, i, pos, &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_TERMS_CELL_FAILURE, __FILE__, __LINE__));
+      }
+      term[POTENTIAL_TERM_LENNARDJONES] += pot;
+    }
+  }
+
+  return (universe);
+}
+
+/* Get the potential energy between the atoms [first;first+nb[ and the rest of the universe
+ * Only non-bonded interactions are accounted for, making this the
+ * intermolecular potential energy of a molecule.
+ */
+universe_t *potential_intermolecular(double *pot, universe_t *universe, const uint64_t first, const uint64_t nb)
+{
+  size_t i;
+  size_t atom_id;
+  vec3_t image;
+  double pot_electrostatic;
+  double pot_lennardjones;
+
+  /* Initialize the potential */
+  *pot = 0.0;
+
+  /* For each atom of the molecule */
+  for (atom_id=first; atom_id<first+nb; ++atom_id)
+  {
+    /* And each atom outside of it */
+    for (i=0; i<(universe->atom_nb); ++i)
+    {
+      if (i >= first && i < first+nb)
+      {
+        continue;
+      }
+
+      /* PERIODIC BOUNDARY CONDITIONS */
+      atom_image(&image, universe, i, &(universe->atom[atom_id].pos));
+
+      /* Beyond the cutoff, nothing */
+      if (!atom_is_near(universe, &(universe->atom[atom_id].pos), &image))
+      {
+        continue;
+      }
+
+      if (potential_electrostatic(&pot_electrostatic, universe, atom_id, i, &(universe->atom[atom_id].pos), &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_INTERMOLECULAR_FAILURE, __FILE__, __LINE__));
+      }
+
+      if (potential_lennardjones(&pot_lennardjones, universe, atom_id, i, &(universe->atom[atom_id].pos), &image) == NULL)
+      {
+        return (retstr(NULL, TEXT_POTENTIAL_INTERMOLECULAR_FAILURE, __FILE__, __LINE__));
+      }
 
-      /* Restore the backup coordinates */
-      universe->atom[i].pos = pos_backup;
+      /* Sum the potentials */
+      *pot += pot_electrostatic;
+      *pot += pot_lennardjones;
     }
   }
 
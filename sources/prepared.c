@@ -0,0 +1,431 @@
+/*
+ * prepared.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "prepared.h"
+#include "parse.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+#include "affinity.h"
+
+/* Padding needed after len bytes to get back on an aligned offset */
+static size_t prepared_pad(const size_t len)
+{
+  return ((PREPARED_ALIGN - len % PREPARED_ALIGN) % PREPARED_ALIGN);
+}
+
+/* Write a block, padded */
+static int prepared_write(FILE *file, const void *data, const size_t len)
+{
+  static const char pad[PREPARED_ALIGN] = {0};
+
+  return (fwrite(data, 1, len, file) == len &&
+          fwrite(pad, 1, prepared_pad(len), file) == prepared_pad(len));
+}
+
+static int prepared_write_string(FILE *file, const char *str)
+{
+  uint64_t len;
+
+  len = strlen(str);
+
+  return (prepared_write(file, &len, sizeof(uint64_t)) &&
+          prepared_write(file, str, len));
+}
+
+static int prepared_write_atoms(FILE *file, const atom_t *atom, const uint64_t atom_nb)
+{
+  prepared_atom_t record;
+  size_t i;
+
+  for (i=0; i<atom_nb; ++i)
+  {
+    record.element = atom[i].element;
+    record.bond_nb = atom[i].bond_nb;
+    record.charge = atom[i].charge;
+    record.epsilon = atom[i].epsilon;
+    record.sigma = atom[i].sigma;
+    record.pos = atom[i].pos;
+    record.vel = atom[i].vel;
+    record.acc = atom[i].acc;
+    record.frc = atom[i].frc;
+
+    if (!prepared_write(file, &record, sizeof(prepared_atom_t)))
+    {
+      return (0);
+    }
+  }
+
+  /* The topology follows, as two flat arrays */
+  for (i=0; i<atom_nb; ++i)
+  {
+    if (fwrite(atom[i].bond, sizeof(uint64_t), atom[i].bond_nb, file) != atom[i].bond_nb)
+    {
+      return (0);
+    }
+  }
+  for (i=0; i<atom_nb; ++i)
+  {
+    if (fwrite(atom[i].bond_strength, sizeof(double), atom[i].bond_nb, file) != atom[i].bond_nb)
+    {
+      return (0);
+    }
+  }
+
+  return (1);
+}
+
+/* Serialize the universe, ready to be simulated */
+universe_t *prepared_save(universe_t *universe, const char *path)
+{
+  prepared_header_t header;
+  prepared_entry_t record;
+  FILE *file;
+  size_t i;
+  int ok;
+
+  if ((file = fopen(path, "wb")) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_SAVE_FAILURE, __FILE__, __LINE__));
+  }
+
+  memset(&header, 0, sizeof(prepared_header_t));
+  memcpy(header.magic, PREPARED_MAGIC, sizeof(header.magic));
+  header.version = PREPARED_VERSION;
+  header.srand_seed = universe->seed;
+  header.entry_nb = universe->model.entry_nb;
+  header.substrate_atom_nb = universe->substrate_atom_nb;
+  header.substrate_bond_nb = universe->substrate_bond_nb;
+  header.solvent_atom_nb = universe->solvent_atom_nb;
+  header.solvent_bond_nb = universe->solvent_bond_nb;
+  header.copy_nb = universe->copy_nb;
+  header.solvent_copy_nb = universe->solvent_copy_nb;
+  header.atom_nb = universe->atom_nb;
+  header.iterations = universe->iterations;
+  header.populate_mode = universe->populate_mode;
+  header.output_format = universe->output_format;
+  header.frame_nb = universe->frame_nb;
+  header.frameskip_left = universe->frameskip_left;
+  header.output_offset = universe->output_offset;
+  header.thermo_offset = universe->thermo_offset;
+  header.thermo_line_nb = universe->thermo_line_nb;
+  header.output_precision = universe->output_precision;
+  header.thermo_energy_0 = universe->thermo_energy_0;
+  header.size = universe->size;
+  header.time = universe->time;
+  header.temperature = universe->temperature;
+  header.pressure = universe->pressure;
+
+  ok = prepared_write(file, &header, sizeof(prepared_header_t)) &&
+       prepared_write_string(file, universe->meta_model_name) &&
+       prepared_write_string(file, universe->meta_model_author) &&
+       prepared_write_string(file, universe->meta_model_comment) &&
+       prepared_write_string(file, universe->meta_substrate_name) &&
+       prepared_write_string(file, universe->meta_substrate_author) &&
+       prepared_write_string(file, universe->meta_substrate_comment) &&
+       prepared_write_string(file, universe->meta_solvent_name) &&
+       prepared_write_string(file, universe->meta_solvent_author) &&
+       prepared_write_string(file, universe->meta_solvent_comment);
+
+  for (i=0; ok && i<(universe->model.entry_nb); ++i)
+  {
+    record.id = universe->model.entry[i].id;
+    record.mass = universe->model.entry[i].mass;
+    record.radius_covalent = universe->model.entry[i].radius_covalent;
+    record.radius_vdw = universe->model.entry[i].radius_vdw;
+    record.bond_angle = universe->model.entry[i].bond_angle;
+    record.lj_epsilon = universe->model.entry[i].lj_epsilon;
+    record.lj_sigma = universe->model.entry[i].lj_sigma;
+
+    ok = prepared_write(file, &record, sizeof(prepared_entry_t)) &&
+         prepared_write_string(file, universe->model.entry[i].name) &&
+         prepared_write_string(file, universe->model.entry[i].symbol);
+  }
+
+  ok = ok &&
+       prepared_write_atoms(file, universe->substrate_atom, universe->substrate_atom_nb) &&
+       prepared_write_atoms(file, universe->solvent_atom, universe->solvent_atom_nb) &&
+       prepared_write_atoms(file, universe->atom, universe->atom_nb);
+
+  /* Make sure it's on disk before anyone relies on it */
+  ok = ok && !fflush(file) && !fsync(fileno(file));
+  if (fclose(file) || !ok)
+  {
+    return (retstr(NULL, TEXT_PREPARED_SAVE_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Get the next block of the mapped file and skip its padding, NULL if the file is truncated */
+static const void *prepared_read(const char *buf, const size_t buf_len, size_t *pos, const size_t len)
+{
+  const void *block;
+
+  if (len > buf_len - *pos || prepared_pad(len) > buf_len - *pos - len)
+  {
+    return (NULL);
+  }
+
+  block = buf + *pos;
+  *pos += len + prepared_pad(len);
+
+  return (block);
+}
+
+static char *prepared_read_string(const char *buf, const size_t buf_len, size_t *pos)
+{
+  const uint64_t *len;
+  const char *block;
+  char *str;
+
+  if ((len = prepared_read(buf, buf_len, pos, sizeof(uint64_t))) == NULL ||
+      (block = prepared_read(buf, buf_len, pos, *len)) == NULL ||
+      (str = malloc(*len + 1)) == NULL)
+  {
+    return (NULL);
+  }
+  memcpy(str, block, *len);
+  str[*len] = '\0';
+
+  return (str);
+}
+
+/* Rebuild an array of atoms, checking it against the model */
+static atom_t *prepared_read_atoms(const char *buf, const size_t buf_len, size_t *pos, const uint64_t atom_nb, const uint64_t entry_nb)
+{
+  const prepared_atom_t *record;
+  const uint64_t *bond;
+  const double *bond_strength;
+  uint64_t bond_total;
+  atom_t *atom;
+  size_t i;
+  size_t j;
+
+  if (atom_nb > buf_len / sizeof(prepared_atom_t) ||
+      (record = prepared_read(buf, buf_len, pos, sizeof(prepared_atom_t) * atom_nb)) == NULL ||
+      (atom = affinity_alloc(atom_nb, sizeof(atom_t))) == NULL)
+  {
+    return (NULL);
+  }
+
+  bond_total = 0;
+  for (i=0; i<atom_nb; ++i)
+  {
+    atom_init(&(atom[i]));
+    if (record[i].element >= entry_nb || record[i].bond_nb > UINT8_MAX)
+    {
+      return (NULL);
+    }
+
+    atom[i].element = record[i].element;
+    atom[i].bond_nb = (uint8_t) record[i].bond_nb;
+    atom[i].charge = record[i].charge;
+    atom[i].epsilon = record[i].epsilon;
+    atom[i].sigma = record[i].sigma;
+    atom[i].pos = record[i].pos;
+    atom[i].vel = record[i].vel;
+    atom[i].acc = record[i].acc;
+    atom[i].frc = record[i].frc;
+    bond_total += atom[i].bond_nb;
+  }
+
+  /* Both topology arrays are aligned, being made of 8 bytes values */
+  if ((bond = prepared_read(buf, buf_len, pos, sizeof(uint64_t) * bond_total)) == NULL ||
+      (bond_strength = prepared_read(buf, buf_len, pos, sizeof(double) * bond_total)) == NULL)
+  {
+    return (NULL);
+  }
+
+  for (i=0; i<atom_nb; ++i)
+  {
+    if ((atom[i].bond = malloc(sizeof(uint64_t) * atom[i].bond_nb)) == NULL ||
+        (atom[i].bond_strength = malloc(sizeof(double) * atom[i].bond_nb)) == NULL)
+    {
+      return (NULL);
+    }
+
+    for (j=0; j<atom[i].bond_nb; ++j)
+    {
+      if (bond[j] >= atom_nb)
+      {
+        return (NULL);
+      }
+    }
+    memcpy(atom[i].bond, bond, sizeof(uint64_t) * atom[i].bond_nb);
+    memcpy(atom[i].bond_strength, bond_strength, sizeof(double) * atom[i].bond_nb);
+    bond += atom[i].bond_nb;
+    bond_strength += atom[i].bond_nb;
+  }
+
+  return (atom);
+}
+
+/* Replace the loading, population and minimization of the universe */
+universe_t *prepared_load(universe_t *universe, const char *path)
+{
+  const prepared_header_t *header;
+  const prepared_entry_t *record;
+  FILE *file;
+  const char *buf;
+  size_t len;
+  size_t pos;
+  size_t i;
+
+  if ((file = fopen(path, "rb")) == NULL ||
+      (buf = parser_map(file, &len)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+
+  pos = 0;
+  if ((header = prepared_read(buf, len, &pos, sizeof(prepared_header_t))) == NULL ||
+      memcmp(header->magic, PREPARED_MAGIC, sizeof(header->magic)) ||
+      header->version != PREPARED_VERSION ||
+      header->entry_nb > len / sizeof(prepared_entry_t) ||
+      header->atom_nb != header->copy_nb * header->substrate_atom_nb + header->solvent_copy_nb * header->solvent_atom_nb)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+
+  if ((universe->meta_model_name = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_model_author = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_model_comment = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_substrate_name = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_substrate_author = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_substrate_comment = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_solvent_name = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_solvent_author = prepared_read_string(buf, len, &pos)) == NULL ||
+      (universe->meta_solvent_comment = prepared_read_string(buf, len, &pos)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The model table */
+  if ((universe->model.entry = malloc(sizeof(model_entry_t) * header->entry_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+  for (i=0; i<(header->entry_nb); ++i)
+  {
+    model_entry_init(&(universe->model.entry[i]));
+    ++(universe->model.entry_nb);
+
+    if ((record = prepared_read(buf, len, &pos, sizeof(prepared_entry_t))) == NULL ||
+        (universe->model.entry[i].name = prepared_read_string(buf, len, &pos)) == NULL ||
+        (universe->model.entry[i].symbol = prepared_read_string(buf, len, &pos)) == NULL)
+    {
+      return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+    }
+
+    universe->model.entry[i].id = record->id;
+    universe->model.entry[i].mass = record->mass;
+    universe->model.entry[i].radius_covalent = record->radius_covalent;
+    universe->model.entry[i].radius_vdw = record->radius_vdw;
+    universe->model.entry[i].bond_angle = record->bond_angle;
+    universe->model.entry[i].lj_epsilon = record->lj_epsilon;
+    universe->model.entry[i].lj_sigma = record->lj_sigma;
+  }
+
+  /* The reference molecules, then the universe itself */
+  if ((universe->substrate_atom = prepared_read_atoms(buf, len, &pos, header->substrate_atom_nb, header->entry_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+  universe->substrate_atom_nb = header->substrate_atom_nb;
+  universe->substrate_bond_nb = header->substrate_bond_nb;
+
+  if ((universe->solvent_atom = prepared_read_atoms(buf, len, &pos, header->solvent_atom_nb, header->entry_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+  universe->solvent_atom_nb = header->solvent_atom_nb;
+  universe->solvent_bond_nb = header->solvent_bond_nb;
+
+  if ((universe->atom = prepared_read_atoms(buf, len, &pos, header->atom_nb, header->entry_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+  universe->atom_nb = header->atom_nb;
+
+  universe->copy_nb = header->copy_nb;
+  universe->solvent_copy_nb = header->solvent_copy_nb;
+  universe->iterations = header->iterations;
+  universe->populate_mode = (uint8_t) header->populate_mode;
+  universe->output_format = (uint8_t) header->output_format;
+  universe->frame_nb = header->frame_nb;
+  universe->frameskip_left = header->frameskip_left;
+  universe->output_offset = header->output_offset;
+  universe->thermo_offset = header->thermo_offset;
+  universe->thermo_line_nb = header->thermo_line_nb;
+  universe->output_precision = header->output_precision;
+  universe->thermo_energy_0 = header->thermo_energy_0;
+  universe->size = header->size;
+  universe->time = header->time;
+  universe->temperature = header->temperature;
+  universe->pressure = header->pressure;
+
+  /* Whatever is drawn next follows the seed the system was prepared with */
+  universe->seed = header->srand_seed;
+
+  parser_unmap(buf, len);
+  fclose(file);
+
+  return (universe);
+}
+
+/* Write a checkpoint, replacing the previous one only once it's complete
+ * The trajectory must be flushed, and universe->output_offset up to date.
+ */
+universe_t *prepared_checkpoint(universe_t *universe, const args_t *args)
+{
+  char *path_tmp;
+
+  if ((path_tmp = malloc(strlen(args->path_checkpoint) + sizeof(PREPARED_TMP_SUFFIX))) == NULL)
+  {
+    return (retstr(NULL, TEXT_PREPARED_CHECKPOINT_FAILURE, __FILE__, __LINE__));
+  }
+  strcpy(path_tmp, args->path_checkpoint);
+  strcat(path_tmp, PREPARED_TMP_SUFFIX);
+
+  if (prepared_save(universe, path_tmp) == NULL ||
+      rename(path_tmp, args->path_checkpoint))
+  {
+    free(path_tmp);
+    return (retstr(NULL, TEXT_PREPARED_CHECKPOINT_FAILURE, __FILE__, __LINE__));
+  }
+  free(path_tmp);
+
+  return (universe);
+}
+
+/* Load the checkpoint, and cut the trajectory back to where it was taken */
+universe_t *prepared_restart(universe_t *universe, const args_t *args)
+{
+  if (prepared_load(universe, args->path_checkpoint) == NULL ||
+      universe->output_format != args->format)
+  {
+    return (retstr(NULL, TEXT_PREPARED_RESTART_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Frames written after the checkpoint will be written again */
+  if (fseek(universe->file_output, 0, SEEK_END) ||
+      ftell(universe->file_output) < (long) universe->output_offset ||
+      ftruncate(fileno(universe->file_output), (off_t) universe->output_offset) ||
+      fseek(universe->file_output, (long) universe->output_offset, SEEK_SET))
+  {
+    return (retstr(NULL, TEXT_PREPARED_RESTART_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
@@ -8,15 +8,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 
 #include "config.h"
+#include "potential.h"
 #include "text.h"
 #include "util.h"
 #include "universe.h"
+#include "rng.h"
 
 /* Move the atoms around until a target potential is reached */
 universe_t *universe_reducepot(universe_t *universe, args_t *args)
 {
+  uint64_t cycle_nb_rigid;                  /* How many cycles of rigid moves we went through */
   uint64_t cycle_nb_coarse;                 /* How many cycles of wiggling we went through */
   uint64_t cycle_nb_fine;                   /* How many cycles of gradient descent we went through */
   double potential_last_cycle;              /* Potential energy at the last cycle */
@@ -25,18 +29,20 @@ universe_t *universe_reducepot(universe_t *universe, args_t *args)
   double potential_reduced_so_far;
   double potential_to_reduce;
   double progress;
+  reducepot_t reducepot;                    /* Per-atom state of the wiggling */
+  double fine_scale;                        /* Global step scale of the batched descent */
 
   /* Compute and print the current potential */
   if (universe_energy_potential(universe, &potential) == NULL)
   {
     return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
   }
-  printf(TEXT_UNIVERSE_REDUCEPOT_CURRENT_POT, potential*1E12, args->reduce_potential * 1E12);
+  universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_CURRENT_POT, potential*1E12, args->reduce_potential * 1E12);
 
   /* Exit if we don't need to reduce the potential any more */
   if (potential < args->reduce_potential)
   {
-    printf("\n");
+    universe_say(universe, "\n");
     return (universe);
   }
 
@@ -44,14 +50,70 @@ universe_t *universe_reducepot(universe_t *universe, args_t *args)
   potential_to_reduce = potential - args->reduce_potential;
 
   /* Print the message that says we're starting potential reduction */
-  printf(TEXT_UNIVERSE_REDUCEPOT_START);
+  universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_START);
 
-  /* PHASE 1 - BRUTEFORCE/WIGGLING */
-  cycle_nb_coarse = 0;
   potential_reduced_so_far = 0.0;
   potential_delta = 0.0;
   progress = 0.0;
-  printf(TEXT_UNIVERSE_REDUCEPOT_COARSE_START);
+
+  /* PHASE 0 - RIGID MOLECULES */
+  /* Only makes sense if there are several molecules to move around */
+  if ((universe->copy_nb) + (universe->solvent_copy_nb) > 1)
+  {
+    cycle_nb_rigid = 0;
+    universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_RIGID_START);
+    while (potential > args->reduce_potential && cycle_nb_rigid < UNIVERSE_REDUCEPOT_RIGID_MAX_CYCLES)
+    {
+      potential_last_cycle = potential;
+
+      /* Increment how many cycles we went through */
+      ++cycle_nb_rigid;
+
+      if (universe_reducepot_rigid(universe, cycle_nb_rigid) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      }
+
+      /* Update the system's potential energy */
+      if (universe_energy_potential(universe, &potential) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      }
+
+      /* Compute how much the potential changed, and the current progress */
+      potential_delta = potential_last_cycle - potential;
+      potential_reduced_so_far += potential_delta;
+      progress = potential_reduced_so_far / potential_to_reduce;
+
+      /* Print current status */
+      universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_RIGID_SUCCESS, potential_delta*1E12, potential*1E12, cycle_nb_rigid, progress*1E2);
+      fflush(stdout);
+
+      /* Moving whole molecules doesn't help anymore, let the atoms relax */
+      if (potential_delta < UNIVERSE_REDUCEPOT_CUTOFF)
+      {
+        break;
+      }
+    }
+
+    /* We need to print a new line, that last message doesn't print its own */
+    universe_say(universe, "\n");
+
+    /* Exit if we don't need to reduce the potential any more */
+    if (potential < args->reduce_potential)
+    {
+      universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_SUCCESS);
+      return (universe);
+    }
+  }
+
+  /* PHASE 1 - BRUTEFORCE/WIGGLING */
+  if (reducepot_init(&reducepot, universe->atom_nb) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+  }
+  cycle_nb_coarse = 0;
+  universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_COARSE_START);
   while (progress < UNIVERSE_REDUCEPOT_END_WIGGLING)
   {
     potential_last_cycle = potential;
@@ -59,14 +121,16 @@ universe_t *universe_reducepot(universe_t *universe, args_t *args)
     /* Increment how many cycles we went through */
     ++cycle_nb_coarse;
 
-    if (universe_reducepot_coarse(universe) == NULL)
+    if (universe_reducepot_coarse(universe, &reducepot) == NULL)
     {
+      reducepot_clean(&reducepot);
       return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
     }
 
     /* Update the system's potential energy */
     if (universe_energy_potential(universe, &potential) == NULL)
     {
+      reducepot_clean(&reducepot);
       return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
     }
 
@@ -86,46 +150,71 @@ universe_t *universe_reducepot(universe_t *universe, args_t *args)
     progress = potential_reduced_so_far / potential_to_reduce;
     
     /* Print current status */
-    printf(TEXT_UNIVERSE_REDUCEPOT_COARSE_SUCCESS, potential_delta*1E12, potential*1E12, cycle_nb_coarse, progress*1E2);
+    universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_COARSE_SUCCESS, potential_delta*1E12, potential*1E12, cycle_nb_coarse, progress*1E2, reducepot.frozen_nb);
     fflush(stdout);
+
+    /* Adapt the step magnitudes for the next cycle, freeze the hopeless atoms */
+    reducepot_adapt(&reducepot);
+
+    /* If no atom can move anymore, go on with gradient descent */
+    if (reducepot.frozen_nb == reducepot.atom_nb)
+    {
+      universe_say(universe, "\n");
+      universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_FROZEN);
+      break;
+    }
     
     /* If the potential can't be significantly reduced anymore, start the simulation */
     if (potential_delta < UNIVERSE_REDUCEPOT_CUTOFF)
     {
-      printf("\n");
-      printf(TEXT_UNIVERSE_REDUCEPOT_CUTOFF);
+      universe_say(universe, "\n");
+      universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_CUTOFF);
       break;
     }
   }
+  reducepot_clean(&reducepot);
 
   /* We need to print a new line, that last message doesn't print its own */
-  printf("\n");
+  universe_say(universe, "\n");
   
   /* Exit if we don't need to reduce the potential any more */
   if (potential < args->reduce_potential)
   {
-    printf("\n");
+    universe_say(universe, "\n");
     return (universe);
   }
 
   /* PHASE 2 - GRADIENT DESCENT */
   cycle_nb_fine= 0;
-  printf(TEXT_UNIVERSE_REDUCEPOT_FINE_START);
+  fine_scale = 1.0;
+  universe_say(universe, args->reducepot_batch ? TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_START : TEXT_UNIVERSE_REDUCEPOT_FINE_START);
   while (potential > args->reduce_potential)
   {
     potential_last_cycle = potential;
 
     /* Increment how many cycles we went through */
     ++cycle_nb_fine;
-    if (universe_reducepot_fine(universe) == NULL)
+
+    /* The batched sweep keeps the potential up to date by itself */
+    if (args->reducepot_batch)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      if (universe_reducepot_fine_batch(universe, &potential, &fine_scale) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      }
     }
-
-    /* Update the system's potential energy */
-    if (universe_energy_potential(universe, &potential) == NULL)
+    else
     {
-      return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      if (universe_reducepot_fine(universe) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      }
+
+      /* Update the system's potential energy */
+      if (universe_energy_potential(universe, &potential) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FAILURE, __FILE__, __LINE__));
+      }
     }
 
     /* Compute how much the potential changed */
@@ -144,75 +233,282 @@ universe_t *universe_reducepot(universe_t *universe, args_t *args)
     progress = potential_reduced_so_far / potential_to_reduce;
 
     /* Print current status */
-    printf(TEXT_UNIVERSE_REDUCEPOT_FINE_SUCCESS, potential_delta*1E12, potential*1E12, cycle_nb_fine, progress*1E2);
+    universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_FINE_SUCCESS, potential_delta*1E12, potential*1E12, cycle_nb_fine, progress*1E2);
     fflush(stdout);
 
     /* If the potential can't be significantly reduced anymore, start the simulation */
     if (potential_delta < UNIVERSE_REDUCEPOT_CUTOFF)
     {
-      printf("\n");
-      printf(TEXT_UNIVERSE_REDUCEPOT_CUTOFF);
+      universe_say(universe, "\n");
+      universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_CUTOFF);
       break;
     }
   }
 
   /* We need to print a new line, that last message doesn't print its own */
-  printf("\n");
+  universe_say(universe, "\n");
 
   /* Print the message saying we're done reducing the potential */
-  printf(TEXT_UNIVERSE_REDUCEPOT_SUCCESS);
+  universe_say(universe, TEXT_UNIVERSE_REDUCEPOT_SUCCESS);
 
   return (universe);
 }
 
-/* Apply transformations to lower the system's potential energy (wiggling) */
-universe_t *universe_reducepot_coarse(universe_t *universe)
+/* Apply transformations to lower the system's potential energy (rigid molecules)
+ *
+ * Each molecule is translated and rotated as a whole. Its intramolecular
+ * geometry is left untouched, so the move is accepted or discarded based on
+ * the intermolecular potential alone.
+ */
+universe_t *universe_reducepot_rigid(universe_t *universe, const uint64_t cycle)
 {
   size_t i;
   size_t tries;
-  double step_magnitude;
+  uint64_t molecule_id;
+  uint64_t first;
+  uint64_t nb;
+  uint64_t nb_max;
   double pot_pre;
   double pot_post;
+  vec3_t *pos_pre;
+  vec3_t centroid;
   vec3_t step;
-  vec3_t pos_pre;
+  vec3_t vec;
+  mat3_t rot;
+  rng_t rng;
 
-  /* For each atom */
-  for (i=0; i<(universe->atom_nb); ++i)
+  /* Allocate memory to backup the biggest molecule */
+  nb_max = (universe->substrate_atom_nb > universe->solvent_atom_nb) ? universe->substrate_atom_nb : universe->solvent_atom_nb;
+  if ((pos_pre = malloc(sizeof(vec3_t) * (nb_max + 1))) == NULL)
   {
-    /* Backup the coordinates */
-    pos_pre.x = universe->atom[i].pos.x;
-    pos_pre.y = universe->atom[i].pos.y;
-    pos_pre.z = universe->atom[i].pos.z;
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_RIGID_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* For each molecule */
+  for (molecule_id=0; molecule_id<(universe->copy_nb)+(universe->solvent_copy_nb); ++molecule_id)
+  {
+    if (universe_molecule(universe, molecule_id, &first, &nb) == NULL || nb == 0)
+    {
+      continue;
+    }
 
     /* Compute the pre-transformation potential */
-    if (universe_energy_total(universe, &pot_pre) == NULL)
+    if (potential_intermolecular(&pot_pre, universe, first, nb) == NULL)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_COARSE_FAILURE, __FILE__, __LINE__));
+      free(pos_pre);
+      return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_RIGID_FAILURE, __FILE__, __LINE__));
     }
 
-    /* Until we lower the potential */
-    tries = 0;
-    step_magnitude = UNIVERSE_REDUCEPOT_COARSE_STEP_MAGNITUDE;
-    do
+    /* Backup the coordinates, unwrapped around the first atom so the molecule is whole */
+    centroid.x = 0.0;
+    centroid.y = 0.0;
+    centroid.z = 0.0;
+    for (i=0; i<nb; ++i)
     {
-      /* Reset the displacement */
-      universe->atom[i].pos = pos_pre;
+      vec3_sub(&vec, &(universe->atom[first+i].pos), &(universe->atom[first].pos));
+      vec.x -= (universe->size) * round(vec.x / (universe->size));
+      vec.y -= (universe->size) * round(vec.y / (universe->size));
+      vec.z -= (universe->size) * round(vec.z / (universe->size));
+      vec3_add(&(pos_pre[i]), &(universe->atom[first].pos), &vec);
+      vec3_add(&centroid, &centroid, &(pos_pre[i]));
+    }
+    vec3_mul(&centroid, &centroid, 1.0/nb);
+
+    /* The molecule's moves of this cycle, drawn one after the other */
+    rng_init(&rng, universe->seed, molecule_id, cycle, RNG_PURPOSE_RIGID);
+    for (tries=0; tries<UNIVERSE_REDUCEPOT_RIGID_ATTEMPTS; ++tries)
+    {
+      /* Compute the displacement and the rotation */
+      vec3_marsaglia(&step, &rng);
+      vec3_mul(&step, &step, UNIVERSE_REDUCEPOT_RIGID_STEP * rng_uniform(&rng));
+      mat3_transform_gen_rand_rot(&rot, UNIVERSE_REDUCEPOT_RIGID_ANGLE, &rng);
+
+      /* Apply them to every atom of the molecule */
+      for (i=0; i<nb; ++i)
+      {
+        vec3_sub(&vec, &(pos_pre[i]), &centroid);
+        mat3_transform_apply(&rot, &vec);
+        vec3_add(&vec, &vec, &centroid);
+        vec3_add(&(universe->atom[first+i].pos), &vec, &step);
+
+        /* Enforce PBCs */
+        if (atom_enforce_pbc(universe, first+i) == NULL)
+        {
+          free(pos_pre);
+          return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_RIGID_FAILURE, __FILE__, __LINE__));
+        }
+      }
 
-      /* Compute the displacement magnitude */
-      if (tries == UNIVERSE_REDUCEPOT_COARSE_MAX_ATTEMPTS)
+      /* Compute the post-transformation potential */
+      if (potential_intermolecular(&pot_post, universe, first, nb) == NULL)
       {
-        tries = 0;
-        step_magnitude *= UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER;
+        free(pos_pre);
+        return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_RIGID_FAILURE, __FILE__, __LINE__));
       }
-      else
-        ++tries;
 
-      /* Compute the displacement */
-      vec3_marsaglia(&step);
-      vec3_mul(&step, &step, step_magnitude);
+      /* Keep the move if it lowered the potential */
+      if (pot_post < pot_pre)
+      {
+        break;
+      }
+
+      /* Otherwise, discard it */
+      for (i=0; i<nb; ++i)
+      {
+        universe->atom[first+i].pos = pos_pre[i];
+        if (atom_enforce_pbc(universe, first+i) == NULL)
+        {
+          free(pos_pre);
+          return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_RIGID_FAILURE, __FILE__, __LINE__));
+        }
+      }
+    }
+  }
+
+  free(pos_pre);
+  return (universe);
+}
+
+/* Initialise the per-atom state of the wiggling */
+reducepot_t *reducepot_init(reducepot_t *reducepot, const uint64_t atom_nb)
+{
+  size_t i;
+
+  reducepot->step = REDUCEPOT_STEP_DEFAULT;
+  reducepot->attempts = REDUCEPOT_ATTEMPTS_DEFAULT;
+  reducepot->accepted = REDUCEPOT_ACCEPTED_DEFAULT;
+  reducepot->idle = REDUCEPOT_IDLE_DEFAULT;
+  reducepot->frozen = REDUCEPOT_FROZEN_DEFAULT;
+  reducepot->atom_nb = REDUCEPOT_ATOM_NB_DEFAULT;
+  reducepot->frozen_nb = REDUCEPOT_FROZEN_NB_DEFAULT;
+
+  if ((reducepot->step = malloc(sizeof(double) * (atom_nb + 1))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REDUCEPOT_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((reducepot->attempts = calloc(atom_nb + 1, sizeof(uint64_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REDUCEPOT_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((reducepot->accepted = calloc(atom_nb + 1, sizeof(uint64_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REDUCEPOT_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((reducepot->idle = calloc(atom_nb + 1, sizeof(uint64_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REDUCEPOT_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((reducepot->frozen = calloc(atom_nb + 1, sizeof(uint8_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REDUCEPOT_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<atom_nb; ++i)
+  {
+    reducepot->step[i] = UNIVERSE_REDUCEPOT_COARSE_STEP_MAGNITUDE;
+  }
+  reducepot->atom_nb = atom_nb;
+
+  return (reducepot);
+}
+
+/* Cleans the per-atom state of the wiggling */
+void reducepot_clean(reducepot_t *reducepot)
+{
+  free(reducepot->step);
+  free(reducepot->attempts);
+  free(reducepot->accepted);
+  free(reducepot->idle);
+  free(reducepot->frozen);
+}
+
+/* Adapt each atom's magnitude to its acceptance ratio over the last cycle */
+reducepot_t *reducepot_adapt(reducepot_t *reducepot)
+{
+  size_t i;
+  double factor;
+
+  for (i=0; i<(reducepot->atom_nb); ++i)
+  {
+    if (reducepot->frozen[i] || reducepot->attempts[i] == 0)
+    {
+      continue;
+    }
+
+    /* Grow the magnitude if too many moves get accepted, shrink it otherwise */
+    factor = ((double) reducepot->accepted[i] / reducepot->attempts[i]) / UNIVERSE_REDUCEPOT_COARSE_TARGET_ACCEPTANCE;
+    if (factor < UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER)
+    {
+      factor = UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_MULTIPLIER;
+    }
+    else if (factor > UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_GROWTH)
+    {
+      factor = UNIVERSE_REDUCEPOT_COARSE_MAGNITUDE_GROWTH;
+    }
+    reducepot->step[i] *= factor;
+
+    /* Keep track of the atoms that don't go anywhere */
+    if (reducepot->accepted[i])
+      reducepot->idle[i] = 0;
+    else
+      ++(reducepot->idle[i]);
+
+    /* And stop trying to move them */
+    if (reducepot->idle[i] >= UNIVERSE_REDUCEPOT_COARSE_FREEZE_CYCLES || reducepot->step[i] < UNIVERSE_REDUCEPOT_COARSE_MIN_MAGNITUDE)
+    {
+      reducepot->frozen[i] = 1;
+      ++(reducepot->frozen_nb);
+    }
+
+    reducepot->attempts[i] = 0;
+    reducepot->accepted[i] = 0;
+  }
+
+  return (reducepot);
+}
+
+/* Apply transformations to lower the system's potential energy (wiggling) */
+universe_t *universe_reducepot_coarse(universe_t *universe, reducepot_t *reducepot)
+{
+  size_t i;
+  size_t tries;
+  double pot_pre;
+  double pot_post;
+  vec3_t step;
+  vec3_t pos_pre;
+  rng_t rng;
+
+  /* Compute the pre-transformation potential
+   * It is then kept up to date as moves get accepted, no need to recompute it
+   */
+  if (universe_energy_potential(universe, &pot_pre) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_COARSE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* For each atom that can still move */
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (reducepot->frozen[i])
+    {
+      continue;
+    }
+
+    /* Backup the coordinates */
+    pos_pre = universe->atom[i].pos;
+
+    /* Until we lower the potential, or run out of attempts */
+    for (tries=0; tries<UNIVERSE_REDUCEPOT_COARSE_MAX_ATTEMPTS; ++tries)
+    {
+      ++(reducepot->attempts[i]);
+
+      /* Compute the displacement, each attempt on an atom having its own stream */
+      rng_init(&rng, universe->seed, i, reducepot->attempts[i], RNG_PURPOSE_COARSE);
+      vec3_marsaglia(&step, &rng);
+      vec3_mul(&step, &step, reducepot->step[i]);
 
       /* Apply the displacement */
-      vec3_add(&(universe->atom[i].pos), &(universe->atom[i].pos), &step);
+      vec3_add(&(universe->atom[i].pos), &pos_pre, &step);
 
       /* Enforce PBCs */
       if (atom_enforce_pbc(universe, i) == NULL)
@@ -221,11 +517,22 @@ universe_t *universe_reducepot_coarse(universe_t *universe)
       }
 
       /* Compute the post-transformation potential */
-      if (universe_energy_total(universe, &pot_post) == NULL)
+      if (universe_energy_potential(universe, &pot_post) == NULL)
       {
         return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_COARSE_FAILURE, __FILE__, __LINE__));
       }
-    } while (pot_post > pot_pre);
+
+      /* Keep the displacement if it lowered the potential */
+      if (pot_post < pot_pre)
+      {
+        ++(reducepot->accepted[i]);
+        pot_pre = pot_post;
+        break;
+      }
+
+      /* Otherwise, reset it */
+      universe->atom[i].pos = pos_pre;
+    }
   }
 
   return (universe);
@@ -299,3 +606,131 @@ universe_t *universe_reducepot_fine(universe_t *universe)
 
   return (universe);
 }
+
+/* Apply transformations to lower the system's potential energy (batched gradient descent)
+ * Every force is computed in a single pass, then every atom takes its step at
+ * once, and the potential is only evaluated once per sweep. If the potential
+ * rose, the sweep is undone and retried with a smaller global scale.
+ * If no scale helps, a sequential sweep is done instead.
+ * potential holds the potential before the sweep and is updated in place.
+ */
+universe_t *universe_reducepot_fine_batch(universe_t *universe, double *potential, double *scale)
+{
+  size_t i;
+  int err = 0;
+  double pot_post;
+  vec3_t *pos_pre;
+  vec3_t *step;
+
+  if ((pos_pre = malloc(sizeof(vec3_t) * (universe->atom_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+  }
+  if ((step = malloc(sizeof(vec3_t) * (universe->atom_nb))) == NULL)
+  {
+    free(pos_pre);
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Compute every force at once */
+#pragma omp parallel for
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (atom_update_frc_analytical(universe, i) == NULL)
+    {
+#pragma omp atomic write
+      err = 1;
+    }
+  }
+  if (err)
+  {
+    free(pos_pre);
+    free(step);
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Derive each atom's step from its force, same as the sequential descent */
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    pos_pre[i] = universe->atom[i].pos;
+    vec3_mul(&(step[i]), &(universe->atom[i].frc), POW2(UNIVERSE_REDUCEPOT_FINE_TIMESTEP)/(2* universe->model.entry[universe->atom[i].element].mass));
+
+    /* Limit the maximum displacement */
+    if (vec3_mag(&(step[i])) > UNIVERSE_REDUCEPOT_FINE_MAX_STEP)
+    {
+      vec3_mul(&(step[i]), &(step[i]), UNIVERSE_REDUCEPOT_FINE_MAX_STEP/vec3_mag(&(step[i])));
+    }
+  }
+
+  /* Back off until the sweep lowers the potential */
+  while (*scale >= UNIVERSE_REDUCEPOT_FINE_MIN_SCALE)
+  {
+    /* Move every atom */
+#pragma omp parallel for
+    for (i=0; i<(universe->atom_nb); ++i)
+    {
+      vec3_t scaled;
+
+      vec3_mul(&scaled, &(step[i]), *scale);
+      vec3_add(&(universe->atom[i].pos), &(pos_pre[i]), &scaled);
+      if (atom_enforce_pbc(universe, i) == NULL)
+      {
+#pragma omp atomic write
+        err = 1;
+      }
+    }
+    if (err)
+    {
+      free(pos_pre);
+      free(step);
+      return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+    }
+
+    if (universe_energy_potential(universe, &pot_post) == NULL)
+    {
+      free(pos_pre);
+      free(step);
+      return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+    }
+
+    /* Keep the sweep, and let the next one be a bit bolder */
+    if (pot_post < *potential)
+    {
+      *potential = pot_post;
+      *scale *= UNIVERSE_REDUCEPOT_FINE_GROWTH;
+      if (*scale > 1.0)
+        *scale = 1.0;
+      free(pos_pre);
+      free(step);
+      return (universe);
+    }
+
+    *scale *= UNIVERSE_REDUCEPOT_FINE_BACKOFF;
+  }
+
+  /* No scale lowers the potential, undo the sweep */
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    universe->atom[i].pos = pos_pre[i];
+  }
+  free(pos_pre);
+  free(step);
+
+  /* The forces don't derive exactly from the summed potential (angle terms
+   * are only accounted for at the node), so fall back to one atom-by-atom
+   * sweep, which can still reject the moves that go uphill.
+   */
+  if (universe_reducepot_fine(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+  }
+  if (universe_energy_potential(universe, potential) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_REDUCEPOT_FINE_BATCH_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Give the next batched sweep a full step again */
+  *scale = 1.0;
+
+  return (universe);
+}
@@ -0,0 +1,264 @@
+/*
+ * reorder.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <omp.h>
+
+#include "config.h"
+#include "reorder.h"
+#include "cell.h"
+#include "affinity.h"
+#include "text.h"
+#include "util.h"
+
+/* Spread the low REORDER_AXIS_BITS bits of x two bits apart */
+static uint64_t reorder_spread(uint64_t x)
+{
+  x &= 0x1FFFFF;
+  x = (x | (x << 32)) & 0x1F00000000FFFF;
+  x = (x | (x << 16)) & 0x1F0000FF0000FF;
+  x = (x | (x << 8))  & 0x100F00F00F00F00F;
+  x = (x | (x << 4))  & 0x10C30C30C30C30C3;
+  x = (x | (x << 2))  & 0x1249249249249249;
+
+  return (x);
+}
+
+/* Cell along an axis of a coordinate, out of side_nb, through the periodic boundaries */
+static uint64_t reorder_axis(const universe_t *universe, const uint64_t side_nb, const double x)
+{
+  double wrapped;
+  int64_t slot;
+
+  wrapped = x - (universe->size)*floor((x + 0.5*(universe->size))/(universe->size));
+  slot = (int64_t) floor((wrapped + 0.5*(universe->size))*side_nb/(universe->size));
+  if (slot < 0)
+    return (0);
+  if (slot >= (int64_t) side_nb)
+    return (side_nb - 1);
+
+  return ((uint64_t) slot);
+}
+
+/* Sort by key, then by index for atoms sharing a cell to keep their order */
+static int reorder_compare(const void *a, const void *b)
+{
+  const reorder_entry_t *entry_a;
+  const reorder_entry_t *entry_b;
+
+  entry_a = a;
+  entry_b = b;
+  if (entry_a->key != entry_b->key)
+    return ((entry_a->key < entry_b->key) ? -1 : 1);
+  if (entry_a->id != entry_b->id)
+    return ((entry_a->id < entry_b->id) ? -1 : 1);
+
+  return (0);
+}
+
+/* Move the atom at from[i] to i, renumbering the bonds and the original ids */
+static universe_t *reorder_permute(universe_t *universe)
+{
+  reorder_t *reorder;
+  atom_t *atom;
+  uint64_t i;
+  uint8_t k;
+
+  reorder = universe->reorder;
+
+  /* Where each original atom is headed, while the order is still the old one */
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->where[reorder->order[reorder->from[i]]] = i;
+  }
+
+  /* Move the atoms, their bonds now pointing to where the others went */
+#pragma omp parallel for schedule(static) private(k)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->atom[i] = universe->atom[reorder->from[i]];
+    for (k=0; k<(reorder->atom[i].bond_nb); ++k)
+    {
+      reorder->atom[i].bond[k] = reorder->where[reorder->order[reorder->atom[i].bond[k]]];
+    }
+  }
+
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->order[reorder->where[i]] = i;
+  }
+
+  atom = universe->atom;
+  universe->atom = reorder->atom;
+  reorder->atom = atom;
+
+  return (universe);
+}
+
+/* Start from the input order, if the atoms are to be sorted at all */
+universe_t *reorder_open(universe_t *universe, const args_t *args)
+{
+  reorder_t *reorder;
+  uint64_t i;
+
+  if (args->reorder == 0)
+  {
+    return (universe);
+  }
+
+  if ((reorder = malloc(sizeof(reorder_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REORDER_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+  reorder->every = args->reorder;
+  reorder->order = REORDER_ORDER_DEFAULT;
+  reorder->where = REORDER_WHERE_DEFAULT;
+  reorder->from = REORDER_FROM_DEFAULT;
+  reorder->entry = REORDER_ENTRY_DEFAULT;
+  reorder->atom = REORDER_ATOM_DEFAULT;
+  reorder->pass_nb = REORDER_PASS_NB_DEFAULT;
+  reorder->pass_time = REORDER_PASS_TIME_DEFAULT;
+  reorder->step_nb[0] = REORDER_STEP_NB_DEFAULT;
+  reorder->step_nb[1] = REORDER_STEP_NB_DEFAULT;
+  reorder->step_time[0] = REORDER_STEP_TIME_DEFAULT;
+  reorder->step_time[1] = REORDER_STEP_TIME_DEFAULT;
+  universe->reorder = reorder;
+
+  if ((reorder->order = malloc(sizeof(uint64_t) * (universe->atom_nb))) == NULL ||
+      (reorder->where = malloc(sizeof(uint64_t) * (universe->atom_nb))) == NULL ||
+      (reorder->from = malloc(sizeof(uint64_t) * (universe->atom_nb))) == NULL ||
+      (reorder->entry = malloc(sizeof(reorder_entry_t) * (universe->atom_nb))) == NULL ||
+      (reorder->atom = affinity_alloc(universe->atom_nb, sizeof(atom_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_REORDER_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->order[i] = i;
+    reorder->where[i] = i;
+  }
+
+  return (universe);
+}
+
+/* Returns 1 if the atoms are to be sorted before the next iteration */
+int reorder_due(const universe_t *universe)
+{
+  return (universe->reorder != NULL && universe->iterations > 0 &&
+          !(universe->iterations % universe->reorder->every));
+}
+
+/* Sort the atoms along the Morton curve through the cells */
+universe_t *reorder_apply(universe_t *universe)
+{
+  reorder_t *reorder;
+  uint64_t side_nb;
+  uint64_t i;
+  double start;
+
+  reorder = universe->reorder;
+  start = omp_get_wtime();
+  side_nb = (universe->cell != NULL) ? universe->cell->side_nb : REORDER_SIDE_NB;
+  if (side_nb > ((uint64_t)1 << REORDER_AXIS_BITS))
+  {
+    return (retstr(NULL, TEXT_REORDER_APPLY_FAILURE, __FILE__, __LINE__));
+  }
+
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->entry[i].key = (reorder_spread(reorder_axis(universe, side_nb, universe->atom[i].pos.z)) << 2) |
+                            (reorder_spread(reorder_axis(universe, side_nb, universe->atom[i].pos.y)) << 1) |
+                             reorder_spread(reorder_axis(universe, side_nb, universe->atom[i].pos.x));
+    reorder->entry[i].id = i;
+  }
+  qsort(reorder->entry, universe->atom_nb, sizeof(reorder_entry_t), reorder_compare);
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->from[i] = reorder->entry[i].id;
+  }
+  reorder_permute(universe);
+
+  ++(reorder->pass_nb);
+  reorder->pass_time += omp_get_wtime() - start;
+
+  return (universe);
+}
+
+/* Put the atoms back in the input order, for a checkpoint to hold them so */
+universe_t *reorder_restore(universe_t *universe)
+{
+  reorder_t *reorder;
+  uint64_t i;
+
+  reorder = universe->reorder;
+  if (reorder == NULL)
+  {
+    return (universe);
+  }
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    reorder->from[i] = reorder->where[i];
+  }
+
+  return (reorder_permute(universe));
+}
+
+/* Count an iteration's time, before or after the first sort */
+void reorder_account(universe_t *universe, const double step_time)
+{
+  reorder_t *reorder;
+
+  reorder = universe->reorder;
+  if (reorder == NULL)
+  {
+    return;
+  }
+
+  ++(reorder->step_nb[(reorder->pass_nb) ? 1 : 0]);
+  reorder->step_time[(reorder->pass_nb) ? 1 : 0] += step_time;
+}
+
+/* Tell how long an iteration took before and after the atoms were sorted */
+void reorder_report(const universe_t *universe)
+{
+  const reorder_t *reorder;
+
+  reorder = universe->reorder;
+  if (reorder == NULL)
+  {
+    return;
+  }
+
+  printf(TEXT_REORDER_REPORT, reorder->pass_nb, reorder->pass_time,
+         (reorder->step_nb[0]) ? 1E3*(reorder->step_time[0])/(reorder->step_nb[0]) : 0.0, reorder->step_nb[0],
+         (reorder->step_nb[1]) ? 1E3*(reorder->step_time[1])/(reorder->step_nb[1]) : 0.0, reorder->step_nb[1]);
+}
+
+void reorder_close(universe_t *universe)
+{
+  if (universe->reorder == NULL)
+  {
+    return;
+  }
+
+  free(universe->reorder->order);
+  free(universe->reorder->where);
+  free(universe->reorder->from);
+  free(universe->reorder->entry);
+  free(universe->reorder->atom);
+  free(universe->reorder);
+  universe->reorder = UNIVERSE_REORDER_DEFAULT;
+}
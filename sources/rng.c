@@ -0,0 +1,166 @@
+/*
+ * rng.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "rng.h"
+
+/* Philox4x32 constants */
+#define RNG_PHILOX_M0 ((uint64_t)0xD2511F53)
+#define RNG_PHILOX_M1 ((uint64_t)0xCD9E8D57)
+#define RNG_PHILOX_W0 ((uint32_t)0x9E3779B9)
+#define RNG_PHILOX_W1 ((uint32_t)0xBB67AE85)
+
+/* Variates drawn by the vectorized loop before they're transformed */
+#define RNG_BATCH_CHUNK 256
+
+/* 2^-53, to turn 53 random bits into a double in [0;1[ */
+#define RNG_DOUBLE_UNIT (1.0 / 9007199254740992.0)
+
+/* A round of Philox, bumping the key for the next one */
+#define RNG_PHILOX_ROUND(x0, x1, x2, x3, k0, k1) \
+  do \
+  { \
+    uint64_t product_0; \
+    uint64_t product_1; \
+    product_0 = RNG_PHILOX_M0 * (x0); \
+    product_1 = RNG_PHILOX_M1 * (x2); \
+    (x0) = ((uint32_t) (product_1 >> 32)) ^ (x1) ^ (k0); \
+    (x1) = (uint32_t) product_1; \
+    (x2) = ((uint32_t) (product_0 >> 32)) ^ (x3) ^ (k1); \
+    (x3) = (uint32_t) product_0; \
+    (k0) += RNG_PHILOX_W0; \
+    (k1) += RNG_PHILOX_W1; \
+  } while (0)
+
+/* Compute the block of a counter under a key, in place on four words. The
+ * ten rounds of Philox4x32-10 are written out and there's no call, for the
+ * batch loop to be vectorized.
+ */
+#define RNG_PHILOX_BLOCK(x0, x1, x2, x3, key_0, key_1) \
+  do \
+  { \
+    uint32_t round_k0 = (key_0); \
+    uint32_t round_k1 = (key_1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+    RNG_PHILOX_ROUND(x0, x1, x2, x3, round_k0, round_k1); \
+  } while (0)
+
+void rng_philox(uint32_t word[RNG_WORD_NB], const uint32_t ctr[RNG_WORD_NB], const uint32_t key[2])
+{
+  uint32_t x0;
+  uint32_t x1;
+  uint32_t x2;
+  uint32_t x3;
+
+  x0 = ctr[0];
+  x1 = ctr[1];
+  x2 = ctr[2];
+  x3 = ctr[3];
+  RNG_PHILOX_BLOCK(x0, x1, x2, x3, key[0], key[1]);
+  word[0] = x0;
+  word[1] = x1;
+  word[2] = x2;
+  word[3] = x3;
+}
+
+/* Start the stream of a purpose, for an id at a step */
+rng_t *rng_init(rng_t *rng, const uint64_t seed, const uint64_t id, const uint64_t step, const uint32_t purpose)
+{
+  rng->key[0] = (uint32_t) seed;
+  rng->key[1] = (uint32_t) (seed >> 32);
+  rng->ctr[0] = 0;
+  rng->ctr[1] = purpose;
+  rng->ctr[2] = (uint32_t) id;
+  rng->ctr[3] = (uint32_t) step;
+  rng->left = RNG_LEFT_DEFAULT;
+
+  return (rng);
+}
+
+uint32_t rng_u32(rng_t *rng)
+{
+  if (rng->left == 0)
+  {
+    rng_philox(rng->word, rng->ctr, rng->key);
+    ++(rng->ctr[0]);
+    rng->left = RNG_WORD_NB;
+  }
+
+  return (rng->word[RNG_WORD_NB - (rng->left)--]);
+}
+
+/* Two words, 53 bits of them */
+double rng_uniform(rng_t *rng)
+{
+  uint32_t hi;
+  uint32_t lo;
+
+  hi = rng_u32(rng) >> 5;
+  lo = rng_u32(rng) >> 6;
+
+  return ((hi * 67108864.0 + lo) * RNG_DOUBLE_UNIT);
+}
+
+/* Box-Muller, 1-u keeps the logarithm away from 0. Each block gives a pair
+ * of variates, the even one is the cosine half.
+ * The blocks are drawn by a vectorized loop, a chunk at a time, then turned
+ * into variates: without -ffast-math the libm calls aren't vectorized.
+ */
+double *rng_gaussian_batch(double *dest, const size_t nb, const uint64_t first, const uint64_t seed, const uint64_t id, const uint64_t step, const uint32_t purpose)
+{
+  double angle[RNG_BATCH_CHUNK];
+  uint32_t k0;
+  uint32_t k1;
+  size_t chunk;
+  size_t chunk_nb;
+  size_t i;
+
+  k0 = (uint32_t) seed;
+  k1 = (uint32_t) (seed >> 32);
+
+  for (chunk=0; chunk<nb; chunk+=RNG_BATCH_CHUNK)
+  {
+    chunk_nb = (nb - chunk < RNG_BATCH_CHUNK) ? nb - chunk : RNG_BATCH_CHUNK;
+
+#pragma omp simd
+    for (i=0; i<chunk_nb; ++i)
+    {
+      uint32_t x0;
+      uint32_t x1;
+      uint32_t x2;
+      uint32_t x3;
+
+      x0 = (uint32_t) ((first + chunk + i) >> 1);
+      x1 = purpose;
+      x2 = (uint32_t) id;
+      x3 = (uint32_t) step;
+      RNG_PHILOX_BLOCK(x0, x1, x2, x3, k0, k1);
+
+      dest[chunk + i] = 1.0 - ((x0 >> 5) * 67108864.0 + (x1 >> 6)) * RNG_DOUBLE_UNIT;
+      angle[i] = 2.0 * M_PI * ((x2 >> 5) * 67108864.0 + (x3 >> 6)) * RNG_DOUBLE_UNIT;
+    }
+
+    for (i=0; i<chunk_nb; ++i)
+    {
+      dest[chunk + i] = sqrt(-2.0 * log(dest[chunk + i])) *
+                        (((first + chunk + i) & 1) ? sin(angle[i]) : cos(angle[i]));
+    }
+  }
+
+  return (dest);
+}
@@ -0,0 +1,354 @@
+/*
+ * scheduler.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <omp.h>
+
+#include "scheduler.h"
+#include "text.h"
+#include "util.h"
+
+#define SCHED_NONE UINT64_MAX /* No task left */
+
+/* Most expensive first, ties broken by id for the dealing to be reproducible */
+static int sched_compare(const void *a, const void *b)
+{
+  const sched_entry_t *entry_a;
+  const sched_entry_t *entry_b;
+
+  entry_a = (const sched_entry_t*) a;
+  entry_b = (const sched_entry_t*) b;
+
+  if (entry_a->cost != entry_b->cost)
+    return ((entry_a->cost > entry_b->cost) ? -1 : 1);
+  if (entry_a->id != entry_b->id)
+    return ((entry_a->id < entry_b->id) ? -1 : 1);
+
+  return (0);
+}
+
+/* Deal the tasks, each going to the thread with the least work so far */
+static sched_t *sched_deal(sched_t *sched, const uint64_t task_nb, const uint64_t *cost)
+{
+  uint64_t i;
+  int thread;
+  int lightest;
+
+  for (i=0; i<task_nb; ++i)
+  {
+    sched->entry[i].cost = cost[i];
+    sched->entry[i].id = i;
+  }
+  qsort(sched->entry, task_nb, sizeof(sched_entry_t), sched_compare);
+
+  for (thread=0; thread<(sched->team_nb); ++thread)
+  {
+    sched->load[thread] = 0;
+    sched->deque[thread].tail = 0;
+  }
+
+  for (i=0; i<task_nb; ++i)
+  {
+    lightest = 0;
+    for (thread=1; thread<(sched->team_nb); ++thread)
+    {
+      if (sched->load[thread] < sched->load[lightest])
+      {
+        lightest = thread;
+      }
+    }
+    sched->load[lightest] += sched->entry[i].cost;
+    ++(sched->deque[lightest].tail);
+    sched->entry[i].thread = lightest;
+  }
+
+  /* Lay the deques out one after the other, then fill them in cost order */
+  sched->deque[0].head = 0;
+  for (thread=1; thread<(sched->team_nb); ++thread)
+  {
+    sched->deque[thread].head = sched->deque[thread-1].head + sched->deque[thread-1].tail;
+  }
+  for (thread=0; thread<(sched->team_nb); ++thread)
+  {
+    sched->deque[thread].tail = sched->deque[thread].head;
+  }
+  for (i=0; i<task_nb; ++i)
+  {
+    thread = sched->entry[i].thread;
+    sched->order[(sched->deque[thread].tail)++] = sched->entry[i].id;
+  }
+
+  return (sched);
+}
+
+/* Next task for a thread, from its own deque or stolen from another one */
+static uint64_t sched_next(sched_t *sched, const int thread, uint64_t *stolen)
+{
+  sched_deque_t *deque;
+  uint64_t task;
+  int victim;
+  int i;
+
+  deque = &(sched->deque[thread]);
+  omp_set_lock(&(deque->lock));
+  task = (deque->head < deque->tail) ? sched->order[(deque->head)++] : SCHED_NONE;
+  omp_unset_lock(&(deque->lock));
+  if (task != SCHED_NONE)
+  {
+    return (task);
+  }
+
+  /* Nothing is ever added, a deque found empty stays empty */
+  for (i=1; i<(sched->team_nb); ++i)
+  {
+    victim = (thread + i) % (sched->team_nb);
+    deque = &(sched->deque[victim]);
+    omp_set_lock(&(deque->lock));
+    task = (deque->head < deque->tail) ? sched->order[--(deque->tail)] : SCHED_NONE;
+    omp_unset_lock(&(deque->lock));
+    if (task != SCHED_NONE)
+    {
+      ++(*stolen);
+      return (task);
+    }
+  }
+
+  return (SCHED_NONE);
+}
+
+/* Make room for thread_nb threads, keeping what the others have done */
+static sched_t *sched_grow(sched_t *sched, const int thread_nb)
+{
+  sched_deque_t *deque;
+  uint64_t *load;
+  double *busy;
+  double *idle;
+  uint64_t *done;
+  uint64_t *stolen;
+  int i;
+
+  /* The locks are all free between runs, they are set up again after moving */
+  for (i=0; i<(sched->thread_nb); ++i)
+  {
+    omp_destroy_lock(&(sched->deque[i].lock));
+  }
+  if ((deque = realloc(sched->deque, sizeof(sched_deque_t) * thread_nb)) != NULL)
+  {
+    sched->deque = deque;
+  }
+  for (i=0; i<(sched->thread_nb); ++i)
+  {
+    omp_init_lock(&(sched->deque[i].lock));
+  }
+  if (deque == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  if ((load = realloc(sched->load, sizeof(uint64_t) * thread_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  sched->load = load;
+  if ((busy = realloc(sched->busy, sizeof(double) * thread_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  sched->busy = busy;
+  if ((idle = realloc(sched->idle, sizeof(double) * thread_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  sched->idle = idle;
+  if ((done = realloc(sched->done, sizeof(uint64_t) * thread_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  sched->done = done;
+  if ((stolen = realloc(sched->stolen, sizeof(uint64_t) * thread_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  sched->stolen = stolen;
+
+  for (i=(sched->thread_nb); i<thread_nb; ++i)
+  {
+    omp_init_lock(&(sched->deque[i].lock));
+    sched->busy[i] = 0.0;
+    sched->idle[i] = 0.0;
+    sched->done[i] = 0;
+    sched->stolen[i] = 0;
+  }
+  sched->thread_nb = thread_nb;
+
+  return (sched);
+}
+
+universe_t *sched_init(universe_t *universe, const uint64_t task_max)
+{
+  sched_t *sched;
+  int i;
+
+  if ((sched = malloc(sizeof(sched_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  sched->thread_nb = SCHED_THREAD_NB_DEFAULT;
+  sched->team_nb = SCHED_TEAM_NB_DEFAULT;
+  sched->task_max = SCHED_TASK_MAX_DEFAULT;
+  sched->deque = SCHED_DEQUE_DEFAULT;
+  sched->entry = SCHED_ENTRY_DEFAULT;
+  sched->order = SCHED_ORDER_DEFAULT;
+  sched->load = SCHED_LOAD_DEFAULT;
+  sched->busy = SCHED_BUSY_DEFAULT;
+  sched->idle = SCHED_IDLE_DEFAULT;
+  sched->done = SCHED_DONE_DEFAULT;
+  sched->stolen = SCHED_STOLEN_DEFAULT;
+  sched->run_nb = SCHED_RUN_NB_DEFAULT;
+  universe->sched = sched;
+
+  sched->thread_nb = omp_get_max_threads();
+  sched->task_max = task_max;
+  if ((sched->deque = malloc(sizeof(sched_deque_t) * (sched->thread_nb))) == NULL ||
+      (sched->entry = malloc(sizeof(sched_entry_t) * task_max)) == NULL ||
+      (sched->order = malloc(sizeof(uint64_t) * task_max)) == NULL ||
+      (sched->load = malloc(sizeof(uint64_t) * (sched->thread_nb))) == NULL ||
+      (sched->busy = calloc(sched->thread_nb, sizeof(double))) == NULL ||
+      (sched->idle = calloc(sched->thread_nb, sizeof(double))) == NULL ||
+      (sched->done = calloc(sched->thread_nb, sizeof(uint64_t))) == NULL ||
+      (sched->stolen = calloc(sched->thread_nb, sizeof(uint64_t))) == NULL)
+  {
+    free(sched->deque);
+    sched->deque = SCHED_DEQUE_DEFAULT;
+    return (retstr(NULL, TEXT_SCHED_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<(sched->thread_nb); ++i)
+  {
+    omp_init_lock(&(sched->deque[i].lock));
+  }
+
+  return (universe);
+}
+
+/* Run task_nb tasks, cost[i] being the estimated cost of task i */
+universe_t *sched_run(universe_t *universe, const uint64_t task_nb, const uint64_t *cost, sched_task_t task)
+{
+  sched_t *sched;
+  int err;
+
+  sched = universe->sched;
+  if (task_nb > sched->task_max)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Whoever calls, the team is the caller's share of the threads */
+  sched->team_nb = omp_get_max_threads();
+  if (sched->team_nb > sched->thread_nb && sched_grow(sched, sched->team_nb) == NULL)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+  sched_deal(sched, task_nb, cost);
+
+  err = 0;
+#pragma omp parallel num_threads(sched->team_nb)
+  {
+    uint64_t task_id;
+    uint64_t done;
+    uint64_t stolen;
+    double start;
+    double busy;
+    double task_start;
+    int thread;
+
+    thread = omp_get_thread_num();
+    done = 0;
+    stolen = 0;
+    busy = 0.0;
+    start = omp_get_wtime();
+
+    while ((task_id = sched_next(sched, thread, &stolen)) != SCHED_NONE)
+    {
+      task_start = omp_get_wtime();
+      if (task(universe, task_id) == NULL)
+      {
+#pragma omp atomic write
+        err = 1;
+      }
+      busy += omp_get_wtime() - task_start;
+      ++done;
+    }
+
+    /* Whatever isn't spent on tasks is spent waiting for the last thread */
+#pragma omp barrier
+    sched->busy[thread] += busy;
+    sched->idle[thread] += omp_get_wtime() - start - busy;
+    sched->done[thread] += done;
+    sched->stolen[thread] += stolen;
+  }
+  ++(sched->run_nb);
+
+  if (err)
+  {
+    return (retstr(NULL, TEXT_SCHED_RUN_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Tell how busy each thread was */
+void sched_report(const universe_t *universe)
+{
+  const sched_t *sched;
+  double total;
+  int i;
+
+  sched = universe->sched;
+  if (sched == NULL || sched->run_nb == 0)
+  {
+    return;
+  }
+
+  for (i=0; i<(sched->thread_nb); ++i)
+  {
+    total = sched->busy[i] + sched->idle[i];
+    printf(TEXT_SCHED_REPORT, i, sched->busy[i], sched->idle[i],
+           (total > 0.0) ? 100*(sched->idle[i])/total : 0.0,
+           sched->done[i], sched->stolen[i]);
+  }
+}
+
+void sched_clean(universe_t *universe)
+{
+  int i;
+
+  if (universe->sched == NULL)
+  {
+    return;
+  }
+
+  if (universe->sched->deque != NULL)
+  {
+    for (i=0; i<(universe->sched->thread_nb); ++i)
+    {
+      omp_destroy_lock(&(universe->sched->deque[i].lock));
+    }
+  }
+  free(universe->sched->deque);
+  free(universe->sched->entry);
+  free(universe->sched->order);
+  free(universe->sched->load);
+  free(universe->sched->busy);
+  free(universe->sched->idle);
+  free(universe->sched->done);
+  free(universe->sched->stolen);
+  free(universe->sched);
+  universe->sched = UNIVERSE_SCHED_DEFAULT;
+}
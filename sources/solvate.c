@@ -0,0 +1,222 @@
+/*
+ * solvate.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "occupancy.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+#include "vec3.h"
+#include "affinity.h"
+#include "rng.h"
+
+/* Fill the space left by the substrate copies with solvent molecules
+ *
+ * The number of solvent molecules is chosen so that the universe reaches the
+ * requested density. They are loaded on a simple cubic lattice with random
+ * orientations, and every molecule that would land too close to an atom
+ * already in the universe is dropped. Should too many be dropped, the
+ * lattice is refined and the solvation starts over.
+ */
+universe_t *universe_solvate(universe_t *universe, const args_t *args)
+{
+  size_t i;
+  size_t ii;
+  uint64_t solute_atom_nb;   /* Atoms in the universe before solvation */
+  uint64_t solvent_nb;       /* Solvent molecules to insert */
+  uint64_t site_nb;          /* Sites on the current lattice */
+  uint64_t cell_nb;          /* Lattice cells per side */
+  uint64_t inserted;         /* Solvent molecules inserted so far */
+  uint64_t *order;           /* Order in which the sites are visited */
+  uint64_t tmp;
+  uint64_t swap;
+  double mass_solute;        /* (kg) */
+  double mass_solvent;       /* (kg) Mass of a solvent molecule */
+  double mass_target;        /* (kg) Mass required to reach the density */
+  int clash;
+  vec3_t site;
+  vec3_t centroid;
+  vec3_t pos;
+  mat3_t rot;
+  rng_t rng;
+  atom_t *atom;
+  occupancy_t occupancy;
+
+  solute_atom_nb = universe->atom_nb;
+
+  /* Nothing to do with an empty solvent */
+  if (universe->solvent_atom_nb == 0)
+  {
+    return (universe);
+  }
+
+  /* Get the masses */
+  mass_solute = 0.0;
+  for (i=0; i<solute_atom_nb; ++i)
+  {
+    mass_solute += universe->model.entry[universe->atom[i].element].mass;
+  }
+  mass_solvent = 0.0;
+  for (i=0; i<(universe->solvent_atom_nb); ++i)
+  {
+    mass_solvent += universe->model.entry[universe->solvent_atom[i].element].mass;
+  }
+  if (mass_solvent < DIV_THRESHOLD)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* How many solvent molecules are needed to reach the density */
+  mass_target = (args->density) * POW3(universe->size);
+  if (mass_target <= mass_solute)
+  {
+    return (universe);
+  }
+  solvent_nb = (uint64_t) floor((mass_target - mass_solute) / mass_solvent);
+  if (solvent_nb == 0)
+  {
+    return (universe);
+  }
+
+  /* Make room for the solvent, the grown array being first touched by the threads too */
+  if ((atom = affinity_alloc(solute_atom_nb + solvent_nb*(universe->solvent_atom_nb), sizeof(atom_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+  }
+  memcpy(atom, universe->atom, sizeof(atom_t) * solute_atom_nb);
+  free(universe->atom);
+  universe->atom = atom;
+  for (i=solute_atom_nb; i<solute_atom_nb + solvent_nb*(universe->solvent_atom_nb); ++i)
+  {
+    atom_init(&(universe->atom[i]));
+  }
+
+  /* Record every atom in an occupancy grid */
+  if (occupancy_init(&occupancy, universe->size, UNIVERSE_SOLVATE_CLASH_DIST, solute_atom_nb + solvent_nb*(universe->solvent_atom_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Get the solvent's centroid, the atoms are placed relative to it */
+  centroid.x = 0.0;
+  centroid.y = 0.0;
+  centroid.z = 0.0;
+  for (i=0; i<(universe->solvent_atom_nb); ++i)
+  {
+    vec3_add(&centroid, &centroid, &(universe->solvent_atom[i].pos));
+  }
+  vec3_mul(&centroid, &centroid, 1.0/(universe->solvent_atom_nb));
+
+  /* Start with the smallest lattice with enough sites */
+  cell_nb = (uint64_t) ceil(cbrt((double) solvent_nb));
+  inserted = 0;
+  order = NULL;
+  while (inserted < solvent_nb)
+  {
+    /* Don't refine the lattice forever */
+    if ((universe->size) / cell_nb < UNIVERSE_SOLVATE_CLASH_DIST)
+    {
+      break;
+    }
+
+    /* Start over from the solute */
+    for (i=solute_atom_nb; i<solute_atom_nb + inserted*(universe->solvent_atom_nb); ++i)
+    {
+      atom_clean(&(universe->atom[i]));
+      atom_init(&(universe->atom[i]));
+    }
+    inserted = 0;
+    occupancy_reset(&occupancy);
+    for (i=0; i<solute_atom_nb; ++i)
+    {
+      if (occupancy_insert(&occupancy, &(universe->atom[i].pos)) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+      }
+    }
+
+    /* Visit the sites in a random order, so dropped sites don't leave a hole at the end of the lattice */
+    site_nb = cell_nb*cell_nb*cell_nb;
+    free(order);
+    if ((order = malloc(sizeof(uint64_t) * site_nb)) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+    }
+    for (i=0; i<site_nb; ++i)
+    {
+      order[i] = i;
+    }
+    rng_init(&rng, universe->seed, 0, cell_nb, RNG_PURPOSE_SHUFFLE);
+    for (i=site_nb-1; i>0; --i)
+    {
+      swap = (uint64_t) (rng_uniform(&rng) * (i+1));
+      tmp = order[i];
+      order[i] = order[swap];
+      order[swap] = tmp;
+    }
+
+    for (i=0; i<site_nb && inserted<solvent_nb; ++i)
+    {
+      if (universe_populate_site(universe, &site, order[i], site_nb, POPULATE_MODE_SC) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+      }
+      rng_init(&rng, universe->seed, order[i], cell_nb, RNG_PURPOSE_SOLVATE);
+      mat3_transform_gen_rand_rot(&rot, 2*M_PI, &rng);
+
+      /* Check each atom of the candidate molecule for clashes */
+      clash = 0;
+      for (ii=0; ii<(universe->solvent_atom_nb) && !clash; ++ii)
+      {
+        vec3_sub(&pos, &(universe->solvent_atom[ii].pos), &centroid);
+        mat3_transform_apply(&rot, &pos);
+        vec3_add(&pos, &pos, &site);
+        clash = occupancy_clash(&occupancy, &pos, UNIVERSE_SOLVATE_CLASH_DIST);
+      }
+      if (clash)
+      {
+        continue;
+      }
+
+      /* Load the molecule and record its atoms */
+      if (universe_populate_copy(universe, universe->solvent_atom, universe->solvent_atom_nb, solute_atom_nb + inserted*(universe->solvent_atom_nb), &site, &rot) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+      }
+      for (ii=0; ii<(universe->solvent_atom_nb); ++ii)
+      {
+        if (occupancy_insert(&occupancy, &(universe->atom[solute_atom_nb + inserted*(universe->solvent_atom_nb) + ii].pos)) == NULL)
+        {
+          return (retstr(NULL, TEXT_UNIVERSE_SOLVATE_FAILURE, __FILE__, __LINE__));
+        }
+      }
+      ++inserted;
+    }
+
+    ++cell_nb;
+  }
+
+  free(order);
+  occupancy_clean(&occupancy);
+
+  /* We may have fallen short of the target */
+  if (inserted < solvent_nb)
+  {
+    printf(TEXT_UNIVERSE_SOLVATE_SHORT, inserted, solvent_nb);
+  }
+
+  universe->solvent_copy_nb = inserted;
+  universe->atom_nb = solute_atom_nb + inserted*(universe->solvent_atom_nb);
+
+  return (universe);
+}
@@ -0,0 +1,368 @@
+/*
+ * stc.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "stc.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+
+/* Bit-packing state, bits are stored least significant first */
+typedef struct stc_bits_s stc_bits_t;
+struct stc_bits_s
+{
+  uint8_t *buf;  /* The packed bytes */
+  size_t len;    /* Bytes available in buf */
+  size_t pos;    /* Bits written or read so far */
+  uint64_t acc;  /* Bits waiting to be flushed or consumed */
+  uint8_t acc_nb;
+};
+
+/* Map signed values to unsigned ones, small magnitudes first */
+static uint32_t stc_zigzag(const int64_t v)
+{
+  return ((uint32_t) ((v < 0) ? (-2*v - 1) : (2*v)));
+}
+
+static int64_t stc_unzigzag(const uint32_t u)
+{
+  return ((u & 1) ? -((int64_t) (u >> 1)) - 1 : (int64_t) (u >> 1));
+}
+
+/* Number of bits needed to store u */
+static uint8_t stc_width(uint32_t u)
+{
+  uint8_t w;
+
+  for (w=0; u; ++w)
+  {
+    u >>= 1;
+  }
+
+  return (w);
+}
+
+static void stc_bits_write(stc_bits_t *bits, const uint32_t value, const uint8_t width)
+{
+  if (width == 0)
+  {
+    return;
+  }
+
+  bits->acc |= ((uint64_t) value) << bits->acc_nb;
+  bits->acc_nb += width;
+  bits->pos += width;
+  while (bits->acc_nb >= 8)
+  {
+    bits->buf[(bits->pos - bits->acc_nb) / 8] = (uint8_t) bits->acc;
+    bits->acc >>= 8;
+    bits->acc_nb -= 8;
+  }
+}
+
+static void stc_bits_flush(stc_bits_t *bits)
+{
+  if (bits->acc_nb)
+  {
+    bits->buf[(bits->pos - bits->acc_nb) / 8] = (uint8_t) bits->acc;
+    bits->acc = 0;
+    bits->acc_nb = 0;
+  }
+}
+
+/* Returns 0 if reading past the end of the buffer */
+static int stc_bits_read(stc_bits_t *bits, uint32_t *value, const uint8_t width)
+{
+  if (width == 0)
+  {
+    *value = 0;
+    return (1);
+  }
+
+  while (bits->acc_nb < width)
+  {
+    if ((bits->pos + bits->acc_nb) / 8 >= bits->len)
+    {
+      return (0);
+    }
+    bits->acc |= ((uint64_t) bits->buf[(bits->pos + bits->acc_nb) / 8]) << bits->acc_nb;
+    bits->acc_nb += 8;
+  }
+
+  *value = (uint32_t) (bits->acc & ((((uint64_t) 1) << width) - 1));
+  bits->acc >>= width;
+  bits->acc_nb -= width;
+  bits->pos += width;
+
+  return (1);
+}
+
+/* Largest payload a frame of atom_nb atoms can produce */
+size_t stc_frame_bound(const uint64_t atom_nb)
+{
+  return ((3*32*atom_nb + STC_WIDTH_BITS*(atom_nb/STC_BLOCK + 1)) / 8 + 1);
+}
+
+/* Pack the interleaved coordinates (Å) of atom_nb atoms into out
+ * out must hold at least stc_frame_bound(atom_nb) bytes.
+ */
+uint8_t *stc_frame_encode(uint8_t *out, size_t *len, const double *coord, const uint64_t atom_nb, const double precision)
+{
+  size_t i;
+  size_t j;
+  size_t block_nb;
+  int64_t q;
+  int64_t prev[3] = {0, 0, 0};
+  uint32_t delta[3*STC_BLOCK];
+  uint32_t max;
+  uint8_t width;
+  stc_bits_t bits = {out, stc_frame_bound(atom_nb), 0, 0, 0};
+
+  /* The first atom is stored as is, so that it doesn't widen the first block */
+  for (j=0; j<3 && atom_nb; ++j)
+  {
+    prev[j] = llround(coord[j] / precision);
+    if (prev[j] > STC_QUANT_MAX || prev[j] < -STC_QUANT_MAX)
+    {
+      return (retstr(NULL, TEXT_STC_FRAME_ENCODE_FAILURE, __FILE__, __LINE__));
+    }
+    stc_bits_write(&bits, stc_zigzag(prev[j]), 32);
+  }
+
+  for (i=1; i<atom_nb; i+=STC_BLOCK)
+  {
+    block_nb = (atom_nb - i < STC_BLOCK) ? (atom_nb - i) : STC_BLOCK;
+
+    /* Quantize, and store the differences to the previous atom */
+    max = 0;
+    for (j=0; j<3*block_nb; ++j)
+    {
+      q = llround(coord[3*i + j] / precision);
+      if (q > STC_QUANT_MAX || q < -STC_QUANT_MAX || llabs(q - prev[j%3]) > STC_QUANT_MAX)
+      {
+        return (retstr(NULL, TEXT_STC_FRAME_ENCODE_FAILURE, __FILE__, __LINE__));
+      }
+      delta[j] = stc_zigzag(q - prev[j%3]);
+      prev[j%3] = q;
+      if (delta[j] > max)
+      {
+        max = delta[j];
+      }
+    }
+
+    /* Pack the whole block with the width of its largest difference */
+    width = stc_width(max);
+    stc_bits_write(&bits, width, STC_WIDTH_BITS);
+    for (j=0; j<3*block_nb; ++j)
+    {
+      stc_bits_write(&bits, delta[j], width);
+    }
+  }
+  stc_bits_flush(&bits);
+
+  *len = (bits.pos + 7) / 8;
+
+  return (out);
+}
+
+/* Unpack a frame of atom_nb atoms into interleaved coordinates (Å) */
+double *stc_frame_decode(double *coord, const uint8_t *in, const size_t len, const uint64_t atom_nb, const double precision)
+{
+  size_t i;
+  size_t j;
+  size_t block_nb;
+  int64_t prev[3] = {0, 0, 0};
+  uint32_t value;
+  uint32_t width;
+  stc_bits_t bits = {(uint8_t*) in, len, 0, 0, 0};
+
+  for (j=0; j<3 && atom_nb; ++j)
+  {
+    if (!stc_bits_read(&bits, &value, 32))
+    {
+      return (retstr(NULL, TEXT_STC_FRAME_DECODE_FAILURE, __FILE__, __LINE__));
+    }
+    prev[j] = stc_unzigzag(value);
+    coord[j] = prev[j] * precision;
+  }
+
+  for (i=1; i<atom_nb; i+=STC_BLOCK)
+  {
+    block_nb = (atom_nb - i < STC_BLOCK) ? (atom_nb - i) : STC_BLOCK;
+
+    if (!stc_bits_read(&bits, &width, STC_WIDTH_BITS) || width > 32)
+    {
+      return (retstr(NULL, TEXT_STC_FRAME_DECODE_FAILURE, __FILE__, __LINE__));
+    }
+
+    for (j=0; j<3*block_nb; ++j)
+    {
+      if (!stc_bits_read(&bits, &value, (uint8_t) width))
+      {
+        return (retstr(NULL, TEXT_STC_FRAME_DECODE_FAILURE, __FILE__, __LINE__));
+      }
+      prev[j%3] += stc_unzigzag(value);
+      coord[3*i + j] = prev[j%3] * precision;
+    }
+  }
+
+  return (coord);
+}
+
+/* Read the file header, symbol gets atom_nb*STC_SYMBOL_LEN freshly allocated bytes */
+FILE *stc_read_header(FILE *file, uint64_t *atom_nb, double *precision, char **symbol)
+{
+  char magic[sizeof(STC_MAGIC)-1];
+  uint32_t nb;
+
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+      memcmp(magic, STC_MAGIC, sizeof(magic)) ||
+      fread(&nb, sizeof(uint32_t), 1, file) != 1 ||
+      fread(precision, sizeof(double), 1, file) != 1 ||
+      *precision <= 0.0)
+  {
+    return (retstr(NULL, TEXT_STC_READ_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+  *atom_nb = nb;
+
+  if ((*symbol = malloc(STC_SYMBOL_LEN * (*atom_nb) + 1)) == NULL)
+  {
+    return (retstr(NULL, TEXT_STC_READ_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+  if (fread(*symbol, STC_SYMBOL_LEN, *atom_nb, file) != *atom_nb)
+  {
+    free(*symbol);
+    return (retstr(NULL, TEXT_STC_READ_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (file);
+}
+
+/* Read the next frame, returns NULL at the end of the file too */
+FILE *stc_read_frame(FILE *file, uint64_t *iteration, double *box, double *coord, const uint64_t atom_nb, const double precision)
+{
+  uint32_t len;
+  uint8_t *payload;
+
+  if (fread(iteration, sizeof(uint64_t), 1, file) != 1)
+  {
+    return (NULL);
+  }
+
+  if (fread(box, sizeof(double), 1, file) != 1 ||
+      fread(&len, sizeof(uint32_t), 1, file) != 1 ||
+      len > stc_frame_bound(atom_nb))
+  {
+    return (retstr(NULL, TEXT_STC_READ_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  if ((payload = malloc(len + 1)) == NULL)
+  {
+    return (retstr(NULL, TEXT_STC_READ_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (fread(payload, 1, len, file) != len ||
+      stc_frame_decode(coord, payload, len, atom_nb, precision) == NULL)
+  {
+    free(payload);
+    return (retstr(NULL, TEXT_STC_READ_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  free(payload);
+
+  return (file);
+}
+
+/* Write the header of the trajectory */
+universe_t *stc_header(universe_t *universe, const args_t *args)
+{
+  size_t i;
+  size_t len;
+  uint32_t atom_nb;
+  char symbol[STC_SYMBOL_LEN];
+
+  universe->output_precision = args->precision;
+
+  atom_nb = (uint32_t) universe->atom_nb;
+  if (fwrite(STC_MAGIC, 1, sizeof(STC_MAGIC)-1, universe->file_output) != sizeof(STC_MAGIC)-1 ||
+      fwrite(&atom_nb, sizeof(uint32_t), 1, universe->file_output) != 1 ||
+      fwrite(&(universe->output_precision), sizeof(double), 1, universe->file_output) != 1)
+  {
+    return (retstr(NULL, TEXT_STC_HEADER_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    memset(symbol, 0, STC_SYMBOL_LEN);
+    len = strlen(universe->model.entry[universe->atom[i].element].symbol);
+    memcpy(symbol, universe->model.entry[universe->atom[i].element].symbol, (len < STC_SYMBOL_LEN) ? len : STC_SYMBOL_LEN);
+    if (fwrite(symbol, 1, STC_SYMBOL_LEN, universe->file_output) != STC_SYMBOL_LEN)
+    {
+      return (retstr(NULL, TEXT_STC_HEADER_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  return (universe);
+}
+
+/* Append the current state to the trajectory */
+universe_t *stc_frame(universe_t *universe)
+{
+  size_t i;
+  size_t len;
+  uint32_t len_frame;
+  double box;
+  double *coord;
+  uint8_t *payload;
+
+  if ((coord = malloc(sizeof(double) * 3 * (universe->atom_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_STC_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+  if ((payload = malloc(stc_frame_bound(universe->atom_nb))) == NULL)
+  {
+    free(coord);
+    return (retstr(NULL, TEXT_STC_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    coord[3*i]     = universe->atom[i].pos.x*1E10;
+    coord[3*i + 1] = universe->atom[i].pos.y*1E10;
+    coord[3*i + 2] = universe->atom[i].pos.z*1E10;
+  }
+
+  if (stc_frame_encode(payload, &len, coord, universe->atom_nb, universe->output_precision) == NULL)
+  {
+    free(coord);
+    free(payload);
+    return (retstr(NULL, TEXT_STC_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  box = universe->size*1E10;
+  len_frame = (uint32_t) len;
+  if (fwrite(&(universe->iterations), sizeof(uint64_t), 1, universe->file_output) != 1 ||
+      fwrite(&box, sizeof(double), 1, universe->file_output) != 1 ||
+      fwrite(&len_frame, sizeof(uint32_t), 1, universe->file_output) != 1 ||
+      fwrite(payload, 1, len, universe->file_output) != len)
+  {
+    free(coord);
+    free(payload);
+    return (retstr(NULL, TEXT_STC_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+
+  free(coord);
+  free(payload);
+  ++(universe->frame_nb);
+
+  return (universe);
+}
@@ -0,0 +1,296 @@
+/*
+ * stream.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "stream.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+
+/* Slots start on their own cache lines */
+#define STREAM_ALIGN(x) (((x) + 63) & ~((uint64_t)63))
+
+/* Segment names start with a single slash */
+static char *stream_name(const char *name)
+{
+  char *str;
+
+  if ((str = malloc(strlen(name) + 2)) == NULL)
+  {
+    return (NULL);
+  }
+  str[0] = '/';
+  strcpy(str + 1, name + (name[0] == '/'));
+
+  return (str);
+}
+
+static stream_slot_t *stream_slot(const stream_t *stream, const uint64_t frame)
+{
+  const stream_header_t *header;
+
+  header = (const stream_header_t*) stream->map;
+
+  return ((stream_slot_t*) (stream->map + header->slot_offset + (frame % header->slot_nb)*(header->slot_len)));
+}
+
+/* Create the shared memory segment, if asked to */
+universe_t *stream_open(universe_t *universe, const args_t *args)
+{
+  stream_t *stream;
+  stream_header_t *header;
+  char *symbol;
+  size_t len;
+  size_t i;
+  int fd;
+
+  if (args->path_shm == ARGS_PATH_SHM_DEFAULT)
+  {
+    return (universe);
+  }
+
+  if ((stream = malloc(sizeof(stream_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_STREAM_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+  stream->map = STREAM_MAP_DEFAULT;
+  stream->map_len = STREAM_MAP_LEN_DEFAULT;
+  stream->every = args->shm_every;
+  universe->stream = stream;
+  if ((stream->name = stream_name(args->path_shm)) == NULL)
+  {
+    return (retstr(NULL, TEXT_STREAM_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* A segment left over by a crashed run is only unlinked,
+   * whoever still maps it won't be pulled from under its feet.
+   */
+  shm_unlink(stream->name);
+  if ((fd = shm_open(stream->name, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0)
+  {
+    return (retstr(NULL, TEXT_STREAM_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+  stream->map_len = STREAM_ALIGN(sizeof(stream_header_t) + (universe->atom_nb)*STREAM_SYMBOL_LEN) +
+                    STREAM_SLOT_NB*STREAM_ALIGN(sizeof(stream_slot_t) + 3*sizeof(double)*(universe->atom_nb));
+  if (ftruncate(fd, (off_t) stream->map_len) ||
+      (stream->map = mmap(NULL, stream->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    stream->map = STREAM_MAP_DEFAULT;
+    close(fd);
+    return (retstr(NULL, TEXT_STREAM_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+  close(fd);
+
+  /* The segment starts zeroed, no slot holds a frame yet */
+  header = (stream_header_t*) stream->map;
+  header->atom_nb = universe->atom_nb;
+  header->slot_nb = STREAM_SLOT_NB;
+  header->slot_len = STREAM_ALIGN(sizeof(stream_slot_t) + 3*sizeof(double)*(universe->atom_nb));
+  header->symbol_offset = sizeof(stream_header_t);
+  header->slot_offset = STREAM_ALIGN(sizeof(stream_header_t) + (universe->atom_nb)*STREAM_SYMBOL_LEN);
+  header->frame_nb = 0;
+  symbol = (char*) (stream->map + header->symbol_offset);
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    len = strlen(universe->model.entry[universe->atom[i].element].symbol);
+    memcpy(symbol + i*STREAM_SYMBOL_LEN, universe->model.entry[universe->atom[i].element].symbol, (len < STREAM_SYMBOL_LEN) ? len : STREAM_SYMBOL_LEN);
+  }
+
+  /* Consumers check the magic before anything else */
+  header->version = STREAM_VERSION;
+  __atomic_store_n(&(header->state), STREAM_STATE_RUNNING, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(header->magic, STREAM_MAGIC, sizeof(header->magic));
+
+  return (universe);
+}
+
+/* Returns 1 if a frame is to be published at the current iteration */
+int stream_due(const universe_t *universe)
+{
+  return (universe->stream != NULL && !(universe->iterations % universe->stream->every));
+}
+
+/* Publish the current state, if due
+ * Nothing here waits on the consumers, a slot is overwritten whether or not
+ * anyone read it.
+ */
+universe_t *stream_publish(universe_t *universe)
+{
+  stream_header_t *header;
+  stream_slot_t *slot;
+  uint64_t frame;
+  double *coord;
+  size_t i;
+
+  if (!stream_due(universe))
+  {
+    return (universe);
+  }
+
+  header = (stream_header_t*) universe->stream->map;
+  frame = header->frame_nb;
+  slot = stream_slot(universe->stream, frame);
+  coord = (double*) (slot + 1);
+
+  /* Odd while the slot is being written */
+  __atomic_store_n(&(slot->seq), 2*frame + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  slot->iteration = universe->iterations;
+  slot->box = universe->size*1E10;
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    coord[3*i]     = universe->atom[i].pos.x*1E10;
+    coord[3*i + 1] = universe->atom[i].pos.y*1E10;
+    coord[3*i + 2] = universe->atom[i].pos.z*1E10;
+  }
+
+  __atomic_store_n(&(slot->seq), 2*frame + 2, __ATOMIC_RELEASE);
+  __atomic_store_n(&(header->frame_nb), frame + 1, __ATOMIC_RELEASE);
+
+  return (universe);
+}
+
+/* Tell the consumers we're done, and remove the segment
+ * Those still attached can finish reading what's in it.
+ */
+void stream_close(universe_t *universe)
+{
+  stream_t *stream;
+
+  if ((stream = universe->stream) == NULL)
+  {
+    return;
+  }
+
+  if (stream->map != STREAM_MAP_DEFAULT)
+  {
+    __atomic_store_n(&(((stream_header_t*) stream->map)->state), STREAM_STATE_ENDED, __ATOMIC_RELEASE);
+    munmap(stream->map, stream->map_len);
+    shm_unlink(stream->name);
+  }
+  free(stream->name);
+  free(stream);
+  universe->stream = UNIVERSE_STREAM_DEFAULT;
+}
+
+/* Map a segment published by a running simulation */
+stream_t *stream_attach(stream_t *stream, const char *name)
+{
+  const stream_header_t *header;
+  struct stat st;
+  int fd;
+
+  stream->map = STREAM_MAP_DEFAULT;
+  stream->map_len = STREAM_MAP_LEN_DEFAULT;
+  stream->every = STREAM_EVERY_DEFAULT;
+  if ((stream->name = stream_name(name)) == NULL)
+  {
+    return (retstr(NULL, TEXT_STREAM_ATTACH_FAILURE, __FILE__, __LINE__));
+  }
+
+  if ((fd = shm_open(stream->name, O_RDONLY, 0)) < 0)
+  {
+    return (retstr(NULL, TEXT_STREAM_ATTACH_FAILURE, __FILE__, __LINE__));
+  }
+  if (fstat(fd, &st) || (size_t) st.st_size < sizeof(stream_header_t) ||
+      (stream->map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    stream->map = STREAM_MAP_DEFAULT;
+    close(fd);
+    return (retstr(NULL, TEXT_STREAM_ATTACH_FAILURE, __FILE__, __LINE__));
+  }
+  close(fd);
+  stream->map_len = (size_t) st.st_size;
+
+  /* The magic is written last, the rest of the header is there if it is */
+  header = (const stream_header_t*) stream->map;
+  if (memcmp(header->magic, STREAM_MAGIC, sizeof(header->magic)))
+  {
+    return (retstr(NULL, TEXT_STREAM_ATTACH_FAILURE, __FILE__, __LINE__));
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (header->version != STREAM_VERSION || header->slot_nb == 0 ||
+      header->slot_len < sizeof(stream_slot_t) + 3*sizeof(double)*(header->atom_nb) ||
+      header->symbol_offset + (header->atom_nb)*STREAM_SYMBOL_LEN > header->slot_offset ||
+      header->slot_offset + (header->slot_nb)*(header->slot_len) > stream->map_len)
+  {
+    return (retstr(NULL, TEXT_STREAM_ATTACH_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (stream);
+}
+
+void stream_detach(stream_t *stream)
+{
+  if (stream->map != STREAM_MAP_DEFAULT)
+  {
+    munmap(stream->map, stream->map_len);
+  }
+  free(stream->name);
+  stream->map = STREAM_MAP_DEFAULT;
+  stream->name = STREAM_NAME_DEFAULT;
+}
+
+const stream_header_t *stream_header(const stream_t *stream)
+{
+  return ((const stream_header_t*) stream->map);
+}
+
+/* Symbol of an atom, STREAM_SYMBOL_LEN bytes at most */
+const char *stream_symbol(const stream_t *stream, const uint64_t atom_id)
+{
+  return ((const char*) (stream->map + stream_header(stream)->symbol_offset + atom_id*STREAM_SYMBOL_LEN));
+}
+
+/* Frames published so far, the last one being the latest */
+uint64_t stream_frame_nb(const stream_t *stream)
+{
+  return (__atomic_load_n(&(stream_header(stream)->frame_nb), __ATOMIC_ACQUIRE));
+}
+
+int stream_ended(const stream_t *stream)
+{
+  return (__atomic_load_n(&(stream_header(stream)->state), __ATOMIC_ACQUIRE) == STREAM_STATE_ENDED);
+}
+
+/* Start reading a frame in place
+ * Returns its coordinates, or NULL if it's no longer (or not yet) in the ring.
+ * Whatever is read must be thrown away unless stream_read_end agrees.
+ */
+const double *stream_read_begin(const stream_t *stream, const uint64_t frame, uint64_t *iteration, double *box)
+{
+  const stream_slot_t *slot;
+
+  slot = stream_slot(stream, frame);
+  if (__atomic_load_n(&(slot->seq), __ATOMIC_ACQUIRE) != 2*frame + 2)
+  {
+    return (NULL);
+  }
+  *iteration = slot->iteration;
+  *box = slot->box;
+
+  return ((const double*) (slot + 1));
+}
+
+/* Returns 1 if the frame wasn't overwritten while it was being read */
+int stream_read_end(const stream_t *stream, const uint64_t frame)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+  return (__atomic_load_n(&(stream_slot(stream, frame)->seq), __ATOMIC_RELAXED) == 2*frame + 2);
+}
@@ -0,0 +1,220 @@
+/*
+ * thermo.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "thermo.h"
+#include "domain.h"
+#include "text.h"
+#include "util.h"
+
+/* Open the log, if asked to, appending to it from the checkpoint when resuming */
+universe_t *thermo_open(universe_t *universe, const args_t *args)
+{
+  thermo_t *thermo;
+
+  if (args->path_thermo == ARGS_PATH_THERMO_DEFAULT)
+  {
+    return (universe);
+  }
+
+  if ((thermo = malloc(sizeof(thermo_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_THERMO_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+  thermo->file = THERMO_FILE_DEFAULT;
+  thermo->term = THERMO_TERM_DEFAULT;
+  thermo->every = args->thermo_every;
+  thermo->energy_0 = THERMO_ENERGY_0_DEFAULT;
+  thermo->line_nb = THERMO_LINE_NB_DEFAULT;
+  universe->thermo = thermo;
+
+  /* Resuming, the drift is still measured from the first line */
+  thermo->energy_0 = universe->thermo_energy_0;
+  thermo->line_nb = universe->thermo_line_nb;
+
+  if ((thermo->term = malloc(sizeof(double) * POTENTIAL_TERM_NB * (universe->atom_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_THERMO_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Every process takes part in the sums, the first one writes them */
+  if (domain_rank() != 0)
+  {
+    return (universe);
+  }
+  if ((thermo->file = fopen(args->path_thermo, (args->restart) ? "a" : "w")) == NULL)
+  {
+    return (retstr(NULL, TEXT_THERMO_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Lines written after the checkpoint will be written again */
+  if (args->restart &&
+      (fseek(thermo->file, 0, SEEK_END) ||
+       ftell(thermo->file) < (long) universe->thermo_offset ||
+       ftruncate(fileno(thermo->file), (off_t) universe->thermo_offset)))
+  {
+    return (retstr(NULL, TEXT_THERMO_OPEN_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Unless the checkpoint was taken without the log */
+  if (!(args->restart) || !(universe->thermo_offset))
+  {
+    fputs(TEXT_THERMO_HEADER, thermo->file);
+  }
+
+  return (universe);
+}
+
+/* Returns 1 if a line is to be written at the current iteration */
+int thermo_due(const universe_t *universe)
+{
+  return (universe->thermo != NULL && !(universe->iterations % universe->thermo->every));
+}
+
+/* Write a line of the log, if due */
+universe_t *thermo_write(universe_t *universe)
+{
+  thermo_t *thermo;
+  double term[POTENTIAL_TERM_NB];
+  double potential;
+  double kinetic;
+  double temperature;
+  size_t i;
+  size_t j;
+  int err = 0;
+
+  if (!thermo_due(universe))
+  {
+    return (universe);
+  }
+  thermo = universe->thermo;
+
+  /* Each atom's terms, for the processes to add those of the atoms they own.
+   * The cells were binned by this iteration's force update, at these positions.
+   */
+#pragma omp parallel for schedule(dynamic, 64)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    for (j=0; j<POTENTIAL_TERM_NB; ++j)
+    {
+      thermo->term[POTENTIAL_TERM_NB*i + j] = 0.0;
+    }
+    if (!DOMAIN_IS_OWNED(universe, i))
+    {
+      continue;
+    }
+    if (((universe->cell != NULL) ? potential_terms_cell(&(thermo->term[POTENTIAL_TERM_NB*i]), universe, i) :
+                                    potential_terms(&(thermo->term[POTENTIAL_TERM_NB*i]), universe, i)) == NULL)
+    {
+#pragma omp atomic write
+      err = 1;
+    }
+  }
+  if (err)
+  {
+    return (retstr(NULL, TEXT_THERMO_WRITE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Added in order, each pair having been counted from both of its atoms */
+  potential = 0.0;
+  for (j=0; j<POTENTIAL_TERM_NB; ++j)
+  {
+    term[j] = 0.0;
+    for (i=0; i<(universe->atom_nb); ++i)
+    {
+      term[j] += thermo->term[POTENTIAL_TERM_NB*i + j];
+    }
+    term[j] = 0.5*domain_sum(universe, term[j]);
+    potential += term[j];
+  }
+  kinetic = domain_sum(universe, universe->kinetic);
+  temperature = universe_temperature(universe);
+
+  if (!(thermo->line_nb))
+  {
+    thermo->energy_0 = kinetic + potential;
+  }
+  ++(thermo->line_nb);
+
+  if (thermo->file != NULL &&
+      fprintf(thermo->file, TEXT_THERMO_LINE, universe->time*1E9, universe->iterations, kinetic*1E12,
+              term[POTENTIAL_TERM_BOND]*1E12, term[POTENTIAL_TERM_ANGLE]*1E12,
+              term[POTENTIAL_TERM_ELECTROSTATIC]*1E12, term[POTENTIAL_TERM_LENNARDJONES]*1E12,
+              potential*1E12, (kinetic + potential)*1E12, temperature,
+              (kinetic + potential - thermo->energy_0)*1E12) < 0)
+  {
+    return (retstr(NULL, TEXT_THERMO_WRITE_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Flush the log, and record where it stands for a checkpoint */
+universe_t *thermo_sync(universe_t *universe)
+{
+  thermo_t *thermo;
+
+  thermo = universe->thermo;
+  if (thermo == NULL)
+  {
+    return (universe);
+  }
+
+  universe->thermo_line_nb = thermo->line_nb;
+  universe->thermo_energy_0 = thermo->energy_0;
+  if (thermo->file != NULL)
+  {
+    if (fflush(thermo->file) || fsync(fileno(thermo->file)))
+    {
+      return (retstr(NULL, TEXT_THERMO_SYNC_FAILURE, __FILE__, __LINE__));
+    }
+    universe->thermo_offset = (uint64_t) ftell(thermo->file);
+  }
+
+  return (universe);
+}
+
+/* Log the swaps tried so far with the next replica up, flushed at once */
+universe_t *thermo_exchange(universe_t *universe, const double temperature_next, const uint64_t accepted, const uint64_t tried)
+{
+  thermo_t *thermo;
+
+  thermo = universe->thermo;
+  if (thermo == NULL || thermo->file == NULL)
+  {
+    return (universe);
+  }
+
+  if (fprintf(thermo->file, TEXT_THERMO_EXCHANGE, universe->time*1E9, universe->iterations,
+              temperature_next, accepted, tried) < 0 ||
+      fflush(thermo->file))
+  {
+    return (retstr(NULL, TEXT_THERMO_EXCHANGE_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+void thermo_close(universe_t *universe)
+{
+  if (universe->thermo == NULL)
+  {
+    return;
+  }
+
+  if (universe->thermo->file != NULL)
+  {
+    fclose(universe->thermo->file);
+  }
+  free(universe->thermo->term);
+  free(universe->thermo);
+  universe->thermo = UNIVERSE_THERMO_DEFAULT;
+}
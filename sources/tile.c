@@ -0,0 +1,315 @@
+/*
+ * tile.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "config.h"
+#include "tile.h"
+#include "force.h"
+#include "text.h"
+#include "util.h"
+
+/* Slot tile_a's atoms get their force from tile_b in, x, y and z after another */
+#define TILE_SLOT(tile, tile_a, tile_b) (&((tile)->partial[3*TILE_ATOM_NB*((tile_a)*((tile)->tile_nb) + (tile_b))]))
+
+/* Give the non-bonded force of each pair of atoms of two tiles to both atoms.
+ * A tile against itself takes each pair once too.
+ * The inner loop always runs over a whole tile, for the vectorizer to have no
+ * remainder to deal with: keep masks the padding past the last atom, the
+ * bonded atoms, and on the diagonal the atoms up to the current one.
+ */
+static void tile_pair(tile_t *tile, universe_t *universe, const uint64_t tile_a, const uint64_t tile_b)
+{
+  double *slot_a;
+  double *slot_b;
+  double *keep;
+  const double *x_b;
+  const double *y_b;
+  const double *z_b;
+  const double *charge_b;
+  const double *epsilon_b;
+  const double *sigma_b;
+  uint64_t first_a;
+  uint64_t first_b;
+  uint64_t last_a;
+  uint64_t last_b;
+  uint64_t i;
+  uint64_t j;
+  uint64_t k;
+  uint64_t bond;
+  double size;
+  double half;
+  double cutoff_sq;
+  double x;
+  double y;
+  double z;
+  double charge;
+  double epsilon;
+  double sigma_i;
+  double fx;
+  double fy;
+  double fz;
+
+  slot_a = TILE_SLOT(tile, tile_a, tile_b);
+  slot_b = TILE_SLOT(tile, tile_b, tile_a);
+  keep = &(tile->keep[TILE_ATOM_NB*omp_get_thread_num()]);
+  first_a = tile_a*TILE_ATOM_NB;
+  first_b = tile_b*TILE_ATOM_NB;
+  last_a = (first_a + TILE_ATOM_NB < universe->atom_nb) ? first_a + TILE_ATOM_NB : universe->atom_nb;
+  last_b = (first_b + TILE_ATOM_NB < universe->atom_nb) ? first_b + TILE_ATOM_NB : universe->atom_nb;
+  x_b = &(tile->x[first_b]);
+  y_b = &(tile->y[first_b]);
+  z_b = &(tile->z[first_b]);
+  charge_b = &(tile->charge[first_b]);
+  epsilon_b = &(tile->epsilon[first_b]);
+  sigma_b = &(tile->sigma[first_b]);
+  size = universe->size;
+  half = 0.5*size;
+  cutoff_sq = (universe->cutoff == 0.0) ? INFINITY : POW2(universe->cutoff);
+
+  for (k=0; k<3*TILE_ATOM_NB; ++k)
+  {
+    slot_a[k] = 0.0;
+    slot_b[k] = 0.0;
+  }
+  for (k=0; k<TILE_ATOM_NB; ++k)
+  {
+    keep[k] = (first_b + k < last_b) ? 1.0 : 0.0;
+  }
+
+  for (i=first_a; i<last_a; ++i)
+  {
+    /* On the diagonal, the pairs with the atoms up to this one were taken already */
+    if (tile_a == tile_b)
+    {
+      keep[i - first_b] = 0.0;
+    }
+
+    /* Bonded atoms are left to force_bonded */
+    for (k=0; k<(universe->atom[i].bond_nb); ++k)
+    {
+      bond = universe->atom[i].bond[k];
+      if (bond >= first_b && bond < last_b)
+      {
+        keep[bond - first_b] = 0.0;
+      }
+    }
+
+    x = tile->x[i];
+    y = tile->y[i];
+    z = tile->z[i];
+    charge = tile->charge[i];
+    epsilon = tile->epsilon[i];
+    sigma_i = tile->sigma[i];
+    fx = 0.0;
+    fy = 0.0;
+    fz = 0.0;
+#pragma omp simd reduction(+:fx,fy,fz)
+    for (j=0; j<TILE_ATOM_NB; ++j)
+    {
+      double dx;
+      double dy;
+      double dz;
+      double dst_sq;
+      double dst;
+      double dst_a;
+      double sigma;
+      double ratio;
+      double lennardjones;
+      double force;
+
+      /* The closest image of j, as atom_image has it */
+      dx = x_b[j] - x;
+      dy = y_b[j] - y;
+      dz = z_b[j] - z;
+      dx = dx - ((dx > half) ? size : 0.0) + ((dx <= -half) ? size : 0.0);
+      dy = dy - ((dy > half) ? size : 0.0) + ((dy <= -half) ? size : 0.0);
+      dz = dz - ((dz > half) ? size : 0.0) + ((dz <= -half) ? size : 0.0);
+      dst_sq = dx*dx + dy*dy + dz*dz;
+      dst = sqrt(dst_sq);
+
+      /* Electrostatic, as force_electrostatic has it, over the distance for the vector not to be made unit */
+      force = -(charge*charge_b[j]) / (4*M_PI*C_VACUUMPERM*dst_sq*dst);
+
+      /* Lennard-Jones, as force_lennardjones has it, in Angstroms */
+      dst_a = dst*1E10;
+      sigma = sigma_i*sigma_b[j];
+      ratio = (sigma*sigma)/(dst_a*dst_a);
+      ratio = ratio*ratio*ratio;
+      lennardjones = 48*(epsilon*epsilon_b[j])*ratio*(ratio - 0.5)/(dst_a*dst_a) * 1.66053892103219E-11;
+      force += (dst_a < LENNARDJONES_CUTOFF*sigma) ? lennardjones : 0.0;
+
+      /* Past the cutoff, or masked, there's nothing: selected, as a masked pair may be at distance 0 */
+      force = (keep[j] != 0.0) ? force : 0.0;
+      force = (dst_sq <= cutoff_sq) ? force : 0.0;
+
+      fx += force*dx;
+      fy += force*dy;
+      fz += force*dz;
+      slot_b[j] -= force*dx;
+      slot_b[TILE_ATOM_NB + j] -= force*dy;
+      slot_b[2*TILE_ATOM_NB + j] -= force*dz;
+    }
+    slot_a[i - first_a] += fx;
+    slot_a[TILE_ATOM_NB + i - first_a] += fy;
+    slot_a[2*TILE_ATOM_NB + i - first_a] += fz;
+
+    /* The bonded atoms are back, unless the diagonal already took them */
+    for (k=0; k<(universe->atom[i].bond_nb); ++k)
+    {
+      bond = universe->atom[i].bond[k];
+      if (bond >= first_b && bond < last_b)
+      {
+        keep[bond - first_b] = (tile_a != tile_b || bond > i) ? 1.0 : 0.0;
+      }
+    }
+  }
+}
+
+/* Cut the atoms into tiles, for small systems without a cell grid */
+universe_t *tile_init(universe_t *universe, const args_t *args)
+{
+  tile_t *tile;
+
+  if (universe->cell != NULL || universe->domain != NULL ||
+      args->numerical != MODE_ANALYTICAL || universe->atom_nb > TILE_ATOM_MAX)
+  {
+    return (universe);
+  }
+
+  if ((tile = malloc(sizeof(tile_t))) == NULL)
+  {
+    return (retstr(NULL, TEXT_TILE_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  tile->tile_nb = TILE_TILE_NB_DEFAULT;
+  tile->thread_nb = TILE_THREAD_NB_DEFAULT;
+  tile->x = TILE_X_DEFAULT;
+  tile->y = TILE_Y_DEFAULT;
+  tile->z = TILE_Z_DEFAULT;
+  tile->charge = TILE_CHARGE_DEFAULT;
+  tile->epsilon = TILE_EPSILON_DEFAULT;
+  tile->sigma = TILE_SIGMA_DEFAULT;
+  tile->keep = TILE_KEEP_DEFAULT;
+  tile->partial = TILE_PARTIAL_DEFAULT;
+  universe->tile = tile;
+
+  tile->tile_nb = (universe->atom_nb + TILE_ATOM_NB - 1)/TILE_ATOM_NB;
+  tile->thread_nb = omp_get_max_threads();
+  /* Padded to whole tiles, the padding left at 0 */
+  if ((tile->x = calloc(TILE_ATOM_NB * (tile->tile_nb), sizeof(double))) == NULL ||
+      (tile->y = calloc(TILE_ATOM_NB * (tile->tile_nb), sizeof(double))) == NULL ||
+      (tile->z = calloc(TILE_ATOM_NB * (tile->tile_nb), sizeof(double))) == NULL ||
+      (tile->charge = calloc(TILE_ATOM_NB * (tile->tile_nb), sizeof(double))) == NULL ||
+      (tile->epsilon = calloc(TILE_ATOM_NB * (tile->tile_nb), sizeof(double))) == NULL ||
+      (tile->sigma = calloc(TILE_ATOM_NB * (tile->tile_nb), sizeof(double))) == NULL ||
+      (tile->keep = malloc(sizeof(double) * TILE_ATOM_NB * (tile->thread_nb))) == NULL ||
+      (tile->partial = malloc(sizeof(double) * 3 * TILE_ATOM_NB * (tile->tile_nb) * (tile->tile_nb))) == NULL)
+  {
+    return (retstr(NULL, TEXT_TILE_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Update the forces of every atom, the bonded terms first, then the tiles' in order */
+universe_t *tile_update_frc(universe_t *universe)
+{
+  tile_t *tile;
+  uint64_t task;
+  uint64_t i;
+  uint64_t j;
+  const double *slot;
+  double *keep;
+  int thread_nb;
+  int err = 0;
+
+  tile = universe->tile;
+
+  /* As many threads as the caller was given, a replica's share in an ensemble */
+  thread_nb = omp_get_max_threads();
+  if (thread_nb > tile->thread_nb)
+  {
+    if ((keep = realloc(tile->keep, sizeof(double) * TILE_ATOM_NB * thread_nb)) == NULL)
+    {
+      return (retstr(NULL, TEXT_TILE_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
+    }
+    tile->keep = keep;
+    tile->thread_nb = thread_nb;
+  }
+
+  /* The atoms, in the flat arrays the tiles are read from */
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    tile->x[i] = universe->atom[i].pos.x;
+    tile->y[i] = universe->atom[i].pos.y;
+    tile->z[i] = universe->atom[i].pos.z;
+    tile->charge[i] = universe->atom[i].charge;
+    tile->epsilon[i] = sqrt(universe->atom[i].epsilon);
+    tile->sigma[i] = sqrt(universe->atom[i].sigma);
+  }
+
+  /* Every pair of tiles, the diagonal ones being the costliest are spread too */
+#pragma omp parallel for schedule(dynamic, 1) num_threads(thread_nb)
+  for (task=0; task<(tile->tile_nb)*(tile->tile_nb); ++task)
+  {
+    if (task % (tile->tile_nb) >= task / (tile->tile_nb))
+    {
+      tile_pair(tile, universe, task / (tile->tile_nb), task % (tile->tile_nb));
+    }
+  }
+
+  /* Add them up, always in the same order */
+#pragma omp parallel for schedule(static) private(j, slot)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    universe->atom[i].frc.x = ATOM_FRC_X_DEFAULT;
+    universe->atom[i].frc.y = ATOM_FRC_Y_DEFAULT;
+    universe->atom[i].frc.z = ATOM_FRC_Z_DEFAULT;
+    if (force_bonded(&(universe->atom[i].frc), universe, i) == NULL)
+    {
+#pragma omp atomic write
+      err = 1;
+    }
+
+    for (j=0; j<(tile->tile_nb); ++j)
+    {
+      slot = TILE_SLOT(tile, i/TILE_ATOM_NB, j);
+      universe->atom[i].frc.x += slot[i % TILE_ATOM_NB];
+      universe->atom[i].frc.y += slot[TILE_ATOM_NB + i % TILE_ATOM_NB];
+      universe->atom[i].frc.z += slot[2*TILE_ATOM_NB + i % TILE_ATOM_NB];
+    }
+  }
+  if (err)
+  {
+    return (retstr(NULL, TEXT_TILE_UPDATE_FRC_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+void tile_clean(universe_t *universe)
+{
+  if (universe->tile == NULL)
+  {
+    return;
+  }
+
+  free(universe->tile->x);
+  free(universe->tile->y);
+  free(universe->tile->z);
+  free(universe->tile->charge);
+  free(universe->tile->epsilon);
+  free(universe->tile->sigma);
+  free(universe->tile->keep);
+  free(universe->tile->partial);
+  free(universe->tile);
+  universe->tile = UNIVERSE_TILE_DEFAULT;
+}
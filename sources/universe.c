@@ -9,7 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <math.h>
+#include <omp.h>
 
 #include "config.h"
 #include "args.h"
@@ -19,21 +21,30 @@
 #include "util.h"
 #include "universe.h"
 #include "potential.h"
-
-universe_t *universe_init(universe_t *universe, const args_t *args)
+#include "dcd.h"
+#include "stc.h"
+#include "writer.h"
+#include "xyz.h"
+#include "prepared.h"
+#include "frames.h"
+#include "group.h"
+#include "stream.h"
+#include "thermo.h"
+#include "domain.h"
+#include "cell.h"
+#include "scheduler.h"
+#include "reorder.h"
+#include "tile.h"
+#include "affinity.h"
+#include "rng.h"
+
+/* Set every field to its default, then to what the arguments ask for */
+universe_t *universe_reset(universe_t *universe, const args_t *args)
 {
-  size_t i;                    /* Iterator */
-  size_t file_len_model;       /* Size of the model file (bytes) */
-  size_t file_len_substrate;   /* Size of the substrate file (bytes) */
-  size_t file_len_solvent;     /* Size of the solvent file (bytes) */
-  char *file_buffer_model;     /* A memory copy of the model */
-  char *file_buffer_substrate; /* A memory copy of the substrate file */
-  char *file_buffer_solvent;   /* A memory copy of the solvent file */
-  double universe_mass;        /* Total mass of the universe */
-
   /* Initialize the structure variables */
   universe->file_model = UNIVERSE_FILE_MODEL_DEFAULT;
   universe->file_output = UNIVERSE_FILE_OUTPUT_DEFAULT;
+  universe->file_index = UNIVERSE_FILE_INDEX_DEFAULT;
   universe->file_substrate = UNIVERSE_FILE_SUBSTRATE_DEFAULT;
   universe->file_solvent = UNIVERSE_FILE_SOLVENT_DEFAULT;
   universe->meta_model_name = UNIVERSE_META_MODEL_NAME_DEFAULT;
@@ -54,129 +65,318 @@ universe_t *universe_init(universe_t *universe, const args_t *args)
   universe->solvent_atom = UNIVERSE_SOLVENT_ATOM_DEFAULT;
   universe->atom = UNIVERSE_ATOM_DEFAULT;
   universe->copy_nb = UNIVERSE_COPY_NB_DEFAULT;
+  universe->solvent_copy_nb = UNIVERSE_SOLVENT_COPY_NB_DEFAULT;
   universe->atom_nb = UNIVERSE_ATOM_NB_DEFAULT;
   universe->iterations = UNIVERSE_ITERATIONS_DEFAULT;
   universe->size = UNIVERSE_SIZE_DEFAULT;
   universe->time = UNIVERSE_TIME_DEFAULT;
   universe->temperature = UNIVERSE_TEMPERATURE_DEFAULT;
   universe->pressure = UNIVERSE_PRESSURE_DEFAULT;
+  universe->populate_mode = UNIVERSE_POPULATE_MODE_DEFAULT;
+  universe->output_format = UNIVERSE_OUTPUT_FORMAT_DEFAULT;
+  universe->frame_nb = UNIVERSE_FRAME_NB_DEFAULT;
+  universe->output_precision = UNIVERSE_OUTPUT_PRECISION_DEFAULT;
+  universe->output_buffer = UNIVERSE_OUTPUT_BUFFER_DEFAULT;
+  universe->output_chunk_len = UNIVERSE_OUTPUT_CHUNK_LEN_DEFAULT;
+  universe->output_chunk_nb = UNIVERSE_OUTPUT_CHUNK_NB_DEFAULT;
+  universe->output_line_max = UNIVERSE_OUTPUT_LINE_MAX_DEFAULT;
+  universe->output_offset = UNIVERSE_OUTPUT_OFFSET_DEFAULT;
+  universe->frameskip_left = UNIVERSE_FRAMESKIP_LEFT_DEFAULT;
+  universe->group = UNIVERSE_GROUP_DEFAULT;
+  universe->group_nb = UNIVERSE_GROUP_NB_DEFAULT;
+  universe->stream = UNIVERSE_STREAM_DEFAULT;
+  universe->thermo = UNIVERSE_THERMO_DEFAULT;
+  universe->thermo_offset = UNIVERSE_THERMO_OFFSET_DEFAULT;
+  universe->thermo_line_nb = UNIVERSE_THERMO_LINE_NB_DEFAULT;
+  universe->thermo_energy_0 = UNIVERSE_THERMO_ENERGY_0_DEFAULT;
+  universe->energy = UNIVERSE_ENERGY_DEFAULT;
+  universe->domain = UNIVERSE_DOMAIN_DEFAULT;
+  universe->cell = UNIVERSE_CELL_DEFAULT;
+  universe->sched = UNIVERSE_SCHED_DEFAULT;
+  universe->reorder = UNIVERSE_REORDER_DEFAULT;
+  universe->tile = UNIVERSE_TILE_DEFAULT;
+  universe->cutoff = UNIVERSE_CUTOFF_DEFAULT;
+  universe->thermostat = UNIVERSE_THERMOSTAT_DEFAULT;
+  universe->kinetic = UNIVERSE_KINETIC_DEFAULT;
+  universe->seed = UNIVERSE_SEED_DEFAULT;
+  universe->shared = UNIVERSE_SHARED_DEFAULT;
+  universe->quiet = UNIVERSE_QUIET_DEFAULT;
+  model_init(&(universe->model));
 
   universe->copy_nb = args->copies;
+  universe->populate_mode = args->lattice;
+  universe->seed = args->srand_seed;
+  universe->output_format = args->format;
   universe->temperature = args->temperature;
   universe->pressure = args->pressure;
+  universe->cutoff = args->cutoff;
+  universe->thermostat = args->thermostat;
+
+  return (universe);
+}
+
+/* Write the trajectory headers, and open the index, the groups and the live stream */
+static universe_t *universe_init_output(universe_t *universe, const args_t *args)
+{
+  uint64_t i;
 
-  /* Open the output file */
-  if ((universe->file_output = fopen(args->path_out, "w")) == NULL)
+  /* Binary trajectories start with a header, now that the atoms are known */
+  /* A resumed trajectory already has its own */
+  if (universe->output_format == OUTPUT_FORMAT_DCD)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    if (!(args->restart) && dcd_header(universe, args) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
+    }
+  }
+  else if (universe->output_format == OUTPUT_FORMAT_STC)
+  {
+    if (!(args->restart) && stc_header(universe, args) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
+    }
+  }
+  else
+  {
+    if (xyz_init(universe) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
+    }
   }
 
-  /* Open the model file */
-  if ((universe->file_model = fopen(args->path_model, "r")) == NULL)
+  /* Index the frames as they're written */
+  if (frames_open(universe, args) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Open the output groups, each with its own trajectory */
+  if (args->group_nb)
+  {
+    if ((universe->group = malloc(sizeof(group_t) * (args->group_nb))) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
+    }
+    for (i=0; i<(args->group_nb); ++i)
+    {
+      if (group_init(universe, args, i) == NULL)
+      {
+        return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
+      }
+    }
+  }
+
+  /* Publish the frames live, if asked to */
+  if (stream_open(universe, args) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_INIT_OUTPUT_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Get the model file's size */
-  fseek(universe->file_model, 0, SEEK_END);
-  file_len_model = ftell(universe->file_model);
-  rewind(universe->file_model);
+  return (universe);
+}
 
-  /* Initialize the memory buffer for the model file */
-  if ((file_buffer_model = (char*)malloc(file_len_model+1)) == NULL)
+universe_t *universe_init(universe_t *universe, const args_t *args)
+{
+  universe_reset(universe, args);
+
+  /* Open the output file, keeping what's there when resuming */
+  /* Only the first process writes, when there are several */
+  if (domain_rank() == 0 && (universe->file_output = fopen(args->path_out, (args->restart) ? "r+b" : (args->format == OUTPUT_FORMAT_XYZ) ? "w" : "wb")) == NULL)
   {
     return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Load it in the model buffer, terminate the string */
-  if (fread(file_buffer_model, sizeof(char), file_len_model, universe->file_model) != file_len_model)
+  /* Build the universe from the input files, unless it comes prepared */
+  if (args->restart)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    if (prepared_restart(universe, args) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    }
   }
-  file_buffer_model[file_len_model] = '\0';
+  else if (args->path_load_prepared != ARGS_PATH_LOAD_PREPARED_DEFAULT)
+  {
+    if (prepared_load(universe, args->path_load_prepared) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    }
 
-  /* Load the model from the file */
-  if (universe_load_model(universe, file_buffer_model) == NULL)
+    /* It may have been checkpointed, but this is a new trajectory */
+    universe->output_format = args->format;
+    universe->frame_nb = UNIVERSE_FRAME_NB_DEFAULT;
+    universe->frameskip_left = UNIVERSE_FRAMESKIP_LEFT_DEFAULT;
+    universe->output_offset = UNIVERSE_OUTPUT_OFFSET_DEFAULT;
+    universe->thermo_offset = UNIVERSE_THERMO_OFFSET_DEFAULT;
+    universe->thermo_line_nb = UNIVERSE_THERMO_LINE_NB_DEFAULT;
+    universe->thermo_energy_0 = UNIVERSE_THERMO_ENERGY_0_DEFAULT;
+
+    /* The prepared seed is kept, unless another one is asked for */
+    if (args->srand_given)
+    {
+      universe->seed = args->srand_seed;
+    }
+  }
+  else if (universe_prepare(universe, args) == NULL)
   {
     return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Free the model file buffer, we're done */
-  free(file_buffer_model);
+  /* The other processes leave the outputs to the first one */
+  if (domain_rank() != 0)
+  {
+    return (universe);
+  }
 
-  /* Open the substrate file */
-  if ((universe->file_substrate = fopen(args->path_substrate, "r")) == NULL)
+  if (universe_init_output(universe, args) == NULL)
   {
     return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Get the substrate file's size */
-  fseek(universe->file_substrate, 0, SEEK_END);
-  file_len_substrate = ftell(universe->file_substrate);
-  rewind(universe->file_substrate);
+  return (universe);
+}
 
-  /* Initialize the memory buffer for the substrate file */
-  if ((file_buffer_substrate = (char*)malloc(file_len_substrate+1)) == NULL)
+/* Build a replica of a universe whose inputs were loaded
+ * The model and the substrate and solvent templates are only borrowed, the
+ * replica populates and solvates a universe of its own with its own seed.
+ * It keeps quiet, other replicas run alongside.
+ */
+universe_t *universe_init_replica(universe_t *universe, const universe_t *reference, const args_t *args)
+{
+  universe_reset(universe, args);
+  universe->shared = 1;
+  universe->quiet = 1;
+  universe->model = reference->model;
+  universe->meta_model_name = reference->meta_model_name;
+  universe->meta_model_author = reference->meta_model_author;
+  universe->meta_model_comment = reference->meta_model_comment;
+  universe->meta_substrate_name = reference->meta_substrate_name;
+  universe->meta_substrate_author = reference->meta_substrate_author;
+  universe->meta_substrate_comment = reference->meta_substrate_comment;
+  universe->meta_solvent_name = reference->meta_solvent_name;
+  universe->meta_solvent_author = reference->meta_solvent_author;
+  universe->meta_solvent_comment = reference->meta_solvent_comment;
+  universe->substrate_atom_nb = reference->substrate_atom_nb;
+  universe->substrate_bond_nb = reference->substrate_bond_nb;
+  universe->substrate_atom = reference->substrate_atom;
+  universe->solvent_atom_nb = reference->solvent_atom_nb;
+  universe->solvent_bond_nb = reference->solvent_bond_nb;
+  universe->solvent_atom = reference->solvent_atom;
+
+  if ((universe->file_output = fopen(args->path_out, (args->format == OUTPUT_FORMAT_XYZ) ? "w" : "wb")) == NULL ||
+      universe_build(universe, args) == NULL ||
+      universe_init_output(universe, args) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_INIT_REPLICA_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Load it in the substrate buffer, terminate the string */
-  if (fread(file_buffer_substrate, sizeof(char), file_len_substrate, universe->file_substrate) != file_len_substrate)
+  return (universe);
+}
+
+/* Load the input files, populate, solvate and set the initial velocities */
+universe_t *universe_prepare(universe_t *universe, const args_t *args)
+{
+  if (universe_load(universe, args) == NULL ||
+      universe_build(universe, args) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_PREPARE_FAILURE, __FILE__, __LINE__));
   }
-  file_buffer_substrate[file_len_substrate] = '\0';
 
-  /* Load the initial state from the substrate file */
-  if (universe_load_substrate(universe, file_buffer_substrate) == NULL)
+  return (universe);
+}
+
+/* Load the model, the substrate and the solvent */
+universe_t *universe_load(universe_t *universe, const args_t *args)
+{
+  size_t file_len_model;          /* Size of the model file (bytes) */
+  size_t file_len_substrate;      /* Size of the substrate file (bytes) */
+  size_t file_len_solvent;        /* Size of the solvent file (bytes) */
+  const char *file_map_model;     /* The model file, mapped */
+  const char *file_map_substrate; /* The substrate file, mapped */
+  const char *file_map_solvent;   /* The solvent file, mapped */
+  parser_t parser;                /* Reads the mapped files */
+
+  /* Open the model file */
+  if ((universe->file_model = fopen(args->path_model, "r")) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Free the substrate file buffer, we're done */
-  free(file_buffer_substrate);
-  
-  /* Open the solvent file */
-  if ((universe->file_solvent  = fopen(args->path_solvent, "r")) == NULL)
+  /* Map the model file, it's parsed in place */
+  if ((file_map_model = parser_map(universe->file_model, &file_len_model)) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+  parser_init(&parser, file_map_model, file_len_model, args->path_model);
+
+  /* Load the model from the file */
+  if (universe_load_model(universe, &parser) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Unmap the model file, we're done */
+  parser_unmap(file_map_model, file_len_model);
+
+  /* Open the substrate file */
+  if ((universe->file_substrate = fopen(args->path_substrate, "r")) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Get the solvent file's size */
-  fseek(universe->file_solvent, 0, SEEK_END);
-  file_len_solvent = ftell(universe->file_solvent);
-  rewind(universe->file_solvent);
+  /* Map the substrate file, it's parsed in place */
+  if ((file_map_substrate = parser_map(universe->file_substrate, &file_len_substrate)) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+  parser_init(&parser, file_map_substrate, file_len_substrate, args->path_substrate);
 
-  /* Initialize the memory buffer for the solvent file */
-  if ((file_buffer_solvent = (char*)malloc(file_len_substrate+1)) == NULL)
+  /* Load the initial state from the substrate file */
+  if (universe_load_substrate(universe, &parser) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Load it in the solvent buffer, terminate the string */
-  if (fread(file_buffer_solvent, sizeof(char), file_len_solvent, universe->file_solvent) != file_len_solvent)
+  /* Unmap the substrate file, we're done */
+  parser_unmap(file_map_substrate, file_len_substrate);
+  
+  /* Open the solvent file */
+  if ((universe->file_solvent  = fopen(args->path_solvent, "r")) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Map the solvent file, it's parsed in place */
+  if ((file_map_solvent = parser_map(universe->file_solvent, &file_len_solvent)) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
   }
-  file_buffer_solvent[file_len_solvent] = '\0';
+  parser_init(&parser, file_map_solvent, file_len_solvent, args->path_solvent);
 
   /* Load the initial state from the solvent file */
-  if (universe_load_solvent(universe, file_buffer_solvent) == NULL)
+  if (universe_load_solvent(universe, &parser) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_LOAD_FAILURE, __FILE__, __LINE__));
   }
 
-  /* Free the solvent file buffer, we're done */
-  free(file_buffer_solvent);
+  /* Unmap the solvent file, we're done */
+  parser_unmap(file_map_solvent, file_len_solvent);
+
+  return (universe);
+}
+
+/* Populate, solvate and set the initial velocities, the inputs being loaded */
+universe_t *universe_build(universe_t *universe, const args_t *args)
+{
+  size_t i;                       /* Iterator */
+  double universe_mass;           /* Total mass of the universe */
 
   /* Initialize the atom number */
   universe->atom_nb = (universe->substrate_atom_nb) * (universe->copy_nb);
 
-  /* Allocate memory for the atoms */
-  if ((universe->atom = malloc (sizeof(atom_t)*(universe->atom_nb))) == NULL)
+  /* Allocate memory for the atoms, close to the threads that will integrate them */
+  if ((universe->atom = affinity_alloc(universe->atom_nb, sizeof(atom_t))) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_BUILD_FAILURE, __FILE__, __LINE__));
   }
 
   /* Initialize the atom memory */
@@ -185,19 +385,32 @@ universe_t *universe_init(universe_t *universe, const args_t *args)
     atom_init(&(universe->atom[i]));
   }
 
-  /* Compute the universe's size from the system density */
+  /* Compute the universe's size from the system density, unless it was given */
   /* size = cbrt(universe_mass / system_density) */
-  universe_mass = 0.0;
-  for (i=0; i<(universe->substrate_atom_nb); ++i)
+  if (args->size > 0.0)
   {
-    universe_mass += args->copies * universe->model.entry[universe->substrate_atom[i].element].mass;
+    universe->size = args->size;
+  }
+  else
+  {
+    universe_mass = 0.0;
+    for (i=0; i<(universe->substrate_atom_nb); ++i)
+    {
+      universe_mass += args->copies * universe->model.entry[universe->substrate_atom[i].element].mass;
+    }
+    universe->size = cbrt((universe_mass) / (args->density));
   }
-  universe->size = cbrt((universe_mass) / (args->density));
 
   /* Populate the universe with extra molecules */
   if (universe_populate(universe) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_BUILD_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Fill the remaining space with solvent */
+  if (universe_solvate(universe, args) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_BUILD_FAILURE, __FILE__, __LINE__));
   }
 
   /* Enforce the PBC */
@@ -205,14 +418,14 @@ universe_t *universe_init(universe_t *universe, const args_t *args)
   {
     if (atom_enforce_pbc(universe, i) == NULL)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+      return (retstr(NULL, TEXT_UNIVERSE_BUILD_FAILURE, __FILE__, __LINE__));
     }
   }
 
   /* Apply initial velocities */
   if (universe_setvelocity(universe) == NULL)
   {
-    return (retstr(NULL, TEXT_UNIVERSE_INIT_FAILURE, __FILE__, __LINE__));
+    return (retstr(NULL, TEXT_UNIVERSE_BUILD_FAILURE, __FILE__, __LINE__));
   }
 
   return (universe);
@@ -221,62 +434,52 @@ universe_t *universe_init(universe_t *universe, const args_t *args)
 universe_t *universe_populate(universe_t *universe)
 {
   size_t i;
-  size_t ii;
-  size_t iii;
-  vec3_t pos_offset;
-  atom_t *reference;
-  atom_t *duplicate;
+  vec3_t site;
+  vec3_t centroid;
+  mat3_t rot;
+  rng_t rng;
+
+  /* Random insertion places the substrate as loaded, relative to its own origin */
+  centroid.x = 0.0;
+  centroid.y = 0.0;
+  centroid.z = 0.0;
+  for (i=0; i<(universe->substrate_atom_nb); ++i)
+  {
+    vec3_add(&centroid, &centroid, &(universe->substrate_atom[i].pos));
+  }
+  if (universe->substrate_atom_nb)
+  {
+    vec3_mul(&centroid, &centroid, 1.0/(universe->substrate_atom_nb));
+  }
 
   for (i=0; i<(universe->copy_nb); ++i)
   {
-    /* Generate a random position vector to load the system at */
-    vec3_marsaglia(&pos_offset);
-    vec3_mul(&pos_offset, &pos_offset, (1-UNIVERSE_POPULATE_MIN_DIST)*(universe->size)*cos(rand()) + UNIVERSE_POPULATE_MIN_DIST*(universe->size));
-
-    /* Load each atom from the reference system into the universe */
-    for (ii=0; ii<(universe->substrate_atom_nb); ++ii)
+    if (universe->populate_mode == POPULATE_MODE_RANDOM)
     {
-      /* Just shortcuts, they make the code cleaner */
-      reference = &(universe->substrate_atom[ii]);
-      duplicate = &(universe->atom[(i*(universe->substrate_atom_nb)) + ii]);
-
-      duplicate->element = reference->element;
-      duplicate->charge = reference->charge;
-      duplicate->epsilon = reference->epsilon;
-      duplicate->sigma = reference->sigma;
-
-      duplicate->bond_nb = reference->bond_nb;
-
-      duplicate->vel.x = reference->vel.x;
-      duplicate->vel.y = reference->vel.y;
-      duplicate->vel.z = reference->vel.z;
-
-      duplicate->acc.x = reference->acc.x;
-      duplicate->acc.y = reference->acc.y;
-      duplicate->acc.z = reference->acc.z;
-
-      duplicate->frc.x = reference->frc.x;
-      duplicate->frc.y = reference->frc.y;
-      duplicate->frc.z = reference->frc.z;
-
-      /* Load the atom's location */
-      vec3_add(&(duplicate->pos), &(reference->pos), &pos_offset);
+      /* Generate a random position vector to load the system at */
+      rng_init(&rng, universe->seed, i, 0, RNG_PURPOSE_POPULATE);
+      vec3_marsaglia(&site, &rng);
+      vec3_mul(&site, &site, (1-UNIVERSE_POPULATE_MIN_DIST)*(universe->size)*rng_uniform(&rng) + UNIVERSE_POPULATE_MIN_DIST*(universe->size));
+      vec3_add(&site, &site, &centroid);
 
-      /* Allocate memory for the bond information */
-      if ((duplicate->bond = malloc(sizeof(uint64_t)*(reference->bond_nb))) == NULL)
+      if (universe_populate_copy(universe, universe->substrate_atom, universe->substrate_atom_nb, i*(universe->substrate_atom_nb), &site, NULL) == NULL)
       {
         return (retstr(NULL, TEXT_UNIVERSE_POPULATE_FAILURE, __FILE__, __LINE__));
       }
-      if ((duplicate->bond_strength = malloc(sizeof(double)*(reference->bond_nb))) == NULL)
+    }
+    else
+    {
+      /* Load the copy on its lattice site, randomly oriented */
+      if (universe_populate_site(universe, &site, i, universe->copy_nb, universe->populate_mode) == NULL)
       {
         return (retstr(NULL, TEXT_UNIVERSE_POPULATE_FAILURE, __FILE__, __LINE__));
       }
+      rng_init(&rng, universe->seed, i, 0, RNG_PURPOSE_ORIENT);
+      mat3_transform_gen_rand_rot(&rot, 2*M_PI, &rng);
 
-      /* Load the bond information */
-      for (iii=0; iii<(duplicate->bond_nb); ++iii)
+      if (universe_populate_copy(universe, universe->substrate_atom, universe->substrate_atom_nb, i*(universe->substrate_atom_nb), &site, &rot) == NULL)
       {
-        duplicate->bond[iii] = reference->bond[iii] + (i*(universe->substrate_atom_nb));
-        duplicate->bond_strength[iii] = reference->bond_strength[iii];
+        return (retstr(NULL, TEXT_UNIVERSE_POPULATE_FAILURE, __FILE__, __LINE__));
       }
     }
   }
@@ -284,13 +487,190 @@ universe_t *universe_populate(universe_t *universe)
   return (universe);
 }
 
+/* Get the location of the id-th of nb lattice sites filling the universe
+ *
+ * The universe is cut in n*n*n cubic cells, n being the smallest integer for
+ * which the lattice has enough sites. Should there be more sites than needed,
+ * the used sites are spread evenly through the lattice rather than packed at
+ * its start.
+ */
+universe_t *universe_populate_site(universe_t *universe, vec3_t *site, const uint64_t id, const uint64_t nb, const uint8_t mode)
+{
+  /* Fractional coordinates of the sites within a cell */
+  static const double basis_sc[1][3] = {{0.5, 0.5, 0.5}};
+  static const double basis_fcc[4][3] = {{0.25, 0.25, 0.25},
+                                         {0.75, 0.75, 0.25},
+                                         {0.75, 0.25, 0.75},
+                                         {0.25, 0.75, 0.75}};
+  const double (*basis)[3];
+  uint64_t basis_nb;   /* Sites per cell */
+  uint64_t cell_nb;    /* Cells per side */
+  uint64_t site_nb;    /* Sites in the whole lattice */
+  uint64_t site_id;
+  uint64_t cell_id;
+  double spacing;      /* (m) Length of a cell */
+  double jitter;
+  vec3_t offset;
+  rng_t rng;
+
+  if (mode == POPULATE_MODE_FCC)
+  {
+    basis = basis_fcc;
+    basis_nb = 4;
+  }
+  else if (mode == POPULATE_MODE_SC || mode == POPULATE_MODE_JITTER)
+  {
+    basis = basis_sc;
+    basis_nb = 1;
+  }
+  else
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_POPULATE_SITE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Find the smallest lattice that fits */
+  cell_nb = (uint64_t) ceil(cbrt((double)nb / basis_nb));
+  while (cell_nb*cell_nb*cell_nb*basis_nb < nb)
+  {
+    ++cell_nb;
+  }
+  if (cell_nb == 0)
+  {
+    cell_nb = 1;
+  }
+  site_nb = cell_nb*cell_nb*cell_nb*basis_nb;
+  spacing = (universe->size) / cell_nb;
+
+  /* Pick the site */
+  site_id = (id * site_nb) / nb;
+  cell_id = site_id / basis_nb;
+  site_id = site_id % basis_nb;
+
+  site->x = -0.5*(universe->size) + spacing*((cell_id % cell_nb) + basis[site_id][0]);
+  site->y = -0.5*(universe->size) + spacing*(((cell_id / cell_nb) % cell_nb) + basis[site_id][1]);
+  site->z = -0.5*(universe->size) + spacing*((cell_id / (cell_nb*cell_nb)) + basis[site_id][2]);
+
+  /* Jittered lattices get moved off their site, within a fraction of the spacing */
+  if (mode == POPULATE_MODE_JITTER)
+  {
+    rng_init(&rng, universe->seed, id, 0, RNG_PURPOSE_JITTER);
+    jitter = UNIVERSE_POPULATE_JITTER * spacing * rng_uniform(&rng);
+    vec3_marsaglia(&offset, &rng);
+    vec3_mul(&offset, &offset, jitter);
+    vec3_add(site, site, &offset);
+  }
+
+  return (universe);
+}
+
+/* Load reference_nb atoms from reference into the universe, starting at the atom first
+ *
+ * The reference's centroid is moved to site. If rot isn't NULL, the copy is
+ * rotated about its centroid beforehand. Bonds are offset to the new atom IDs.
+ */
+universe_t *universe_populate_copy(universe_t *universe, const atom_t *reference, const uint64_t reference_nb, const uint64_t first, const vec3_t *site, mat3_t *rot)
+{
+  size_t i;
+  size_t ii;
+  vec3_t centroid;
+  vec3_t pos;
+  const atom_t *ref;
+  atom_t *duplicate;
+
+  /* Get the reference's centroid */
+  centroid.x = 0.0;
+  centroid.y = 0.0;
+  centroid.z = 0.0;
+  for (i=0; i<reference_nb; ++i)
+  {
+    vec3_add(&centroid, &centroid, &(reference[i].pos));
+  }
+  if (reference_nb)
+  {
+    vec3_mul(&centroid, &centroid, 1.0/reference_nb);
+  }
+
+  /* Load each atom from the reference system into the universe */
+  for (i=0; i<reference_nb; ++i)
+  {
+    /* Just shortcuts, they make the code cleaner */
+    ref = &(reference[i]);
+    duplicate = &(universe->atom[first + i]);
+
+    duplicate->element = ref->element;
+    duplicate->charge = ref->charge;
+    duplicate->epsilon = ref->epsilon;
+    duplicate->sigma = ref->sigma;
+
+    duplicate->bond_nb = ref->bond_nb;
+
+    duplicate->vel = ref->vel;
+    duplicate->acc = ref->acc;
+    duplicate->frc = ref->frc;
+
+    /* Load the atom's location */
+    vec3_sub(&pos, &(ref->pos), &centroid);
+    if (rot != NULL)
+    {
+      mat3_transform_apply(rot, &pos);
+    }
+    vec3_add(&(duplicate->pos), &pos, site);
+
+    /* Allocate memory for the bond information */
+    if ((duplicate->bond = malloc(sizeof(uint64_t)*(ref->bond_nb))) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_POPULATE_FAILURE, __FILE__, __LINE__));
+    }
+    if ((duplicate->bond_strength = malloc(sizeof(double)*(ref->bond_nb))) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_POPULATE_FAILURE, __FILE__, __LINE__));
+    }
+
+    /* Load the bond information */
+    for (ii=0; ii<(duplicate->bond_nb); ++ii)
+    {
+      duplicate->bond[ii] = ref->bond[ii] + first;
+      duplicate->bond_strength[ii] = ref->bond_strength[ii];
+    }
+  }
+
+  return (universe);
+}
+
+/* Get the range of atoms making up a molecule
+ * Substrate copies come first, followed by the solvent molecules
+ */
+universe_t *universe_molecule(universe_t *universe, const uint64_t molecule_id, uint64_t *first, uint64_t *nb)
+{
+  if (molecule_id < universe->copy_nb)
+  {
+    *first = molecule_id * (universe->substrate_atom_nb);
+    *nb = universe->substrate_atom_nb;
+  }
+  else if (molecule_id < (universe->copy_nb) + (universe->solvent_copy_nb))
+  {
+    *first = (universe->copy_nb) * (universe->substrate_atom_nb) + (molecule_id - universe->copy_nb) * (universe->solvent_atom_nb);
+    *nb = universe->solvent_atom_nb;
+  }
+  else
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_MOLECULE_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
 /* Apply a velocity to all the system's atoms from the average kinetic energy */
 universe_t *universe_setvelocity(universe_t *universe)
 {
   size_t i;        /* Iterator */
   double mass_mol; /* Mass of a loaded system's */
   double velocity; /* Average velocity calculated */
-  vec3_t vec;     /* Random vector */
+  double velocity_solvent; /* Same, for the solvent molecules */
+  size_t block;    /* First atom of a batch */
+  size_t block_nb; /* Atoms in the batch */
+  double gauss[3*UNIVERSE_VELOCITY_BLOCK_NB]; /* Gaussian coordinates of their directions */
+  vec3_t vec;      /* Random vector */
 
   /* Get the molecular mass */
   mass_mol = 0;
@@ -302,99 +682,293 @@ universe_t *universe_setvelocity(universe_t *universe)
   /* Get the average velocity */
   velocity = sqrt(3*C_BOLTZMANN*(universe->temperature)/mass_mol);
 
-  /* For every atom in the universe */
-  for (i=0; i<(universe->atom_nb); ++i)
+  /* Same for the solvent, if there is any */
+  velocity_solvent = 0.0;
+  if (universe->solvent_copy_nb)
+  {
+    mass_mol = 0;
+    for (i=0; i<(universe->solvent_atom_nb); ++i)
+    {
+      mass_mol += universe->model.entry[universe->solvent_atom[i].element].mass;
+    }
+    velocity_solvent = sqrt(3*C_BOLTZMANN*(universe->temperature)/mass_mol);
+  }
+
+  /* Batches of atoms, atom i's direction being variates 3i to 3i+2 of the stream */
+#pragma omp parallel for schedule(static) private(i, block_nb, gauss, vec)
+  for (block=0; block<(universe->atom_nb); block+=UNIVERSE_VELOCITY_BLOCK_NB)
   {
-    /* Apply the velocity in a random direction */
-    vec3_marsaglia(&vec);
-    vec3_mul(&(universe->atom[i].vel), &vec, velocity);
+    block_nb = (universe->atom_nb - block < UNIVERSE_VELOCITY_BLOCK_NB) ? universe->atom_nb - block : UNIVERSE_VELOCITY_BLOCK_NB;
+    rng_gaussian_batch(gauss, 3*block_nb, 3*block, universe->seed, 0, 0, RNG_PURPOSE_VELOCITY);
+
+    for (i=0; i<block_nb; ++i)
+    {
+      /* Apply the velocity in a random direction, gaussian vectors being isotropic */
+      vec.x = gauss[3*i];
+      vec.y = gauss[3*i + 1];
+      vec.z = gauss[3*i + 2];
+      vec3_mul(&vec, &vec, 1.0/vec3_mag(&vec));
+      if (block + i < (universe->copy_nb)*(universe->substrate_atom_nb))
+        vec3_mul(&(universe->atom[block + i].vel), &vec, velocity);
+      else
+        vec3_mul(&(universe->atom[block + i].vel), &vec, velocity_solvent);
+    }
   }
 
   return (universe);
 }
 
+/* Report progress, unless told to keep quiet */
+void universe_say(const universe_t *universe, const char *format, ...)
+{
+  va_list list;
+
+  if (universe->quiet)
+  {
+    return;
+  }
+
+  va_start(list, format);
+  vprintf(format, list);
+  va_end(list);
+}
+
 void universe_clean(universe_t *universe)
 {
   size_t i;
 
-  /* Clean each atom in the reference system */
-  for (i=0; i<(universe->substrate_atom_nb); ++i)
+  /* Clean each atom in the reference system, unless it's borrowed */
+  for (i=0; i<(universe->substrate_atom_nb) && !(universe->shared); ++i)
   {
     atom_clean(&(universe->substrate_atom[i]));
   }
 
+  /* Clean each atom in the solvent */
+  for (i=0; i<(universe->solvent_atom_nb) && !(universe->shared); ++i)
+  {
+    atom_clean(&(universe->solvent_atom[i]));
+  }
+
   /* Clean each atom in the universe */
   for (i=0; i<(universe->atom_nb); ++i)
   {
     atom_clean(&(universe->atom[i]));
   }
 
-  model_clean(&(universe->model));
-
-  /* Close the file pointers */
-  fclose(universe->file_model);
-  fclose(universe->file_substrate);
-  fclose(universe->file_solvent);
-  fclose(universe->file_output);
-
-  /* Free allocated memory */
-  free(universe->meta_model_name);
-  free(universe->meta_model_author);
-  free(universe->meta_model_comment);
-  free(universe->meta_substrate_name);
-  free(universe->meta_substrate_author);
-  free(universe->meta_substrate_comment);
-  free(universe->substrate_atom);
-  free(universe->meta_solvent_name);
-  free(universe->meta_solvent_author);
-  free(universe->meta_solvent_comment);
-  free(universe->solvent_atom);
+  if (!(universe->shared))
+  {
+    model_clean(&(universe->model));
+  }
+
+  /* Tell the binary trajectory how many frames it holds */
+  if (universe->output_format == OUTPUT_FORMAT_DCD && universe->file_output != NULL)
+  {
+    dcd_close(universe);
+  }
+
+  /* Close the file pointers, prepared systems don't open the inputs */
+  if (universe->file_model != NULL)
+    fclose(universe->file_model);
+  if (universe->file_substrate != NULL)
+    fclose(universe->file_substrate);
+  if (universe->file_solvent != NULL)
+    fclose(universe->file_solvent);
+  if (universe->file_output != NULL)
+    fclose(universe->file_output);
+  if (universe->file_index != NULL)
+    fclose(universe->file_index);
+
+  /* Then the groups' */
+  for (i=0; i<(universe->group_nb); ++i)
+  {
+    group_clean(&(universe->group[i]));
+  }
+  free(universe->group);
+  stream_close(universe);
+  thermo_close(universe);
+  domain_clean(universe);
+  cell_clean(universe);
+  sched_clean(universe);
+  reorder_close(universe);
+  tile_clean(universe);
+
+  /* Free allocated memory, the templates only if they're this universe's */
+  if (!(universe->shared))
+  {
+    free(universe->meta_model_name);
+    free(universe->meta_model_author);
+    free(universe->meta_model_comment);
+    free(universe->meta_substrate_name);
+    free(universe->meta_substrate_author);
+    free(universe->meta_substrate_comment);
+    free(universe->substrate_atom);
+    free(universe->meta_solvent_name);
+    free(universe->meta_solvent_author);
+    free(universe->meta_solvent_comment);
+    free(universe->solvent_atom);
+  }
   free(universe->atom);
+  free(universe->output_buffer);
+  free(universe->output_chunk_len);
+  free(universe->energy);
 }
 
 /* Main loop of the simulator. Iterates until the target time is reached */
 int universe_simulate(universe_t *universe, const args_t *args)
 {
-  uint64_t frame_nb; /* Used for frameskipping */
-  uint64_t frame_max;
+  writer_t writer;   /* Writes the frames while we keep iterating */
 
-  frame_max = (args->max_time / args->timestep);
-  /* Tell the user the simulation is starting */
-  puts(TEXT_SIMSTART);
+  if (universe_simulate_start(universe, args, &writer) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
 
   /* While we haven't reached the target time, we iterate the universe */
-  frame_nb = 0;
   while (universe->time < args->max_time)
   {
-    /* Print the state to the .xyz file, if required */
-    if (!frame_nb)
+    if (universe_simulate_step(universe, args, &writer) == NULL)
     {
-      if (universe_printstate(universe) == NULL)
-      {
-        return (retstri(EXIT_FAILURE, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
-      }
-      frame_nb = (args->frameskip);
+      return (retstri(EXIT_FAILURE, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
     }
-    else
-      --frame_nb;
+  }
+
+  return (universe_simulate_end(universe, &writer));
+}
+
+/* Get the universe ready to be iterated, and start the output thread */
+universe_t *universe_simulate_start(universe_t *universe, const args_t *args, writer_t *writer)
+{
+  /* Split the universe between the processes, if there are several */
+  if (domain_init(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
 
-    /* Iterate */
-    if (universe_iterate(universe, args) == NULL)
+  /* With a cutoff, bin the atoms in cells and balance the cells over the threads */
+  if (cell_init(universe) == NULL ||
+      (universe->cell != NULL && sched_init(universe, universe->cell->cell_nb) == NULL))
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Without cells, small systems have their pairs computed tile against tile */
+  if (tile_init(universe, args) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Keep track of the atoms' input order, if they are to be sorted */
+  if (reorder_open(universe, args) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Open the thermodynamics log, every process takes part in its sums */
+  if (thermo_open(universe, args) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Start the output thread, the other processes have nothing to write */
+  if (writer_init(writer, universe, (domain_rank() == 0) ? args->out_buffers : 0) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Tell the user the simulation is starting */
+  universe_say(universe, "%s\n", TEXT_SIMSTART);
+
+  return (universe);
+}
+
+/* Write the frames due, then iterate the universe once */
+universe_t *universe_simulate_step(universe_t *universe, const args_t *args, writer_t *writer)
+{
+  uint64_t frame_max;
+  double step_start;
+
+  frame_max = (args->max_time / args->timestep);
+
+  /* Print the state to the .xyz file, the groups' trajectories and the live stream, if required */
+  if (!(universe->frameskip_left) || group_due(universe) || stream_due(universe))
+  {
+    /* Every process takes part in gathering the atoms, the first one writes them */
+    if ((universe->domain != NULL && domain_gather(universe) == NULL) ||
+        (domain_rank() == 0 && writer_push(writer, universe, !(universe->frameskip_left)) == NULL))
     {
-      return (retstri(EXIT_FAILURE, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+      writer_clean(writer, universe);
+      return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
     }
+  }
+  if (!(universe->frameskip_left))
+    universe->frameskip_left = (args->frameskip);
+  else
+    --(universe->frameskip_left);
+
+  /* Sort the atoms along the cells, if due */
+  if (reorder_due(universe) && reorder_apply(universe) == NULL)
+  {
+    writer_clean(writer, universe);
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Iterate */
+  step_start = omp_get_wtime();
+  if (universe_iterate(universe, args) == NULL)
+  {
+    writer_clean(writer, universe);
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+  reorder_account(universe, omp_get_wtime() - step_start);
 
-    printf(TEXT_UNIVERSE_SIMULATE_SUCCESS, universe->iterations + 1, frame_max, (double) 100 * (universe->iterations + 1) / frame_max);
-    fflush(stdout);
+  universe_say(universe, TEXT_UNIVERSE_SIMULATE_SUCCESS, universe->iterations + 1, frame_max, (double) 100 * (universe->iterations + 1) / frame_max);
+  fflush(stdout);
 
-    universe->time += args->timestep;
-    ++(universe->iterations);
+  universe->time += args->timestep;
+  ++(universe->iterations);
+
+  /* Log the thermodynamics, if due */
+  if (thermo_write(universe) == NULL)
+  {
+    writer_clean(writer, universe);
+    return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Checkpoint, once every frame pushed so far is in the trajectory, with the atoms in their input order */
+  if (args->path_checkpoint != ARGS_PATH_CHECKPOINT_DEFAULT && !(universe->iterations % args->checkpoint_interval))
+  {
+    if (writer_sync(writer, universe) == NULL ||
+        thermo_sync(universe) == NULL ||
+        reorder_restore(universe) == NULL ||
+        prepared_checkpoint(universe, args) == NULL)
+    {
+      writer_clean(writer, universe);
+      return (retstr(NULL, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+    }
   }
 
-  printf("\n");
+  return (universe);
+}
+
+/* Wait for the last frames, then clean the universe up */
+int universe_simulate_end(universe_t *universe, writer_t *writer)
+{
+  universe_say(universe, "\n");
+
+  /* Wait for the last frames to be written */
+  if (writer_clean(writer, universe) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_UNIVERSE_SIMULATE_FAILURE, __FILE__, __LINE__));
+  }
+  universe_say(universe, TEXT_WRITER_WAIT, writer->wait_time, writer->wait_nb);
+  if (!(universe->quiet))
+  {
+    sched_report(universe);
+    reorder_report(universe);
+  }
 
   /* End of simulation */
-  puts(TEXT_SIMEND);
+  universe_say(universe, "%s\n", TEXT_SIMEND);
   universe_clean(universe);
 
   return (EXIT_SUCCESS);
@@ -406,10 +980,11 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
   int err = 0;
   
   /* We update the position vector first, as part of the Velocity-Verley integration */
-#pragma omp parallel for 
+  /* Spread over several processes, each one only integrates the atoms it owns */
+#pragma omp parallel for schedule(static)
   for (i=0; i<(universe->atom_nb); ++i)
     {
-      if (atom_update_pos(universe, args, i) == NULL)
+      if (DOMAIN_IS_OWNED(universe, i) && atom_update_pos(universe, args, i) == NULL)
         {
 #pragma omp atomic write
           err = 1;
@@ -421,10 +996,10 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
     }
   
   /* We enforce the periodic boundary conditions */
-#pragma omp parallel for 
+#pragma omp parallel for schedule(static)
   for (i=0; i<(universe->atom_nb); ++i)
     {
-      if (atom_enforce_pbc(universe, i) == NULL)
+      if (DOMAIN_IS_OWNED(universe, i) && atom_enforce_pbc(universe, i) == NULL)
         {
 #pragma omp atomic write
           err = 1;
@@ -434,14 +1009,21 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
     {
       return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
     }
+
+  /* Hand the atoms that changed slabs over, and get the ones within reach */
+  if (universe->domain != NULL && domain_exchange(universe) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
+    }
+
   /* Update the force vectors */
   /* By numerically differentiating the potential energy... */
   if (args->numerical == MODE_NUMERICAL)
     {
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
       for (i=0; i<(universe->atom_nb); ++i)
         {
-          if (atom_update_frc_numerical(universe, i) == NULL)
+          if (DOMAIN_IS_OWNED(universe, i) && atom_update_frc_numerical(universe, i) == NULL)
             {
 #pragma omp atomic write
               err = 1;
@@ -455,10 +1037,10 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
   /* By numerically differentiating the potential energy using points in a tetrahedron... */
   if (args->numerical == MODE_NUMERICAL_TETRA)
     {
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
       for (i=0; i<(universe->atom_nb); ++i)
         {
-          if (atom_update_frc_numerical_tetrahedron(universe, i) == NULL)
+          if (DOMAIN_IS_OWNED(universe, i) && atom_update_frc_numerical_tetrahedron(universe, i) == NULL)
             {
 #pragma omp atomic write
               err = 1;
@@ -470,13 +1052,28 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
           }
     }
   
-  /* Or analytically solving for force */
+  /* Or analytically solving for force, cell by cell if there's a grid, tile by tile for small systems */
+  else if (universe->cell != NULL)
+    {
+      if (cell_bin(universe) == NULL ||
+          sched_run(universe, universe->cell->cell_nb, universe->cell->pair_nb, cell_update_frc) == NULL)
+        {
+          return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
+        }
+    }
+  else if (universe->tile != NULL)
+    {
+      if (tile_update_frc(universe) == NULL)
+        {
+          return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
+        }
+    }
   else
     {
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
       for (i=0; i<(universe->atom_nb); ++i)
         {
-          if (atom_update_frc_analytical(universe, i) == NULL)
+          if (DOMAIN_IS_OWNED(universe, i) && atom_update_frc_analytical(universe, i) == NULL)
             {
 #pragma omp atomic write
               err = 1;
@@ -489,10 +1086,10 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
     }
   
   /* Update the acceleration vectors */
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
   for (i=0; i<(universe->atom_nb); ++i)
   {
-    if (atom_update_acc(universe, i) == NULL)
+    if (DOMAIN_IS_OWNED(universe, i) && atom_update_acc(universe, i) == NULL)
     {
 #pragma omp atomic write
         err = 1;
@@ -502,54 +1099,226 @@ universe_t *universe_iterate(universe_t *universe, const args_t *args)
     {
       return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
     }
-  /* Update the speed vectors */
-#pragma omp parallel for
+  /* Update the speed vectors, and the kinetic energy of each atom on the way */
+  if (universe_energy_alloc(universe) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
+    }
+#pragma omp parallel for schedule(static)
   for (i=0; i<(universe->atom_nb); ++i)
   {
+    universe->energy[i] = 0.0;
+    if (!DOMAIN_IS_OWNED(universe, i))
+    {
+      continue;
+    }
     if (atom_update_vel(universe, args, i) == NULL)
     {
 #pragma omp atomic write
         err = 1;
     }
+    universe->energy[i] = 0.5 * vec3_dot(&(universe->atom[i].vel), &(universe->atom[i].vel)) * universe->model.entry[universe->atom[i].element].mass;
   }
   if( 0 != err )
     {
       return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
     }
+  universe->kinetic = universe_energy_sum(universe);
+
+  /* Hold the temperature, if asked to, canonically for the replicas to be swapped */
+  if (universe->thermostat != UNIVERSE_THERMOSTAT_DEFAULT &&
+      ((args->exchange) ? universe_thermostat_bussi(universe, args) : universe_thermostat(universe, args)) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
+    }
+  return (universe);
+}
+
+/* Rescale the velocities towards the target temperature (Berendsen et al., 1984)
+ * The gap closes by timestep/thermostat of itself every iteration.
+ */
+universe_t *universe_thermostat(universe_t *universe, const args_t *args)
+{
+  size_t i;           /* Iterator */
+  double temperature; /* (K) Instantaneous temperature */
+  double scale;       /* Velocity scaling factor */
+
+  temperature = universe_temperature(universe);
+  if (temperature <= 0.0)
+  {
+    return (universe);
+  }
+  scale = sqrt(1.0 + (args->timestep/universe->thermostat)*(universe->temperature/temperature - 1.0));
+
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (DOMAIN_IS_OWNED(universe, i))
+    {
+      vec3_mul(&(universe->atom[i].vel), &(universe->atom[i].vel), scale);
+    }
+  }
+  universe->kinetic *= scale*scale;
+
+  return (universe);
+}
+
+/* Rescale the velocities by a random factor, for the kinetic energy to sample
+ * the canonical distribution (Bussi, Donadio and Parrinello, 2007). It takes
+ * 3N gaussian variates of the (seed, iteration) stream: the first, and the
+ * sum of the others' squares, added block by block in order for the factor
+ * not to depend on the threads.
+ */
+universe_t *universe_thermostat_bussi(universe_t *universe, const args_t *args)
+{
+  double gauss[UNIVERSE_VELOCITY_BLOCK_NB];
+  uint64_t dof;       /* Degrees of freedom */
+  uint64_t block;     /* First variate of a block */
+  uint64_t block_nb;  /* Variates in it */
+  size_t i;           /* Iterator */
+  double kinetic;     /* (J) Kinetic energy */
+  double target;      /* (J) Its mean at the target temperature */
+  double decay;       /* What's left of its gap to the target after a timestep */
+  double first;       /* The first variate */
+  double squares;     /* Sum of the others' squares */
+  double scale;       /* Velocity scaling factor */
+
+  kinetic = domain_sum(universe, universe->kinetic);
+  if (kinetic <= 0.0)
+  {
+    return (universe);
+  }
+  if (universe_energy_alloc(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_ITERATE_FAILURE, __FILE__, __LINE__));
+  }
+  dof = 3*(universe->atom_nb);
+  target = 0.5*dof*C_BOLTZMANN*(universe->temperature);
+  decay = exp(-(args->timestep)/(universe->thermostat));
+
+  /* The atoms' energies were summed already, their array holds the blocks' sums */
+#pragma omp parallel for schedule(static) private(i, block_nb, gauss)
+  for (block=0; block<dof; block+=UNIVERSE_VELOCITY_BLOCK_NB)
+  {
+    block_nb = (dof - block < UNIVERSE_VELOCITY_BLOCK_NB) ? dof - block : UNIVERSE_VELOCITY_BLOCK_NB;
+    rng_gaussian_batch(gauss, block_nb, block, universe->seed, 0, universe->iterations, RNG_PURPOSE_THERMOSTAT);
+
+    universe->energy[block/UNIVERSE_VELOCITY_BLOCK_NB] = 0.0;
+    for (i=(block == 0); i<block_nb; ++i)
+    {
+      universe->energy[block/UNIVERSE_VELOCITY_BLOCK_NB] += gauss[i]*gauss[i];
+    }
+  }
+  rng_gaussian_batch(&first, 1, 0, universe->seed, 0, universe->iterations, RNG_PURPOSE_THERMOSTAT);
+  squares = 0.0;
+  for (block=0; block<dof; block+=UNIVERSE_VELOCITY_BLOCK_NB)
+  {
+    squares += universe->energy[block/UNIVERSE_VELOCITY_BLOCK_NB];
+  }
+
+  scale = sqrt((kinetic + (1.0 - decay)*(target*(squares + first*first)/dof - kinetic) +
+                2.0*first*sqrt(kinetic*target/dof*(1.0 - decay)*decay)) / kinetic);
+
+#pragma omp parallel for schedule(static)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (DOMAIN_IS_OWNED(universe, i))
+    {
+      vec3_mul(&(universe->atom[i].vel), &(universe->atom[i].vel), scale);
+    }
+  }
+  universe->kinetic *= scale*scale;
+
   return (universe);
 }
 
-/* Print the system's state to the .xyz file */
+/* Print the system's state to the output file */
 universe_t *universe_printstate(universe_t *universe)
 {
-  size_t i; /* Iterator */
+  /* Remember where the frame starts */
+  if (frames_append(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_PRINTSTATE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Binary trajectory */
+  if (universe->output_format == OUTPUT_FORMAT_DCD)
+  {
+    if (dcd_frame(universe) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_PRINTSTATE_FAILURE, __FILE__, __LINE__));
+    }
+    return (universe);
+  }
+
+  /* Compressed trajectory */
+  if (universe->output_format == OUTPUT_FORMAT_STC)
+  {
+    if (stc_frame(universe) == NULL)
+    {
+      return (retstr(NULL, TEXT_UNIVERSE_PRINTSTATE_FAILURE, __FILE__, __LINE__));
+    }
+    return (universe);
+  }
 
   /* Print in the .xyz */
-  fprintf(universe->file_output, "%ld\n%ld\n", universe->atom_nb, universe->iterations);
-  for (i=0; i<(universe->atom_nb); ++i)
+  if (xyz_frame(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_PRINTSTATE_FAILURE, __FILE__, __LINE__));
+  }
+  return (universe);
+}
+
+/* The per-atom energies, allocated on first use */
+universe_t *universe_energy_alloc(universe_t *universe)
+{
+  if (universe->energy == UNIVERSE_ENERGY_DEFAULT &&
+      (universe->energy = malloc(sizeof(double) * (universe->atom_nb))) == NULL)
   {
-    fprintf(universe->file_output,
-            "%s\t%lf\t%lf\t%lf\n",
-            universe->model.entry[universe->atom[i].element].symbol,
-            universe->atom[i].pos.x*1E10,
-            universe->atom[i].pos.y*1E10,
-            universe->atom[i].pos.z*1E10);
+    return (retstr(NULL, TEXT_UNIVERSE_ENERGY_ALLOC_FAILURE, __FILE__, __LINE__));
   }
+
   return (universe);
 }
 
+/* Sum the per-atom energies
+ * The atoms are computed in parallel, but added in order, for the total to be
+ * the same whatever the number of threads. A reduction clause would add the
+ * threads' shares in whatever order they finish, and the trajectories depend
+ * on the last bits of the totals through the thermostat.
+ */
+double universe_energy_sum(const universe_t *universe)
+{
+  size_t i;
+  double sum;
+
+  sum = 0.0;
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    sum += universe->energy[i];
+  }
+
+  return (sum);
+}
+
 /* Compute the system's total kinetic energy */
 universe_t *universe_energy_kinetic(universe_t *universe, double *energy)
 {
   size_t i;   /* Iterator */
   double vel; /* Particle velocity (m/s) */
 
-  *energy = 0.0;
+  if (universe_energy_alloc(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_ENERGY_KINETIC_FAILURE, __FILE__, __LINE__));
+  }
+
+#pragma omp parallel for schedule(static) private(vel)
   for (i=0; i<(universe->atom_nb); ++i)
   {
     vel = vec3_mag(&(universe->atom[i].vel));
-    *energy += 0.5 * POW2(vel) * universe->model.entry[universe->atom[i].element].mass;
+    universe->energy[i] = 0.5 * POW2(vel) * universe->model.entry[universe->atom[i].element].mass;
   }
+  *energy = universe_energy_sum(universe);
 
   return (universe);
 }
@@ -557,22 +1326,76 @@ universe_t *universe_energy_kinetic(universe_t *universe, double *energy)
 /* Compute the system's total potential energy */
 universe_t *universe_energy_potential(universe_t *universe, double *energy)
 {
-  size_t i;         /* Iterator */
-  double potential; /* Total potential energy */
+  size_t i;  /* Iterator */
+  int err = 0;
+
+  if (universe_energy_alloc(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_ENERGY_POTENTIAL_FAILURE, __FILE__, __LINE__));
+  }
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (i=0; i<(universe->atom_nb); ++i)
+  {
+    if (potential_total(&(universe->energy[i]), universe, i) == NULL)
+    {
+#pragma omp atomic write
+      err = 1;
+    }
+  }
+  if (err)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_ENERGY_POTENTIAL_FAILURE, __FILE__, __LINE__));
+  }
+  *energy = universe_energy_sum(universe);
+
+  return (universe);
+}
+
+/* The same within the cutoff, from the cells the last force pass binned */
+universe_t *universe_energy_potential_cell(universe_t *universe, double *energy)
+{
+  double term[POTENTIAL_TERM_NB];
+  size_t i;
+  size_t j;
+  int err = 0;
 
-  *energy = 0.0;
+  if (universe_energy_alloc(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_ENERGY_POTENTIAL_FAILURE, __FILE__, __LINE__));
+  }
+
+#pragma omp parallel for schedule(dynamic, 64) private(term, j)
   for (i=0; i<(universe->atom_nb); ++i)
   {
-    if (potential_total(&potential, universe, i) == NULL)
+    if (potential_terms_cell(term, universe, i) == NULL)
+    {
+#pragma omp atomic write
+      err = 1;
+    }
+    universe->energy[i] = 0.0;
+    for (j=0; j<POTENTIAL_TERM_NB; ++j)
     {
-      return (retstr(NULL, TEXT_UNIVERSE_ENERGY_POTENTIAL_FAILURE, __FILE__, __LINE__));
+      universe->energy[i] += term[j];
     }
-    *energy += potential;
   }
+  if (err)
+  {
+    return (retstr(NULL, TEXT_UNIVERSE_ENERGY_POTENTIAL_FAILURE, __FILE__, __LINE__));
+  }
+  *energy = universe_energy_sum(universe);
 
   return (universe);
 }
 
+/* Instantaneous temperature, from the kinetic energy of the last velocity update
+ * Every process takes part, each having summed the atoms it owns.
+ */
+double universe_temperature(const universe_t *universe)
+{
+  return (2.0*domain_sum(universe, universe->kinetic) / (3.0*(universe->atom_nb)*C_BOLTZMANN));
+}
+
 /* Compute the total system energy */
 universe_t *universe_energy_total(universe_t *universe, double *energy)
 {
@@ -599,6 +1422,8 @@ universe_t *universe_energy_total(universe_t *universe, double *energy)
 universe_t *universe_parameters_print(universe_t *universe, const args_t *args)
 {
   double potential;    /* The universe's potential energy */
+  const char *path_prepared; /* Where the universe came from, if not the input files */
+  uint64_t i;                /* Iterator */
 
   /* Compute the potential energy */
    if (universe_energy_potential(universe, &potential) == NULL)
@@ -606,9 +1431,11 @@ universe_t *universe_parameters_print(universe_t *universe, const args_t *args)
      return (retstr(NULL, TEXT_UNIVERSE_PARAMETERS_PRINT_FAILURE, __FILE__, __LINE__));
    }
   
+  path_prepared = (args->restart) ? args->path_checkpoint : args->path_load_prepared;
+
   /* Print some useful information */
   puts(TEXT_INFO_MODEL);
-  printf(TEXT_INFO_PATH, args->path_model);
+  printf(TEXT_INFO_PATH, (path_prepared != NULL) ? path_prepared : args->path_model);
   printf(TEXT_INFO_NAME, universe->meta_model_name);
   printf(TEXT_INFO_AUTHOR, universe->meta_model_author);
   printf(TEXT_INFO_COMMENT, universe->meta_model_comment);
@@ -616,7 +1443,7 @@ universe_t *universe_parameters_print(universe_t *universe, const args_t *args)
   puts("\n");
 
   puts(TEXT_INFO_SUBSTRATE);
-  printf(TEXT_INFO_PATH, args->path_substrate);
+  printf(TEXT_INFO_PATH, (path_prepared != NULL) ? path_prepared : args->path_substrate);
   printf(TEXT_INFO_NAME, universe->meta_substrate_name);
   printf(TEXT_INFO_AUTHOR, universe->meta_substrate_author);
   printf(TEXT_INFO_COMMENT, universe->meta_substrate_comment);
@@ -625,7 +1452,7 @@ universe_t *universe_parameters_print(universe_t *universe, const args_t *args)
   puts("\n");
 
   puts(TEXT_INFO_SOLVENT);
-  printf(TEXT_INFO_PATH, args->path_solvent);
+  printf(TEXT_INFO_PATH, (path_prepared != NULL) ? path_prepared : args->path_solvent);
   printf(TEXT_INFO_NAME, universe->meta_solvent_name);
   printf(TEXT_INFO_AUTHOR, universe->meta_solvent_author);
   printf(TEXT_INFO_COMMENT, universe->meta_solvent_comment);
@@ -635,6 +1462,13 @@ universe_t *universe_parameters_print(universe_t *universe, const args_t *args)
 
   puts(TEXT_INFO_SIMULATION);
   printf(TEXT_INFO_SUBSTRATE_COPIES, universe->copy_nb);
+  printf(TEXT_INFO_LATTICE, (universe->populate_mode == POPULATE_MODE_SC)     ? LATTICE_SC :
+                            (universe->populate_mode == POPULATE_MODE_FCC)    ? LATTICE_FCC :
+                            (universe->populate_mode == POPULATE_MODE_JITTER) ? LATTICE_JITTER : LATTICE_RANDOM);
+  printf(TEXT_INFO_SOLVENT_COPIES, universe->solvent_copy_nb);
+  printf(TEXT_INFO_OUT_BUFFERS, args->out_buffers);
+  printf(TEXT_INFO_FORMAT, (universe->output_format == OUTPUT_FORMAT_DCD) ? FORMAT_DCD :
+                           (universe->output_format == OUTPUT_FORMAT_STC) ? FORMAT_STC : FORMAT_XYZ);
   printf(TEXT_INFO_ATOM_NB, universe->atom_nb);
   printf(TEXT_INFO_TEMPERATURE, universe->temperature);
   printf(TEXT_INFO_PRESSURE, args->pressure/1E2);
@@ -643,6 +1477,34 @@ universe_t *universe_parameters_print(universe_t *universe, const args_t *args)
   printf(TEXT_INFO_SIMULATION_TIME, args->max_time);
   printf(TEXT_INFO_TIMESTEP, args->timestep);
   printf(TEXT_INFO_FRAMESKIP, args->frameskip);
+  for (i=0; i<(universe->group_nb); ++i)
+  {
+    printf(TEXT_INFO_GROUP, args->group_selection[i], universe->group[i].atom_nb, universe->group[i].every, args->group_path[i]);
+  }
+  if (args->path_thermo != ARGS_PATH_THERMO_DEFAULT)
+  {
+    printf(TEXT_INFO_THERMO, args->path_thermo, args->thermo_every);
+  }
+  if (args->reorder != ARGS_REORDER_DEFAULT)
+  {
+    printf(TEXT_INFO_REORDER, args->reorder);
+  }
+  if (universe->stream != UNIVERSE_STREAM_DEFAULT)
+  {
+    printf(TEXT_INFO_SHM, universe->stream->name, universe->stream->every);
+  }
+  if (universe->cutoff != UNIVERSE_CUTOFF_DEFAULT)
+  {
+    printf(TEXT_INFO_CUTOFF, universe->cutoff);
+  }
+  if (domain_rank_nb() > 1)
+  {
+    printf(TEXT_INFO_PROCESSES, domain_rank_nb());
+  }
+  if (args->pin == PIN_MODE_NONE)
+    printf(TEXT_INFO_THREADS, omp_get_max_threads());
+  else
+    printf(TEXT_INFO_THREADS_PINNED, omp_get_max_threads(), (args->pin == PIN_MODE_COMPACT) ? PIN_COMPACT : PIN_SCATTER);
   printf(TEXT_INFO_ITERATIONS, (long)floor(args->max_time/args->timestep));
 
   return (universe);
@@ -78,18 +78,18 @@ vec3_t *vec3_unit(vec3_t *dest, const vec3_t *v)
   return (dest);
 }
 
-/* Generate a random vector from the unit sphere*/
+/* Generate a random vector from the unit sphere, drawing from rng */
 /* Method from Marsaglia, 1972 */
-vec3_t *vec3_marsaglia(vec3_t *v)
+vec3_t *vec3_marsaglia(vec3_t *v, rng_t *rng)
 {
   double x1;
   double x2;
 
   do
   {
-    x1 = cos(rand());
-    x2 = cos(rand());
-  } while ((x1*x1)+(x2*x2) > 1);
+    x1 = 2*rng_uniform(rng) - 1;
+    x2 = 2*rng_uniform(rng) - 1;
+  } while ((x1*x1)+(x2*x2) >= 1);
 
   v->x = 2*x1*sqrt(1-(x1*x1)-(x2*x2));
   v->y = 2*x2*sqrt(1-(x1*x1)-(x2*x2));
@@ -133,9 +133,14 @@ double vec3_mag(const vec3_t *v)
 /* Apply a transformation matrix to a vector */
 mat3_t *mat3_transform_apply(mat3_t *m, vec3_t *v)
 {
-  v->x = ((m->x0)*(v->x)) + ((m->y0)*(v->y)) + ((m->z0)*(v->z));
-  v->y = ((m->x1)*(v->x)) + ((m->y1)*(v->y)) + ((m->z1)*(v->z));
-  v->z = ((m->x2)*(v->x)) + ((m->y2)*(v->y)) + ((m->z2)*(v->z));
+  vec3_t tmp;
+
+  /* Work on a copy, v is both the input and the output */
+  tmp = *v;
+
+  v->x = ((m->x0)*(tmp.x)) + ((m->y0)*(tmp.y)) + ((m->z0)*(tmp.z));
+  v->y = ((m->x1)*(tmp.x)) + ((m->y1)*(tmp.y)) + ((m->z1)*(tmp.z));
+  v->z = ((m->x2)*(tmp.x)) + ((m->y2)*(tmp.y)) + ((m->z2)*(tmp.z));
 
   return (m);
 }
@@ -165,3 +170,15 @@ mat3_t *mat3_transform_gen_rot(mat3_t *m, vec3_t *axis, const double angle)
 
     return (m);
 }
+
+/* Generates a rotation transform matrix around a random axis */
+mat3_t *mat3_transform_gen_rand_rot(mat3_t *m, const double max_angle, rng_t *rng)
+{
+  vec3_t axis;
+  double angle;
+
+  vec3_marsaglia(&axis, rng);
+  angle = max_angle * rng_uniform(rng);
+
+  return (mat3_transform_gen_rot(m, &axis, angle));
+}
@@ -0,0 +1,259 @@
+/*
+ * writer.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "writer.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+#include "group.h"
+#include "stream.h"
+#include "reorder.h"
+
+/* I/O thread: write the filled slots in order until told to stop */
+static void *writer_run(void *arg)
+{
+  writer_t *writer;
+  writer_slot_t *slot;
+
+  writer = (writer_t*) arg;
+
+  pthread_mutex_lock(&(writer->lock));
+  while (1)
+  {
+    while (writer->pending == 0 && !(writer->stop))
+    {
+      pthread_cond_wait(&(writer->cond), &(writer->lock));
+    }
+    if (writer->pending == 0)
+    {
+      break;
+    }
+    slot = &(writer->slot[writer->tail]);
+    pthread_mutex_unlock(&(writer->lock));
+
+    /* The slot can't be refilled until it's released, no need to hold the lock */
+    writer->view.atom = slot->atom;
+    writer->view.iterations = slot->iterations;
+    writer->view.size = slot->size;
+    if ((slot->main && universe_printstate(&(writer->view)) == NULL) ||
+        group_printstate(&(writer->view)) == NULL ||
+        stream_publish(&(writer->view)) == NULL)
+    {
+      pthread_mutex_lock(&(writer->lock));
+      writer->err = 1;
+      pthread_mutex_unlock(&(writer->lock));
+    }
+
+    /* Release the slot */
+    pthread_mutex_lock(&(writer->lock));
+    writer->tail = (writer->tail + 1) % (writer->slot_nb);
+    --(writer->pending);
+    pthread_cond_broadcast(&(writer->cond));
+  }
+  pthread_mutex_unlock(&(writer->lock));
+
+  return (NULL);
+}
+
+/* Allocate the slots and start the I/O thread */
+writer_t *writer_init(writer_t *writer, universe_t *universe, const uint64_t slot_nb)
+{
+  size_t i;
+
+  writer->slot = WRITER_SLOT_DEFAULT;
+  writer->slot_nb = WRITER_SLOT_NB_DEFAULT;
+  writer->head = WRITER_HEAD_DEFAULT;
+  writer->tail = WRITER_TAIL_DEFAULT;
+  writer->pending = WRITER_PENDING_DEFAULT;
+  writer->stop = WRITER_STOP_DEFAULT;
+  writer->err = WRITER_ERR_DEFAULT;
+  writer->wait_time = WRITER_WAIT_TIME_DEFAULT;
+  writer->wait_nb = WRITER_WAIT_NB_DEFAULT;
+
+  /* Without slots, everything is written from the simulation thread */
+  if (slot_nb == 0)
+  {
+    return (writer);
+  }
+
+  if ((writer->slot = malloc(sizeof(writer_slot_t) * slot_nb)) == NULL)
+  {
+    return (retstr(NULL, TEXT_WRITER_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  for (i=0; i<slot_nb; ++i)
+  {
+    writer->slot[i].atom = WRITER_SLOT_ATOM_DEFAULT;
+    writer->slot[i].iterations = WRITER_SLOT_ITERATIONS_DEFAULT;
+    writer->slot[i].size = WRITER_SLOT_SIZE_DEFAULT;
+    writer->slot[i].main = WRITER_SLOT_MAIN_DEFAULT;
+  }
+  writer->slot_nb = slot_nb;
+  for (i=0; i<slot_nb; ++i)
+  {
+    if ((writer->slot[i].atom = malloc(sizeof(atom_t) * (universe->atom_nb))) == NULL)
+    {
+      return (retstr(NULL, TEXT_WRITER_INIT_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  /* The I/O thread owns the output file from now on */
+  writer->view = *universe;
+
+  if (pthread_mutex_init(&(writer->lock), NULL) ||
+      pthread_cond_init(&(writer->cond), NULL) ||
+      pthread_create(&(writer->thread), NULL, writer_run, writer))
+  {
+    return (retstr(NULL, TEXT_WRITER_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (writer);
+}
+
+/* Hand the current state over to the I/O thread
+ * Groups and the live stream, when due, take their frame from the same snapshot.
+ */
+writer_t *writer_push(writer_t *writer, universe_t *universe, const int main)
+{
+  writer_slot_t *slot;
+  double wait_start;
+  uint64_t i;
+
+  if (writer->slot_nb == 0)
+  {
+    if ((main && universe_printstate(universe) == NULL) ||
+        group_printstate(universe) == NULL ||
+        stream_publish(universe) == NULL)
+    {
+      return (retstr(NULL, TEXT_WRITER_PUSH_FAILURE, __FILE__, __LINE__));
+    }
+    return (writer);
+  }
+
+  /* Wait for a free slot, if none is */
+  pthread_mutex_lock(&(writer->lock));
+  if (writer->pending == writer->slot_nb)
+  {
+    wait_start = omp_get_wtime();
+    while (writer->pending == writer->slot_nb)
+    {
+      pthread_cond_wait(&(writer->cond), &(writer->lock));
+    }
+    writer->wait_time += omp_get_wtime() - wait_start;
+    ++(writer->wait_nb);
+  }
+  if (writer->err)
+  {
+    pthread_mutex_unlock(&(writer->lock));
+    return (retstr(NULL, TEXT_WRITER_PUSH_FAILURE, __FILE__, __LINE__));
+  }
+  slot = &(writer->slot[writer->head]);
+  pthread_mutex_unlock(&(writer->lock));
+
+  /* Take the snapshot, with the atoms back in their input order if they were sorted */
+  if (universe->reorder == NULL)
+  {
+    memcpy(slot->atom, universe->atom, sizeof(atom_t) * (universe->atom_nb));
+  }
+  else
+  {
+#pragma omp parallel for schedule(static)
+    for (i=0; i<(universe->atom_nb); ++i)
+    {
+      slot->atom[universe->reorder->order[i]] = universe->atom[i];
+    }
+  }
+  slot->iterations = universe->iterations;
+  slot->size = universe->size;
+  slot->main = main;
+
+  /* And let the I/O thread know */
+  pthread_mutex_lock(&(writer->lock));
+  writer->head = (writer->head + 1) % (writer->slot_nb);
+  ++(writer->pending);
+  pthread_cond_broadcast(&(writer->cond));
+  pthread_mutex_unlock(&(writer->lock));
+
+  return (writer);
+}
+
+/* Wait for every pushed snapshot to be written and flush the trajectory
+ * The I/O thread stays idle until the next push, the output file can be used.
+ */
+writer_t *writer_sync(writer_t *writer, universe_t *universe)
+{
+  int err;
+
+  err = 0;
+  if (writer->slot_nb)
+  {
+    pthread_mutex_lock(&(writer->lock));
+    while (writer->pending)
+    {
+      pthread_cond_wait(&(writer->cond), &(writer->lock));
+    }
+    universe->frame_nb = writer->view.frame_nb;
+    err = writer->err;
+    pthread_mutex_unlock(&(writer->lock));
+  }
+
+  /* Frames are written straight to the descriptor by some formats */
+  if (err || fflush(universe->file_output) || fsync(fileno(universe->file_output)) ||
+      fflush(universe->file_index) || fsync(fileno(universe->file_index)) ||
+      group_flush(universe) == NULL)
+  {
+    return (retstr(NULL, TEXT_WRITER_SYNC_FAILURE, __FILE__, __LINE__));
+  }
+  universe->output_offset = (uint64_t) lseek(fileno(universe->file_output), 0, SEEK_CUR);
+
+  return (writer);
+}
+
+/* Write whatever is left, stop the I/O thread and free the slots */
+writer_t *writer_clean(writer_t *writer, universe_t *universe)
+{
+  size_t i;
+  int err;
+
+  if (writer->slot_nb == 0)
+  {
+    return (writer);
+  }
+
+  pthread_mutex_lock(&(writer->lock));
+  writer->stop = 1;
+  pthread_cond_broadcast(&(writer->cond));
+  pthread_mutex_unlock(&(writer->lock));
+  pthread_join(writer->thread, NULL);
+
+  /* Hand the output file state back to the universe */
+  universe->frame_nb = writer->view.frame_nb;
+  err = writer->err;
+
+  pthread_mutex_destroy(&(writer->lock));
+  pthread_cond_destroy(&(writer->cond));
+  for (i=0; i<(writer->slot_nb); ++i)
+  {
+    free(writer->slot[i].atom);
+  }
+  free(writer->slot);
+  writer->slot = WRITER_SLOT_DEFAULT;
+  writer->slot_nb = WRITER_SLOT_NB_DEFAULT;
+
+  if (err)
+  {
+    return (retstr(NULL, TEXT_WRITER_CLEAN_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (writer);
+}
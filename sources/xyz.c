@@ -0,0 +1,205 @@
+/*
+ * xyz.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <errno.h>
+#include <float.h>
+
+#include "config.h"
+#include "xyz.h"
+#include "text.h"
+#include "util.h"
+#include "universe.h"
+
+/* Write x the way printf("%lf") does, returns the number of characters */
+size_t xyz_format_double(char *out, const double x)
+{
+  double scaled;
+  double rounded;
+  double margin;
+  uint64_t fixed;
+  uint64_t integer;
+  uint64_t fraction;
+  char digits[24];
+  size_t len;
+  size_t i;
+  int ret;
+
+  scaled = fabs(x) * 1E6;
+
+  /* The product is off by half an ulp at most: unless it lies that close to
+   * a rounding tie, rounding it gives the same digits as printf would.
+   */
+  rounded = floor(scaled + 0.5);
+  margin = scaled * 4.0 * DBL_EPSILON;
+  if (!(scaled < XYZ_FAST_MAX) || fabs(scaled - floor(scaled) - 0.5) <= margin)
+  {
+    /* Past 1E22 Å the digits don't fit the field, they are cut there */
+    ret = snprintf(out, XYZ_FIELD_MAX, "%lf", x);
+    if (ret < 0)
+    {
+      return (0);
+    }
+    if ((size_t) ret > XYZ_FIELD_MAX - 1)
+    {
+      return (XYZ_FIELD_MAX - 1);
+    }
+    return ((size_t) ret);
+  }
+
+  /* Ties aside, printf rounds to nearest */
+  fixed = (uint64_t) rounded;
+  integer = fixed / 1000000;
+  fraction = fixed % 1000000;
+
+  len = 0;
+  if (signbit(x))
+  {
+    out[len++] = '-';
+  }
+
+  i = 0;
+  do
+  {
+    digits[i++] = (char) ('0' + integer % 10);
+    integer /= 10;
+  } while (integer);
+  while (i)
+  {
+    out[len++] = digits[--i];
+  }
+
+  out[len++] = '.';
+  for (i=6; i; --i)
+  {
+    out[len + i - 1] = (char) ('0' + fraction % 10);
+    fraction /= 10;
+  }
+  len += 6;
+
+  return (len);
+}
+
+/* Allocate the frame buffer, once the atoms are known */
+universe_t *xyz_init(universe_t *universe)
+{
+  size_t i;
+  size_t len;
+  size_t symbol_max;
+
+  symbol_max = 0;
+  for (i=0; i<(universe->model.entry_nb); ++i)
+  {
+    len = strlen(universe->model.entry[i].symbol);
+    if (len > symbol_max)
+    {
+      symbol_max = len;
+    }
+  }
+
+  /* symbol, tab, x, tab, y, tab, z, newline */
+  universe->output_line_max = symbol_max + 3*XYZ_FIELD_MAX + 4;
+  universe->output_chunk_nb = (universe->atom_nb + XYZ_CHUNK_ATOMS - 1) / XYZ_CHUNK_ATOMS;
+
+  if ((universe->output_buffer = malloc(XYZ_HEADER_MAX + (universe->atom_nb) * (universe->output_line_max))) == NULL)
+  {
+    return (retstr(NULL, TEXT_XYZ_INIT_FAILURE, __FILE__, __LINE__));
+  }
+  if ((universe->output_chunk_len = malloc(sizeof(size_t) * (universe->output_chunk_nb + 1))) == NULL)
+  {
+    return (retstr(NULL, TEXT_XYZ_INIT_FAILURE, __FILE__, __LINE__));
+  }
+
+  return (universe);
+}
+
+/* Format the current state and write it at once */
+universe_t *xyz_frame(universe_t *universe)
+{
+  int64_t c;
+  size_t len;
+  size_t written;
+  ssize_t ret;
+  char header[XYZ_HEADER_MAX];
+  char *start;
+  char *end;
+
+  /* Each chunk formats its atoms in its own region of the buffer */
+#pragma omp parallel for schedule(dynamic)
+  for (c=0; c<(int64_t)(universe->output_chunk_nb); ++c)
+  {
+    size_t i;
+    size_t last;
+    const char *symbol;
+    char *cursor;
+
+    cursor = universe->output_buffer + XYZ_HEADER_MAX + c*XYZ_CHUNK_ATOMS*(universe->output_line_max);
+    last = (size_t) (c+1)*XYZ_CHUNK_ATOMS;
+    if (last > universe->atom_nb)
+    {
+      last = universe->atom_nb;
+    }
+
+    for (i=c*XYZ_CHUNK_ATOMS; i<last; ++i)
+    {
+      symbol = universe->model.entry[universe->atom[i].element].symbol;
+      while (*symbol)
+      {
+        *(cursor++) = *(symbol++);
+      }
+      *(cursor++) = '\t';
+      cursor += xyz_format_double(cursor, universe->atom[i].pos.x*1E10);
+      *(cursor++) = '\t';
+      cursor += xyz_format_double(cursor, universe->atom[i].pos.y*1E10);
+      *(cursor++) = '\t';
+      cursor += xyz_format_double(cursor, universe->atom[i].pos.z*1E10);
+      *(cursor++) = '\n';
+    }
+
+    universe->output_chunk_len[c] = (size_t) (cursor - (universe->output_buffer + XYZ_HEADER_MAX + c*XYZ_CHUNK_ATOMS*(universe->output_line_max)));
+  }
+
+  /* The header goes right before the first chunk */
+  len = (size_t) snprintf(header, XYZ_HEADER_MAX, "%ld\n%ld\n", universe->atom_nb, universe->iterations);
+  start = universe->output_buffer + XYZ_HEADER_MAX - len;
+  memcpy(start, header, len);
+
+  /* Close the gaps between the chunks */
+  end = universe->output_buffer + XYZ_HEADER_MAX;
+  for (c=0; c<(int64_t)(universe->output_chunk_nb); ++c)
+  {
+    memmove(end, universe->output_buffer + XYZ_HEADER_MAX + c*XYZ_CHUNK_ATOMS*(universe->output_line_max), universe->output_chunk_len[c]);
+    end += universe->output_chunk_len[c];
+  }
+
+  /* One write for the whole frame, after whatever the stream still holds */
+  if (fflush(universe->file_output))
+  {
+    return (retstr(NULL, TEXT_XYZ_FRAME_FAILURE, __FILE__, __LINE__));
+  }
+  for (written=0; written<(size_t)(end - start); written+=(size_t)ret)
+  {
+    if ((ret = write(fileno(universe->file_output), start + written, (size_t)(end - start) - written)) < 0)
+    {
+      if (errno == EINTR)
+      {
+        ret = 0;
+        continue;
+      }
+      return (retstr(NULL, TEXT_XYZ_FRAME_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  ++(universe->frame_nb);
+
+  return (universe);
+}
@@ -0,0 +1,89 @@
+#include <criterion/criterion.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "frames.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+#define FRAMES_TEST_PATH "/tmp/senpai_test_frames.xyz"
+
+static char frames_test_path[] = FRAMES_TEST_PATH;
+
+/* Write a trajectory of frames of varying sizes, indexed as senpai does */
+static void write_trajectory(const size_t frame_nb)
+{
+    universe_t universe;
+    args_t args;
+    size_t i;
+
+    args_init(&args);
+    args.path_out = frames_test_path;
+    universe.file_output = fopen(FRAMES_TEST_PATH, "wb");
+    universe.output_format = OUTPUT_FORMAT_XYZ;
+    universe.frame_nb = 0;
+    frames_open(&universe, &args);
+
+    fputs("header\n", universe.file_output);
+    for (i=0; i < frame_nb; ++i)
+    {
+        universe.iterations = 10*i;
+        frames_append(&universe);
+        fprintf(universe.file_output, "frame %ld %.*s\n", i, (int) i, "xxxxxxxxxxxxxxxxxxxx");
+    }
+
+    fclose(universe.file_index);
+    fclose(universe.file_output);
+}
+
+/* FRAMES_T */
+Test(frames, random_access)
+{
+    frames_t frames;
+    uint64_t offset;
+    uint64_t len;
+    char expected[64];
+    char buf[64];
+
+    write_trajectory(20);
+    cr_assert_not_null(frames_init(&frames, FRAMES_TEST_PATH));
+    cr_assert_eq(frames.frame_nb, 20);
+    cr_assert_eq(frames.format, OUTPUT_FORMAT_XYZ);
+    cr_assert_eq(frames.entry[0].offset, strlen("header\n"));
+    cr_assert_eq(frames.entry[13].iteration, 130);
+
+    /* Any frame, in any order */
+    cr_assert_not_null(frames_span(&frames, 17, &offset, &len));
+    snprintf(expected, sizeof(expected), "frame 17 %.*s\n", 17, "xxxxxxxxxxxxxxxxxxxx");
+    cr_assert_eq(len, strlen(expected));
+    fseek(frames.file, (long) offset, SEEK_SET);
+    cr_assert_eq(fread(buf, 1, len, frames.file), len);
+    cr_assert_arr_eq(buf, expected, len);
+
+    cr_assert_not_null(frames_span(&frames, 19, &offset, &len));
+    cr_assert_eq(offset + len, frames.file_len);
+    cr_assert_null(frames_span(&frames, 20, &offset, &len));
+
+    frames_clean(&frames);
+}
+
+Test(frames, truncated_trajectory)
+{
+    frames_t frames;
+    FILE *file;
+
+    /* The last frame was indexed, but never made it to the trajectory */
+    write_trajectory(5);
+    cr_assert_not_null(frames_init(&frames, FRAMES_TEST_PATH));
+    file = fopen(FRAMES_TEST_PATH, "r+b");
+    cr_assert_eq(ftruncate(fileno(file), (off_t) frames.entry[4].offset), 0);
+    fclose(file);
+    frames_clean(&frames);
+
+    cr_assert_not_null(frames_init(&frames, FRAMES_TEST_PATH));
+    cr_assert_eq(frames.frame_nb, 4);
+    frames_clean(&frames);
+}
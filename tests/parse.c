@@ -0,0 +1,144 @@
+#include <criterion/criterion.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parse.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+/* Parse str with both the tokenizer and strtod, and compare bit for bit */
+static int same_as_strtod(const char *str)
+{
+    double fast;
+    double ref;
+    char *end;
+    size_t used;
+
+    used = parser_strtod(str, strlen(str), &fast);
+    ref = strtod(str, &end);
+
+    return (used == (size_t) (end - str) && !memcmp(&fast, &ref, sizeof(double)));
+}
+
+/* PARSER_STRTOD */
+Test(parser_strtod, simple_values)
+{
+    cr_assert(same_as_strtod("0"));
+    cr_assert(same_as_strtod("-0.0"));
+    cr_assert(same_as_strtod("1"));
+    cr_assert(same_as_strtod("+0.41"));
+    cr_assert(same_as_strtod("-0.82"));
+    cr_assert(same_as_strtod("3.166"));
+    cr_assert(same_as_strtod(".5"));
+    cr_assert(same_as_strtod("5."));
+}
+
+Test(parser_strtod, exponents)
+{
+    cr_assert(same_as_strtod("1.6605E-27"));
+    cr_assert(same_as_strtod("64.84E-12"));
+    cr_assert(same_as_strtod("122E-12"));
+    cr_assert(same_as_strtod("8.9875517923E9"));
+    cr_assert(same_as_strtod("1e308"));
+    cr_assert(same_as_strtod("4.9e-324"));
+    cr_assert(same_as_strtod("2E"));
+    cr_assert(same_as_strtod("2E+"));
+}
+
+Test(parser_strtod, long_mantissas)
+{
+    cr_assert(same_as_strtod("3.14159265358979323846264338327950288"));
+    cr_assert(same_as_strtod("123456789012345678901234567890"));
+    cr_assert(same_as_strtod("0.000000000000000000000000001234567890123456789"));
+}
+
+Test(parser_strtod, random_coordinates)
+{
+    char str[64];
+    size_t i;
+
+    srand(1337);
+    for (i=0; i < 100000; ++i)
+    {
+        snprintf(str, sizeof(str), "%.*lf", (int) (i % 9), ((double) rand() / RAND_MAX - 0.5) * 1E4);
+        cr_assert(same_as_strtod(str));
+    }
+}
+
+Test(parser_strtod, not_a_number)
+{
+    double x;
+
+    cr_assert_eq(parser_strtod("", 0, &x), 0);
+    cr_assert_eq(parser_strtod("-", 1, &x), 0);
+    cr_assert_eq(parser_strtod(".", 1, &x), 0);
+    cr_assert_eq(parser_strtod("SENPAI", 6, &x), 0);
+}
+
+/* PARSER_T */
+Test(parser, lines_and_tokens)
+{
+    const char *buf = "Water\r\n 3 2 SENPAI\r\n  0.2774  -0.8929 18\r\n\r\n";
+    parser_t parser;
+    char *str;
+    uint64_t n;
+    double x;
+
+    parser_init(&parser, buf, strlen(buf), "test");
+
+    cr_assert_not_null(parser_text(&parser, &str));
+    cr_assert_str_eq(str, "Water");
+    free(str);
+
+    cr_assert_not_null(parser_uint(&parser, &n));
+    cr_assert_eq(n, 3);
+    cr_assert_not_null(parser_uint(&parser, &n));
+    cr_assert_eq(n, 2);
+    cr_assert_not_null(parser_word(&parser, &str));
+    cr_assert_str_eq(str, "SENPAI");
+    free(str);
+    parser_next_line(&parser);
+
+    cr_assert_not_null(parser_double(&parser, &x));
+    cr_assert_eq(x, 0.2774);
+    cr_assert_not_null(parser_double(&parser, &x));
+    cr_assert_eq(x, -0.8929);
+    cr_assert_not_null(parser_uint(&parser, &n));
+    cr_assert_eq(n, 18);
+    parser_next_line(&parser);
+
+    cr_assert(parser_eof(&parser));
+}
+
+Test(parser, error_position)
+{
+    const char *buf = "1.0 2.0\n3.0 4,0\n";
+    parser_t parser;
+    double x;
+
+    parser_init(&parser, buf, strlen(buf), "test");
+
+    cr_assert_not_null(parser_double(&parser, &x));
+    cr_assert_not_null(parser_double(&parser, &x));
+    parser_next_line(&parser);
+    cr_assert_not_null(parser_double(&parser, &x));
+    cr_assert_null(parser_double(&parser, &x));
+
+    cr_assert_eq(parser.line, 2);
+    cr_assert_eq(parser.token - parser.line_start + 1, 5);
+}
+
+Test(parser, unterminated_buffer)
+{
+    /* The mapping isn't NUL terminated, the tokenizer mustn't read past it */
+    const char buf[] = {'4', '2', '.', '5', '7'};
+    parser_t parser;
+    double x;
+
+    parser_init(&parser, buf, 4, "test");
+    cr_assert_not_null(parser_double(&parser, &x));
+    cr_assert_eq(x, 42.5);
+    cr_assert(parser_eof(&parser));
+}
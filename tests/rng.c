@@ -0,0 +1,123 @@
+#include <criterion/criterion.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "rng.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+#define DRAW_NB 10000
+
+/* RNG_PHILOX, against the Random123 known answers */
+Test(rng_philox, known_answers)
+{
+    const uint32_t ctr_zero[4] = {0, 0, 0, 0};
+    const uint32_t key_zero[2] = {0, 0};
+    const uint32_t ctr_ones[4] = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
+    const uint32_t key_ones[2] = {0xFFFFFFFF, 0xFFFFFFFF};
+    const uint32_t ctr_pi[4] = {0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344};
+    const uint32_t key_pi[2] = {0xA4093822, 0x299F31D0};
+    uint32_t word[4];
+
+    rng_philox(word, ctr_zero, key_zero);
+    cr_assert_eq(word[0], 0x6627E8D5);
+    cr_assert_eq(word[1], 0xE169C58D);
+    cr_assert_eq(word[2], 0xBC57AC4C);
+    cr_assert_eq(word[3], 0x9B00DBD8);
+
+    rng_philox(word, ctr_ones, key_ones);
+    cr_assert_eq(word[0], 0x408F276D);
+    cr_assert_eq(word[1], 0x41C83B0E);
+    cr_assert_eq(word[2], 0xA20BC7C6);
+    cr_assert_eq(word[3], 0x6D5451FD);
+
+    rng_philox(word, ctr_pi, key_pi);
+    cr_assert_eq(word[0], 0xD16CFE09);
+    cr_assert_eq(word[1], 0x94FDCCEB);
+    cr_assert_eq(word[2], 0x5001E420);
+    cr_assert_eq(word[3], 0x24126EA1);
+}
+
+/* RNG_INIT / RNG_UNIFORM */
+Test(rng_uniform, reproducible_and_in_range)
+{
+    rng_t rng_1;
+    rng_t rng_2;
+    double sum;
+    double u;
+    size_t i;
+
+    rng_init(&rng_1, 1337, 42, 7, RNG_PURPOSE_VELOCITY);
+    rng_init(&rng_2, 1337, 42, 7, RNG_PURPOSE_VELOCITY);
+    sum = 0.0;
+    for (i=0; i<DRAW_NB; ++i)
+    {
+        u = rng_uniform(&rng_1);
+        cr_assert_eq(u, rng_uniform(&rng_2));
+        cr_assert(u >= 0.0 && u < 1.0);
+        sum += u;
+    }
+    cr_assert_float_eq(sum / DRAW_NB, 0.5, 0.02);
+}
+
+Test(rng_uniform, streams_differ)
+{
+    rng_t rng_id;
+    rng_t rng_step;
+    rng_t rng_purpose;
+    rng_t rng;
+    uint32_t word;
+    uint32_t word_id;
+    uint32_t word_step;
+    uint32_t word_purpose;
+
+    rng_init(&rng, 1337, 42, 7, RNG_PURPOSE_VELOCITY);
+    rng_init(&rng_id, 1337, 43, 7, RNG_PURPOSE_VELOCITY);
+    rng_init(&rng_step, 1337, 42, 8, RNG_PURPOSE_VELOCITY);
+    rng_init(&rng_purpose, 1337, 42, 7, RNG_PURPOSE_COARSE);
+
+    /* The first word of each stream, drawn once */
+    word = rng_u32(&rng);
+    word_id = rng_u32(&rng_id);
+    word_step = rng_u32(&rng_step);
+    word_purpose = rng_u32(&rng_purpose);
+
+    cr_assert_neq(word, word_id);
+    cr_assert_neq(word, word_step);
+    cr_assert_neq(word, word_purpose);
+}
+
+/* RNG_GAUSSIAN_BATCH */
+Test(rng_gaussian_batch, moments)
+{
+    static double dest[DRAW_NB];
+    double mean;
+    double var;
+    size_t i;
+
+    rng_gaussian_batch(dest, DRAW_NB, 0, 1337, 0, 0, RNG_PURPOSE_VELOCITY);
+    mean = 0.0;
+    for (i=0; i<DRAW_NB; ++i)
+        mean += dest[i];
+    mean /= DRAW_NB;
+    var = 0.0;
+    for (i=0; i<DRAW_NB; ++i)
+        var += (dest[i] - mean) * (dest[i] - mean);
+    var /= DRAW_NB;
+
+    cr_assert_float_eq(mean, 0.0, 0.05);
+    cr_assert_float_eq(var, 1.0, 0.05);
+}
+
+Test(rng_gaussian_batch, split_matches_whole)
+{
+    double whole[64];
+    double split[64];
+
+    rng_gaussian_batch(whole, 64, 0, 1337, 3, 5, RNG_PURPOSE_VELOCITY);
+    rng_gaussian_batch(split, 21, 0, 1337, 3, 5, RNG_PURPOSE_VELOCITY);
+    rng_gaussian_batch(split + 21, 43, 21, 1337, 3, 5, RNG_PURPOSE_VELOCITY);
+
+    cr_assert_arr_eq(whole, split, sizeof(whole));
+}
@@ -0,0 +1,118 @@
+#include <criterion/criterion.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "stc.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+#define ATOM_NB 100
+
+/* Random coordinates (Å) within a box of the given side */
+static void fill_random(double *coord, const size_t nb, const double size)
+{
+    size_t i;
+
+    srand(1337);
+    for (i=0; i<3*nb; ++i)
+        coord[i] = size * ((double) rand() / RAND_MAX - 0.5);
+}
+
+/* STC_FRAME_ENCODE / STC_FRAME_DECODE */
+Test(stc_frame, round_trip_within_precision)
+{
+    double coord[3*ATOM_NB];
+    double decoded[3*ATOM_NB];
+    uint8_t payload[stc_frame_bound(ATOM_NB)];
+    size_t len;
+    size_t i;
+
+    fill_random(coord, ATOM_NB, 50.0);
+
+    cr_assert_not_null(stc_frame_encode(payload, &len, coord, ATOM_NB, 1E-2));
+    cr_assert_leq(len, stc_frame_bound(ATOM_NB));
+    cr_assert_not_null(stc_frame_decode(decoded, payload, len, ATOM_NB, 1E-2));
+
+    for (i=0; i<3*ATOM_NB; ++i)
+        cr_assert_float_eq(decoded[i], coord[i], 0.5E-2 + 1E-9);
+}
+
+Test(stc_frame, round_trip_is_exact_on_the_grid)
+{
+    double coord[3*ATOM_NB];
+    double decoded[3*ATOM_NB];
+    uint8_t payload[stc_frame_bound(ATOM_NB)];
+    size_t len;
+    size_t i;
+
+    for (i=0; i<3*ATOM_NB; ++i)
+        coord[i] = ((double) i - 150.0) * 0.25;
+
+    cr_assert_not_null(stc_frame_encode(payload, &len, coord, ATOM_NB, 0.25));
+    cr_assert_not_null(stc_frame_decode(decoded, payload, len, ATOM_NB, 0.25));
+
+    for (i=0; i<3*ATOM_NB; ++i)
+        cr_assert_float_eq(decoded[i], coord[i], 1E-12);
+}
+
+Test(stc_frame, partial_block)
+{
+    double coord[3*(STC_BLOCK + 3)];
+    double decoded[3*(STC_BLOCK + 3)];
+    uint8_t payload[stc_frame_bound(STC_BLOCK + 3)];
+    size_t len;
+    size_t i;
+
+    fill_random(coord, STC_BLOCK + 3, 20.0);
+
+    cr_assert_not_null(stc_frame_encode(payload, &len, coord, STC_BLOCK + 3, 1E-3));
+    cr_assert_not_null(stc_frame_decode(decoded, payload, len, STC_BLOCK + 3, 1E-3));
+
+    for (i=0; i<3*(STC_BLOCK + 3); ++i)
+        cr_assert_float_eq(decoded[i], coord[i], 0.5E-3 + 1E-9);
+}
+
+Test(stc_frame, neighbours_compress)
+{
+    double coord[3*ATOM_NB];
+    uint8_t payload[stc_frame_bound(ATOM_NB)];
+    size_t len;
+    size_t i;
+
+    /* Neighbouring atoms about 1 Å apart, as in a molecule */
+    for (i=0; i<ATOM_NB; ++i)
+    {
+        coord[3*i]     = 10.0 + 0.9 * i;
+        coord[3*i + 1] = -5.0 + 0.1 * (i % 7);
+        coord[3*i + 2] = 0.5 * (i % 3);
+    }
+
+    cr_assert_not_null(stc_frame_encode(payload, &len, coord, ATOM_NB, 1E-2));
+
+    /* At least 3 times smaller than single precision floats */
+    cr_assert_lt(len, 3*sizeof(float)*ATOM_NB / 3);
+}
+
+Test(stc_frame, out_of_range)
+{
+    double coord[3] = {1E12, 0.0, 0.0};
+    uint8_t payload[stc_frame_bound(1)];
+    size_t len;
+
+    cr_assert_null(stc_frame_encode(payload, &len, coord, 1, 1E-2));
+}
+
+Test(stc_frame, truncated_payload)
+{
+    double coord[3*ATOM_NB];
+    double decoded[3*ATOM_NB];
+    uint8_t payload[stc_frame_bound(ATOM_NB)];
+    size_t len;
+
+    fill_random(coord, ATOM_NB, 50.0);
+
+    cr_assert_not_null(stc_frame_encode(payload, &len, coord, ATOM_NB, 1E-2));
+    cr_assert_null(stc_frame_decode(decoded, payload, len/2, ATOM_NB, 1E-2));
+}
@@ -0,0 +1,128 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stream.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+#define STREAM_TEST_NAME "senpai_test_stream"
+#define STREAM_TEST_RING_NAME "senpai_test_stream_ring"
+#define STREAM_TEST_ATOM_NB 3
+
+static char stream_test_name[] = STREAM_TEST_NAME;
+static char stream_test_ring_name[] = STREAM_TEST_RING_NAME;
+static char stream_test_oxygen[] = "O";
+static char stream_test_hydrogen[] = "H";
+
+/* A water molecule, published every other iteration */
+static void stream_test_universe(universe_t *universe, atom_t *atom, model_entry_t *entry, args_t *args)
+{
+    size_t i;
+
+    args_init(args);
+    args->path_shm = stream_test_name;
+    args->shm_every = 2;
+
+    memset(entry, 0, 2*sizeof(model_entry_t));
+    entry[0].symbol = stream_test_oxygen;
+    entry[1].symbol = stream_test_hydrogen;
+
+    memset(atom, 0, STREAM_TEST_ATOM_NB*sizeof(atom_t));
+    for (i=0; i<STREAM_TEST_ATOM_NB; ++i)
+    {
+        atom[i].element = (i > 0);
+        atom[i].pos.x = i*1E-10;
+        atom[i].pos.y = -1E-10;
+        atom[i].pos.z = 0.5E-10;
+    }
+
+    universe->atom = atom;
+    universe->atom_nb = STREAM_TEST_ATOM_NB;
+    universe->model.entry = entry;
+    universe->model.entry_nb = 2;
+    universe->iterations = 0;
+    universe->size = 1E-9;
+    universe->stream = UNIVERSE_STREAM_DEFAULT;
+}
+
+/* STREAM_PUBLISH / STREAM_READ_BEGIN */
+Test(stream, publish_and_read)
+{
+    universe_t universe;
+    atom_t atom[STREAM_TEST_ATOM_NB];
+    model_entry_t entry[2];
+    args_t args;
+    stream_t stream;
+    const double *coord;
+    uint64_t iteration;
+    double box;
+
+    stream_test_universe(&universe, atom, entry, &args);
+    cr_assert_not_null(stream_open(&universe, &args));
+    cr_assert_not_null(stream_attach(&stream, STREAM_TEST_NAME));
+    cr_assert_eq(stream_header(&stream)->atom_nb, STREAM_TEST_ATOM_NB);
+    cr_assert_eq(stream_frame_nb(&stream), 0);
+    cr_assert_arr_eq(stream_symbol(&stream, 0), "O", 2);
+    cr_assert_arr_eq(stream_symbol(&stream, 2), "H", 2);
+
+    /* Only even iterations are published */
+    for (universe.iterations=0; universe.iterations<5; ++(universe.iterations))
+    {
+        cr_assert_not_null(stream_publish(&universe));
+    }
+    cr_assert_eq(stream_frame_nb(&stream), 3);
+
+    coord = stream_read_begin(&stream, 2, &iteration, &box);
+    cr_assert_not_null(coord);
+    cr_assert_eq(iteration, 4);
+    cr_assert_float_eq(box, 10.0, 1E-9);
+    cr_assert_float_eq(coord[3], 1.0, 1E-9);
+    cr_assert_float_eq(coord[7], -1.0, 1E-9);
+    cr_assert(stream_read_end(&stream, 2));
+
+    /* Not published yet */
+    cr_assert_null(stream_read_begin(&stream, 3, &iteration, &box));
+
+    cr_assert(!stream_ended(&stream));
+    stream_close(&universe);
+    cr_assert(stream_ended(&stream));
+    stream_detach(&stream);
+}
+
+Test(stream, overwritten_frames_are_dropped)
+{
+    universe_t universe;
+    atom_t atom[STREAM_TEST_ATOM_NB];
+    model_entry_t entry[2];
+    args_t args;
+    stream_t stream;
+    uint64_t iteration;
+    double box;
+
+    stream_test_universe(&universe, atom, entry, &args);
+    args.path_shm = stream_test_ring_name;
+    args.shm_every = 1;
+    cr_assert_not_null(stream_open(&universe, &args));
+    cr_assert_not_null(stream_attach(&stream, STREAM_TEST_RING_NAME));
+
+    /* A reader caught in the middle of frame 0 while the ring goes around */
+    cr_assert_not_null(stream_publish(&universe));
+    cr_assert_not_null(stream_read_begin(&stream, 0, &iteration, &box));
+    for (universe.iterations=1; universe.iterations<=STREAM_SLOT_NB; ++(universe.iterations))
+    {
+        cr_assert_not_null(stream_publish(&universe));
+    }
+    cr_assert(!stream_read_end(&stream, 0));
+    cr_assert_null(stream_read_begin(&stream, 0, &iteration, &box));
+
+    /* The latest are still there */
+    cr_assert_not_null(stream_read_begin(&stream, STREAM_SLOT_NB, &iteration, &box));
+    cr_assert_eq(iteration, STREAM_SLOT_NB);
+    cr_assert(stream_read_end(&stream, STREAM_SLOT_NB));
+
+    stream_close(&universe);
+    stream_detach(&stream);
+}
@@ -0,0 +1,131 @@
+#include <criterion/criterion.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tile.h"
+#include "force.h"
+#include "rng.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+#define TILE_TEST_SIDE 7                  /* Molecules along an axis */
+#define TILE_TEST_SPACING 3E-10           /* (m) Between two molecules */
+#define TILE_TEST_MOLECULE_NB (TILE_TEST_SIDE*TILE_TEST_SIDE*TILE_TEST_SIDE)
+#define TILE_TEST_ATOM_NB (3*TILE_TEST_MOLECULE_NB)
+
+static atom_t tile_test_atom[TILE_TEST_ATOM_NB];
+static uint64_t tile_test_bond[TILE_TEST_ATOM_NB][2];
+static double tile_test_strength[TILE_TEST_ATOM_NB][2];
+static vec3_t tile_test_reference[TILE_TEST_ATOM_NB];
+
+/* Water-like molecules on a jittered lattice, more than a few tiles of them */
+static void tile_test_universe(universe_t *universe, model_entry_t *entry, args_t *args, const double cutoff)
+{
+    const double offset[3][3] = {{0.0, 0.0, 0.0}, {0.96E-10, 0.0, 0.0}, {-0.24E-10, 0.93E-10, 0.0}};
+    rng_t rng;
+    uint64_t m;
+    uint64_t a;
+    uint64_t k;
+
+    args_init(args);
+    memset(universe, 0, sizeof(universe_t));
+    memset(entry, 0, 2*sizeof(model_entry_t));
+    entry[0].radius_covalent = 0.66E-10;
+    entry[0].bond_angle = 1.82;
+    entry[1].radius_covalent = 0.31E-10;
+    entry[1].bond_angle = 1.82;
+
+    memset(tile_test_atom, 0, sizeof(tile_test_atom));
+    for (m=0; m<TILE_TEST_MOLECULE_NB; ++m)
+    {
+        rng_init(&rng, 1337, m, 0, RNG_PURPOSE_JITTER);
+        for (k=0; k<3; ++k)
+        {
+            a = 3*m + k;
+            tile_test_atom[a].element = (k > 0);
+            tile_test_atom[a].charge = (k > 0) ? 0.41*C_ELEMCHARGE : -0.82*C_ELEMCHARGE;
+            tile_test_atom[a].epsilon = (k > 0) ? 0.0 : 0.65;
+            tile_test_atom[a].sigma = (k > 0) ? 0.0 : 3.17;
+            tile_test_atom[a].pos.x = (m % TILE_TEST_SIDE)*TILE_TEST_SPACING + offset[k][0] + 0.3E-10*rng_uniform(&rng);
+            tile_test_atom[a].pos.y = ((m / TILE_TEST_SIDE) % TILE_TEST_SIDE)*TILE_TEST_SPACING + offset[k][1] + 0.3E-10*rng_uniform(&rng);
+            tile_test_atom[a].pos.z = (m / (TILE_TEST_SIDE*TILE_TEST_SIDE))*TILE_TEST_SPACING + offset[k][2] + 0.3E-10*rng_uniform(&rng);
+            tile_test_atom[a].bond = tile_test_bond[a];
+            tile_test_atom[a].bond_strength = tile_test_strength[a];
+            tile_test_strength[a][0] = 500.0;
+            tile_test_strength[a][1] = 500.0;
+        }
+
+        /* The oxygen is bonded to both hydrogens */
+        tile_test_atom[3*m].bond_nb = 2;
+        tile_test_bond[3*m][0] = 3*m + 1;
+        tile_test_bond[3*m][1] = 3*m + 2;
+        tile_test_atom[3*m + 1].bond_nb = 1;
+        tile_test_bond[3*m + 1][0] = 3*m;
+        tile_test_atom[3*m + 2].bond_nb = 1;
+        tile_test_bond[3*m + 2][0] = 3*m;
+    }
+
+    universe->atom = tile_test_atom;
+    universe->atom_nb = TILE_TEST_ATOM_NB;
+    universe->model.entry = entry;
+    universe->size = TILE_TEST_SIDE*TILE_TEST_SPACING;
+    universe->cutoff = cutoff;
+}
+
+/* The tiles against force_total, atom after atom */
+static void tile_test_compare(const double cutoff)
+{
+    universe_t universe;
+    model_entry_t entry[2];
+    args_t args;
+    vec3_t diff;
+    uint64_t i;
+
+    tile_test_universe(&universe, entry, &args, cutoff);
+    cr_assert_gt(universe.atom_nb, 2*TILE_ATOM_NB);
+
+    for (i=0; i<TILE_TEST_ATOM_NB; ++i)
+    {
+        memset(&(tile_test_reference[i]), 0, sizeof(vec3_t));
+        cr_assert_not_null(force_total(&(tile_test_reference[i]), &universe, i));
+    }
+
+    cr_assert_not_null(tile_init(&universe, &args));
+    cr_assert_not_null(universe.tile);
+    cr_assert_not_null(tile_update_frc(&universe));
+
+    for (i=0; i<TILE_TEST_ATOM_NB; ++i)
+    {
+        vec3_sub(&diff, &(universe.atom[i].frc), &(tile_test_reference[i]));
+        cr_assert(vec3_mag(&diff) <= 1E-9*vec3_mag(&(tile_test_reference[i])) + 1E-20);
+    }
+
+    tile_clean(&universe);
+    cr_assert_null(universe.tile);
+}
+
+/* TILE_UPDATE_FRC */
+Test(tile_update_frc, matches_all_pairs)
+{
+    tile_test_compare(0.0);
+}
+
+Test(tile_update_frc, matches_all_pairs_cutoff)
+{
+    tile_test_compare(6E-10);
+}
+
+/* TILE_INIT */
+Test(tile_init, large_systems_keep_the_all_pairs_loop)
+{
+    universe_t universe;
+    model_entry_t entry[2];
+    args_t args;
+
+    tile_test_universe(&universe, entry, &args, 0.0);
+    universe.atom_nb = TILE_ATOM_MAX + 1;
+    cr_assert_not_null(tile_init(&universe, &args));
+    cr_assert_null(universe.tile);
+}
@@ -204,7 +204,9 @@ Test(vec3_unit, zero_vector)
 Test(vec3_marsaglia, unit_sphere)
 {
     vec3_t v;
-    vec3_marsaglia(&v);
+    rng_t rng;
+    rng_init(&rng, 1337, 0, 0, RNG_PURPOSE_POPULATE);
+    vec3_marsaglia(&v, &rng);
 
     double magnitude = sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
     cr_assert_float_eq(magnitude, 1.0, 0.00001, "Expected magnitude to be approximately 1.0");
@@ -214,8 +216,10 @@ Test(vec3_marsaglia, random_direction)
 {
     vec3_t v1;
     vec3_t v2;
-    vec3_marsaglia(&v1);
-    vec3_marsaglia(&v2);
+    rng_t rng;
+    rng_init(&rng, 1337, 0, 0, RNG_PURPOSE_POPULATE);
+    vec3_marsaglia(&v1, &rng);
+    vec3_marsaglia(&v2, &rng);
 
     // Check that the generated vectors are not parallel
     cr_assert_neq(v1.x * v2.y - v2.x * v1.y, 0.0, "Expected the vectors to be non-parallel");
@@ -0,0 +1,81 @@
+#include <criterion/criterion.h>
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xyz.h"
+#include "config.h"
+#include "util.h"
+#include "text.h"
+
+/* Format x with both the encoder and printf, and compare */
+static int same_as_printf(const double x)
+{
+    char fast[XYZ_FIELD_MAX + 1];
+    char ref[512];
+    size_t len;
+
+    len = xyz_format_double(fast, x);
+    fast[len] = '\0';
+    snprintf(ref, sizeof(ref), "%lf", x);
+
+    return (!strcmp(fast, ref));
+}
+
+/* XYZ_FORMAT_DOUBLE */
+Test(xyz_format_double, simple_values)
+{
+    cr_assert(same_as_printf(0.0));
+    cr_assert(same_as_printf(1.0));
+    cr_assert(same_as_printf(-1.0));
+    cr_assert(same_as_printf(12.345678));
+    cr_assert(same_as_printf(-987.654321));
+    cr_assert(same_as_printf(1E9));
+}
+
+Test(xyz_format_double, negative_zero)
+{
+    cr_assert(same_as_printf(-0.0));
+    cr_assert(same_as_printf(-1E-9));
+    cr_assert(same_as_printf(-4.9E-7));
+}
+
+Test(xyz_format_double, rounding_ties)
+{
+    cr_assert(same_as_printf(0.0000005));
+    cr_assert(same_as_printf(0.0000015));
+    cr_assert(same_as_printf(2.5E-6));
+    cr_assert(same_as_printf(0.1234565));
+    cr_assert(same_as_printf(-0.9999995));
+}
+
+Test(xyz_format_double, huge_and_special_values)
+{
+    cr_assert(same_as_printf(1E20));
+    cr_assert(same_as_printf(-3.5E21));
+    cr_assert(same_as_printf(INFINITY));
+    cr_assert(same_as_printf(-INFINITY));
+}
+
+Test(xyz_format_double, cut_to_the_field)
+{
+    char out[XYZ_FIELD_MAX];
+
+    cr_assert(xyz_format_double(out, DBL_MAX) == XYZ_FIELD_MAX - 1);
+    cr_assert(xyz_format_double(out, -1E40) == XYZ_FIELD_MAX - 1);
+}
+
+Test(xyz_format_double, random_coordinates)
+{
+    size_t i;
+    double x;
+
+    srand(1337);
+    for (i=0; i<200000; ++i)
+    {
+        x = 200.0 * ((double) rand() / RAND_MAX - 0.5);
+        cr_assert(same_as_printf(x));
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * shmdump.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "stream.h"
+#include "text.h"
+#include "util.h"
+#include "xyz.h"
+
+#define SHMDUMP_POLL_US 1000 /* Time between two looks at an idle stream */
+
+/* Format a frame straight from the segment, returns the number of characters */
+static size_t shmdump_frame(char *out, const stream_t *stream, const double *coord, const uint64_t iteration)
+{
+  const char *symbol;
+  char *cursor;
+  uint64_t atom_nb;
+  size_t i;
+  size_t j;
+
+  atom_nb = stream_header(stream)->atom_nb;
+  cursor = out + snprintf(out, XYZ_HEADER_MAX, "%ld\n%ld\n", atom_nb, iteration);
+  for (i=0; i<atom_nb; ++i)
+  {
+    symbol = stream_symbol(stream, i);
+    for (j=0; j<STREAM_SYMBOL_LEN && symbol[j] != '\0'; ++j)
+    {
+      *(cursor++) = symbol[j];
+    }
+    *(cursor++) = '\t';
+    cursor += xyz_format_double(cursor, coord[3*i]);
+    *(cursor++) = '\t';
+    cursor += xyz_format_double(cursor, coord[3*i + 1]);
+    *(cursor++) = '\t';
+    cursor += xyz_format_double(cursor, coord[3*i + 2]);
+    *(cursor++) = '\n';
+  }
+
+  return ((size_t) (cursor - out));
+}
+
+/* Follow a live stream and write its frames as XYZ
+ * Usage: shmdump <name> [output.xyz] [frames]
+ * Stops once the simulation ends, or after the given number of frames. The
+ * XYZ goes to the standard output unless an output path is given.
+ */
+int main(int argc, char **argv)
+{
+  stream_t stream;
+  FILE *file_out;
+  char *buffer;
+  const double *coord;
+  uint64_t frame;
+  uint64_t frame_nb;
+  uint64_t frame_max;
+  uint64_t dumped;
+  uint64_t missed;
+  uint64_t iteration;
+  double box;
+  size_t len;
+  int ended;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, TEXT_SHMDUMP_USAGE);
+    return (EXIT_FAILURE);
+  }
+
+  if (stream_attach(&stream, argv[1]) == NULL)
+  {
+    stream_detach(&stream);
+    return (retstri(EXIT_FAILURE, TEXT_SHMDUMP_FAILURE, __FILE__, __LINE__));
+  }
+  file_out = stdout;
+  if (argc > 2 && (file_out = fopen(argv[2], "w")) == NULL)
+  {
+    stream_detach(&stream);
+    return (retstri(EXIT_FAILURE, TEXT_SHMDUMP_FAILURE, __FILE__, __LINE__));
+  }
+  frame_max = (argc > 3) ? strtoul(argv[3], NULL, 10) : 0;
+
+  /* symbol, tab, x, tab, y, tab, z, newline */
+  if ((buffer = malloc(XYZ_HEADER_MAX + (stream_header(&stream)->atom_nb)*(STREAM_SYMBOL_LEN + 3*XYZ_FIELD_MAX + 4))) == NULL)
+  {
+    stream_detach(&stream);
+    return (retstri(EXIT_FAILURE, TEXT_SHMDUMP_FAILURE, __FILE__, __LINE__));
+  }
+
+  frame = 0;
+  dumped = 0;
+  missed = 0;
+  while (frame_max == 0 || dumped < frame_max)
+  {
+    /* Whatever was published before the end is still to be read */
+    ended = stream_ended(&stream);
+    frame_nb = stream_frame_nb(&stream);
+    if (frame == frame_nb)
+    {
+      if (ended)
+      {
+        break;
+      }
+      usleep(SHMDUMP_POLL_US);
+      continue;
+    }
+
+    /* Too far behind, the oldest frames are gone */
+    if (frame_nb - frame > stream_header(&stream)->slot_nb)
+    {
+      missed += frame_nb - stream_header(&stream)->slot_nb - frame;
+      frame = frame_nb - stream_header(&stream)->slot_nb;
+    }
+
+    /* Keep the text only if the frame held still while it was formatted */
+    len = 0;
+    if ((coord = stream_read_begin(&stream, frame, &iteration, &box)) != NULL)
+    {
+      len = shmdump_frame(buffer, &stream, coord, iteration);
+    }
+    if (coord == NULL || !stream_read_end(&stream, frame))
+    {
+      ++missed;
+      ++frame;
+      continue;
+    }
+    if (fwrite(buffer, 1, len, file_out) != len)
+    {
+      free(buffer);
+      stream_detach(&stream);
+      return (retstri(EXIT_FAILURE, TEXT_SHMDUMP_FAILURE, __FILE__, __LINE__));
+    }
+    ++dumped;
+    ++frame;
+  }
+
+  fprintf(stderr, TEXT_SHMDUMP_SUCCESS, dumped, stream_header(&stream)->atom_nb, missed);
+
+  free(buffer);
+  stream_detach(&stream);
+  if (file_out != stdout)
+  {
+    fclose(file_out);
+  }
+
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,90 @@
+/*
+ * stc2xyz.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "stc.h"
+#include "text.h"
+#include "util.h"
+
+/* Convert a compressed STC trajectory back to XYZ
+ * Usage: stc2xyz <input.stc> [output.xyz]
+ * The XYZ goes to the standard output unless an output path is given.
+ */
+int main(int argc, char **argv)
+{
+  size_t i;
+  FILE *file_in;
+  FILE *file_out;
+  uint64_t atom_nb;
+  uint64_t iteration;
+  uint64_t frame_nb;
+  double precision;
+  double box;
+  double *coord;
+  char *symbol;
+  char name[STC_SYMBOL_LEN + 1];
+
+  if (argc < 2)
+  {
+    fprintf(stderr, TEXT_STC2XYZ_USAGE);
+    return (EXIT_FAILURE);
+  }
+
+  if ((file_in = fopen(argv[1], "rb")) == NULL)
+  {
+    return (retstri(EXIT_FAILURE, TEXT_STC2XYZ_FAILURE, __FILE__, __LINE__));
+  }
+  file_out = stdout;
+  if (argc > 2 && (file_out = fopen(argv[2], "w")) == NULL)
+  {
+    fclose(file_in);
+    return (retstri(EXIT_FAILURE, TEXT_STC2XYZ_FAILURE, __FILE__, __LINE__));
+  }
+
+  if (stc_read_header(file_in, &atom_nb, &precision, &symbol) == NULL)
+  {
+    fclose(file_in);
+    return (retstri(EXIT_FAILURE, TEXT_STC2XYZ_FAILURE, __FILE__, __LINE__));
+  }
+
+  if ((coord = malloc(sizeof(double) * 3 * (atom_nb + 1))) == NULL)
+  {
+    free(symbol);
+    fclose(file_in);
+    return (retstri(EXIT_FAILURE, TEXT_STC2XYZ_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* Same layout as the XYZ files written by senpai */
+  frame_nb = 0;
+  name[STC_SYMBOL_LEN] = '\0';
+  while (stc_read_frame(file_in, &iteration, &box, coord, atom_nb, precision) != NULL)
+  {
+    fprintf(file_out, "%ld\n%ld\n", atom_nb, iteration);
+    for (i=0; i<atom_nb; ++i)
+    {
+      memcpy(name, symbol + i*STC_SYMBOL_LEN, STC_SYMBOL_LEN);
+      fprintf(file_out, "%s\t%lf\t%lf\t%lf\n", name, coord[3*i], coord[3*i + 1], coord[3*i + 2]);
+    }
+    ++frame_nb;
+  }
+
+  fprintf(stderr, TEXT_STC2XYZ_SUCCESS, frame_nb, atom_nb, precision);
+
+  free(coord);
+  free(symbol);
+  fclose(file_in);
+  if (file_out != stdout)
+  {
+    fclose(file_out);
+  }
+
+  return (EXIT_SUCCESS);
+}
@@ -0,0 +1,102 @@
+/*
+ * trajslice.c
+ *
+ * Licensed under GPLv3 license
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "dcd.h"
+#include "frames.h"
+#include "text.h"
+#include "util.h"
+
+/* Extract a range of frames from an indexed trajectory, in the same format
+ * Usage: trajslice <input> <output> <first> [last] [stride]
+ * Frames are numbered from 0, last is included and defaults to the last frame.
+ * Only the header and the selected frames are read.
+ */
+int main(int argc, char **argv)
+{
+  frames_t frames;
+  FILE *file_out;
+  uint64_t first;
+  uint64_t last;
+  uint64_t stride;
+  uint64_t frame;
+  uint64_t frame_nb;
+  uint64_t offset;
+  uint64_t len;
+  int32_t count;
+
+  if (argc < 4)
+  {
+    fprintf(stderr, TEXT_TRAJSLICE_USAGE);
+    return (EXIT_FAILURE);
+  }
+
+  if (frames_init(&frames, argv[1]) == NULL)
+  {
+    frames_clean(&frames);
+    return (retstri(EXIT_FAILURE, TEXT_TRAJSLICE_FAILURE, __FILE__, __LINE__));
+  }
+
+  first = strtoul(argv[3], NULL, 10);
+  last = (argc > 4) ? strtoul(argv[4], NULL, 10) : frames.frame_nb - 1;
+  stride = (argc > 5) ? strtoul(argv[5], NULL, 10) : 1;
+  if (last >= frames.frame_nb)
+  {
+    last = frames.frame_nb - 1;
+  }
+  if (frames.frame_nb == 0 || first > last || stride == 0 ||
+      (file_out = fopen(argv[2], "wb")) == NULL)
+  {
+    frames_clean(&frames);
+    return (retstri(EXIT_FAILURE, TEXT_TRAJSLICE_FAILURE, __FILE__, __LINE__));
+  }
+
+  /* The header is whatever comes before the first frame */
+  frame_nb = 0;
+  if (frames_copy(&frames, file_out, 0, frames.entry[0].offset) == NULL)
+  {
+    fclose(file_out);
+    frames_clean(&frames);
+    return (retstri(EXIT_FAILURE, TEXT_TRAJSLICE_FAILURE, __FILE__, __LINE__));
+  }
+
+  for (frame=first; frame<=last; frame+=stride)
+  {
+    if (frames_span(&frames, frame, &offset, &len) == NULL ||
+        frames_copy(&frames, file_out, offset, len) == NULL)
+    {
+      fclose(file_out);
+      frames_clean(&frames);
+      return (retstri(EXIT_FAILURE, TEXT_TRAJSLICE_FAILURE, __FILE__, __LINE__));
+    }
+    ++frame_nb;
+  }
+
+  /* DCD headers announce how many frames follow */
+  if (frames.format == OUTPUT_FORMAT_DCD)
+  {
+    count = (int32_t) frame_nb;
+    if (fseek(file_out, DCD_OFFSET_NSET, SEEK_SET) ||
+        fwrite(&count, sizeof(int32_t), 1, file_out) != 1)
+    {
+      fclose(file_out);
+      frames_clean(&frames);
+      return (retstri(EXIT_FAILURE, TEXT_TRAJSLICE_FAILURE, __FILE__, __LINE__));
+    }
+  }
+
+  fclose(file_out);
+  fprintf(stderr, TEXT_TRAJSLICE_SUCCESS, frame_nb, frames.frame_nb);
+  frames_clean(&frames);
+
+  return (EXIT_SUCCESS);
+}